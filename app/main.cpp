@@ -0,0 +1,45 @@
+#include "mainwindow.h"
+#include <QApplication>
+#include "settings.h"
+#include "modbustimeline.h"
+#include "modbusconfcache.h"
+#include "modbusimagecache.h"
+#include <QStandardPaths>
+#include <QDir>
+
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+
+    a.setOrganizationName(QStringLiteral("artem.lab"));
+    a.setApplicationName(QStringLiteral("qmidbus_boot"));
+
+    Settings::get().read();
+
+    // Переподключение без чтения конфигурации загрузчика.
+    ModbusConfCache::get().setEnabled(true);
+
+    // Записываются только страницы, изменённые с прошлой записи;
+    // без каталога данных образы хранятся до конца сеанса.
+    QString data_dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    if(data_dir.isEmpty() || !ModbusImageCache::get().setDirectory(QDir(data_dir).filePath(QStringLiteral("images")))){
+        ModbusImageCache::get().setDirectory(QString());
+    }
+    ModbusImageCache::get().setEnabled(true);
+
+    // Файл временной шкалы сеанса для Perfetto.
+    QString timeline_file = QString::fromLocal8Bit(qgetenv("QMODBUS_BOOT_TIMELINE"));
+    if(!timeline_file.isEmpty()) ModbusTimeline::get().setEnabled(true);
+
+    MainWindow w;
+    w.show();
+
+    int res = a.exec();
+
+    Settings::get().write();
+
+    if(!timeline_file.isEmpty()) ModbusTimeline::get().save(timeline_file);
+
+    return res;
+}
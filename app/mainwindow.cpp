@@ -0,0 +1,751 @@
+#include "mainwindow.h"
+#include "ui_mainwindow.h"
+#include <QApplication>
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QByteArray>
+#include <QDebug>
+#include "settings.h"
+#include "settingsdlg.h"
+#include "modbusnet.h"
+#include "modbusdev.h"
+#include "modbusreg.h"
+#include "modbusfile.h"
+#include "modbusfirmware.h"
+#include "modbuslinktest.h"
+#include "modbusrtutransport.h"
+#include "modbusimagewatcher.h"
+#include <QTimer>
+
+
+#define STATUSBAR_TIME 5000
+
+
+MainWindow::MainWindow(QWidget *parent) :
+    QMainWindow(parent),
+    ui(new Ui::MainWindow)
+{
+    ui->setupUi(this);
+
+    settingsDlg = nullptr;
+    write_delta_pages = 0;
+    write_delta_total = 0;
+    watch_write = false;
+    watch_pending = false;
+    write_addr = 0;
+    written_addr = 0;
+
+    modbus_net = new ModbusNet(this);
+    modbus_dev = new ModbusDev(modbus_net, Settings::get().modbusSlaveAddress(), this);
+    modbus_fw = new ModbusFirmware(modbus_dev);
+    link_test = new ModbusLinkTest(modbus_dev);
+
+    connect(modbus_net, &ModbusNet::errorOccured, this, &MainWindow::modbus_net_error_occured);
+    connect(modbus_net, &ModbusNet::stateChanged, this, &MainWindow::modbus_net_state_changed);
+    connect(modbus_net, &ModbusNet::connectedToNet, this, &MainWindow::connectedToNet);
+    connect(modbus_net, &ModbusNet::disconnectedFromNet, this, &MainWindow::disconnectedFromNet);
+
+    connect(modbus_fw, &ModbusFirmware::progressSetMin, ui->prbProgress, &QProgressBar::setMinimum);
+    connect(modbus_fw, &ModbusFirmware::progressSetMax, ui->prbProgress, &QProgressBar::setMaximum);
+    connect(modbus_fw, &ModbusFirmware::progressChanged, ui->prbProgress, &QProgressBar::setValue);
+    connect(modbus_fw, &ModbusFirmware::estimateChanged, this, &MainWindow::flashEstimateChanged);
+
+    connect(modbus_fw, &ModbusFirmware::confReaded, this, &MainWindow::confReaded);
+    connect(modbus_fw, &ModbusFirmware::confReadErrorOccured, this, &MainWindow::confReadError);
+
+    connect(modbus_fw, &ModbusFirmware::dataReaded, this, &MainWindow::readFlashDone);
+    connect(modbus_fw, &ModbusFirmware::dataReadErrorOccured, this, &MainWindow::readFlashFail);
+    connect(modbus_fw, &ModbusFirmware::dataReadCanceled, this, &MainWindow::readFlashCanceled);
+
+    connect(modbus_fw, &ModbusFirmware::deltaPlanned, this, &MainWindow::writeDeltaPlanned);
+    connect(modbus_fw, &ModbusFirmware::deltaUnavailable, this, &MainWindow::writeDeltaUnavailable);
+    connect(modbus_fw, &ModbusFirmware::dataWrited, this, &MainWindow::writeFlashDone);
+    connect(modbus_fw, &ModbusFirmware::dataWriteErrorOccured, this, &MainWindow::writeFlashFail);
+    connect(modbus_fw, &ModbusFirmware::dataWriteCanceled, this, &MainWindow::writeFlashCanceled);
+
+    connect(modbus_fw, &ModbusFirmware::dataVerified, this, &MainWindow::verifyFlashDone);
+    connect(modbus_fw, &ModbusFirmware::dataVerifyErrorOccured, this, &MainWindow::verifyFlashFail);
+    connect(modbus_fw, &ModbusFirmware::dataVerifyCanceled, this, &MainWindow::verifyFlashCanceled);
+
+    image_watcher = new ModbusImageWatcher(this);
+    connect(image_watcher, &ModbusImageWatcher::imageChanged, this, &MainWindow::watchImageChanged);
+
+    connect(link_test, &ModbusLinkTest::progressSetMax, ui->prbProgress, &QProgressBar::setMaximum);
+    connect(link_test, &ModbusLinkTest::progressChanged, ui->prbProgress, &QProgressBar::setValue);
+    connect(link_test, &ModbusLinkTest::done, this, &MainWindow::linkTestDone);
+    connect(link_test, &ModbusLinkTest::errorOccured, this, &MainWindow::linkTestError);
+
+    modbus_net->setup();
+    modbus_fw->setTargetBaud(Settings::get().serialFlashBaud());
+
+    refreshUi();
+}
+
+MainWindow::~MainWindow()
+{
+    delete link_test;
+    delete modbus_fw;
+    delete modbus_dev;
+    delete modbus_net;
+
+    if(settingsDlg) delete settingsDlg;
+
+    delete ui;
+}
+
+void MainWindow::modbus_net_state_changed(QModbusDevice::State state)
+{
+    QString stateStr;
+
+    switch(state){
+    case QModbusDevice::UnconnectedState:
+        stateStr = tr("Разъединено");
+        break;
+    case QModbusDevice::ConnectingState:
+        stateStr = tr("Соединение...");
+        break;
+    case QModbusDevice::ConnectedState:
+        stateStr = tr("Соединено");
+        break;
+    case QModbusDevice::ClosingState:
+        stateStr = tr("Разъединение...");
+        break;
+    default:
+        break;
+    }
+
+    statusBar()->showMessage(stateStr, STATUSBAR_TIME);
+
+    refreshUi();
+}
+
+void MainWindow::modbus_net_error_occured(ModbusErr error)
+{
+    statusBar()->showMessage(modbusErrorToString(error.modbusError()), STATUSBAR_TIME);
+
+    refreshUi();
+}
+
+void MainWindow::refreshUi()
+{
+    bool connected = modbus_net->isConnectedToNet();
+    bool fw_updated = modbus_fw->isConfReaded();
+    bool fw_exec = modbus_fw->isExecuting() || link_test->isExecuting();
+
+    bool fw_ready = connected && fw_updated;
+
+    ui->actSettings->setEnabled(!connected);
+    ui->actConnect->setEnabled(!connected);
+    ui->actDisconnect->setEnabled(connected);
+    ui->actLinkTest->setEnabled(connected && !fw_exec);
+
+    /*ui->leAddress->setEnabled(fw_ready && !fw_exec);
+    ui->sbSize->setEnabled(fw_ready && !fw_exec);
+    ui->pbSelectFile->setEnabled(fw_ready && !fw_exec);
+    ui->leFileName->setEnabled(fw_ready && !fw_exec);*/
+
+    ui->pbRead->setEnabled(fw_ready && !fw_exec);
+    ui->pbWrite->setEnabled(fw_ready && !fw_exec);
+    ui->pbVerify->setEnabled(fw_ready && !fw_exec);
+    ui->pbCancel->setEnabled(fw_ready && fw_exec);
+
+    ui->pbRun->setEnabled(fw_ready && !fw_exec);
+
+    if(!fw_exec) ui->prbProgress->setFormat(QStringLiteral("%p%"));
+
+    // Образ изменился во время другой операции.
+    if(watch_pending && fw_ready && !fw_exec){
+        QTimer::singleShot(0, this, &MainWindow::watchPendingWrite);
+    }
+}
+
+QString MainWindow::modbusErrorToString(QModbusDevice::Error err) const
+{
+    QString res;
+
+    switch(err){
+    case QModbusDevice::NoError:
+        res = tr("Нет ошибки");
+        break;
+    case QModbusDevice::ReadError:
+        res = tr("Ошибка чтения");
+        break;
+    case QModbusDevice::WriteError:
+        res = tr("Ошибка записи");
+        break;
+    case QModbusDevice::ConnectionError:
+        res = tr("Ошибка соединения");
+        break;
+    case QModbusDevice::ConfigurationError:
+        res = tr("Ошибка конфигурации");
+        break;
+    case QModbusDevice::TimeoutError:
+        res = tr("Превышено время ожидания");
+        break;
+    case QModbusDevice::ProtocolError:
+        res = tr("Ошибка протокола");
+        break;
+    case QModbusDevice::ReplyAbortedError:
+        res = tr("Ответ отменён");
+        break;
+    default:
+    case QModbusDevice::UnknownError:
+        res = tr("Неизвестная ошибка");
+        break;
+    }
+
+    return res;
+}
+
+QString MainWindow::makeErrorString(ModbusErr err) const
+{
+    QString res;
+
+    res += tr("%1: %2")
+            .arg(err.sanderName())
+            .arg(err.errorStr());
+
+    if(err.type() == ModbusErr::Modbus){
+        res += tr("\nОшибка Modbus:\n"
+                  "Код исключения: %1\n"
+                  "Ошибка: \"%2\" (%3)\n"
+                  "Текст ошибки: %4")
+                .arg(static_cast<uint>(err.modbusException()))
+                .arg(modbusErrorToString(err.modbusError()))
+                .arg(static_cast<uint>(err.modbusError()))
+                .arg(err.modbusErrorStr());
+    }
+
+    return res;
+}
+
+bool MainWindow::getAddrSize(quint32* address, quint32* size)
+{
+    int addr_base = 10;
+    bool addr_ok = false;
+
+    quint32 flash_addr = 0;
+    quint32 flash_size = 0;
+
+    if(address){
+        QString addr_text = ui->leAddress->text();
+        if(addr_text.startsWith(QStringLiteral("0x")) || addr_text.startsWith(QStringLiteral("0X"))){
+            addr_base = 16;
+        }else{
+            addr_base = 10;
+        }
+        flash_addr = addr_text.toUInt(&addr_ok, addr_base);
+        if(!addr_ok){
+            QMessageBox::critical(this, tr("Ошибка"), tr("Неправильный адрес!"));
+            return false;
+        }
+        *address = flash_addr;
+    }
+
+    if(size){
+        flash_size = ui->sbSize->value();
+        if(!flash_size){
+            QMessageBox::critical(this, tr("Ошибка"), tr("Неправильный размер!"));
+            return false;
+        }
+        *size = flash_size;
+    }
+
+    return true;
+}
+
+bool MainWindow::readImageFile(const QString& title, QByteArray* data)
+{
+    QFile file(ui->leFileName->text());
+    if(!file.open(QIODevice::ReadOnly)){
+        QMessageBox::critical(this, title, tr("Невозможно открыть файл прошивки!"));
+        return false;
+    }
+
+    if(file.size() == 0){
+        QMessageBox::critical(this, title, tr("Файл пуст!"));
+        return false;
+    }
+
+    *data = file.readAll();
+    if(data->size() != file.size()){
+        QMessageBox::critical(this, title, tr("Ошибка чтения файла прошивки!"));
+        return false;
+    }
+
+    return true;
+}
+
+void MainWindow::on_actQuit_triggered()
+{
+    qApp->quit();
+}
+
+void MainWindow::on_actSettings_triggered()
+{
+    if(!settingsDlg) settingsDlg = new SettingsDlg(this);
+
+    settingsDlg->loadSettings();
+    if(settingsDlg->exec()){
+        settingsDlg->storeSettings();
+
+        modbus_net->setup();
+
+        Settings& settings = Settings::get();
+
+        modbus_dev->setSlaveAddress(settings.modbusSlaveAddress());
+        modbus_fw->setTargetBaud(settings.serialFlashBaud());
+
+        refreshUi();
+    }
+}
+
+void MainWindow::on_actConnect_triggered()
+{
+    modbus_net->connectToNet();
+}
+
+void MainWindow::on_actDisconnect_triggered()
+{
+    modbus_net->disconnectFromNet();
+}
+
+void MainWindow::on_actLinkTest_triggered()
+{
+    ui->prbProgress->setMinimum(0);
+
+    if(!link_test->exec()){
+        QMessageBox::critical(this, tr("Проверка линии"), tr("Невозможно начать проверку линии!"));
+        return;
+    }
+
+    statusBar()->showMessage(tr("Проверка линии..."), STATUSBAR_TIME);
+
+    refreshUi();
+}
+
+void MainWindow::on_pbSelectFile_clicked()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Файл прошивки"),
+                                                    QFileInfo(ui->leFileName->text()).absoluteFilePath(),
+                                                    tr("Двоичный (*.bin);;Все файлы (*)"),
+                                                    nullptr, QFileDialog::DontConfirmOverwrite);
+    if(filename.isEmpty()) return;
+
+    ui->leFileName->setText(filename);
+}
+
+void MainWindow::on_pbRead_clicked()
+{
+    if(ui->leFileName->text().isEmpty()){
+        on_pbSelectFile_clicked();
+        if(ui->leFileName->text().isEmpty()){
+            QMessageBox::critical(this, tr("Чтение прошивки"), tr("Неправильное имя файла!"));
+            return;
+        }
+    }
+
+    quint32 flash_addr, flash_size;
+
+    if(!getAddrSize(&flash_addr, &flash_size)) return;
+
+    if(!modbus_fw->readData(flash_addr, flash_size)){
+        QMessageBox::critical(this, tr("Чтение прошивки"), tr("Невозможно начать чтение!"));
+        return;
+    }
+
+    refreshUi();
+}
+
+void MainWindow::on_pbWrite_clicked()
+{
+    if(ui->leFileName->text().isEmpty()){
+        on_pbSelectFile_clicked();
+        if(ui->leFileName->text().isEmpty()){
+            QMessageBox::critical(this, tr("Запись прошивки"), tr("Неправильное имя файла!"));
+            return;
+        }
+    }
+
+    quint32 flash_addr;
+
+    if(!getAddrSize(&flash_addr, nullptr)) return;
+
+    QByteArray data;
+    if(!readImageFile(tr("Запись прошивки"), &data)) return;
+
+    write_delta_pages = 0;
+    write_delta_total = 0;
+    write_full_reason.clear();
+    write_addr = flash_addr;
+    write_image = data;
+    written_image.clear();
+
+    if(!modbus_fw->writeData(flash_addr, data)){
+        QMessageBox::critical(this, tr("Запись прошивки"), tr("Невозможно начать запись!"));
+        return;
+    }
+
+    refreshUi();
+}
+
+void MainWindow::on_pbVerify_clicked()
+{
+    if(ui->leFileName->text().isEmpty()){
+        on_pbSelectFile_clicked();
+        if(ui->leFileName->text().isEmpty()){
+            QMessageBox::critical(this, tr("Проверка прошивки"), tr("Неправильное имя файла!"));
+            return;
+        }
+    }
+
+    quint32 flash_addr;
+
+    if(!getAddrSize(&flash_addr, nullptr)) return;
+
+    QByteArray data;
+    if(!readImageFile(tr("Проверка прошивки"), &data)) return;
+
+    // Все расхождения, чтобы показать их число;
+    // по CRC читаются только несовпавшие страницы.
+    if(!modbus_fw->verifyCrc(flash_addr, data, false)){
+        QMessageBox::critical(this, tr("Проверка прошивки"), tr("Невозможно начать проверку!"));
+        return;
+    }
+
+    refreshUi();
+}
+
+void MainWindow::on_pbCancel_clicked()
+{
+    modbus_fw->cancel();
+}
+
+void MainWindow::on_pbRun_clicked()
+{
+    modbus_fw->runApp();
+}
+
+void MainWindow::on_actWatch_toggled(bool checked)
+{
+    watch_pending = false;
+
+    if(!checked){
+        image_watcher->stop();
+        statusBar()->showMessage(tr("Слежение за файлом остановлено"), STATUSBAR_TIME);
+        return;
+    }
+
+    if(ui->leFileName->text().isEmpty()) on_pbSelectFile_clicked();
+
+    if(ui->leFileName->text().isEmpty() || !image_watcher->start(ui->leFileName->text())){
+        QMessageBox::critical(this, tr("Слежение за файлом"), tr("Невозможно следить за файлом прошивки!"));
+        ui->actWatch->setChecked(false);
+        return;
+    }
+
+    statusBar()->showMessage(tr("Слежение за %1").arg(QFileInfo(image_watcher->fileName()).fileName()), STATUSBAR_TIME);
+}
+
+void MainWindow::watchImageChanged(const QByteArray& image)
+{
+    Q_UNUSED(image);
+
+    watch_pending = true;
+
+    bool fw_ready = modbus_net->isConnectedToNet() && modbus_fw->isConfReaded();
+    bool fw_exec = modbus_fw->isExecuting() || link_test->isExecuting();
+
+    if(fw_ready && !fw_exec) watchPendingWrite();
+}
+
+void MainWindow::watchPendingWrite()
+{
+    if(!watch_pending || !image_watcher->isWatching()) return;
+    if(modbus_fw->isExecuting() || link_test->isExecuting()) return;
+
+    watch_pending = false;
+
+    quint32 flash_addr;
+
+    if(!getAddrSize(&flash_addr, nullptr)) return;
+
+    write_delta_pages = 0;
+    write_delta_total = 0;
+    write_full_reason.clear();
+    write_addr = flash_addr;
+    write_image = image_watcher->image();
+
+    // После прерванной записи память устройства неизвестна.
+    QByteArray base = written_image;
+    written_image.clear();
+
+    bool res = base.isEmpty() ? modbus_fw->writeData(write_addr, write_image) :
+                                modbus_fw->writeDataDelta(write_addr, write_image, written_addr, base);
+
+    if(!res){
+        statusBar()->showMessage(tr("Невозможно начать запись!"), STATUSBAR_TIME);
+        return;
+    }
+
+    watch_write = true;
+
+    statusBar()->showMessage(tr("Запись изменённой прошивки..."), STATUSBAR_TIME);
+
+    refreshUi();
+}
+
+void MainWindow::confReaded()
+{
+    QString msg = tr("Объём памяти: %1 кбайт").arg(modbus_fw->flashSize());
+
+    if(modbus_fw->isConfCached()){
+        msg += tr(" (сохранённая конфигурация)");
+    }
+
+    if(modbus_fw->negotiatedBaud() != 0){
+        msg += tr(", скорость: %1 бод").arg(modbus_fw->negotiatedBaud());
+    }else if(modbus_fw->targetBaud() != 0 && modbus_fw->targetBaud() != modbus_net->baud()){
+        msg += tr(", скорость %1 бод не согласована").arg(modbus_fw->targetBaud());
+    }
+
+    statusBar()->showMessage(msg, STATUSBAR_TIME);
+    refreshUi();
+}
+
+void MainWindow::confReadError(ModbusErr error)
+{
+    QMessageBox::critical(this, tr("Ошибка чтения конфигурации прошивки"), makeErrorString(error));
+
+    refreshUi();
+}
+
+void MainWindow::readFlashDone()
+{
+    QFile file(ui->leFileName->text());
+    if(!file.open(QIODevice::WriteOnly)){
+        QMessageBox::critical(this, tr("Ошибка"), tr("Невозможно открыть файл для записи прошивки!"));
+        return;
+    }
+
+    QByteArray data = modbus_fw->data();
+    if(file.write(data.data(), data.size()) != data.size()){
+        QMessageBox::critical(this, tr("Ошибка"), tr("Ошибка записи в файл прошивки!"));
+        return;
+    }
+
+    QMessageBox::information(this, tr("Завершено"), tr("Прошивка успешно прочитана!"));
+
+    refreshUi();
+}
+
+void MainWindow::readFlashFail(ModbusErr error)
+{
+    QMessageBox::critical(this, tr("Ошибка чтения"), makeErrorString(error));
+
+    // Устройство заменено - конфигурация читается заново.
+    if(!modbus_fw->isConfReaded() && modbus_net->isConnectedToNet()){
+        modbus_fw->confRead();
+    }
+
+    refreshUi();
+}
+
+void MainWindow::readFlashCanceled()
+{
+    QMessageBox::warning(this, tr("Отменено"), tr("Чтение прошивки было прекращено!"));
+
+    refreshUi();
+}
+
+void MainWindow::writeDeltaPlanned(int pages, int total)
+{
+    write_delta_pages = pages;
+    write_delta_total = total;
+}
+
+void MainWindow::writeDeltaUnavailable(const QString& reason)
+{
+    write_full_reason = reason;
+}
+
+void MainWindow::writeFlashDone()
+{
+    written_addr = write_addr;
+    written_image = write_image;
+    write_image.clear();
+
+    // Запись по слежению - без диалога, чтобы не прерывать работу.
+    if(watch_write){
+        watch_write = false;
+
+        QString msg = tr("Прошивка записана");
+        if(write_delta_total != 0){
+            msg += tr(", изменённых страниц: %1 из %2").arg(write_delta_pages).arg(write_delta_total);
+        }else if(!write_full_reason.isEmpty()){
+            msg += tr(" целиком: %1").arg(write_full_reason);
+        }
+
+        statusBar()->showMessage(msg, STATUSBAR_TIME);
+
+        refreshUi();
+        return;
+    }
+
+    QString msg = tr("Прошивка успешно записана!");
+
+    if(write_delta_total != 0){
+        msg += tr("\nИзменённых страниц: %1 из %2.").arg(write_delta_pages).arg(write_delta_total);
+    }
+
+    QMessageBox::information(this, tr("Завершено"), msg);
+
+    refreshUi();
+}
+
+void MainWindow::writeFlashFail(ModbusErr error)
+{
+    write_image.clear();
+
+    if(watch_write){
+        watch_write = false;
+        statusBar()->showMessage(tr("Ошибка записи: %1").arg(error.errorStr()), STATUSBAR_TIME);
+    }else{
+        QMessageBox::critical(this, tr("Ошибка записи"), makeErrorString(error));
+    }
+
+    // Устройство заменено - конфигурация читается заново.
+    if(!modbus_fw->isConfReaded() && modbus_net->isConnectedToNet()){
+        modbus_fw->confRead();
+    }
+
+    refreshUi();
+}
+
+void MainWindow::writeFlashCanceled()
+{
+    watch_write = false;
+    write_image.clear();
+
+    QMessageBox::warning(this, tr("Отменено"), tr("Запись прошивки была прекращена!"));
+
+    refreshUi();
+}
+
+void MainWindow::verifyFlashDone(bool match)
+{
+    if(match){
+        QMessageBox::information(this, tr("Завершено"), tr("Прошивка совпадает с файлом!"));
+        refreshUi();
+        return;
+    }
+
+    const QVector<ModbusFirmware::Mismatch>& mismatches = modbus_fw->mismatches();
+
+    quint32 bytes = 0;
+    for(const ModbusFirmware::Mismatch& m: mismatches) bytes += m.size;
+
+    QString msg = tr("Прошивка не совпадает с файлом: %1 участков, %2 байт.").arg(mismatches.size()).arg(bytes);
+    if(!mismatches.isEmpty()){
+        msg += tr("\nПервый участок: 0x%1, %2 байт.")
+                .arg(mismatches.first().address, 8, 16, QLatin1Char('0'))
+                .arg(mismatches.first().size);
+    }
+
+    QMessageBox::warning(this, tr("Проверка прошивки"), msg);
+
+    refreshUi();
+}
+
+void MainWindow::verifyFlashFail(ModbusErr error)
+{
+    QMessageBox::critical(this, tr("Ошибка проверки"), makeErrorString(error));
+
+    // Устройство заменено - конфигурация читается заново.
+    if(!modbus_fw->isConfReaded() && modbus_net->isConnectedToNet()){
+        modbus_fw->confRead();
+    }
+
+    refreshUi();
+}
+
+void MainWindow::verifyFlashCanceled()
+{
+    QMessageBox::warning(this, tr("Отменено"), tr("Проверка прошивки была прекращена!"));
+
+    refreshUi();
+}
+
+void MainWindow::flashEstimateChanged(double eta, double bytes_per_s)
+{
+    int secs = qRound(eta);
+
+    ui->prbProgress->setFormat(tr("%p% (осталось %1:%2, %3 байт/с)")
+                               .arg(secs / 60)
+                               .arg(secs % 60, 2, 10, QLatin1Char('0'))
+                               .arg(qRound(bytes_per_s)));
+}
+
+void MainWindow::linkTestDone()
+{
+    const ModbusLinkTest::Result& res = link_test->result();
+
+    Settings& settings = Settings::get();
+
+    Settings::LinkTuning tuning;
+    tuning.baud = settings.serailPortBaud();
+    tuning.timeout = res.timeout;
+    tuning.frame_delay = res.frame_delay;
+    tuning.retries = res.retries;
+
+    settings.setLinkTuning(settings.serialPortName(), tuning);
+
+    modbus_net->setLinkParameters(res.timeout, res.retries, res.frame_delay);
+
+    QMessageBox::information(this, tr("Проверка линии"),
+                             tr("Запросов: %1, потеряно: %2\n"
+                                "RTT: %3 - %4 мкс, реакция: %5 мкс\n\n"
+                                "Подобранные параметры для порта %6:\n"
+                                "Таймаут: %7 мс\n"
+                                "Задержка кадра: %8 мкс\n"
+                                "Повторов: %9")
+                             .arg(res.probes).arg(res.lost)
+                             .arg(res.rtt_min).arg(res.rtt_max).arg(res.turnaround)
+                             .arg(settings.serialPortName())
+                             .arg(res.timeout).arg(res.frame_delay).arg(res.retries));
+
+    refreshUi();
+}
+
+void MainWindow::linkTestError(ModbusErr error)
+{
+    QMessageBox::critical(this, tr("Ошибка проверки линии"), makeErrorString(error));
+
+    refreshUi();
+}
+
+void MainWindow::connectedToNet()
+{
+    statusBar()->showMessage(tr("Чтение конфигурации памяти..."), STATUSBAR_TIME);
+
+    ModbusRtuTransport* rtu = qobject_cast<ModbusRtuTransport*>(modbus_net->transport());
+    if(rtu && !rtu->serialTuning().report().isEmpty()){
+        statusBar()->showMessage(tr("Порт: %1").arg(rtu->serialTuning().report().join(QStringLiteral("; "))),
+                                 STATUSBAR_TIME);
+    }
+
+    modbus_fw->confRead();
+
+    refreshUi();
+}
+
+void MainWindow::disconnectedFromNet()
+{
+    // Устройство могут заменить.
+    written_image.clear();
+
+    refreshUi();
+}
@@ -0,0 +1,106 @@
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include <QMainWindow>
+#include "modbusnet.h"
+#include "modbuserr.h"
+
+class SettingsDlg;
+class ModbusDev;
+class ModbusReg;
+class ModbusFirmware;
+class ModbusLinkTest;
+class ModbusImageWatcher;
+
+namespace Ui {
+class MainWindow;
+}
+
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit MainWindow(QWidget *parent = 0);
+    ~MainWindow();
+
+private slots:
+    void modbus_net_state_changed(QModbusDevice::State state);
+    void modbus_net_error_occured(ModbusErr error);
+    void on_actQuit_triggered();
+    void on_actSettings_triggered();
+    void on_actConnect_triggered();
+    void on_actDisconnect_triggered();
+    void on_actLinkTest_triggered();
+
+    void on_pbSelectFile_clicked();
+    void on_pbRead_clicked();
+    void on_pbWrite_clicked();
+    void on_pbVerify_clicked();
+    void on_pbCancel_clicked();
+    void on_pbRun_clicked();
+    void on_actWatch_toggled(bool checked);
+
+    void watchImageChanged(const QByteArray& image);
+    void watchPendingWrite();
+
+    void confReaded();
+    void confReadError(ModbusErr error);
+
+    void readFlashDone();
+    void readFlashFail(ModbusErr error);
+    void readFlashCanceled();
+
+    void writeDeltaPlanned(int pages, int total);
+    void writeDeltaUnavailable(const QString& reason);
+    void writeFlashDone();
+    void writeFlashFail(ModbusErr error);
+    void writeFlashCanceled();
+
+    void verifyFlashDone(bool match);
+    void verifyFlashFail(ModbusErr error);
+    void verifyFlashCanceled();
+
+    void flashEstimateChanged(double eta, double bytes_per_s);
+
+    void linkTestDone();
+    void linkTestError(ModbusErr error);
+
+    void connectedToNet();
+    void disconnectedFromNet();
+private:
+    void refreshUi();
+
+    QString modbusErrorToString(QModbusDevice::Error err) const;
+    QString makeErrorString(ModbusErr err) const;
+
+    bool getAddrSize(quint32* address, quint32* size);
+    bool readImageFile(const QString& title, QByteArray* data);
+
+    Ui::MainWindow *ui;
+    SettingsDlg* settingsDlg;
+    ModbusNet* modbus_net;
+    ModbusDev* modbus_dev;
+    ModbusFirmware* modbus_fw;
+    ModbusLinkTest* link_test;
+
+    // Слежение за файлом: запись изменённых страниц после сборки.
+    ModbusImageWatcher* image_watcher;
+    bool watch_write;
+    bool watch_pending;
+
+    // Записываемый образ и последний записанный в сеансе,
+    // по нему слежение пишет изменённые страницы.
+    quint32 write_addr;
+    QByteArray write_image;
+    quint32 written_addr;
+    QByteArray written_image;
+
+    // Запись по кэшу образов: страниц записано из всех, 0 - весь образ.
+    int write_delta_pages;
+    int write_delta_total;
+    // Причина записи всего образа, пусто - не сообщалась.
+    QString write_full_reason;
+};
+
+#endif // MAINWINDOW_H
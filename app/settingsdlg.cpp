@@ -31,6 +31,14 @@ void SettingsDlg::loadSettings()
 
     ui->cbParity->setCurrentIndex(parityToIndex(settings.serialPortParity()));
     ui->cbStopBits->setCurrentIndex(stopBitsToIndex(settings.serialPortStopBits()));
+    ui->cbLowLatency->setChecked(settings.serialLowLatency());
+    ui->sbLatencyTimer->setValue(settings.serialLatencyTimer());
+    ui->cbRs485->setChecked(settings.serialRs485());
+    if(settings.serialFlashBaud() == 0){
+        ui->cbFlashSpeed->setCurrentIndex(0);
+    }else{
+        setCurrentItemByText(ui->cbFlashSpeed, QString::number(settings.serialFlashBaud()));
+    }
 
     ui->sbAddress->setValue(settings.modbusSlaveAddress());
     ui->sbTimeOut->setValue(settings.modbusTimeout());
@@ -46,6 +54,18 @@ void SettingsDlg::storeSettings()
     settings.setSerialPortBaud(ui->cbSpeed->currentText().toUInt());
     settings.setSerialPortParity(indexToParity(ui->cbParity->currentIndex()));
     settings.setSerialPortStopBits(indexToStopBits(ui->cbStopBits->currentIndex()));
+    settings.setSerialLowLatency(ui->cbLowLatency->isChecked());
+    settings.setSerialLatencyTimer(ui->sbLatencyTimer->value());
+    settings.setSerialRs485(ui->cbRs485->isChecked());
+    // Не число - без согласования.
+    settings.setSerialFlashBaud(ui->cbFlashSpeed->currentText().toUInt());
+
+    // Заданные вручную параметры связи важнее подобранных.
+    if(settings.modbusTimeout() != static_cast<quint32>(ui->sbTimeOut->value()) ||
+       settings.modbusFrameDelay() != static_cast<quint32>(ui->sbFrameDelay->value()) ||
+       settings.modbusRetries() != static_cast<quint32>(ui->sbRetries->value())){
+        settings.removeLinkTuning(settings.serialPortName());
+    }
 
     settings.setModbusSlaveAddress(ui->sbAddress->value());
     settings.setModbusTimeout(ui->sbTimeOut->value());
@@ -73,15 +93,20 @@ void SettingsDlg::populateBaudsList()
 {
     auto bauds = QSerialPortInfo::standardBaudRates();
 
+    ui->cbFlashSpeed->addItem(tr("Нет"));
+
     for(const qint32& baud: bauds){
         ui->cbSpeed->addItem(QString::number(baud));
+        ui->cbFlashSpeed->addItem(QString::number(baud));
     }
 
-    QCompleter* completer = ui->cbSpeed->completer();
-    if(completer){
-        completer->setCaseSensitivity(Qt::CaseInsensitive);
-        completer->setModelSorting(QCompleter::UnsortedModel);
-        completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    for(QComboBox* combobox: {ui->cbSpeed, ui->cbFlashSpeed}){
+        QCompleter* completer = combobox->completer();
+        if(completer){
+            completer->setCaseSensitivity(Qt::CaseInsensitive);
+            completer->setModelSorting(QCompleter::UnsortedModel);
+            completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+        }
     }
 }
 
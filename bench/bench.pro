@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Тест производительности записи/чтения прошивки
+# на модели загрузчика.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = qmodbus_bench
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../modbus.pri)
+
+SOURCES += main.cpp \
+    flashbench.cpp
+
+HEADERS += flashbench.h
@@ -0,0 +1,259 @@
+#include "flashbench.h"
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QVector>
+#include <time.h>
+#include "settings.h"
+#include "modbusnet.h"
+#include "modbusdev.h"
+#include "modbusfirmware.h"
+#include "modbusbootsim.h"
+#include "modbusvirtualtransport.h"
+
+
+#define S(str) QStringLiteral(str)
+
+
+FlashBench::Case::Case()
+{
+    baud = 9600;
+    flash_baud = 0;
+    page_size = 1024;
+    image_size = 16384;
+    error_rate = 0.0;
+    slaves = 1;
+}
+
+FlashBench::FlashBench(QObject *parent) : QObject(parent)
+{
+}
+
+FlashBench::~FlashBench()
+{
+}
+
+const ModbusTransferPlanner::Capabilities& FlashBench::capabilities() const
+{
+    return bench_caps;
+}
+
+void FlashBench::setCapabilities(const ModbusTransferPlanner::Capabilities& caps)
+{
+    bench_caps = caps;
+}
+
+QJsonObject FlashBench::run(const Case& c, Op op)
+{
+    Settings::get().setSerialPortBaud(c.baud);
+
+    ModbusNet net;
+
+    ModbusVirtualTransport* transport = new ModbusVirtualTransport();
+
+    ModbusVirtualTransport::Link link;
+    link.baud = c.baud;
+    link.timeout = Settings::get().modbusTimeout();
+    link.retries = Settings::get().modbusRetries();
+    transport->setLink(link);
+
+    net.setTransport(transport);
+    net.setBaud(c.baud);
+    net.connectToNet();
+
+    QByteArray image = makeImage(c.image_size, c.image_size ^ c.page_size);
+
+    ModbusBootSim::Config sim_conf;
+    sim_conf.page_size = c.page_size;
+    sim_conf.flash_size = qMax<quint32>(64, (c.image_size + 1023) / 1024);
+    sim_conf.drop_rate = c.error_rate;
+    sim_conf.boot_baud = c.baud;
+
+    QVector<ModbusBootSim*> sims;
+    QVector<ModbusDev*> devs;
+    QVector<ModbusFirmware*> fws;
+
+    for(int i = 0; i < c.slaves; i ++){
+        sim_conf.slave_addr = i + 1;
+        sim_conf.seed = i + 1;
+
+        ModbusBootSim* sim = new ModbusBootSim(sim_conf);
+        if(op == Read) sim->setFlash(0, image);
+        transport->addDevice(sim);
+
+        ModbusDev* dev = new ModbusDev(&net, sim_conf.slave_addr);
+
+        sims.append(sim);
+        devs.append(dev);
+        ModbusFirmware* fw = new ModbusFirmware(dev);
+        fw->setCapabilities(bench_caps);
+        fw->setTargetBaud(c.flash_baud);
+
+        fws.append(fw);
+    }
+
+    QEventLoop loop;
+
+    int pending = 0;
+    int failed = 0;
+
+    auto done = [&]{
+        if(-- pending <= 0) loop.quit();
+    };
+    auto fail = [&](ModbusErr){
+        failed ++;
+        if(-- pending <= 0) loop.quit();
+    };
+
+    // Чтение конфигурации в замер не входит.
+    pending = fws.size();
+    for(ModbusFirmware* fw: fws){
+        connect(fw, &ModbusFirmware::confReaded, &loop, done);
+        connect(fw, &ModbusFirmware::confReadErrorOccured, &loop, fail);
+        fw->confRead();
+    }
+    if(pending > 0) loop.exec();
+
+    QJsonObject res = caseJson(c, op);
+    res[S("negotiated_baud")] = static_cast<double>(net.baud());
+
+    QJsonObject pred = predict(c, op);
+    res[S("predicted_s")] = pred.value(S("predicted_s"));
+    res[S("predicted_transactions")] = pred.value(S("predicted_transactions"));
+
+    if(failed == 0){
+        // Оценка устройства, откалиброванная по чтению конфигурации.
+        double estimated = (op == Write) ? fws[0]->estimateWrite(ModbusFirmware::flashBase(), image) :
+                                           fws[0]->estimateRead(ModbusFirmware::flashBase(), c.image_size);
+        res[S("estimated_s")] = estimated * c.slaves;
+
+        net.resetStats();
+
+        qint64 virt_start = transport->timestamp();
+        double cpu_start = cpuTime();
+        QElapsedTimer wall;
+        wall.start();
+
+        pending = fws.size();
+        for(ModbusFirmware* fw: fws){
+            if(op == Write){
+                connect(fw, &ModbusFirmware::dataWrited, &loop, done);
+                connect(fw, &ModbusFirmware::dataWriteErrorOccured, &loop, fail);
+                if(!fw->writeData(ModbusFirmware::flashBase(), image)) fail(ModbusErr());
+            }else{
+                connect(fw, &ModbusFirmware::dataReaded, &loop, done);
+                connect(fw, &ModbusFirmware::dataReadErrorOccured, &loop, fail);
+                if(!fw->readData(ModbusFirmware::flashBase(), c.image_size)) fail(ModbusErr());
+            }
+        }
+        if(pending > 0) loop.exec();
+
+        double virt_time = (transport->timestamp() - virt_start) / 1e9;
+        double cpu_time = cpuTime() - cpu_start;
+
+        bool valid = failed == 0;
+        for(int i = 0; valid && i < c.slaves; i ++){
+            const QByteArray& result = (op == Write) ? sims[i]->flash() : fws[i]->data();
+            valid = result.left(image.size()) == image;
+        }
+
+        quint64 bytes = static_cast<quint64>(c.image_size) * c.slaves;
+        quint32 pages = (c.image_size + c.page_size - 1) / c.page_size * c.slaves;
+
+        const ModbusNetStats& stats = net.stats();
+
+        res[S("virtual_s")] = virt_time;
+        res[S("bytes_per_s")] = (virt_time > 0.0) ? bytes / virt_time : 0.0;
+        res[S("transactions")] = static_cast<double>(stats.transactions());
+        res[S("transactions_per_page")] = pages ? static_cast<double>(stats.transactions()) / pages : 0.0;
+        res[S("timeouts")] = static_cast<double>(transport->timeoutsCount());
+        res[S("bytes_sent")] = static_cast<double>(stats.bytesSent());
+        res[S("bytes_received")] = static_cast<double>(stats.bytesReceived());
+        res[S("cpu_ms")] = cpu_time * 1000.0;
+        res[S("wall_ms")] = static_cast<double>(wall.nsecsElapsed()) / 1e6;
+        res[S("cpu_us_per_transaction")] = stats.transactions() ? cpu_time * 1e6 / stats.transactions() : 0.0;
+        res[S("estimator")] = fws[0]->estimator().toJson();
+        res[S("ok")] = valid;
+    }else{
+        res[S("ok")] = false;
+    }
+
+    net.disconnectFromNet();
+
+    qDeleteAll(fws);
+    qDeleteAll(devs);
+    qDeleteAll(sims);
+
+    return res;
+}
+
+QJsonObject FlashBench::predict(const Case& c, Op op) const
+{
+    ModbusBootSim::Config sim_conf;
+
+    ModbusTransferPlanner::Timing timing;
+    timing.baud = c.flash_baud ? c.flash_baud : c.baud;
+    timing.char_bits = ModbusVirtualTransport::Link().char_bits;
+    timing.turnaround = ModbusVirtualTransport::Link().turnaround;
+    timing.response_latency = sim_conf.response_latency;
+    timing.erase_latency = sim_conf.erase_latency;
+    timing.program_latency = sim_conf.program_latency;
+
+    ModbusTransferPlanner planner;
+    planner.setCapabilities(bench_caps);
+    planner.setTiming(timing);
+    planner.setPageSize(c.page_size);
+
+    if(op == Write){
+        planner.planWrite(0, makeImage(c.image_size, c.image_size ^ c.page_size));
+    }else{
+        planner.planRead(0, c.image_size);
+    }
+
+    ModbusTransferPlanner::Prediction pred = planner.predict();
+
+    // Устройства на одной шине обслуживаются по очереди.
+    QJsonObject res = caseJson(c, op);
+    res[S("plan")] = planner.toJson();
+    res[S("predicted_s")] = pred.duration * c.slaves;
+    res[S("predicted_transactions")] = pred.transactions * c.slaves;
+    res[S("predicted_bytes_per_s")] = (pred.duration > 0.0) ? c.image_size / pred.duration : 0.0;
+
+    return res;
+}
+
+QJsonObject FlashBench::caseJson(const Case& c, Op op)
+{
+    QJsonObject res;
+
+    res[S("op")] = (op == Write) ? S("write") : S("read");
+    res[S("baud")] = static_cast<double>(c.baud);
+    res[S("flash_baud")] = static_cast<double>(c.flash_baud);
+    res[S("page_size")] = static_cast<double>(c.page_size);
+    res[S("image_size")] = static_cast<double>(c.image_size);
+    res[S("error_rate")] = c.error_rate;
+    res[S("slaves")] = c.slaves;
+
+    return res;
+}
+
+QByteArray FlashBench::makeImage(quint32 size, quint32 seed)
+{
+    QByteArray image(static_cast<int>(size), Qt::Uninitialized);
+
+    quint32 state = seed ? seed : 1;
+
+    for(quint32 i = 0; i < size; i ++){
+        state = state * 1664525 + 1013904223;
+        image[i] = static_cast<char>(state >> 24);
+    }
+
+    return image;
+}
+
+double FlashBench::cpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,55 @@
+#ifndef FLASHBENCH_H
+#define FLASHBENCH_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QByteArray>
+#include "modbustransferplanner.h"
+
+
+/*
+ * Прогон записи и чтения образа через ModbusFirmware
+ * на виртуальном транспорте с моделями загрузчика.
+ */
+class FlashBench : public QObject
+{
+    Q_OBJECT
+public:
+
+    struct Case {
+        Case();
+
+        quint32 baud;
+        quint32 flash_baud; // Согласуемая скорость записи, 0 - нет.
+        quint32 page_size;
+        quint32 image_size;
+        double error_rate;
+        int slaves;
+    };
+
+    enum Op {
+        Write = 0,
+        Read
+    };
+
+    explicit FlashBench(QObject *parent = 0);
+    ~FlashBench();
+
+    const ModbusTransferPlanner::Capabilities& capabilities() const;
+    void setCapabilities(const ModbusTransferPlanner::Capabilities& caps);
+
+    // Результат одного прогона в виде JSON.
+    QJsonObject run(const Case& c, Op op);
+
+    // Оценка планировщика без передачи (пробный прогон).
+    QJsonObject predict(const Case& c, Op op) const;
+
+private:
+    ModbusTransferPlanner::Capabilities bench_caps;
+
+    static QJsonObject caseJson(const Case& c, Op op);
+    static QByteArray makeImage(quint32 size, quint32 seed);
+    static double cpuTime();
+};
+
+#endif // FLASHBENCH_H
@@ -0,0 +1,177 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+#include <QFile>
+#include <QTextStream>
+#include "settings.h"
+#include "flashbench.h"
+#include "modbuscompat.h"
+
+
+#define S(str) QStringLiteral(str)
+
+
+template <typename T>
+static QVector<T> parseList(const QString& str, T (*conv)(const QString&, bool*))
+{
+    QVector<T> res;
+
+    for(const QString& item: str.split(QLatin1Char(','), Qt::SkipEmptyParts)){
+        bool ok = false;
+        T val = conv(item.trimmed(), &ok);
+        if(!ok) return QVector<T>();
+        res.append(val);
+    }
+
+    return res;
+}
+
+static quint32 toUInt(const QString& str, bool* ok)
+{
+    // Допускаются суффиксы K и M.
+    QString s = str.toUpper();
+    quint32 mul = 1;
+
+    if(s.endsWith(QLatin1Char('K'))){
+        mul = 1024;
+        s.chop(1);
+    }else if(s.endsWith(QLatin1Char('M'))){
+        mul = 1024 * 1024;
+        s.chop(1);
+    }
+
+    return s.toUInt(ok) * mul;
+}
+
+static double toDouble(const QString& str, bool* ok)
+{
+    return str.toDouble(ok);
+}
+
+static int toInt(const QString& str, bool* ok)
+{
+    return str.toInt(ok);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setOrganizationName(S("artem.lab"));
+    a.setApplicationName(S("qmodbus_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(S("Firmware read/write throughput on simulated bootloaders.\n"
+                                       "Prints one JSON object per case."));
+    parser.addHelpOption();
+
+    QCommandLineOption optBaud(S("baud"), S("Baud rates."), S("list"), S("9600,115200"));
+    QCommandLineOption optPageSize(S("page-size"), S("Flash page sizes, bytes."), S("list"), S("1024,2048"));
+    QCommandLineOption optImageSize(S("image-size"), S("Image sizes, bytes (K/M suffix)."), S("list"), S("16K,128K"));
+    QCommandLineOption optErrorRate(S("error-rate"), S("Fractions of lost responses."), S("list"), S("0,0.01"));
+    QCommandLineOption optSlaves(S("slaves"), S("Slave counts on the bus."), S("list"), S("1,4"));
+    QCommandLineOption optOp(S("op"), S("Operations: write, read."), S("list"), S("write,read"));
+    QCommandLineOption optTimeout(S("timeout"), S("Response timeout, ms."), S("ms"), S("500"));
+    QCommandLineOption optRetries(S("retries"), S("Retries count."), S("count"), S("3"));
+    QCommandLineOption optFlashBaud(S("flash-baud"), S("Baud rate negotiated with a single bootloader after configuration read, 0 - off."),
+                                    S("baud"), S("0"));
+    QCommandLineOption optMultiSubReq(S("multiple-sub-requests"), S("Plan several file sub-requests per PDU."));
+    QCommandLineOption optNoSkipErased(S("no-skip-erased"), S("Transfer records equal to erased flash."));
+    QCommandLineOption optDryRun(S("dry-run"), S("Print planner predictions without transferring."));
+    QCommandLineOption optOutput(S("output"), S("Write results to file instead of stdout."), S("file"));
+
+    parser.addOptions({optBaud, optPageSize, optImageSize, optErrorRate,
+                       optSlaves, optOp, optTimeout, optRetries, optFlashBaud,
+                       optMultiSubReq, optNoSkipErased, optDryRun, optOutput});
+
+    parser.process(a);
+
+    QTextStream err(stderr);
+
+    QVector<quint32> bauds = parseList<quint32>(parser.value(optBaud), toUInt);
+    QVector<quint32> page_sizes = parseList<quint32>(parser.value(optPageSize), toUInt);
+    QVector<quint32> image_sizes = parseList<quint32>(parser.value(optImageSize), toUInt);
+    QVector<double> error_rates = parseList<double>(parser.value(optErrorRate), toDouble);
+    QVector<int> slaves = parseList<int>(parser.value(optSlaves), toInt);
+
+    QVector<FlashBench::Op> ops;
+    for(const QString& op: parser.value(optOp).split(QLatin1Char(','), Qt::SkipEmptyParts)){
+        if(op == S("write")) ops.append(FlashBench::Write);
+        else if(op == S("read")) ops.append(FlashBench::Read);
+        else{
+            err << "Invalid operation " << op << Qt::endl;
+            return 2;
+        }
+    }
+
+    if(bauds.isEmpty() || page_sizes.isEmpty() || image_sizes.isEmpty() ||
+       error_rates.isEmpty() || slaves.isEmpty() || ops.isEmpty()){
+        err << "Invalid benchmark matrix!" << Qt::endl;
+        return 2;
+    }
+
+    // Настройки пользователя не читаются,
+    // чтобы результаты не зависели от машины.
+    Settings& settings = Settings::get();
+    settings.setModbusTimeout(parser.value(optTimeout).toUInt());
+    settings.setModbusRetries(parser.value(optRetries).toUInt());
+    settings.setModbusFrameDelay(0);
+
+    QFile out_file;
+
+    if(parser.isSet(optOutput)){
+        out_file.setFileName(parser.value(optOutput));
+        if(!out_file.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+            err << "Can't open " << out_file.fileName() << Qt::endl;
+            return 2;
+        }
+    }else{
+        out_file.open(stdout, QIODevice::WriteOnly);
+    }
+
+    ModbusTransferPlanner::Capabilities caps;
+    caps.multiple_sub_requests = parser.isSet(optMultiSubReq);
+    caps.skip_erased = !parser.isSet(optNoSkipErased);
+
+    FlashBench bench;
+    bench.setCapabilities(caps);
+
+    bool dry_run = parser.isSet(optDryRun);
+
+    int failed = 0;
+
+    for(FlashBench::Op op: ops)
+    for(quint32 baud: bauds)
+    for(quint32 page_size: page_sizes)
+    for(quint32 image_size: image_sizes)
+    for(double error_rate: error_rates)
+    for(int slave_count: slaves){
+
+        if(page_size == 0 || page_size % 2 != 0 || slave_count <= 0 || slave_count > 247){
+            err << "Skipping invalid case: page " << page_size << ", slaves " << slave_count << Qt::endl;
+            continue;
+        }
+
+        FlashBench::Case c;
+        c.baud = baud;
+        c.page_size = page_size;
+        c.image_size = image_size;
+        c.error_rate = error_rate;
+        c.slaves = slave_count;
+        // Скорость сети общая, согласование - только с единственным устройством.
+        c.flash_baud = (slave_count == 1) ? parser.value(optFlashBaud).toUInt() : 0;
+
+        QJsonObject res = dry_run ? bench.predict(c, op) : bench.run(c, op);
+
+        if(!dry_run && !res.value(S("ok")).toBool()) failed ++;
+
+        out_file.write(QJsonDocument(res).toJson(QJsonDocument::Compact));
+        out_file.write("\n");
+        out_file.flush();
+    }
+
+    return failed ? 1 : 0;
+}
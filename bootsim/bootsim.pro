@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# Симулятор загрузчика на псевдотерминале.
+#
+#-------------------------------------------------
+
+QT       += core serialbus
+QT       -= gui
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = qmodbus_bootsim
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../core
+
+SOURCES += main.cpp \
+    bootsimpty.cpp \
+    bootsimtuningcheck.cpp \
+    ../core/modbusbootsim.cpp \
+    ../core/modbuscrc32.cpp \
+    ../core/modbusquitsignals.cpp \
+    ../core/modbusserialtuning.cpp
+
+HEADERS += bootsimpty.h \
+    bootsimtuningcheck.h \
+    ../core/modbusbootsim.h \
+    ../core/modbusbootregs.h \
+    ../core/modbuscrc32.h \
+    ../core/modbusquitsignals.h \
+    ../core/modbuscompat.h \
+    ../core/modbusserialtuning.h
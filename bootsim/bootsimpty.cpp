@@ -0,0 +1,325 @@
+#include "bootsimpty.h"
+#include "modbusbootsim.h"
+#include "modbusbootregs.h"
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QFile>
+#include <QDebug>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <termios.h>
+#include <poll.h>
+#include <math.h>
+
+
+// Ожидание места в буфере терминала, мс.
+#define WRITE_TIMEOUT_MS 1000
+
+
+static quint32 speedToBaud(speed_t speed)
+{
+    switch(speed){
+    default:
+        return 0;
+    case B1200:
+        return 1200;
+    case B2400:
+        return 2400;
+    case B4800:
+        return 4800;
+    case B9600:
+        return 9600;
+    case B19200:
+        return 19200;
+    case B38400:
+        return 38400;
+    case B57600:
+        return 57600;
+    case B115200:
+        return 115200;
+    case B230400:
+        return 230400;
+#ifdef B460800
+    case B460800:
+        return 460800;
+#endif
+#ifdef B921600
+    case B921600:
+        return 921600;
+#endif
+    }
+}
+
+
+BootSimPty::BootSimPty(ModbusBootSim* sim, QObject *parent) : QObject(parent)
+{
+    boot_sim = sim;
+    master_fd = -1;
+    slave_fd = -1;
+    port_baud = 9600;
+    rx_notifier = nullptr;
+    processing = false;
+
+    frame_timer = new QTimer(this);
+    frame_timer->setSingleShot(true);
+    frame_timer->setTimerType(Qt::PreciseTimer);
+
+    connect(frame_timer, &QTimer::timeout, this, &BootSimPty::frameReceived);
+
+    baud_timer = new QTimer(this);
+    baud_timer->setSingleShot(true);
+    baud_timer->setInterval(BOOT_MODBUS_BAUD_WATCHDOG_MS);
+
+    connect(baud_timer, &QTimer::timeout, this, &BootSimPty::baudWatchdog);
+
+    sim_clock.start();
+
+    setBaud(port_baud);
+}
+
+BootSimPty::~BootSimPty()
+{
+    close();
+}
+
+bool BootSimPty::open(const QString& link)
+{
+    if(master_fd != -1) return false;
+
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(master_fd == -1){
+        qDebug() << "BootSimPty: posix_openpt fail!";
+        return false;
+    }
+
+    if(grantpt(master_fd) != 0 || unlockpt(master_fd) != 0){
+        qDebug() << "BootSimPty: grantpt/unlockpt fail!";
+        close();
+        return false;
+    }
+
+    slave_name = QString::fromLocal8Bit(ptsname(master_fd));
+
+    // Подчинённая сторона держится открытой, чтобы чтение
+    // мастера не возвращало EIO между сеансами клиента.
+    slave_fd = ::open(slave_name.toLocal8Bit().constData(), O_RDWR | O_NOCTTY);
+    if(slave_fd == -1){
+        qDebug() << "BootSimPty: open slave fail!";
+        close();
+        return false;
+    }
+
+    struct termios tio;
+    if(tcgetattr(slave_fd, &tio) == 0){
+        cfmakeraw(&tio);
+        tcsetattr(slave_fd, TCSANOW, &tio);
+    }
+
+    if(!link.isEmpty()){
+        QFile::remove(link);
+        if(!QFile::link(slave_name, link)){
+            qDebug() << "BootSimPty: link fail!" << link;
+            close();
+            return false;
+        }
+        link_name = link;
+    }
+
+    rx_notifier = new QSocketNotifier(master_fd, QSocketNotifier::Read, this);
+    connect(rx_notifier, &QSocketNotifier::activated, this, &BootSimPty::readyRead);
+
+    return true;
+}
+
+void BootSimPty::close()
+{
+    if(rx_notifier){
+        delete rx_notifier;
+        rx_notifier = nullptr;
+    }
+
+    if(!link_name.isEmpty()){
+        QFile::remove(link_name);
+        link_name.clear();
+    }
+
+    if(slave_fd != -1){
+        ::close(slave_fd);
+        slave_fd = -1;
+    }
+
+    if(master_fd != -1){
+        ::close(master_fd);
+        master_fd = -1;
+    }
+}
+
+QString BootSimPty::portName() const
+{
+    return link_name.isEmpty() ? slave_name : link_name;
+}
+
+quint32 BootSimPty::baud() const
+{
+    return port_baud;
+}
+
+void BootSimPty::setBaud(quint32 val)
+{
+    if(val == 0) return;
+
+    port_baud = val;
+
+    // Пауза 3.5 символа, не менее 1.75 мс (как в спецификации для скоростей выше 19200).
+    double t35 = qMax(3.5 * 11 * 1000 / port_baud, 1.75);
+
+    frame_timer->setInterval(static_cast<int>(ceil(t35)));
+}
+
+quint32 BootSimPty::clientBaud() const
+{
+    if(slave_fd == -1) return 0;
+
+    // Настройки терминала общие для всех дескрипторов подчинённой стороны.
+    struct termios tio;
+    if(tcgetattr(slave_fd, &tio) != 0) return 0;
+
+    return speedToBaud(cfgetospeed(&tio));
+}
+
+quint16 BootSimPty::crc16(const char* data, int size)
+{
+    quint16 crc = 0xffff;
+
+    for(int i = 0; i < size; i ++){
+        crc ^= static_cast<quint8>(data[i]);
+        for(int bit = 0; bit < 8; bit ++){
+            crc = (crc & 0x1) ? ((crc >> 1) ^ 0xa001) : (crc >> 1);
+        }
+    }
+
+    return crc;
+}
+
+void BootSimPty::readyRead()
+{
+    char buf[512];
+
+    for(;;){
+        ssize_t n = ::read(master_fd, buf, sizeof(buf));
+        if(n <= 0) break;
+
+        // Устройство занято обработкой - приём игнорируется.
+        if(!processing) rx_buffer.append(buf, static_cast<int>(n));
+    }
+
+    if(!rx_buffer.isEmpty()) frame_timer->start();
+}
+
+void BootSimPty::frameReceived()
+{
+    QByteArray frame = rx_buffer;
+    rx_buffer.clear();
+
+    // Адрес(1) + функция(1) + CRC(2).
+    if(frame.size() < 4) return;
+
+    boot_sim->setTime(static_cast<quint64>(sim_clock.nsecsElapsed() / 1000));
+
+    // На другой скорости устройство принимает искажённые символы.
+    quint32 client_baud = clientBaud();
+    if(client_baud != 0 && client_baud != boot_sim->baud()){
+        emit requestProcessed(static_cast<quint8>(frame.at(1)), false);
+        return;
+    }
+
+    quint16 crc = static_cast<quint16>(static_cast<quint8>(frame.at(frame.size() - 2)) |
+                                       (static_cast<quint8>(frame.at(frame.size() - 1)) << 8));
+    if(crc != crc16(frame.constData(), frame.size() - 2)) return;
+
+    int addr = static_cast<quint8>(frame.at(0));
+    if(addr != 0 && addr != boot_sim->slaveAddress()) return;
+
+    QModbusRequest req(static_cast<QModbusPdu::FunctionCode>(static_cast<quint8>(frame.at(1))),
+                       frame.mid(2, frame.size() - 4));
+
+    QModbusResponse resp;
+    quint32 latency = 0;
+
+    bool answer = boot_sim->process(req, &resp, &latency);
+
+    emit requestProcessed(req.functionCode(), answer && addr != 0);
+
+    // Широковещательные запросы без ответа.
+    if(!answer || addr == 0) return;
+
+    quint8 func = static_cast<quint8>(resp.functionCode());
+    if(resp.isException()) func |= 0x80;
+
+    tx_frame.clear();
+    tx_frame.append(static_cast<char>(addr));
+    tx_frame.append(static_cast<char>(func));
+    tx_frame.append(resp.data());
+
+    quint16 tx_crc = crc16(tx_frame.constData(), tx_frame.size());
+    tx_frame.append(static_cast<char>(tx_crc & 0xff));
+    tx_frame.append(static_cast<char>(tx_crc >> 8));
+
+    processing = true;
+
+    QTimer::singleShot(static_cast<int>(latency / 1000), Qt::PreciseTimer, this, &BootSimPty::sendResponse);
+}
+
+void BootSimPty::sendResponse()
+{
+    processing = false;
+
+    if(master_fd == -1) return;
+
+    const char* data = tx_frame.constData();
+    int size = tx_frame.size();
+
+    while(size > 0){
+        ssize_t n = ::write(master_fd, data, size);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            // Буфер терминала полон - ожидание, пока клиент не прочтёт.
+            if(errno == EAGAIN && waitWritable()) continue;
+            qDebug() << "BootSimPty: write fail!";
+            break;
+        }
+        data += n;
+        size -= static_cast<int>(n);
+    }
+
+    // Смена скорости записью регистра - после отправки ответа.
+    if(boot_sim->baud() != port_baud){
+        setBaud(boot_sim->baud());
+
+        if(boot_sim->isBaudPending()) baud_timer->start();
+    }
+}
+
+bool BootSimPty::waitWritable()
+{
+    struct pollfd pfd;
+    pfd.fd = master_fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    for(;;){
+        int res = ::poll(&pfd, 1, WRITE_TIMEOUT_MS);
+        if(res < 0 && errno == EINTR) continue;
+
+        return res > 0 && (pfd.revents & POLLOUT);
+    }
+}
+
+void BootSimPty::baudWatchdog()
+{
+    boot_sim->setTime(static_cast<quint64>(sim_clock.nsecsElapsed() / 1000));
+
+    setBaud(boot_sim->baud());
+}
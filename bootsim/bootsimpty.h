@@ -0,0 +1,70 @@
+#ifndef BOOTSIMPTY_H
+#define BOOTSIMPTY_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QElapsedTimer>
+
+class QSocketNotifier;
+class QTimer;
+class ModbusBootSim;
+
+
+/*
+ * Modbus RTU поверх псевдотерминала:
+ * разбивает поток на кадры по паузе 3.5 символа,
+ * проверяет CRC и передаёт PDU модели загрузчика.
+ * Скорость терминала, заданная клиентом, сравнивается
+ * со скоростью модели: кадры на другой скорости теряются.
+ */
+class BootSimPty : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BootSimPty(ModbusBootSim* sim, QObject *parent = 0);
+    ~BootSimPty();
+
+    bool open(const QString& link = QString());
+    void close();
+
+    // Имя подчинённого терминала для подключения клиента.
+    QString portName() const;
+
+    quint32 baud() const;
+    void setBaud(quint32 val);
+
+    // Скорость, установленная клиентом на терминале, 0 - нестандартная.
+    quint32 clientBaud() const;
+
+    static quint16 crc16(const char* data, int size);
+
+signals:
+    void requestProcessed(int func_code, bool answered);
+
+private slots:
+    void readyRead();
+    void frameReceived();
+    void sendResponse();
+    void baudWatchdog();
+
+private:
+    bool waitWritable();
+
+    ModbusBootSim* boot_sim;
+    int master_fd;
+    int slave_fd;
+    QString slave_name;
+    QString link_name;
+    quint32 port_baud;
+
+    QSocketNotifier* rx_notifier;
+    QTimer* frame_timer;
+    QTimer* baud_timer;
+    QElapsedTimer sim_clock;
+    QByteArray rx_buffer;
+    QByteArray tx_frame;
+    bool processing;
+};
+
+#endif // BOOTSIMPTY_H
@@ -0,0 +1,148 @@
+#include "bootsimtuningcheck.h"
+#include "modbusserialtuning.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTemporaryDir>
+#include <errno.h>
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#endif
+
+
+#define INITIAL_SERIAL_FLAGS 0x1000
+#define INITIAL_LATENCY_TIMER 16
+#define TUNED_LATENCY_TIMER 1
+
+
+#ifdef Q_OS_LINUX
+// Флаги драйвера, видимые через подменённый ioctl.
+static int mock_serial_flags = INITIAL_SERIAL_FLAGS;
+
+static int mockIoctl(int fd, unsigned long request, void* arg)
+{
+    Q_UNUSED(fd);
+
+    switch(request){
+    case TIOCGSERIAL:
+        memset(arg, 0, sizeof(struct serial_struct));
+        static_cast<struct serial_struct*>(arg)->flags = mock_serial_flags;
+        return 0;
+    case TIOCSSERIAL:
+        mock_serial_flags = static_cast<struct serial_struct*>(arg)->flags;
+        return 0;
+    default:
+        // Как у USB-адаптеров: RS-485 ioctl не поддерживается.
+        errno = ENOTTY;
+        return -1;
+    }
+}
+
+static bool readTimer(const QString& path, quint32* value)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    bool ok = false;
+    *value = file.readAll().trimmed().toUInt(&ok);
+
+    return ok;
+}
+#endif
+
+
+bool BootSimTuningCheck::run(const QString& port_name, QStringList* log)
+{
+#ifdef Q_OS_LINUX
+    QTemporaryDir sysfs;
+    if(!sysfs.isValid()){
+        log->append(QStringLiteral("can't create sysfs root"));
+        return false;
+    }
+
+    // Имя терминала - как его определяет ModbusSerialTuning.
+    QFileInfo info(port_name);
+    QString canonical = info.canonicalFilePath();
+    QString tty_name = QFileInfo(canonical.isEmpty() ? info.filePath() : canonical).fileName();
+
+    QString dev_dir = sysfs.path() + QStringLiteral("/bus/usb-serial/devices/") + tty_name;
+    QString timer_path = dev_dir + QStringLiteral("/latency_timer");
+
+    QFile timer_file(timer_path);
+    if(!QDir().mkpath(dev_dir) || !timer_file.open(QIODevice::WriteOnly) ||
+       timer_file.write(QByteArray::number(INITIAL_LATENCY_TIMER)) <= 0){
+        log->append(QStringLiteral("can't create %1").arg(timer_path));
+        return false;
+    }
+    timer_file.close();
+
+    int fd = ::open(port_name.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(fd == -1){
+        log->append(QStringLiteral("can't open %1: %2").arg(port_name, QString::fromLocal8Bit(strerror(errno))));
+        return false;
+    }
+
+    mock_serial_flags = INITIAL_SERIAL_FLAGS;
+
+    ModbusSerialTuning tuning;
+    tuning.setIoctlFunc(mockIoctl);
+    tuning.setSysfsRoot(sysfs.path());
+
+    ModbusSerialTuning::Config conf;
+    conf.low_latency = true;
+    conf.latency_timer = TUNED_LATENCY_TIMER;
+    conf.rs485 = true;
+    tuning.setConfig(conf);
+
+    bool res = true;
+    quint32 timer = 0;
+
+    if(!tuning.apply(fd, port_name) || !tuning.isApplied()){
+        log->append(QStringLiteral("apply failed"));
+        res = false;
+    }
+    log->append(tuning.report());
+
+    if(!(mock_serial_flags & ASYNC_LOW_LATENCY)){
+        log->append(QStringLiteral("ASYNC_LOW_LATENCY is not set"));
+        res = false;
+    }
+
+    if(!readTimer(timer_path, &timer) || timer != TUNED_LATENCY_TIMER){
+        log->append(QStringLiteral("latency_timer is %1, expected %2").arg(timer).arg(TUNED_LATENCY_TIMER));
+        res = false;
+    }
+
+    if(!tuning.restore(fd) || tuning.isApplied()){
+        log->append(QStringLiteral("restore failed"));
+        res = false;
+    }
+    log->append(tuning.report().mid(tuning.report().size() - 1));
+
+    if(mock_serial_flags != INITIAL_SERIAL_FLAGS){
+        log->append(QStringLiteral("serial flags are 0x%1, expected 0x%2")
+                    .arg(mock_serial_flags, 0, 16).arg(INITIAL_SERIAL_FLAGS, 0, 16));
+        res = false;
+    }
+
+    if(!readTimer(timer_path, &timer) || timer != INITIAL_LATENCY_TIMER){
+        log->append(QStringLiteral("latency_timer is %1 after restore, expected %2").arg(timer).arg(INITIAL_LATENCY_TIMER));
+        res = false;
+    }
+
+    ::close(fd);
+
+    return res;
+#else
+    Q_UNUSED(port_name);
+
+    log->append(QStringLiteral("serial port tuning is supported on Linux only"));
+
+    return false;
+#endif
+}
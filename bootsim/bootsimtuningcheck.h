@@ -0,0 +1,21 @@
+#ifndef BOOTSIMTUNINGCHECK_H
+#define BOOTSIMTUNINGCHECK_H
+
+#include <QString>
+#include <QStringList>
+
+
+/*
+ * Проверка настройки порта ModbusSerialTuning на псевдотерминале:
+ * ioctl подменяется моделью флагов драйвера, sysfs - временным
+ * каталогом с latency_timer. После apply() флаг ASYNC_LOW_LATENCY
+ * и таймер должны быть установлены, после restore() - прежними.
+ */
+class BootSimTuningCheck
+{
+public:
+    // port_name - подчинённый терминал симулятора.
+    static bool run(const QString& port_name, QStringList* log);
+};
+
+#endif // BOOTSIMTUNINGCHECK_H
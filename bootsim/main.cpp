@@ -0,0 +1,124 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include "bootsimpty.h"
+#include "bootsimtuningcheck.h"
+#include "modbusbootsim.h"
+#include "modbusquitsignals.h"
+#include "modbuscompat.h"
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setOrganizationName(QStringLiteral("artem.lab"));
+    a.setApplicationName(QStringLiteral("qmodbus_bootsim"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Modbus bootloader simulator on a pseudo-terminal."));
+    parser.addHelpOption();
+
+    QCommandLineOption optLink(QStringLiteral("link"), QStringLiteral("Symlink to the slave pty."), QStringLiteral("path"));
+    QCommandLineOption optSlave(QStringLiteral("slave"), QStringLiteral("Slave address."), QStringLiteral("addr"), QStringLiteral("1"));
+    QCommandLineOption optBaud(QStringLiteral("baud"), QStringLiteral("Boot baud rate, also used for frame timing."), QStringLiteral("baud"), QStringLiteral("9600"));
+    QCommandLineOption optMaxBaud(QStringLiteral("max-baud"), QStringLiteral("Highest baud rate accepted by the baud register."), QStringLiteral("baud"), QStringLiteral("921600"));
+    QCommandLineOption optFlashSize(QStringLiteral("flash-size"), QStringLiteral("Flash size, KiB."), QStringLiteral("kib"), QStringLiteral("64"));
+    QCommandLineOption optPageSize(QStringLiteral("page-size"), QStringLiteral("Flash page size, bytes."), QStringLiteral("bytes"), QStringLiteral("1024"));
+    QCommandLineOption optDeviceId(QStringLiteral("device-id"), QStringLiteral("Device identity register value."), QStringLiteral("id"), QStringLiteral("0x5a5a"));
+    QCommandLineOption optRespLatency(QStringLiteral("response-latency"), QStringLiteral("Request processing latency, us."), QStringLiteral("us"), QStringLiteral("100"));
+    QCommandLineOption optEraseLatency(QStringLiteral("erase-latency"), QStringLiteral("Page erase latency, us."), QStringLiteral("us"), QStringLiteral("20000"));
+    QCommandLineOption optProgLatency(QStringLiteral("program-latency"), QStringLiteral("Half-word program latency, us."), QStringLiteral("us"), QStringLiteral("50"));
+    QCommandLineOption optCrcLatency(QStringLiteral("crc-latency"), QStringLiteral("CRC-32 latency per KiB, us."), QStringLiteral("us"), QStringLiteral("400"));
+    QCommandLineOption optDropRate(QStringLiteral("drop-rate"), QStringLiteral("Fraction of requests left unanswered."), QStringLiteral("rate"), QStringLiteral("0"));
+    QCommandLineOption optExcRate(QStringLiteral("exception-rate"), QStringLiteral("Fraction of requests answered with ServerDeviceBusy."), QStringLiteral("rate"), QStringLiteral("0"));
+    QCommandLineOption optSeed(QStringLiteral("seed"), QStringLiteral("Error injection seed."), QStringLiteral("seed"), QStringLiteral("1"));
+    QCommandLineOption optImage(QStringLiteral("image"), QStringLiteral("Preload flash from file."), QStringLiteral("file"));
+    QCommandLineOption optDump(QStringLiteral("dump"), QStringLiteral("Save flash to file on exit."), QStringLiteral("file"));
+    QCommandLineOption optCheckTuning(QStringLiteral("check-tuning"), QStringLiteral("Check serial port tuning and restore on the pty, then exit."));
+
+    parser.addOptions({optLink, optSlave, optBaud, optMaxBaud, optFlashSize, optPageSize, optDeviceId,
+                       optRespLatency, optEraseLatency, optProgLatency, optCrcLatency,
+                       optDropRate, optExcRate, optSeed, optImage, optDump, optCheckTuning});
+
+    parser.process(a);
+
+    ModbusBootSim::Config conf;
+    conf.slave_addr = parser.value(optSlave).toInt();
+    conf.flash_size = parser.value(optFlashSize).toUInt();
+    conf.page_size = parser.value(optPageSize).toUInt();
+    conf.device_id = static_cast<quint16>(parser.value(optDeviceId).toUInt(nullptr, 0));
+    conf.response_latency = parser.value(optRespLatency).toUInt();
+    conf.erase_latency = parser.value(optEraseLatency).toUInt();
+    conf.program_latency = parser.value(optProgLatency).toUInt();
+    conf.crc_latency = parser.value(optCrcLatency).toUInt();
+    conf.drop_rate = parser.value(optDropRate).toDouble();
+    conf.exception_rate = parser.value(optExcRate).toDouble();
+    conf.seed = parser.value(optSeed).toUInt();
+    conf.boot_baud = parser.value(optBaud).toUInt();
+    conf.max_baud = parser.value(optMaxBaud).toUInt();
+
+    QTextStream err(stderr);
+
+    if(conf.boot_baud == 0){
+        err << "Invalid baud rate!" << Qt::endl;
+        return 1;
+    }
+
+    if(conf.flash_size == 0 || conf.page_size == 0 || conf.page_size % 2 != 0){
+        err << "Invalid flash geometry!" << Qt::endl;
+        return 1;
+    }
+
+    ModbusBootSim sim(conf);
+
+    if(parser.isSet(optImage)){
+        QFile file(parser.value(optImage));
+        if(!file.open(QIODevice::ReadOnly)){
+            err << "Can't open image " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        sim.setFlash(0, file.readAll());
+    }
+
+    BootSimPty pty(&sim);
+    pty.setBaud(parser.value(optBaud).toUInt());
+
+    if(!pty.open(parser.value(optLink))){
+        err << "Can't open pty!" << Qt::endl;
+        return 1;
+    }
+
+    QTextStream out(stdout);
+
+    if(parser.isSet(optCheckTuning)){
+        QStringList log;
+        bool ok = BootSimTuningCheck::run(pty.portName(), &log);
+
+        for(const QString& str: log) out << str << Qt::endl;
+        out << (ok ? "tuning check passed" : "tuning check failed") << Qt::endl;
+
+        pty.close();
+        return ok ? 0 : 1;
+    }
+
+    out << pty.portName() << Qt::endl;
+
+    ModbusQuitSignals quit_signals;
+    quit_signals.install();
+
+    int res = a.exec();
+
+    pty.close();
+
+    if(parser.isSet(optDump)){
+        QFile file(parser.value(optDump));
+        if(!file.open(QIODevice::WriteOnly) || file.write(sim.flash()) != sim.flash().size()){
+            err << "Can't save flash to " << file.fileName() << Qt::endl;
+            return 1;
+        }
+    }
+
+    return res;
+}
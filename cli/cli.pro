@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Запись прошивки из командной строки, без GUI.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = qmodbus_flash
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../modbus.pri)
+
+SOURCES += main.cpp \
+    cliflasher.cpp
+
+HEADERS += cliflasher.h
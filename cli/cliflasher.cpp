@@ -0,0 +1,576 @@
+#include "cliflasher.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTimer>
+#include <stdio.h>
+#include "modbusnet.h"
+#include "modbusdev.h"
+#include "modbusfirmware.h"
+#include "modbusimagewatcher.h"
+#include "settings.h"
+
+
+#define S(str) QStringLiteral(str)
+
+
+CliFlasher::Job::Job()
+{
+    mode = Write;
+    slave = 1;
+    address = ModbusFirmware::flashBase();
+    size = 0;
+    verify = false;
+    verify_all = false;
+    verify_crc = false;
+    delta_confirm = true;
+    run_app = false;
+    flash_baud = 0;
+}
+
+CliFlasher::CliFlasher(QObject *parent) : QObject(parent)
+{
+    stage = Idle;
+    exit_code = ExitOk;
+    progress_max = 0;
+    progress_val = 0;
+    watch_pending = false;
+
+    std_out.open(stdout, QIODevice::WriteOnly);
+    event_out = &std_out;
+
+    net = new ModbusNet(this);
+    dev = new ModbusDev(net, cli_job.slave, this);
+    fw = new ModbusFirmware(dev, this);
+    watcher = new ModbusImageWatcher(this);
+
+    connect(net, &ModbusNet::errorOccured, this, &CliFlasher::netError);
+    connect(net, &ModbusNet::connectedToNet, this, &CliFlasher::connectedToNet);
+
+    connect(fw, &ModbusFirmware::confReaded, this, &CliFlasher::confReaded);
+    connect(fw, &ModbusFirmware::confReadErrorOccured, this, &CliFlasher::confReadError);
+
+    connect(fw, &ModbusFirmware::progressSetMax, this, &CliFlasher::progressSetMax);
+    connect(fw, &ModbusFirmware::progressChanged, this, &CliFlasher::progressChanged);
+    connect(fw, &ModbusFirmware::estimateChanged, this, &CliFlasher::estimateChanged);
+
+    connect(fw, &ModbusFirmware::dataReaded, this, &CliFlasher::dataReaded);
+    connect(fw, &ModbusFirmware::dataReadErrorOccured, this, &CliFlasher::opError);
+    connect(fw, &ModbusFirmware::deltaPlanned, this, &CliFlasher::deltaPlanned);
+    connect(fw, &ModbusFirmware::deltaUnavailable, this, &CliFlasher::deltaUnavailable);
+    connect(fw, &ModbusFirmware::dataWrited, this, &CliFlasher::dataWrited);
+    connect(fw, &ModbusFirmware::dataWriteErrorOccured, this, &CliFlasher::opError);
+    connect(fw, &ModbusFirmware::dataVerified, this, &CliFlasher::dataVerified);
+    connect(fw, &ModbusFirmware::dataVerifyErrorOccured, this, &CliFlasher::opError);
+
+    connect(fw, &ModbusFirmware::appRunned, this, &CliFlasher::appRunned);
+    connect(fw, &ModbusFirmware::appRunErrorOccured, this, &CliFlasher::appRunError);
+
+    connect(watcher, &ModbusImageWatcher::imageChanged, this, &CliFlasher::imageChanged);
+
+    clock.start();
+}
+
+CliFlasher::~CliFlasher()
+{
+    delete watcher;
+    delete fw;
+    delete dev;
+    delete net;
+}
+
+const CliFlasher::Job& CliFlasher::job() const
+{
+    return cli_job;
+}
+
+void CliFlasher::setJob(const Job& job)
+{
+    cli_job = job;
+}
+
+void CliFlasher::setEventOutput(QFile* file)
+{
+    event_out = file ? file : &std_out;
+}
+
+bool CliFlasher::isFinished() const
+{
+    return stage == Finished;
+}
+
+int CliFlasher::exitCode() const
+{
+    return exit_code;
+}
+
+void CliFlasher::start()
+{
+    if(stage != Idle) return;
+
+    Settings& settings = Settings::get();
+
+    dev->setSlaveAddress(cli_job.slave);
+    fw->setTargetBaud(cli_job.flash_baud);
+    fw->setDeltaConfirm(cli_job.delta_confirm);
+
+    stage = Connecting;
+
+    QJsonObject obj;
+    obj[S("port")] = settings.serialPortName();
+    obj[S("baud")] = static_cast<double>(settings.serailPortBaud());
+    obj[S("slave")] = cli_job.slave;
+    writeEvent(S("connecting"), obj);
+
+    if(!net->setup()){
+        fail(ExitConnect, S("Network setup fail"));
+        return;
+    }
+
+    if(!net->connectToNet()){
+        fail(ExitConnect, S("Can't open port %1").arg(settings.serialPortName()));
+    }
+}
+
+void CliFlasher::abort()
+{
+    if(stage == Finished) return;
+
+    QJsonObject obj;
+    obj[S("stage")] = QString::fromLatin1(stageName(stage));
+    obj[S("code")] = ExitCanceled;
+    obj[S("message")] = S("Canceled");
+    writeEvent(S("error"), obj);
+
+    stage = Finished;
+    exit_code = ExitCanceled;
+
+    writeEvent(S("done"), QJsonObject{{S("code"), exit_code}});
+
+    net->disconnectFromNet();
+}
+
+void CliFlasher::netError(ModbusErr error)
+{
+    // Ошибки транзакций приходят и от сообщений.
+    if(stage != Connecting) return;
+
+    fail(ExitConnect, S("Connection fail"), errorJson(error));
+}
+
+void CliFlasher::connectedToNet()
+{
+    if(stage != Connecting) return;
+
+    stage = Config;
+
+    writeEvent(S("connected"));
+
+    fw->confRead();
+}
+
+void CliFlasher::confReaded()
+{
+    if(stage != Config) return;
+
+    QJsonObject obj;
+    obj[S("flash_kib")] = static_cast<double>(fw->flashSize());
+    obj[S("page_size")] = static_cast<double>(fw->pageSize());
+    obj[S("baud")] = static_cast<double>(net->baud());
+    obj[S("cached")] = fw->isConfCached();
+    writeEvent(S("config"), obj);
+
+    quint32 flash_bytes = fw->flashSize() * 1024;
+    quint32 offset = cli_job.address >= ModbusFirmware::flashBase() ?
+                         cli_job.address - ModbusFirmware::flashBase() : cli_job.address;
+
+    quint32 size = 0;
+
+    switch(cli_job.mode){
+    case Write:
+    case Verify:
+        size = static_cast<quint32>(cli_job.image.size());
+        break;
+    case Read:
+        size = cli_job.size ? cli_job.size : (offset < flash_bytes ? flash_bytes - offset : 0);
+        break;
+    }
+
+    if(!inFlash(size)){
+        fail(ExitUsage, S("Range 0x%1 + %2 is out of flash").arg(cli_job.address, 8, 16, QLatin1Char('0')).arg(size));
+        return;
+    }
+
+    if(!cli_job.watch.isEmpty()){
+        if(!watcher->start(cli_job.watch)){
+            fail(ExitFile, S("Can't watch %1").arg(cli_job.watch));
+            return;
+        }
+        // Файл изменился после чтения образа.
+        if(watcher->image() != cli_job.image) watch_pending = true;
+    }
+
+    switch(cli_job.mode){
+    case Write:
+        startWrite();
+        break;
+    case Read:
+        startRead(size);
+        break;
+    case Verify:
+        startVerify();
+        break;
+    }
+}
+
+void CliFlasher::confReadError(ModbusErr error)
+{
+    fail(ExitConfig, S("Bootloader configuration read fail"), errorJson(error));
+}
+
+void CliFlasher::progressSetMax(int val)
+{
+    progress_max = val;
+    progress_val = 0;
+}
+
+void CliFlasher::progressChanged(int val)
+{
+    progress_val = val;
+}
+
+void CliFlasher::estimateChanged(double eta, double bytes_per_s)
+{
+    if(stage != Writing && stage != Reading && stage != Verifying) return;
+
+    QJsonObject obj;
+    obj[S("op")] = QString::fromLatin1(stageName(stage));
+    obj[S("done")] = progress_val;
+    obj[S("total")] = progress_max;
+    obj[S("percent")] = progress_max ? 100.0 * progress_val / progress_max : 0.0;
+    obj[S("eta_s")] = eta;
+    obj[S("bytes_per_s")] = bytes_per_s;
+    writeEvent(S("progress"), obj);
+}
+
+void CliFlasher::dataReaded()
+{
+    if(stage == Reading){
+        QFile file(cli_job.output);
+
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+           file.write(fw->data()) != fw->data().size()){
+            fail(ExitFile, S("Can't write %1").arg(cli_job.output));
+            return;
+        }
+
+        writeEvent(S("saved"), QJsonObject{{S("file"), cli_job.output}, {S("size"), fw->data().size()}});
+
+    }else{
+        return;
+    }
+
+    if(cli_job.run_app){
+        runApp();
+        return;
+    }
+
+    finish(ExitOk);
+}
+
+void CliFlasher::deltaPlanned(int pages, int total)
+{
+    QJsonObject obj;
+    obj[S("pages")] = pages;
+    obj[S("total")] = total;
+    writeEvent(S("delta"), obj);
+}
+
+void CliFlasher::deltaUnavailable(const QString& reason)
+{
+    writeEvent(S("full_write"), QJsonObject{{S("reason"), reason}});
+}
+
+void CliFlasher::dataWrited()
+{
+    if(stage != Writing) return;
+
+    if(!cli_job.watch.isEmpty()) watch_base = cli_job.image;
+
+    if(cli_job.verify){
+        startVerify();
+        return;
+    }
+
+    if(cli_job.run_app){
+        runApp();
+        return;
+    }
+
+    finish(ExitOk);
+}
+
+void CliFlasher::dataVerified(bool match)
+{
+    if(stage != Verifying) return;
+
+    if(!match){
+        const QVector<ModbusFirmware::Mismatch>& mismatches = fw->mismatches();
+
+        QJsonArray ranges;
+        for(const ModbusFirmware::Mismatch& m: mismatches){
+            ranges.append(QJsonObject{{S("address"), static_cast<double>(m.address)},
+                                      {S("size"), static_cast<double>(m.size)}});
+        }
+
+        quint32 offset = mismatches.isEmpty() ? 0 : mismatches.first().address - cli_job.address;
+
+        QJsonObject obj;
+        obj[S("address")] = static_cast<double>(cli_job.address + offset);
+        obj[S("offset")] = static_cast<double>(offset);
+        obj[S("ranges")] = ranges;
+        fail(ExitVerify, S("Verify mismatch at offset %1").arg(offset), obj);
+        return;
+    }
+
+    writeEvent(S("verified"), QJsonObject{{S("size"), cli_job.image.size()}});
+
+    if(cli_job.run_app){
+        runApp();
+        return;
+    }
+
+    finish(ExitOk);
+}
+
+void CliFlasher::opError(ModbusErr error)
+{
+    fail(ExitTransfer, S("Transfer fail"), errorJson(error));
+}
+
+void CliFlasher::appRunned()
+{
+    if(stage != Running) return;
+
+    finish(ExitOk);
+}
+
+void CliFlasher::appRunError(ModbusErr error)
+{
+    if(stage != Running) return;
+
+    fail(ExitRunApp, S("Application start fail"), errorJson(error));
+}
+
+void CliFlasher::imageChanged(const QByteArray& image)
+{
+    // Запись текущего образа завершится, затем - новый.
+    if(stage != Watching){
+        watch_pending = true;
+        return;
+    }
+
+    watch_pending = false;
+
+    writeEvent(S("changed"), QJsonObject{{S("file"), cli_job.watch}, {S("size"), image.size()}});
+
+    if(!inFlash(static_cast<quint32>(image.size()))){
+        QJsonObject obj;
+        obj[S("stage")] = QString::fromLatin1(stageName(stage));
+        obj[S("code")] = ExitUsage;
+        obj[S("message")] = S("Range 0x%1 + %2 is out of flash").arg(cli_job.address, 8, 16, QLatin1Char('0')).arg(image.size());
+        writeEvent(S("error"), obj);
+        return;
+    }
+
+    cli_job.image = image;
+
+    startWrite();
+}
+
+void CliFlasher::startWrite()
+{
+    stage = Writing;
+
+    QJsonObject obj;
+    obj[S("op")] = QString::fromLatin1(stageName(stage));
+    obj[S("address")] = static_cast<double>(cli_job.address);
+    obj[S("size")] = cli_job.image.size();
+    obj[S("predicted_s")] = fw->estimateWrite(cli_job.address, cli_job.image);
+    writeEvent(S("begin"), obj);
+
+    // После прерванной записи память устройства неизвестна.
+    QByteArray base = watch_base;
+    watch_base.clear();
+
+    bool res = base.isEmpty() ? fw->writeData(cli_job.address, cli_job.image) :
+                                fw->writeDataDelta(cli_job.address, cli_job.image, cli_job.address, base);
+
+    if(!res){
+        fail(ExitTransfer, S("Write start fail"));
+    }
+}
+
+void CliFlasher::startRead(quint32 size)
+{
+    stage = Reading;
+
+    QJsonObject obj;
+    obj[S("op")] = QString::fromLatin1(stageName(stage));
+    obj[S("address")] = static_cast<double>(cli_job.address);
+    obj[S("size")] = static_cast<double>(size);
+    obj[S("predicted_s")] = fw->estimateRead(cli_job.address, size);
+    writeEvent(S("begin"), obj);
+
+    if(!fw->readData(cli_job.address, size)){
+        fail(ExitTransfer, S("Read start fail"));
+    }
+}
+
+void CliFlasher::startVerify()
+{
+    stage = Verifying;
+
+    quint32 size = static_cast<quint32>(cli_job.image.size());
+
+    QJsonObject obj;
+    obj[S("op")] = QString::fromLatin1(stageName(stage));
+    obj[S("address")] = static_cast<double>(cli_job.address);
+    obj[S("size")] = static_cast<double>(size);
+    obj[S("predicted_s")] = fw->estimateRead(cli_job.address, size);
+    obj[S("crc")] = cli_job.verify_crc;
+    writeEvent(S("begin"), obj);
+
+    bool res = cli_job.verify_crc ?
+                fw->verifyCrc(cli_job.address, cli_job.image, !cli_job.verify_all) :
+                fw->verifyData(cli_job.address, cli_job.image, !cli_job.verify_all);
+
+    if(!res){
+        fail(ExitTransfer, S("Verify start fail"));
+    }
+}
+
+void CliFlasher::runApp()
+{
+    stage = Running;
+
+    writeEvent(S("run"));
+
+    if(!fw->runApp()){
+        fail(ExitRunApp, S("Application start fail"));
+    }
+}
+
+void CliFlasher::watchIdle(int code)
+{
+    stage = Watching;
+
+    QJsonObject obj;
+    obj[S("code")] = code;
+    obj[S("file")] = cli_job.watch;
+    writeEvent(S("watching"), obj);
+
+    if(watch_pending){
+        QTimer::singleShot(0, this, [this]{
+            if(stage == Watching) imageChanged(watcher->image());
+        });
+    }
+}
+
+bool CliFlasher::inFlash(quint32 size) const
+{
+    quint32 flash_bytes = fw->flashSize() * 1024;
+    quint32 offset = cli_job.address >= ModbusFirmware::flashBase() ?
+                         cli_job.address - ModbusFirmware::flashBase() : cli_job.address;
+
+    return size != 0 && offset < flash_bytes && size <= flash_bytes - offset;
+}
+
+void CliFlasher::finish(int code)
+{
+    if(stage == Finished) return;
+
+    // Слежение: ошибка задания не завершает работу,
+    // следующая сборка записывается заново.
+    if(!cli_job.watch.isEmpty() && (stage == Writing || stage == Verifying || stage == Running)){
+        watchIdle(code);
+        return;
+    }
+
+    stage = Finished;
+    exit_code = code;
+
+    QJsonObject obj;
+    obj[S("code")] = code;
+    obj[S("stats")] = net->stats().toJson();
+    writeEvent(S("done"), obj);
+
+    // Отключение вне обработчиков сообщений сети.
+    QTimer::singleShot(0, this, [this]{
+        net->disconnectFromNet();
+        emit finished(exit_code);
+    });
+}
+
+void CliFlasher::fail(int code, const QString& message, const QJsonObject& details)
+{
+    if(stage == Finished) return;
+
+    QJsonObject obj = details;
+    obj[S("stage")] = QString::fromLatin1(stageName(stage));
+    obj[S("code")] = code;
+    obj[S("message")] = message;
+    writeEvent(S("error"), obj);
+
+    finish(code);
+}
+
+void CliFlasher::writeEvent(const QString& name, QJsonObject obj)
+{
+    obj[S("event")] = name;
+    obj[S("t_ms")] = clock.nsecsElapsed() / 1e6;
+
+    event_out->write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    event_out->write("\n");
+    event_out->flush();
+}
+
+const char* CliFlasher::stageName(Stage st)
+{
+    switch(st){
+    default:
+    case Idle:
+        return "idle";
+    case Connecting:
+        return "connect";
+    case Config:
+        return "config";
+    case Writing:
+        return "write";
+    case Reading:
+        return "read";
+    case Verifying:
+        return "verify";
+    case Running:
+        return "run";
+    case Watching:
+        return "watch";
+    case Finished:
+        return "finished";
+    }
+}
+
+QJsonObject CliFlasher::errorJson(ModbusErr error)
+{
+    QJsonObject obj;
+
+    obj[S("sender")] = error.sanderName();
+    obj[S("error")] = error.errorStr();
+
+    if(error.type() == ModbusErr::Modbus){
+        obj[S("modbus_error")] = static_cast<int>(error.modbusError());
+        obj[S("modbus_exception")] = static_cast<int>(error.modbusException());
+        obj[S("modbus_error_str")] = error.modbusErrorStr();
+    }
+
+    return obj;
+}
@@ -0,0 +1,162 @@
+#ifndef CLIFLASHER_H
+#define CLIFLASHER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include "modbuserr.h"
+
+class ModbusNet;
+class ModbusDev;
+class ModbusFirmware;
+class ModbusImageWatcher;
+
+
+/*
+ * Запись, чтение и проверка прошивки без графического интерфейса.
+ * Подключается к порту из Settings, читает конфигурацию загрузчика,
+ * выполняет задание и сообщает о ходе работы строками JSON
+ * (по объекту на строку) в заданный файл.
+ * Результат - код завершения ExitCode.
+ * В режиме слежения после записи ожидается изменение файла
+ * образа, и записываются только изменённые страницы.
+ */
+class CliFlasher : public QObject
+{
+    Q_OBJECT
+public:
+
+    enum Mode {
+        Write = 0,
+        Read,
+        Verify
+    };
+
+    enum ExitCode {
+        ExitOk = 0,
+        ExitUsage = 1,
+        ExitFile = 2,
+        ExitConnect = 3,
+        ExitConfig = 4,
+        ExitTransfer = 5,
+        ExitVerify = 6,
+        ExitRunApp = 7,
+        ExitCanceled = 8
+    };
+
+    struct Job {
+        Job();
+
+        Mode mode;
+        int slave;
+        quint32 address;
+        quint32 size; // Чтение: 0 - до конца памяти.
+        QByteArray image; // Запись и проверка.
+        QString output; // Чтение: файл образа.
+        QString watch; // Запись: файл образа для слежения, пусто - нет.
+        bool verify; // Проверка после записи.
+        bool verify_all; // Поиск всех расхождений, иначе до первого.
+        bool verify_crc; // Проверка по CRC загрузчика.
+        bool delta_confirm; // Подтверждение кэша образов CRC загрузчика.
+        bool run_app;
+        quint32 flash_baud; // Согласуемая скорость, 0 - нет.
+    };
+
+    explicit CliFlasher(QObject *parent = 0);
+    ~CliFlasher();
+
+    const Job& job() const;
+    void setJob(const Job& job);
+
+    // Вывод событий, по умолчанию stdout.
+    void setEventOutput(QFile* file);
+
+    bool isFinished() const;
+    int exitCode() const;
+
+signals:
+    void finished(int code);
+
+public slots:
+    void start();
+    // Прерывание по сигналу: задание не дожидается ответов.
+    void abort();
+
+private slots:
+    void netError(ModbusErr error);
+    void connectedToNet();
+
+    void confReaded();
+    void confReadError(ModbusErr error);
+
+    void progressSetMax(int val);
+    void progressChanged(int val);
+    void estimateChanged(double eta, double bytes_per_s);
+
+    void dataReaded();
+    void deltaPlanned(int pages, int total);
+    void deltaUnavailable(const QString& reason);
+    void dataWrited();
+    void dataVerified(bool match);
+    void opError(ModbusErr error);
+
+    void appRunned();
+    void appRunError(ModbusErr error);
+
+    void imageChanged(const QByteArray& image);
+
+private:
+    enum Stage {
+        Idle = 0,
+        Connecting,
+        Config,
+        Writing,
+        Reading,
+        Verifying,
+        Running,
+        Watching,
+        Finished
+    };
+
+    Job cli_job;
+    Stage stage;
+    int exit_code;
+
+    ModbusNet* net;
+    ModbusDev* dev;
+    ModbusFirmware* fw;
+
+    ModbusImageWatcher* watcher;
+    // Образ изменился во время задания.
+    bool watch_pending;
+    // Образ, записанный последним в сеансе слежения;
+    // пустой - память устройства неизвестна.
+    QByteArray watch_base;
+
+    QFile* event_out;
+    QFile std_out;
+    QElapsedTimer clock;
+
+    int progress_max;
+    int progress_val;
+
+    void startWrite();
+    void startRead(quint32 size);
+    void startVerify();
+    void runApp();
+    void watchIdle(int code);
+
+    bool inFlash(quint32 size) const;
+
+    void finish(int code);
+    void fail(int code, const QString& message, const QJsonObject& details = QJsonObject());
+    void writeEvent(const QString& name, QJsonObject obj = QJsonObject());
+
+    static const char* stageName(Stage st);
+    static QJsonObject errorJson(ModbusErr error);
+};
+
+#endif // CLIFLASHER_H
@@ -0,0 +1,226 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include "settings.h"
+#include "modbustimeline.h"
+#include "modbusconfcache.h"
+#include "modbusimagecache.h"
+#include "cliflasher.h"
+#include "modbusquitsignals.h"
+#include "modbuscompat.h"
+
+
+#define S(str) QStringLiteral(str)
+
+
+static bool toSize(const QString& str, quint32* size)
+{
+    // Допускаются суффиксы K и M.
+    QString s = str.toUpper();
+    quint32 mul = 1;
+
+    if(s.endsWith(QLatin1Char('K'))){
+        mul = 1024;
+        s.chop(1);
+    }else if(s.endsWith(QLatin1Char('M'))){
+        mul = 1024 * 1024;
+        s.chop(1);
+    }
+
+    bool ok = false;
+    *size = s.toUInt(&ok, 0) * mul;
+
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setOrganizationName(S("artem.lab"));
+    a.setApplicationName(S("qmodbus_flash"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(S("Headless firmware flasher for the Modbus bootloader.\n"
+                                       "Prints one JSON event per line. Exit codes:\n"
+                                       "0 - ok, 1 - usage, 2 - file, 3 - connection, 4 - configuration read,\n"
+                                       "5 - transfer, 6 - verify mismatch, 7 - application start, 8 - canceled."));
+    parser.addHelpOption();
+
+    QCommandLineOption optPort(S("port"), S("Serial port name or path."), S("port"));
+    QCommandLineOption optBaud(S("baud"), S("Baud rate."), S("baud"), S("9600"));
+    QCommandLineOption optParity(S("parity"), S("Parity: none, even, odd."), S("parity"), S("none"));
+    QCommandLineOption optStopBits(S("stop-bits"), S("Stop bits: 1, 2."), S("count"), S("1"));
+    QCommandLineOption optSlave(S("slave"), S("Slave address."), S("addr"), S("1"));
+    QCommandLineOption optMode(S("mode"), S("Operation: write, read, verify."), S("mode"), S("write"));
+    QCommandLineOption optImage(S("image"), S("Image file: source for write and verify, destination for read."), S("file"));
+    QCommandLineOption optAddress(S("address"), S("Flash address."), S("addr"), S("0x08000000"));
+    QCommandLineOption optSize(S("size"), S("Read size, bytes (K/M suffix), 0 - up to the end of flash."), S("bytes"), S("0"));
+    QCommandLineOption optVerify(S("verify"), S("Read back and compare after write."));
+    QCommandLineOption optVerifyAll(S("verify-all"), S("Report all mismatching ranges instead of stopping at the first one."));
+    QCommandLineOption optCrc(S("crc"), S("Verify by the bootloader CRC-32, reading back only mismatching pages."));
+    QCommandLineOption optWatch(S("watch"), S("Write mode: keep running and write changed pages on every image file change."));
+    QCommandLineOption optRun(S("run"), S("Start the application when done."));
+    QCommandLineOption optTimeout(S("timeout"), S("Response timeout, ms."), S("ms"), S("500"));
+    QCommandLineOption optRetries(S("retries"), S("Retries count."), S("count"), S("3"));
+    QCommandLineOption optFrameDelay(S("frame-delay"), S("Minimal inter-frame delay, us."), S("us"), S("0"));
+    QCommandLineOption optFlashBaud(S("flash-baud"), S("Baud rate negotiated with the bootloader, 0 - off."), S("baud"), S("0"));
+    QCommandLineOption optLowLatency(S("low-latency"), S("Linux: low latency serial mode."));
+    QCommandLineOption optLatencyTimer(S("latency-timer"), S("Linux: USB adapter latency timer in low latency mode, ms."), S("ms"), S("1"));
+    QCommandLineOption optRs485(S("rs485"), S("Linux: driver RS-485 mode."));
+    QCommandLineOption optConfCache(S("conf-cache"), S("Bootloader configuration cache file: skips configuration read for known devices."), S("file"));
+    QCommandLineOption optImageCache(S("image-cache"), S("Last written images cache directory: only changed pages are written."), S("dir"));
+    QCommandLineOption optNoDeltaConfirm(S("no-delta-confirm"), S("Trust the image cache without the bootloader CRC check."));
+    QCommandLineOption optEvents(S("events"), S("Write events to file instead of stdout."), S("file"));
+    QCommandLineOption optTimeline(S("timeline"), S("Save Chrome trace timeline to file."), S("file"));
+
+    parser.addOptions({optPort, optBaud, optParity, optStopBits, optSlave,
+                       optMode, optImage, optAddress, optSize, optVerify, optVerifyAll, optCrc, optWatch, optRun,
+                       optTimeout, optRetries, optFrameDelay, optFlashBaud,
+                       optLowLatency, optLatencyTimer, optRs485, optConfCache, optImageCache, optNoDeltaConfirm, optEvents, optTimeline});
+
+    parser.process(a);
+
+    QTextStream err(stderr);
+
+    CliFlasher::Job job;
+
+    QString mode = parser.value(optMode);
+    if(mode == S("write")) job.mode = CliFlasher::Write;
+    else if(mode == S("read")) job.mode = CliFlasher::Read;
+    else if(mode == S("verify")) job.mode = CliFlasher::Verify;
+    else{
+        err << "Invalid mode " << mode << Qt::endl;
+        return CliFlasher::ExitUsage;
+    }
+
+    QSerialPort::Parity parity;
+    QString parity_str = parser.value(optParity);
+    if(parity_str == S("none")) parity = QSerialPort::NoParity;
+    else if(parity_str == S("even")) parity = QSerialPort::EvenParity;
+    else if(parity_str == S("odd")) parity = QSerialPort::OddParity;
+    else{
+        err << "Invalid parity " << parity_str << Qt::endl;
+        return CliFlasher::ExitUsage;
+    }
+
+    QSerialPort::StopBits stop_bits;
+    QString stop_bits_str = parser.value(optStopBits);
+    if(stop_bits_str == S("1")) stop_bits = QSerialPort::OneStop;
+    else if(stop_bits_str == S("2")) stop_bits = QSerialPort::TwoStop;
+    else{
+        err << "Invalid stop bits " << stop_bits_str << Qt::endl;
+        return CliFlasher::ExitUsage;
+    }
+
+    bool baud_ok = false, slave_ok = false, addr_ok = false;
+    quint32 baud = parser.value(optBaud).toUInt(&baud_ok);
+    job.slave = parser.value(optSlave).toInt(&slave_ok);
+    job.address = parser.value(optAddress).toUInt(&addr_ok, 0);
+    job.verify = parser.isSet(optVerify);
+    job.verify_all = parser.isSet(optVerifyAll);
+    job.verify_crc = parser.isSet(optCrc);
+    job.delta_confirm = !parser.isSet(optNoDeltaConfirm);
+    job.run_app = parser.isSet(optRun);
+    job.flash_baud = parser.value(optFlashBaud).toUInt();
+
+    if(!parser.isSet(optPort) || !parser.isSet(optImage) || !baud_ok || baud == 0 ||
+       !slave_ok || job.slave < 1 || job.slave > 247 || !addr_ok || !toSize(parser.value(optSize), &job.size)){
+        err << "Invalid arguments, see --help" << Qt::endl;
+        return CliFlasher::ExitUsage;
+    }
+
+    if(parser.isSet(optWatch)){
+        if(job.mode != CliFlasher::Write){
+            err << "Watch requires write mode" << Qt::endl;
+            return CliFlasher::ExitUsage;
+        }
+        job.watch = parser.value(optImage);
+    }
+
+    if(job.mode == CliFlasher::Read){
+        job.output = parser.value(optImage);
+    }else{
+        QFile file(parser.value(optImage));
+        if(!file.open(QIODevice::ReadOnly)){
+            err << "Can't open image " << file.fileName() << Qt::endl;
+            return CliFlasher::ExitFile;
+        }
+        job.image = file.readAll();
+        if(job.image.isEmpty()){
+            err << "Empty image " << file.fileName() << Qt::endl;
+            return CliFlasher::ExitFile;
+        }
+    }
+
+    QFile events_file;
+    if(parser.isSet(optEvents)){
+        events_file.setFileName(parser.value(optEvents));
+        if(!events_file.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+            err << "Can't open " << events_file.fileName() << Qt::endl;
+            return CliFlasher::ExitFile;
+        }
+    }
+
+    // Настройки приложения не читаются: это не требует
+    // перечисления портов и не зависит от пользователя.
+    Settings& settings = Settings::get();
+    settings.setSerialPortName(parser.value(optPort));
+    settings.setSerialPortBaud(baud);
+    settings.setSerialPortParity(parity);
+    settings.setSerialPortStopBits(stop_bits);
+    settings.setSerialLowLatency(parser.isSet(optLowLatency));
+    settings.setSerialLatencyTimer(parser.value(optLatencyTimer).toUInt());
+    settings.setSerialRs485(parser.isSet(optRs485));
+    settings.setSerialFlashBaud(job.flash_baud);
+    settings.setModbusSlaveAddress(static_cast<quint32>(job.slave));
+    settings.setModbusTimeout(parser.value(optTimeout).toUInt());
+    settings.setModbusRetries(parser.value(optRetries).toUInt());
+    settings.setModbusFrameDelay(parser.value(optFrameDelay).toUInt());
+
+    if(parser.isSet(optTimeline)) ModbusTimeline::get().setEnabled(true);
+
+    // Файла ещё может не быть.
+    if(parser.isSet(optConfCache)){
+        ModbusConfCache::get().setEnabled(true);
+        ModbusConfCache::get().load(parser.value(optConfCache));
+    }
+
+    if(parser.isSet(optImageCache)){
+        if(!ModbusImageCache::get().setDirectory(parser.value(optImageCache))){
+            err << "Can't open image cache " << parser.value(optImageCache) << Qt::endl;
+            return CliFlasher::ExitUsage;
+        }
+        ModbusImageCache::get().setEnabled(true);
+    }
+
+    CliFlasher flasher;
+    flasher.setJob(job);
+    if(events_file.isOpen()) flasher.setEventOutput(&events_file);
+
+    QObject::connect(&flasher, &CliFlasher::finished, &a, [](int code){
+        QCoreApplication::exit(code);
+    });
+
+    ModbusQuitSignals quit_signals;
+    quit_signals.install();
+
+    QTimer::singleShot(0, &flasher, &CliFlasher::start);
+
+    int res = a.exec();
+
+    if(!flasher.isFinished()){
+        flasher.abort();
+    }
+    res = flasher.exitCode();
+
+    if(parser.isSet(optTimeline)) ModbusTimeline::get().save(parser.value(optTimeline));
+
+    if(parser.isSet(optConfCache) && !ModbusConfCache::get().save(parser.value(optConfCache))){
+        err << "Can't save " << parser.value(optConfCache) << Qt::endl;
+    }
+
+    return res;
+}
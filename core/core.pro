@@ -0,0 +1,85 @@
+#-------------------------------------------------
+#
+# Библиотека Modbus: сеть, объекты, загрузчик.
+# Зависит только от QtCore, QtConcurrent, SerialBus и SerialPort.
+#
+#-------------------------------------------------
+
+QT       += core concurrent serialbus serialport
+QT       -= gui
+
+CONFIG   += c++11 staticlib
+
+TARGET = qmodbus_core
+TEMPLATE = lib
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += settings.cpp \
+    modbusnet.cpp \
+    modbusreg.cpp \
+    modbusobj.cpp \
+    modbusdev.cpp \
+    modbusmsg.cpp \
+    modbusfile.cpp \
+    modbusfirmware.cpp \
+    modbuserr.cpp \
+    modbuschain.cpp \
+    modbusnetstats.cpp \
+    modbustransport.cpp \
+    modbusrtutransport.cpp \
+    modbustrace.cpp \
+    modbusreplaytransport.cpp \
+    modbustimeline.cpp \
+    modbusbootsim.cpp \
+    modbusvirtualtransport.cpp \
+    modbusrecordcodec.cpp \
+    modbuspduarena.cpp \
+    modbuspdustream.cpp \
+    modbustransferplanner.cpp \
+    modbusflashestimator.cpp \
+    modbuslinktest.cpp \
+    modbusserialtuning.cpp \
+    modbusconfcache.cpp \
+    modbusimagecompare.cpp \
+    modbuscrc32.cpp \
+    modbusimagedigest.cpp \
+    modbusimagecache.cpp \
+    modbusimagewatcher.cpp \
+    modbusquitsignals.cpp
+
+HEADERS += settings.h \
+    modbusnet.h \
+    modbusreg.h \
+    modbusregview.h \
+    modbusobj.h \
+    modbusdev.h \
+    modbusmsg.h \
+    modbusfile.h \
+    modbusfirmware.h \
+    modbuserr.h \
+    modbuschain.h \
+    modbusnetstats.h \
+    modbustransport.h \
+    modbusrtutransport.h \
+    modbustrace.h \
+    modbusreplaytransport.h \
+    modbustimeline.h \
+    modbusbootregs.h \
+    modbusbootsim.h \
+    modbusvirtualtransport.h \
+    modbusrecordcodec.h \
+    modbuspduarena.h \
+    modbuspdustream.h \
+    modbustransferplanner.h \
+    modbusflashestimator.h \
+    modbuslinktest.h \
+    modbusserialtuning.h \
+    modbusconfcache.h \
+    modbusimagecompare.h \
+    modbuscrc32.h \
+    modbusimagedigest.h \
+    modbusimagecache.h \
+    modbusimagewatcher.h \
+    modbusquitsignals.h \
+    modbuscompat.h
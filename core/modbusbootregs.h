@@ -0,0 +1,51 @@
+#ifndef MODBUSBOOTREGS_H
+#define MODBUSBOOTREGS_H
+
+// Карта Modbus загрузчика.
+
+// Регистры ввода.
+//! Базовый адрес регистров ввода.
+#define BOOT_MODBUS_INPUT_REG_BASE 0x1
+//! Регистр с размером FLASH-памяти.
+#define BOOT_MODBUS_INPUT_REG_FLASH_SIZE (BOOT_MODBUS_INPUT_REG_BASE + 0)
+//! Регистр с размером страницы FLASH-памяти.
+#define BOOT_MODBUS_INPUT_REG_FLASH_PAGE_SIZE (BOOT_MODBUS_INPUT_REG_BASE + 1)
+//! Регистр идентификатора экземпляра устройства (свёртка UID микроконтроллера).
+//! Меняется при замене устройства, по нему проверяется сохранённая конфигурация.
+#define BOOT_MODBUS_INPUT_REG_DEVICE_ID (BOOT_MODBUS_INPUT_REG_BASE + 2)
+//! Регистры CRC-32 участка памяти (2 регистра, старшее слово первым),
+//! заданного BOOT_MODBUS_HOLD_REG_CRC_ADDR и BOOT_MODBUS_HOLD_REG_CRC_SIZE.
+#define BOOT_MODBUS_INPUT_REG_CRC (BOOT_MODBUS_INPUT_REG_BASE + 3)
+// Регистры хранения.
+//! Базовый адрес регистров хранения.
+#define BOOT_MODBUS_HOLD_REG_BASE 0x1
+//! Регистр номера страницы.
+#define BOOT_MODBUS_HOLD_REG_PAGE_NUMBER (BOOT_MODBUS_HOLD_REG_BASE + 0)
+//! Регистр скорости обмена в единицах BOOT_MODBUS_BAUD_DIVIDER бод.
+//! Ответ на запись передаётся на прежней скорости, затем устройство
+//! переходит на новую. Если за BOOT_MODBUS_BAUD_WATCHDOG_MS на новой скорости
+//! не принято ни одного запроса, устройство возвращается к скорости загрузки.
+#define BOOT_MODBUS_HOLD_REG_BAUD (BOOT_MODBUS_HOLD_REG_BASE + 1)
+//! Единица регистра скорости, бод.
+#define BOOT_MODBUS_BAUD_DIVIDER 100
+//! Время подтверждения новой скорости, мс.
+#define BOOT_MODBUS_BAUD_WATCHDOG_MS 1000
+//! Смещение участка CRC от начала FLASH (2 регистра, старшее слово первым).
+#define BOOT_MODBUS_HOLD_REG_CRC_ADDR (BOOT_MODBUS_HOLD_REG_BASE + 2)
+//! Размер участка CRC, байт (2 регистра, старшее слово первым).
+//! Запись младшего слова запускает вычисление, ответ - после его завершения.
+#define BOOT_MODBUS_HOLD_REG_CRC_SIZE (BOOT_MODBUS_HOLD_REG_BASE + 4)
+// Флаги.
+//! Базовый адрес флагов.
+#define BOOT_MODBUS_COIL_BASE 0x1
+//! Флаг стирания страницы по адресу в регистре BOOT_MODBUS_HOLD_REG_PAGE_ADDRESS.
+#define BOOT_MODBUS_COIL_PAGE_ERASE (BOOT_MODBUS_COIL_BASE + 0)
+//! Флаг запуска приложения.
+#define BOOT_MODBUS_COIL_RUN_APP (BOOT_MODBUS_COIL_BASE + 1)
+// Файлы.
+//! Базовый адрес файлов.
+#define BOOT_MODBUS_FILE_BASE 0x1
+//! Файл текущей страницы памяти.
+#define BOOT_MODBUS_FILE_PAGE (BOOT_MODBUS_FILE_BASE + 0)
+
+#endif // MODBUSBOOTREGS_H
@@ -0,0 +1,518 @@
+#include "modbusbootsim.h"
+#include "modbusbootregs.h"
+#include "modbuscrc32.h"
+#include <QDataStream>
+#include <string.h>
+
+
+// Тип ссылки файловых запросов.
+#define REF_TYPE 0x6
+// Значение стёртой FLASH.
+#define FLASH_ERASED 0xff
+
+
+ModbusBootSim::Config::Config()
+{
+    slave_addr = 1;
+    flash_size = 64;
+    page_size = 1024;
+    device_id = 0x5a5a;
+    response_latency = 100;
+    erase_latency = 20000;
+    program_latency = 50;
+    crc_latency = 400;
+    boot_baud = 9600;
+    max_baud = 921600;
+    drop_rate = 0.0;
+    exception_rate = 0.0;
+    seed = 1;
+}
+
+ModbusBootSim::ModbusBootSim(const Config& conf)
+{
+    sim_conf = conf;
+    requests_count = 0;
+    rng_state = conf.seed ? conf.seed : 1;
+    sim_time = 0;
+
+    reset();
+}
+
+ModbusBootSim::~ModbusBootSim()
+{
+}
+
+const ModbusBootSim::Config& ModbusBootSim::config() const
+{
+    return sim_conf;
+}
+
+int ModbusBootSim::slaveAddress() const
+{
+    return sim_conf.slave_addr;
+}
+
+void ModbusBootSim::reset()
+{
+    sim_flash.fill(static_cast<char>(FLASH_ERASED), sim_conf.flash_size * 1024);
+    page_number = 0;
+    app_running = false;
+    sim_baud = sim_conf.boot_baud;
+    baud_pending = false;
+    baud_switch_time = 0;
+    crc_addr = 0;
+    crc_size = 0;
+    crc_value = 0;
+}
+
+const QByteArray& ModbusBootSim::flash() const
+{
+    return sim_flash;
+}
+
+void ModbusBootSim::setFlash(quint32 offset, const QByteArray& data)
+{
+    if(offset >= static_cast<quint32>(sim_flash.size())) return;
+
+    int size = qMin(data.size(), sim_flash.size() - static_cast<int>(offset));
+
+    sim_flash.replace(offset, size, data.constData(), size);
+}
+
+quint32 ModbusBootSim::pageNumber() const
+{
+    return page_number;
+}
+
+bool ModbusBootSim::isAppRunning() const
+{
+    return app_running;
+}
+
+quint32 ModbusBootSim::requestsCount() const
+{
+    return requests_count;
+}
+
+quint32 ModbusBootSim::baud() const
+{
+    return sim_baud;
+}
+
+bool ModbusBootSim::isBaudPending() const
+{
+    return baud_pending;
+}
+
+void ModbusBootSim::setTime(quint64 usecs)
+{
+    sim_time = usecs;
+
+    if(baud_pending && sim_time - baud_switch_time >= BOOT_MODBUS_BAUD_WATCHDOG_MS * 1000ULL){
+        sim_baud = sim_conf.boot_baud;
+        baud_pending = false;
+    }
+}
+
+bool ModbusBootSim::process(const QModbusRequest& req, QModbusResponse* resp, quint32* latency)
+{
+    requests_count ++;
+
+    // Принятый на новой скорости запрос подтверждает её.
+    baud_pending = false;
+
+    *latency = sim_conf.response_latency;
+
+    if(randomEvent(sim_conf.drop_rate)) return false;
+
+    if(randomEvent(sim_conf.exception_rate)){
+        *resp = QModbusExceptionResponse(req.functionCode(), QModbusPdu::ServerDeviceBusy);
+        return true;
+    }
+
+    switch(req.functionCode()){
+    default:
+        *resp = QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalFunction);
+        break;
+    case QModbusPdu::ReadCoils:
+    case QModbusPdu::ReadDiscreteInputs:
+        *resp = readBits(req);
+        break;
+    case QModbusPdu::ReadHoldingRegisters:
+    case QModbusPdu::ReadInputRegisters:
+        *resp = readRegisters(req);
+        break;
+    case QModbusPdu::WriteSingleCoil:
+        *resp = writeSingleCoil(req, latency);
+        break;
+    case QModbusPdu::WriteSingleRegister:
+        *resp = writeSingleRegister(req, latency);
+        break;
+    case QModbusPdu::WriteMultipleRegisters:
+        *resp = writeMultipleRegisters(req, latency);
+        break;
+    case QModbusPdu::ReadFileRecord:
+        *resp = readFileRecord(req);
+        break;
+    case QModbusPdu::WriteFileRecord:
+        *resp = writeFileRecord(req, latency);
+        break;
+    }
+
+    return true;
+}
+
+QModbusResponse ModbusBootSim::readBits(const QModbusRequest& req)
+{
+    QDataStream ds(req.data());
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint16 addr = 0, count = 0;
+    ds >> addr >> count;
+
+    if(ds.status() != QDataStream::Ok || count == 0 || count > 2000){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    // Флаги только для записи, читаются как ноль.
+    if(req.functionCode() == QModbusPdu::ReadDiscreteInputs ||
+       addr < BOOT_MODBUS_COIL_BASE || addr + count > BOOT_MODBUS_COIL_RUN_APP + 1){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+    }
+
+    QByteArray data;
+    data.append(static_cast<char>((count + 7) / 8));
+    data.append(QByteArray((count + 7) / 8, 0));
+
+    return QModbusResponse(req.functionCode(), data);
+}
+
+QModbusResponse ModbusBootSim::readRegisters(const QModbusRequest& req)
+{
+    QDataStream ds(req.data());
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint16 addr = 0, count = 0;
+    ds >> addr >> count;
+
+    if(ds.status() != QDataStream::Ok || count == 0 || count > 125){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    QModbusDataUnit::RegisterType type = (req.functionCode() == QModbusPdu::ReadInputRegisters) ?
+                QModbusDataUnit::InputRegisters : QModbusDataUnit::HoldingRegisters;
+
+    QByteArray data;
+
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::BigEndian);
+
+    out << static_cast<quint8>(count * 2);
+
+    for(quint16 i = 0; i < count; i ++){
+        quint16 value = 0;
+        if(!readRegister(type, addr + i, &value)){
+            return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+        }
+        out << value;
+    }
+
+    return QModbusResponse(req.functionCode(), data);
+}
+
+QModbusResponse ModbusBootSim::writeSingleCoil(const QModbusRequest& req, quint32* latency)
+{
+    QDataStream ds(req.data());
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint16 addr = 0, value = 0;
+    ds >> addr >> value;
+
+    if(ds.status() != QDataStream::Ok || (value != 0xff00 && value != 0x0000)){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    switch(addr){
+    default:
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+    case BOOT_MODBUS_COIL_PAGE_ERASE:
+        if(value){
+            quint32 page_addr = page_number * sim_conf.page_size;
+            if(page_addr + sim_conf.page_size > static_cast<quint32>(sim_flash.size())){
+                return QModbusExceptionResponse(req.functionCode(), QModbusPdu::ServerDeviceFailure);
+            }
+            memset(sim_flash.data() + page_addr, FLASH_ERASED, sim_conf.page_size);
+            *latency += sim_conf.erase_latency;
+        }
+        break;
+    case BOOT_MODBUS_COIL_RUN_APP:
+        if(value) app_running = true;
+        break;
+    }
+
+    return QModbusResponse(req.functionCode(), req.data());
+}
+
+QModbusResponse ModbusBootSim::writeSingleRegister(const QModbusRequest& req, quint32* latency)
+{
+    QDataStream ds(req.data());
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint16 addr = 0, value = 0;
+    ds >> addr >> value;
+
+    if(ds.status() != QDataStream::Ok){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    if(!writeRegister(addr, value, latency)){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+    }
+
+    return QModbusResponse(req.functionCode(), req.data());
+}
+
+QModbusResponse ModbusBootSim::writeMultipleRegisters(const QModbusRequest& req, quint32* latency)
+{
+    QDataStream ds(req.data());
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint16 addr = 0, count = 0;
+    quint8 bytes = 0;
+    ds >> addr >> count >> bytes;
+
+    if(ds.status() != QDataStream::Ok || count == 0 || bytes != count * 2 ||
+       req.data().size() != 5 + bytes){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    for(quint16 i = 0; i < count; i ++){
+        quint16 value = 0;
+        ds >> value;
+        if(!writeRegister(addr + i, value, latency)){
+            return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+        }
+    }
+
+    QByteArray data;
+
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::BigEndian);
+    out << addr << count;
+
+    return QModbusResponse(req.functionCode(), data);
+}
+
+QModbusResponse ModbusBootSim::readFileRecord(const QModbusRequest& req)
+{
+    QDataStream ds(req.data());
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint8 byte_count = 0;
+    ds >> byte_count;
+
+    if(byte_count == 0 || byte_count % 7 != 0 || req.data().size() != byte_count + 1){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    quint32 page_addr = page_number * sim_conf.page_size;
+    if(page_addr + sim_conf.page_size > static_cast<quint32>(sim_flash.size())){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+    }
+
+    QByteArray resp_data;
+    resp_data.append('\0');
+
+    for(int sub = 0; sub < byte_count / 7; sub ++){
+        quint8 ref_type = 0;
+        quint16 file_num = 0, rec_num = 0, rec_len = 0;
+
+        ds >> ref_type >> file_num >> rec_num >> rec_len;
+
+        if(ref_type != REF_TYPE){
+            return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+        }
+
+        if(file_num != BOOT_MODBUS_FILE_PAGE ||
+           (static_cast<quint32>(rec_num) + rec_len) * 2 > sim_conf.page_size){
+            return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+        }
+
+        resp_data.append(static_cast<char>(1 + rec_len * 2));
+        resp_data.append(static_cast<char>(REF_TYPE));
+
+        const char* flash_data = sim_flash.constData() + page_addr + rec_num * 2;
+
+        // Запись - полуслово в порядке байт FLASH (little-endian),
+        // в сети - big-endian.
+        for(quint16 i = 0; i < rec_len; i ++){
+            resp_data.append(flash_data[i * 2 + 1]);
+            resp_data.append(flash_data[i * 2]);
+        }
+    }
+
+    // Ответ ограничен размером PDU (253 байта),
+    // как у загрузчика, а не 0xF5 байтами данных по спецификации.
+    if(resp_data.size() + 1 > 253){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    resp_data[0] = static_cast<char>(resp_data.size() - 1);
+
+    return QModbusResponse(req.functionCode(), resp_data);
+}
+
+QModbusResponse ModbusBootSim::writeFileRecord(const QModbusRequest& req, quint32* latency)
+{
+    const QByteArray data = req.data();
+
+    if(data.size() < 1 || static_cast<quint8>(data.at(0)) != data.size() - 1){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+    }
+
+    quint32 page_addr = page_number * sim_conf.page_size;
+    if(page_addr + sim_conf.page_size > static_cast<quint32>(sim_flash.size())){
+        return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+    }
+
+    int pos = 1;
+
+    while(pos < data.size()){
+        if(data.size() - pos < 7){
+            return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+        }
+
+        const uchar* sub = reinterpret_cast<const uchar*>(data.constData() + pos);
+
+        quint8 ref_type = sub[0];
+        quint16 file_num = static_cast<quint16>((sub[1] << 8) | sub[2]);
+        quint16 rec_num = static_cast<quint16>((sub[3] << 8) | sub[4]);
+        quint16 rec_len = static_cast<quint16>((sub[5] << 8) | sub[6]);
+
+        pos += 7;
+
+        if(ref_type != REF_TYPE || data.size() - pos < rec_len * 2){
+            return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataValue);
+        }
+
+        if(file_num != BOOT_MODBUS_FILE_PAGE ||
+           (static_cast<quint32>(rec_num) + rec_len) * 2 > sim_conf.page_size){
+            return QModbusExceptionResponse(req.functionCode(), QModbusPdu::IllegalDataAddress);
+        }
+
+        char* flash_data = sim_flash.data() + page_addr + rec_num * 2;
+        const char* rec_data = data.constData() + pos;
+
+        for(quint16 i = 0; i < rec_len; i ++){
+            char lo = rec_data[i * 2 + 1];
+            char hi = rec_data[i * 2];
+
+            char& flash_lo = flash_data[i * 2];
+            char& flash_hi = flash_data[i * 2 + 1];
+
+            // Запись в нестёртое полуслово - ошибка программирования.
+            bool erased = static_cast<uchar>(flash_lo) == FLASH_ERASED &&
+                          static_cast<uchar>(flash_hi) == FLASH_ERASED;
+            if(!erased && (flash_lo != lo || flash_hi != hi)){
+                return QModbusExceptionResponse(req.functionCode(), QModbusPdu::ServerDeviceFailure);
+            }
+
+            flash_lo = lo;
+            flash_hi = hi;
+        }
+
+        *latency += sim_conf.program_latency * rec_len;
+
+        pos += rec_len * 2;
+    }
+
+    return QModbusResponse(req.functionCode(), data);
+}
+
+bool ModbusBootSim::readRegister(QModbusDataUnit::RegisterType type, quint16 addr, quint16* value) const
+{
+    if(type == QModbusDataUnit::InputRegisters){
+        switch(addr){
+        default:
+            return false;
+        case BOOT_MODBUS_INPUT_REG_FLASH_SIZE:
+            *value = static_cast<quint16>(sim_conf.flash_size);
+            return true;
+        case BOOT_MODBUS_INPUT_REG_FLASH_PAGE_SIZE:
+            *value = static_cast<quint16>(sim_conf.page_size);
+            return true;
+        case BOOT_MODBUS_INPUT_REG_DEVICE_ID:
+            *value = sim_conf.device_id;
+            return true;
+        case BOOT_MODBUS_INPUT_REG_CRC:
+            *value = static_cast<quint16>(crc_value >> 16);
+            return true;
+        case BOOT_MODBUS_INPUT_REG_CRC + 1:
+            *value = static_cast<quint16>(crc_value);
+            return true;
+        }
+    }
+
+    switch(addr){
+    default:
+        return false;
+    case BOOT_MODBUS_HOLD_REG_PAGE_NUMBER:
+        *value = static_cast<quint16>(page_number);
+        return true;
+    case BOOT_MODBUS_HOLD_REG_BAUD:
+        *value = static_cast<quint16>(sim_baud / BOOT_MODBUS_BAUD_DIVIDER);
+        return true;
+    }
+}
+
+bool ModbusBootSim::writeRegister(quint16 addr, quint16 value, quint32* latency)
+{
+    switch(addr){
+    default:
+        return false;
+    case BOOT_MODBUS_HOLD_REG_PAGE_NUMBER:
+        if(static_cast<quint32>(value) * sim_conf.page_size >= static_cast<quint32>(sim_flash.size())) return false;
+        page_number = value;
+        return true;
+    case BOOT_MODBUS_HOLD_REG_BAUD:{
+        quint32 baud = static_cast<quint32>(value) * BOOT_MODBUS_BAUD_DIVIDER;
+        if(baud < 1200 || baud > sim_conf.max_baud) return false;
+        // Переход после отправки ответа, подтверждение - следующим запросом.
+        if(baud != sim_baud){
+            sim_baud = baud;
+            baud_pending = baud != sim_conf.boot_baud;
+            baud_switch_time = sim_time;
+        }
+    }return true;
+    case BOOT_MODBUS_HOLD_REG_CRC_ADDR:
+        crc_addr = (crc_addr & 0xffff) | (static_cast<quint32>(value) << 16);
+        return true;
+    case BOOT_MODBUS_HOLD_REG_CRC_ADDR + 1:
+        crc_addr = (crc_addr & 0xffff0000) | value;
+        return true;
+    case BOOT_MODBUS_HOLD_REG_CRC_SIZE:
+        crc_size = (crc_size & 0xffff) | (static_cast<quint32>(value) << 16);
+        return true;
+    case BOOT_MODBUS_HOLD_REG_CRC_SIZE + 1:{
+        crc_size = (crc_size & 0xffff0000) | value;
+
+        quint32 flash_size = static_cast<quint32>(sim_flash.size());
+        if(crc_size == 0 || crc_addr >= flash_size || crc_size > flash_size - crc_addr) return false;
+
+        crc_value = ModbusCrc32::calc(sim_flash.constData() + crc_addr, static_cast<int>(crc_size));
+        *latency += static_cast<quint32>((static_cast<quint64>(sim_conf.crc_latency) * crc_size + 1023) / 1024);
+    }return true;
+    }
+}
+
+bool ModbusBootSim::randomEvent(double rate)
+{
+    if(rate <= 0.0) return false;
+
+    // xorshift32 - воспроизводимая последовательность для заданного seed.
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+
+    return (static_cast<double>(rng_state) / 4294967296.0) < rate;
+}
@@ -0,0 +1,107 @@
+#ifndef MODBUSBOOTSIM_H
+#define MODBUSBOOTSIM_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QModbusPdu>
+#include <QModbusDataUnit>
+#include <QModbusRequest>
+#include <QModbusResponse>
+
+
+/*
+ * Модель загрузчика stm32f10x с доступом по Modbus:
+ * карта регистров, флагов и файлов BOOT_MODBUS_*,
+ * FLASH-память со стиранием по страницам,
+ * задержки стирания/записи и внесение ошибок.
+ * Работает на уровне PDU, транспорт - забота пользователя.
+ */
+class ModbusBootSim
+{
+public:
+
+    struct Config {
+        Config();
+
+        int slave_addr;
+        quint32 flash_size; // кбайт.
+        quint32 page_size; // байт.
+        quint16 device_id; // BOOT_MODBUS_INPUT_REG_DEVICE_ID.
+        quint32 response_latency; // мкс, обработка любого запроса.
+        quint32 erase_latency; // мкс, стирание страницы.
+        quint32 program_latency; // мкс, запись полуслова.
+        quint32 crc_latency; // мкс, CRC-32 одного кбайта.
+        quint32 boot_baud; // Скорость после сброса.
+        quint32 max_baud; // Наибольшая скорость для BOOT_MODBUS_HOLD_REG_BAUD.
+        double drop_rate; // Доля запросов без ответа.
+        double exception_rate; // Доля запросов с исключением SlaveDeviceBusy.
+        quint32 seed;
+    };
+
+    explicit ModbusBootSim(const Config& conf = Config());
+    ~ModbusBootSim();
+
+    const Config& config() const;
+
+    int slaveAddress() const;
+
+    // Стирание всей памяти и сброс регистров.
+    void reset();
+
+    const QByteArray& flash() const;
+    void setFlash(quint32 offset, const QByteArray& data);
+
+    quint32 pageNumber() const;
+    bool isAppRunning() const;
+
+    quint32 requestsCount() const;
+
+    /*
+     * Скорость обмена устройства. Транспорт передаёт запрос
+     * устройству, только если скорость линии совпадает,
+     * и сообщает время через setTime() для сторожевого таймера
+     * подтверждения новой скорости.
+     */
+    quint32 baud() const;
+    bool isBaudPending() const;
+    void setTime(quint64 usecs);
+
+    /*
+     * Обработка запроса.
+     * Возвращает ложь, если ответ должен быть потерян.
+     * latency - время обработки запроса устройством, мкс.
+     */
+    bool process(const QModbusRequest& req, QModbusResponse* resp, quint32* latency);
+
+private:
+    QModbusResponse readBits(const QModbusRequest& req);
+    QModbusResponse readRegisters(const QModbusRequest& req);
+    QModbusResponse writeSingleCoil(const QModbusRequest& req, quint32* latency);
+    QModbusResponse writeSingleRegister(const QModbusRequest& req, quint32* latency);
+    QModbusResponse writeMultipleRegisters(const QModbusRequest& req, quint32* latency);
+    QModbusResponse readFileRecord(const QModbusRequest& req);
+    QModbusResponse writeFileRecord(const QModbusRequest& req, quint32* latency);
+
+    bool readRegister(QModbusDataUnit::RegisterType type, quint16 addr, quint16* value) const;
+    bool writeRegister(quint16 addr, quint16 value, quint32* latency);
+
+    bool randomEvent(double rate);
+
+    Config sim_conf;
+    QByteArray sim_flash;
+    quint32 page_number;
+    bool app_running;
+    quint32 requests_count;
+    quint32 rng_state;
+
+    quint32 sim_baud;
+    bool baud_pending;
+    quint64 baud_switch_time;
+    quint64 sim_time;
+
+    quint32 crc_addr;
+    quint32 crc_size;
+    quint32 crc_value;
+};
+
+#endif // MODBUSBOOTSIM_H
@@ -1,8 +1,9 @@
 #include "modbuschain.h"
+#include "modbustimeline.h"
 
 ModbusChain::ModbusChain(QObject *parent) : QObject(parent)
 {
-    need_cancel = false;
+    chain_name = "chain";
     chain_state = Idle;
     chain_list = new ChainList();
     chain_index = 0;
@@ -47,12 +48,21 @@ bool ModbusChain::isExecuting() const
     return chain_state == Executing;
 }
 
+const char* ModbusChain::name() const
+{
+    return chain_name;
+}
+
+void ModbusChain::setName(const char* chain_name)
+{
+    this->chain_name = chain_name;
+}
+
 bool ModbusChain::exec()
 {
     if(chain_state == Executing) return false;
     if(chain_list->empty()) return false;
 
-    need_cancel = false;
     chain_state = Executing;
     chain_index = 0;
 
@@ -66,7 +76,22 @@ bool ModbusChain::cancel()
     if(chain_state != Executing) return false;
     if(chain_list->empty()) return false;
 
-    need_cancel = true;
+    if(chain_index >= chain_list->size()){
+        qDebug() << "ModbusChain: cancel chain_index out of range!";
+        return false;
+    }
+
+    ChainItem item = (*chain_list)[chain_index];
+    item.disconnectSignals(this);
+
+    ModbusTimeline::asyncEnd("chain", chain_name, this, "index", chain_index);
+
+    chain_state = Canceled;
+
+    // Ответ на передаваемый запрос не ждётся.
+    item.cancel();
+
+    emit canceled();
 
     return true;
 }
@@ -86,12 +111,9 @@ void ModbusChain::chainItemSucc()
     ChainItem item = (*chain_list)[chain_index];
     item.disconnectSignals(this);
 
-    if(need_cancel){
-
-        chain_state = Canceled;
-        emit canceled();
+    ModbusTimeline::asyncEnd("chain", chain_name, this, "index", chain_index);
 
-    }else if(++ chain_index >= chain_list->size()){
+    if(++ chain_index >= chain_list->size()){
 
         chain_state = Done;
         emit success();
@@ -118,6 +140,8 @@ void ModbusChain::chainItemFail(ModbusErr error)
     ChainItem& item = (*chain_list)[chain_index];
     item.disconnectSignals(this);
 
+    ModbusTimeline::asyncEnd("chain", chain_name, this, "index", chain_index);
+
     emit fail(error);
 }
 
@@ -136,6 +160,8 @@ void ModbusChain::chainNext()
     ChainItem& item = (*chain_list)[chain_index];
     item.connectSignals(this, &ModbusChain::chainItemSucc, &ModbusChain::chainItemFail);
 
+    ModbusTimeline::asyncBegin("chain", chain_name, this, "index", chain_index);
+
     if(!item.exec()){
         ModbusErr err(ModbusErr::General, tr("ModbusChain"), tr("Error executing chain item"));
         chainItemFail(err);
@@ -158,6 +184,11 @@ bool ModbusChain::ChainItem::exec()
     return exec_proc();
 }
 
+void ModbusChain::ChainItem::cancel()
+{
+    item_signals->cancel();
+}
+
 void ModbusChain::ChainItem::connectSignals(ModbusChain* chain, ChainSuccSlot succ, ChainFailSlot fail)
 {
     item_signals->connectSignals(chain, succ, fail);
@@ -44,6 +44,12 @@ public:
     bool isDone() const;
     bool isExecuting() const;
 
+    // Имя цепочки на временной шкале (строковый литерал).
+    const char* name() const;
+    void setName(const char* chain_name);
+
+    // Объект элемента должен поддерживать cancel()
+    // для прерывания выполняемого элемента при отмене цепочки.
     template <typename Obj, typename Exec>
     void append(Obj* object, SuccFunc<Obj> succ, FailFunc<Obj> fail, Exec exec);
 
@@ -54,6 +60,8 @@ signals:
 
 public slots:
     bool exec();
+    // Прерывание выполняемого элемента, сигнал canceled
+    // выдаётся до возврата.
     bool cancel();
 
 private slots:
@@ -73,6 +81,7 @@ private:
         ~ChainItem();
 
         bool exec();
+        void cancel();
         void connectSignals(ModbusChain* chain, ChainSuccSlot succ, ChainFailSlot fail);
         void disconnectSignals(ModbusChain* chain);
 
@@ -89,6 +98,7 @@ private:
 
         virtual void connectSignals(ModbusChain* chain, ChainSuccSlot succ, ChainFailSlot fail) = 0;
         virtual void disconnectSignals(ModbusChain* chain) = 0;
+        virtual void cancel() = 0;
     };
 
     template <typename Obj>
@@ -101,6 +111,7 @@ private:
 
         void connectSignals(ModbusChain* chain, ChainSuccSlot succ, ChainFailSlot fail);
         void disconnectSignals(ModbusChain* chain);
+        void cancel();
 
         Obj* object;
         SuccFunc<Obj> succ_signal;
@@ -109,7 +120,7 @@ private:
 
     typedef QList<ChainItem> ChainList;
 
-    bool need_cancel;
+    const char* chain_name;
     State chain_state;
     ChainList* chain_list;
     int chain_index;
@@ -163,4 +174,10 @@ void ModbusChain::ChainItemSignalsTempl<Obj>::disconnectSignals(ModbusChain* cha
     QObject::disconnect(object, fail_signal, chain, nullptr);
 }
 
+template <typename Obj>
+void ModbusChain::ChainItemSignalsTempl<Obj>::cancel()
+{
+    object->cancel();
+}
+
 #endif // MODBUSCHAIN_H
@@ -0,0 +1,21 @@
+#ifndef MODBUSCOMPAT_H
+#define MODBUSCOMPAT_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QTextStream>
+
+
+/*
+ * Qt::endl и Qt::SkipEmptyParts появились в Qt 5.14,
+ * прежние QString::SkipEmptyParts и endl в 5.15 устарели.
+ * Для старых версий имена из Qt сводятся к прежним.
+ */
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+namespace Qt {
+    static const QString::SplitBehavior SkipEmptyParts = QString::SkipEmptyParts;
+    using ::endl;
+}
+#endif
+
+#endif // MODBUSCOMPAT_H
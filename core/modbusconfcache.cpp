@@ -0,0 +1,128 @@
+#include "modbusconfcache.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+
+
+ModbusConfCache::Entry::Entry()
+{
+    device_id = 0;
+    flash_size = 0;
+    page_size = 0;
+}
+
+ModbusConfCache::ModbusConfCache()
+{
+    cache_enabled = false;
+}
+
+ModbusConfCache& ModbusConfCache::get()
+{
+    static ModbusConfCache cache;
+
+    return cache;
+}
+
+ModbusConfCache::~ModbusConfCache()
+{
+}
+
+bool ModbusConfCache::isEnabled() const
+{
+    return cache_enabled;
+}
+
+void ModbusConfCache::setEnabled(bool enabled)
+{
+    cache_enabled = enabled;
+}
+
+bool ModbusConfCache::find(const QString& link, int slave, Entry* entry) const
+{
+    if(!cache_enabled || link.isEmpty()) return false;
+
+    auto it = entries.constFind(key(link, slave));
+    if(it == entries.constEnd()) return false;
+
+    *entry = it.value();
+
+    return true;
+}
+
+void ModbusConfCache::insert(const QString& link, int slave, const Entry& entry)
+{
+    if(!cache_enabled || link.isEmpty()) return;
+
+    entries.insert(key(link, slave), entry);
+}
+
+void ModbusConfCache::remove(const QString& link, int slave)
+{
+    entries.remove(key(link, slave));
+}
+
+void ModbusConfCache::clear()
+{
+    entries.clear();
+}
+
+int ModbusConfCache::count() const
+{
+    return entries.size();
+}
+
+bool ModbusConfCache::load(const QString& filename)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if(!doc.isArray()) return false;
+
+    for(const QJsonValue& val: doc.array()){
+        QJsonObject obj = val.toObject();
+
+        QString link = obj.value(QStringLiteral("link")).toString();
+        int slave = obj.value(QStringLiteral("slave")).toInt();
+
+        Entry entry;
+        entry.device_id = static_cast<quint16>(obj.value(QStringLiteral("device_id")).toInt());
+        entry.flash_size = static_cast<quint32>(obj.value(QStringLiteral("flash_size")).toDouble());
+        entry.page_size = static_cast<quint32>(obj.value(QStringLiteral("page_size")).toDouble());
+
+        if(link.isEmpty() || entry.flash_size == 0 || entry.page_size == 0) continue;
+
+        entries.insert(key(link, slave), entry);
+    }
+
+    return true;
+}
+
+bool ModbusConfCache::save(const QString& filename) const
+{
+    QJsonArray arr;
+
+    for(auto it = entries.constBegin(); it != entries.constEnd(); ++ it){
+        int sep = it.key().lastIndexOf(QLatin1Char('#'));
+
+        QJsonObject obj;
+        obj[QStringLiteral("link")] = it.key().left(sep);
+        obj[QStringLiteral("slave")] = it.key().mid(sep + 1).toInt();
+        obj[QStringLiteral("device_id")] = it.value().device_id;
+        obj[QStringLiteral("flash_size")] = static_cast<double>(it.value().flash_size);
+        obj[QStringLiteral("page_size")] = static_cast<double>(it.value().page_size);
+
+        arr.append(obj);
+    }
+
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    return file.write(QJsonDocument(arr).toJson()) >= 0;
+}
+
+QString ModbusConfCache::key(const QString& link, int slave)
+{
+    return link + QLatin1Char('#') + QString::number(slave);
+}
@@ -0,0 +1,54 @@
+#ifndef MODBUSCONFCACHE_H
+#define MODBUSCONFCACHE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QHash>
+
+
+/*
+ * Кэш конфигурации загрузчиков: размеры памяти и страницы
+ * по ключу линия + адрес устройства. Вместе с конфигурацией
+ * хранится идентификатор устройства BOOT_MODBUS_INPUT_REG_DEVICE_ID,
+ * по которому ModbusFirmware проверяет запись перед первым заданием.
+ * Может сохраняться в файл между запусками.
+ */
+class ModbusConfCache
+{
+public:
+
+    struct Entry {
+        Entry();
+
+        quint16 device_id;
+        quint32 flash_size; // кбайт.
+        quint32 page_size; // байт.
+    };
+
+    static ModbusConfCache& get();
+    ~ModbusConfCache();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    bool find(const QString& link, int slave, Entry* entry) const;
+    void insert(const QString& link, int slave, const Entry& entry);
+    void remove(const QString& link, int slave);
+
+    void clear();
+    int count() const;
+
+    // Файл JSON: массив записей.
+    bool load(const QString& filename);
+    bool save(const QString& filename) const;
+
+private:
+    ModbusConfCache();
+
+    static QString key(const QString& link, int slave);
+
+    bool cache_enabled;
+    QHash<QString, Entry> entries;
+};
+
+#endif // MODBUSCONFCACHE_H
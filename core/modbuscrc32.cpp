@@ -0,0 +1,159 @@
+#include "modbuscrc32.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32_ARMV8
+#endif
+
+
+#define CRC32_POLY 0xedb88320
+
+
+#if !defined(CRC32_ARMV8)
+// Таблицы slicing-by-8: table[k][b] - CRC байта b, за которым следуют k нулевых.
+struct Crc32Tables {
+    Crc32Tables()
+    {
+        for(uint32_t b = 0; b < 256; b ++){
+            uint32_t crc = b;
+            for(int i = 0; i < 8; i ++){
+                crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLY : 0);
+            }
+            table[0][b] = crc;
+        }
+
+        for(uint32_t b = 0; b < 256; b ++){
+            for(int k = 1; k < 8; k ++){
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+            }
+        }
+    }
+
+    uint32_t table[8][256];
+};
+
+static const Crc32Tables crc32_tables;
+#endif
+
+
+uint32_t ModbusCrc32::calc(const void* data, int size)
+{
+    return update(0, data, size);
+}
+
+uint32_t ModbusCrc32::update(uint32_t crc, const void* data, int size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+
+    crc = ~crc;
+
+#if defined(CRC32_ARMV8)
+    for(; size >= 8; size -= 8, p += 8){
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32d(crc, v);
+    }
+
+    for(; size > 0; size --, p ++){
+        crc = __crc32b(crc, *p);
+    }
+#else
+    const uint32_t (*t)[256] = crc32_tables.table;
+
+    // Слова читаются как little-endian.
+    for(; size >= 8; size -= 8, p += 8){
+        uint32_t lo = crc ^ (static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                             static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24);
+        uint32_t hi = static_cast<uint32_t>(p[4]) | static_cast<uint32_t>(p[5]) << 8 |
+                      static_cast<uint32_t>(p[6]) << 16 | static_cast<uint32_t>(p[7]) << 24;
+
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+              t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+
+    for(; size > 0; size --, p ++){
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    }
+#endif
+
+    return ~crc;
+}
+
+// Умножение матрицы 32x32 над GF(2) на вектор.
+static uint32_t gf2MatrixTimes(const uint32_t* mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+
+    for(; vec; vec >>= 1, mat ++){
+        if(vec & 1) sum ^= *mat;
+    }
+
+    return sum;
+}
+
+static void gf2MatrixSquare(uint32_t* square, const uint32_t* mat)
+{
+    for(int n = 0; n < 32; n ++){
+        square[n] = gf2MatrixTimes(mat, mat[n]);
+    }
+}
+
+uint32_t ModbusCrc32::combine(uint32_t crc1, uint32_t crc2, uint64_t size2)
+{
+    if(size2 == 0) return crc1;
+
+    // Сдвиг crc1 на size2 нулевых байт - возведением
+    // в степень оператора сдвига на один бит.
+    uint32_t even[32];
+    uint32_t odd[32];
+
+    odd[0] = CRC32_POLY;
+    for(int n = 1; n < 32; n ++){
+        odd[n] = 1u << (n - 1);
+    }
+
+    gf2MatrixSquare(even, odd); // 2 бита.
+    gf2MatrixSquare(odd, even); // 4 бита.
+
+    do{
+        gf2MatrixSquare(even, odd);
+        if(size2 & 1) crc1 = gf2MatrixTimes(even, crc1);
+        size2 >>= 1;
+
+        if(size2 == 0) break;
+
+        gf2MatrixSquare(odd, even);
+        if(size2 & 1) crc1 = gf2MatrixTimes(odd, crc1);
+        size2 >>= 1;
+    }while(size2);
+
+    return crc1 ^ crc2;
+}
+
+uint32_t ModbusCrc32::updateScalar(uint32_t crc, const void* data, int size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+
+    crc = ~crc;
+
+    for(int i = 0; i < size; i ++){
+        crc ^= p[i];
+        for(int k = 0; k < 8; k ++){
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32_POLY : 0);
+        }
+    }
+
+    return ~crc;
+}
+
+const char* ModbusCrc32::implementation()
+{
+#if defined(CRC32_ARMV8)
+    return "armv8";
+#else
+    return "slice8";
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef MODBUSCRC32_H
+#define MODBUSCRC32_H
+
+#include <stdint.h>
+
+
+/*
+ * CRC-32 (IEEE 802.3, как в zlib): полином 0x04c11db7 в отражённой
+ * форме, начальное значение и итоговое xor 0xffffffff.
+ * Так же считает загрузчик для BOOT_MODBUS_INPUT_REG_CRC.
+ * Вычисление по 8 байт за шаг таблицами slicing-by-8,
+ * на ARMv8 с расширением CRC - инструкциями процессора.
+ */
+class ModbusCrc32
+{
+public:
+    static uint32_t calc(const void* data, int size);
+
+    // Продолжение вычисления: crc - результат предыдущего calc/update.
+    static uint32_t update(uint32_t crc, const void* data, int size);
+
+    // CRC склейки блоков: crc1 - первого, crc2 - второго блока длиной size2.
+    static uint32_t combine(uint32_t crc1, uint32_t crc2, uint64_t size2);
+
+    // Побайтовая реализация, для проверки и сравнения.
+    static uint32_t updateScalar(uint32_t crc, const void* data, int size);
+
+    // Используемая реализация: "armv8" или "slice8".
+    static const char* implementation();
+};
+
+#endif // MODBUSCRC32_H
@@ -57,3 +57,10 @@ bool ModbusDev::sendMsg(ModbusMsg* msg)
 
     return modbus_net->sendMsg(msg, slave_address);
 }
+
+bool ModbusDev::cancelMsg(ModbusMsg* msg)
+{
+    if(!modbus_net) return false;
+
+    return modbus_net->cancelMsg(msg);
+}
@@ -25,6 +25,7 @@ public:
     int maxPduSize() const;
 
     bool sendMsg(ModbusMsg* msg);
+    bool cancelMsg(ModbusMsg* msg);
 
 signals:
 
@@ -1,25 +1,31 @@
 #include "modbusfile.h"
 #include "modbusmsg.h"
+#include "modbusrecordcodec.h"
 #include <QModbusReply>
 #include <QModbusResponse>
 #include <QByteArray>
-#include <QDataStream>
 #include <QDebug>
+#include <string.h>
 
 
 #define REF_TYPE 0x6
 
+// ref_type(1) + file_num(2) + rec_num(2) + rec_len(2).
+#define SUB_REQ_HEADER_SIZE 7
+
 
 ModbusFile::ModbusFile(QObject *parent) : ModbusObj(parent)
 {
     file_number = 0;
     rgns_queue = new RgnsQueue();
+    rgn_msg = nullptr;
 }
 
 ModbusFile::ModbusFile(ModbusDev* dev, uint16_t fileNum, QObject* parent) : ModbusObj(dev, parent)
 {
     file_number = fileNum;
     rgns_queue = new RgnsQueue();
+    rgn_msg = nullptr;
 }
 
 ModbusFile::~ModbusFile()
@@ -63,6 +69,36 @@ bool ModbusFile::writeRegion(ModbusFileRegion* fileRgn)
     return true;
 }
 
+bool ModbusFile::cancelRegion(ModbusFileRegion* fileRgn)
+{
+    bool canceled = false;
+
+    for(int i = rgns_queue->size() - 1; i > 0; i --){
+        if((*rgns_queue)[i].region() != fileRgn) continue;
+
+        rgns_queue->removeAt(i);
+        canceled = true;
+    }
+
+    if(rgns_queue->empty() || rgns_queue->first().region() != fileRgn) return canceled;
+
+    if(rgn_msg){
+        ModbusMsg* msg = rgn_msg;
+        rgn_msg = nullptr;
+
+        disconnect(msg, nullptr, this, nullptr);
+
+        if(modbusDev()) modbusDev()->cancelMsg(msg);
+
+        msg->deleteLater();
+    }
+
+    rgns_queue->removeFirst();
+    doNextRegionOp();
+
+    return true;
+}
+
 void ModbusFile::regionOpMsgSended()
 {
     ModbusMsg* msg = qobject_cast<ModbusMsg*>(sender());
@@ -71,6 +107,8 @@ void ModbusFile::regionOpMsgSended()
         return;
     }
 
+    if(msg == rgn_msg) rgn_msg = nullptr;
+
     msg->deleteLater();
 
     if(!msg->isSended()) return;
@@ -133,6 +171,8 @@ void ModbusFile::regionOpMsgError(ModbusErr error)
         return;
     }
 
+    if(msg == rgn_msg) rgn_msg = nullptr;
+
     msg->deleteLater();
 
     if(rgns_queue->empty()){
@@ -183,7 +223,10 @@ bool ModbusFile::processRegionOp()
     connect(msg, &ModbusMsg::sendSuccess, this, &ModbusFile::regionOpMsgSended);
     connect(msg, &ModbusMsg::sendError, this, &ModbusFile::regionOpMsgError);
 
+    rgn_msg = msg;
+
     if(!modbusDev()->sendMsg(msg)){
+        rgn_msg = nullptr;
         delete msg;
         return false;
     }
@@ -248,15 +291,14 @@ bool ModbusFile::RegionOp::iterStoreData(const QModbusResponse& resp)
 {
     if(op_type != Read) return false;
 
-    QDataStream ds(resp.data());
-    ds.setByteOrder(QDataStream::BigEndian);
+    const QByteArray resp_data = resp.data();
+    if(resp_data.size() < 3) return false;
 
-    uint8_t data_len = 0,
-            resp_len = 0,
-            ref_type = 0;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(resp_data.constData());
 
-    ds >> data_len;
-    ds >> resp_len >> ref_type;
+    uint8_t data_len = data[0],
+            resp_len = data[1],
+            ref_type = data[2];
 
     if(ref_type != REF_TYPE) return false;
     if(resp_len != data_len - 1) return false; // only single request;
@@ -264,15 +306,13 @@ bool ModbusFile::RegionOp::iterStoreData(const QModbusResponse& resp)
     int resp_records_data_len = resp_len - 1;
     int reading_records_data_len = cur_count * 2;
     if(resp_records_data_len != reading_records_data_len) return false;
+    if(resp_data.size() < 3 + resp_records_data_len) return false;
 
     uint16_t last_index = cur_index + cur_count;
     if(last_index > file_region->recordsCount()) return false;
 
-    QVector<uint16_t>& records = file_region->records();
-
-    for(uint16_t index = cur_index; index < last_index; index ++){
-        ds >> records[index];
-    }
+    // Записи уже в порядке байт на линии.
+    memcpy(file_region->record_data.data() + cur_index * 2, data + 3, resp_records_data_len);
 
     return true;
 }
@@ -293,19 +333,9 @@ QModbusRequest ModbusFile::RegionOp::readModbusRequset() const
     ModbusFile* file = file_region->modbusFile();
     if(!file) return QModbusRequest();
 
-    QByteArray data;
+    QByteArray data(1 + SUB_REQ_HEADER_SIZE, Qt::Uninitialized);
 
-    QDataStream ds(&data, QIODevice::WriteOnly);
-    ds.setByteOrder(QDataStream::BigEndian);
-
-    uint8_t byte_count = 7; // ref_type(1) + file_num(2) + rec_num(2) + rec_len(2).
-    uint8_t ref_type = REF_TYPE;
-    uint16_t file_num = file->fileNumber();
-    uint16_t rec_num = cur_index;
-    uint16_t rec_len = cur_count;
-
-    ds << byte_count << ref_type;
-    ds << file_num << rec_num << rec_len;
+    putHeader(reinterpret_cast<uint8_t*>(data.data()), SUB_REQ_HEADER_SIZE, file->fileNumber());
 
     return QModbusRequest(QModbusPdu::ReadFileRecord, data);
 }
@@ -315,30 +345,35 @@ QModbusRequest ModbusFile::RegionOp::writeModbusRequset() const
     ModbusFile* file = file_region->modbusFile();
     if(!file) return QModbusRequest();
 
-    QByteArray data;
+    uint16_t last_index = cur_index + cur_count;
+    if(last_index > file_region->recordsCount()) return QModbusRequest();
 
-    QDataStream ds(&data, QIODevice::WriteOnly);
-    ds.setByteOrder(QDataStream::BigEndian);
+    int records_size = cur_count * sizeof(uint16_t);
 
-    uint8_t data_len = 7 /* ref_type(1) + file_num(2) + rec_num(2) + rec_len(2) */ + cur_count * sizeof(uint16_t);
-    uint8_t ref_type = REF_TYPE;
-    uint16_t file_num = file->fileNumber();
-    uint16_t rec_num = cur_index;
-    uint16_t rec_len = cur_count;
+    QByteArray data(1 + SUB_REQ_HEADER_SIZE + records_size, Qt::Uninitialized);
+    uint8_t* ptr = reinterpret_cast<uint8_t*>(data.data());
 
-    ds << data_len << ref_type;
-    ds << file_num << rec_num << rec_len;
+    putHeader(ptr, SUB_REQ_HEADER_SIZE + records_size, file->fileNumber());
 
-    QVector<uint16_t>& records = file_region->records();
+    // Записи уже в порядке байт на линии.
+    memcpy(ptr + 1 + SUB_REQ_HEADER_SIZE, file_region->record_data.constData() + cur_index * 2, records_size);
 
-    uint16_t last_index = cur_index + cur_count;
-    if(last_index > file_region->recordsCount()) return QModbusRequest();
+    return QModbusRequest(QModbusPdu::WriteFileRecord, data);
+}
 
-    for(uint16_t index = cur_index; index < last_index; index ++){
-        ds << records[index];
-    }
+void ModbusFile::RegionOp::putHeader(uint8_t* ptr, uint8_t data_len, uint16_t file_num) const
+{
+    uint16_t rec_num = file_region->recordNumber() + cur_index;
+    uint16_t rec_len = cur_count;
 
-    return QModbusRequest(QModbusPdu::WriteFileRecord, data);
+    ptr[0] = data_len;
+    ptr[1] = REF_TYPE;
+    ptr[2] = file_num >> 8;
+    ptr[3] = file_num & 0xff;
+    ptr[4] = rec_num >> 8;
+    ptr[5] = rec_num & 0xff;
+    ptr[6] = rec_len >> 8;
+    ptr[7] = rec_len & 0xff;
 }
 
 uint16_t ModbusFile::RegionOp::remainCount() const
@@ -382,7 +417,7 @@ ModbusFileRegion::ModbusFileRegion(ModbusFile* mbFile, uint16_t recNum, uint16_t
 {
     modbus_file = mbFile;
     record_number = recNum;
-    record_data.resize(recsCount);
+    record_data.fill(0, recsCount * 2);
 }
 
 ModbusFileRegion::~ModbusFileRegion()
@@ -411,23 +446,26 @@ void ModbusFileRegion::setRecordNumber(uint16_t recNum)
 
 uint16_t ModbusFileRegion::recordsCount() const
 {
-    return record_data.size();
+    return record_data.size() / 2;
 }
 
 void ModbusFileRegion::setRecordsCount(uint16_t recsCount)
 {
-    record_data.resize(recsCount);
+    int old_size = record_data.size();
+    int new_size = recsCount * 2;
+
+    record_data.resize(new_size);
+
+    if(new_size > old_size){
+        memset(record_data.data() + old_size, 0, new_size - old_size);
+    }
 }
 
 QByteArray ModbusFileRegion::data() const
 {
-    QByteArray ba;
-    QDataStream ds(&ba, QIODevice::WriteOnly);
-    ds.setByteOrder(QDataStream::LittleEndian);
+    QByteArray ba(record_data.size(), Qt::Uninitialized);
 
-    for(const quint16& data: record_data){
-        ds << data;
-    }
+    ModbusRecordCodec::swap(ba.data(), record_data.constData(), recordsCount());
 
     return ba;
 }
@@ -439,40 +477,53 @@ void ModbusFileRegion::setData(const QByteArray& data)
     // Число целых записей в массиве.
     int count = data.size() / sizeof(uint16_t);
 
-    QDataStream ds(data);
-    ds.setByteOrder(QDataStream::LittleEndian);
+    record_data.resize(recs_count * 2);
 
-    record_data.resize(recs_count);
+    ModbusRecordCodec::swap(record_data.data(), data.constData(), count);
 
-    // Цикл по записям в массиве.
-    for(int i = 0; i < count; i ++){
-        ds >> record_data[i];
+    // Если остался байт данных - он младший в последней записи.
+    if(recs_count != count){
+        record_data[recs_count * 2 - 2] = 0;
+        record_data[recs_count * 2 - 1] = data.at(data.size() - 1);
     }
+}
 
-    // Если остался байт данных.
-    if(recs_count != count){
-        // Последний байт.
-        uint8_t last_rec_byte = 0;
-        // Считаем.
-        ds >> last_rec_byte;
-        // Присвоим.
-        record_data[recs_count - 1] = last_rec_byte;
+QVector<uint16_t> ModbusFileRegion::records() const
+{
+    QVector<uint16_t> recs(recordsCount());
+
+    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(record_data.constData());
+
+    for(int i = 0; i < recs.size(); i ++){
+        recs[i] = (ptr[i * 2] << 8) | ptr[i * 2 + 1];
     }
+
+    return recs;
 }
 
-const QVector<uint16_t>& ModbusFileRegion::records() const
+void ModbusFileRegion::setRecords(const QVector<uint16_t>& recs)
 {
-    return record_data;
+    record_data.resize(recs.size() * 2);
+
+    uint8_t* ptr = reinterpret_cast<uint8_t*>(record_data.data());
+
+    for(int i = 0; i < recs.size(); i ++){
+        ptr[i * 2] = recs[i] >> 8;
+        ptr[i * 2 + 1] = recs[i] & 0xff;
+    }
 }
 
-QVector<uint16_t>& ModbusFileRegion::records()
+const QByteArray& ModbusFileRegion::wireData() const
 {
     return record_data;
 }
 
-void ModbusFileRegion::setRecords(const QVector<uint16_t>& recs)
+void ModbusFileRegion::setWireData(const QByteArray& data)
 {
-    record_data = recs;
+    record_data = data;
+
+    // Только целые записи.
+    if(record_data.size() % 2 != 0) record_data.chop(1);
 }
 
 bool ModbusFileRegion::read()
@@ -489,6 +540,13 @@ bool ModbusFileRegion::write()
     return modbus_file->writeRegion(this);
 }
 
+bool ModbusFileRegion::cancel()
+{
+    if(!modbus_file) return false;
+
+    return modbus_file->cancelRegion(this);
+}
+
 void ModbusFileRegion::file_read_region()
 {
     emit dataReaded();
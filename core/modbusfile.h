@@ -11,6 +11,7 @@
 
 
 class ModbusFileRegion;
+class ModbusMsg;
 class QModbusResponse;
 
 
@@ -28,6 +29,10 @@ public:
     bool readRegion(ModbusFileRegion* fileRgn);
     bool writeRegion(ModbusFileRegion* fileRgn);
 
+    // Отмена операций области без сигналов,
+    // передаваемый запрос прерывается.
+    bool cancelRegion(ModbusFileRegion* fileRgn);
+
 signals:
     void regionReaded(ModbusFileRegion* fileRgn);
     void regionWrited(ModbusFileRegion* fileRgn);
@@ -37,7 +42,8 @@ private slots:
     void regionOpMsgSended();
     void regionOpMsgError(ModbusErr error);
 
-private:
+// DEBUG.
+public:
 
     class RegionOp {
     public:
@@ -69,16 +75,21 @@ private:
 
         QModbusRequest readModbusRequset() const;
         QModbusRequest writeModbusRequset() const;
+        void putHeader(uint8_t* ptr, uint8_t data_len, uint16_t file_num) const;
 
         uint16_t remainCount() const;
         uint16_t maxCount() const;
     };
 
+private:
     uint16_t file_number;
 
     typedef QQueue<RegionOp> RgnsQueue;
     RgnsQueue* rgns_queue;
 
+    // Сообщение первой операции очереди.
+    ModbusMsg* rgn_msg;
+
     bool doNextRegionOp();
     bool processRegionOp();
 
@@ -107,15 +118,20 @@ public:
     uint16_t recordsCount() const;
     void setRecordsCount(uint16_t recsCount);
 
+    // Данные в порядке байт образа (little-endian).
     QByteArray data() const;
     void setData(const QByteArray& data);
 
-    const QVector<uint16_t>& records() const;
-    QVector<uint16_t>& records();
+    QVector<uint16_t> records() const;
     void setRecords(const QVector<uint16_t>& recs);
 
+    // Записи в порядке байт на линии (big-endian).
+    const QByteArray& wireData() const;
+    void setWireData(const QByteArray& data);
+
     bool read();
     bool write();
+    bool cancel();
 
 signals:
     void dataReaded();
@@ -131,7 +147,8 @@ private:
     ModbusFile* modbus_file;
     uint16_t record_number;
 
-    QVector<uint16_t> record_data;
+    // Записи в порядке байт на линии.
+    QByteArray record_data;
 };
 
 
@@ -0,0 +1,1752 @@
+#include "modbusfirmware.h"
+#include "modbusreg.h"
+#include "modbusfile.h"
+#include "modbuschain.h"
+#include "modbuspduarena.h"
+#include "modbuspdustream.h"
+#include "modbustimeline.h"
+#include "modbusbootregs.h"
+#include "modbusconfcache.h"
+#include "modbusnet.h"
+#include "modbustransport.h"
+#include "modbusimagecompare.h"
+#include "modbusimagedigest.h"
+#include "modbusimagecache.h"
+#include <QTimer>
+
+
+// Запас к сторожевому таймеру скорости загрузчика, мс.
+#define BAUD_WATCHDOG_MARGIN 50
+
+
+ModbusFirmware::ModbusFirmware(QObject *parent) : ModbusObj(parent)
+{
+    conf_chain = nullptr;
+    reg_flash_size = nullptr;
+    reg_page_size = nullptr;
+    reg_run_app = nullptr;
+    reg_page_num = nullptr;
+    file_page = nullptr;
+    file_rgn_page = nullptr;
+    iter_chain = nullptr;
+    write_planner = nullptr;
+    write_arena = nullptr;
+    write_stream = nullptr;
+    write_page_index = 0;
+    conf_start_time = 0;
+    entry_time = 0;
+    reg_baud = nullptr;
+    target_baud = 0;
+    boot_baud = 0;
+    negotiated_baud = 0;
+    baud_stage = BaudNone;
+    baud_switch_time = 0;
+    baud_ping_time = 0;
+    reg_device_id = nullptr;
+    reg_crc_range = nullptr;
+    reg_crc = nullptr;
+    crc_chain = nullptr;
+    fw_digest = nullptr;
+    conf_readed = false;
+    conf_cached = false;
+    conf_device_id = 0;
+    conf_device_known = false;
+    id_stage = IdNone;
+    check_op = Read;
+    check_address = 0;
+    check_size = 0;
+    check_resume = false;
+    verify_stop_at_first = true;
+    verify_crc = false;
+    crc_stage = CrcNone;
+    crc_address = 0;
+    crc_wait = false;
+    crc_device = 0;
+    crc_index = 0;
+    delta_confirm = true;
+    delta_address = 0;
+    delta_old_address = 0;
+    delta_old_size = 0;
+    delta_old_crc = 0;
+    delta_base_address = 0;
+
+    op_iter.setModbusFirmware(this);
+}
+
+ModbusFirmware::ModbusFirmware(ModbusDev* dev, QObject* parent) : ModbusObj(dev, parent)
+{
+    conf_chain = nullptr;
+    reg_flash_size = nullptr;
+    reg_page_size = nullptr;
+    reg_run_app = nullptr;
+    reg_page_num = nullptr;
+    file_page = nullptr;
+    file_rgn_page = nullptr;
+    iter_chain = nullptr;
+    write_planner = nullptr;
+    write_arena = nullptr;
+    write_stream = nullptr;
+    write_page_index = 0;
+    conf_start_time = 0;
+    entry_time = 0;
+    reg_baud = nullptr;
+    target_baud = 0;
+    boot_baud = 0;
+    negotiated_baud = 0;
+    baud_stage = BaudNone;
+    baud_switch_time = 0;
+    baud_ping_time = 0;
+    reg_device_id = nullptr;
+    reg_crc_range = nullptr;
+    reg_crc = nullptr;
+    crc_chain = nullptr;
+    fw_digest = nullptr;
+    conf_readed = false;
+    conf_cached = false;
+    conf_device_id = 0;
+    conf_device_known = false;
+    id_stage = IdNone;
+    check_op = Read;
+    check_address = 0;
+    check_size = 0;
+    check_resume = false;
+    verify_stop_at_first = true;
+    verify_crc = false;
+    crc_stage = CrcNone;
+    crc_address = 0;
+    crc_wait = false;
+    crc_device = 0;
+    crc_index = 0;
+    delta_confirm = true;
+    delta_address = 0;
+    delta_old_address = 0;
+    delta_old_size = 0;
+    delta_old_crc = 0;
+    delta_base_address = 0;
+
+    op_iter.setModbusFirmware(this);
+}
+
+ModbusFirmware::~ModbusFirmware()
+{
+    if(conf_chain) delete conf_chain;
+    if(reg_flash_size) delete reg_flash_size;
+    if(reg_page_size) delete reg_page_size;
+    if(reg_run_app) delete reg_run_app;
+    if(reg_baud) delete reg_baud;
+    if(reg_device_id) delete reg_device_id;
+    if(crc_chain) delete crc_chain;
+    if(reg_crc_range) delete reg_crc_range;
+    if(reg_crc) delete reg_crc;
+    if(fw_digest) delete fw_digest;
+    if(reg_page_num) delete reg_page_num;
+    if(file_page) delete file_page;
+    if(file_rgn_page) delete file_rgn_page;
+    if(iter_chain) delete iter_chain;
+    if(write_stream) delete write_stream;
+    if(write_arena) delete write_arena;
+    if(write_planner) delete write_planner;
+}
+
+bool ModbusFirmware::isConfReaded() const
+{
+    return conf_readed && baud_stage == BaudNone;
+}
+
+bool ModbusFirmware::isConfCached() const
+{
+    return conf_readed && conf_cached;
+}
+
+bool ModbusFirmware::isExecuting() const
+{
+    return id_stage == IdCheck ||
+           crc_stage != CrcNone ||
+           (iter_chain && iter_chain->isExecuting()) ||
+           (write_stream && write_stream->isExecuting());
+}
+
+quint32 ModbusFirmware::flashSize() const
+{
+    if(!reg_flash_size) return 0;
+    return reg_flash_size->value();
+}
+
+quint32 ModbusFirmware::pageSize() const
+{
+    if(!reg_page_size) return 0;
+    return reg_page_size->value();
+}
+
+quint32 ModbusFirmware::pagesCount() const
+{
+    quint32 flash_size = flashSize();
+    quint32 page_size = pageSize();
+
+    if(flash_size == 0 || page_size == 0) return 0;
+
+    return flash_size * 1024 / page_size;
+}
+
+quint32 ModbusFirmware::pageNumber(quint32 addr) const
+{
+    quint32 pg_size = pageSize();
+    if(!pg_size) return 0;
+
+    if(addr >= flashBase()) addr -= flashBase();
+
+    return addr / pg_size;
+}
+
+quint32 ModbusFirmware::pageAddress(quint32 pg_num) const
+{
+    return flashBase() + pg_num * pageSize();
+}
+
+quint32 ModbusFirmware::pageAlignedAddress(quint32 addr) const
+{
+    return addr & ~(pageSize() - 1);
+}
+
+quint32 ModbusFirmware::dataSize() const
+{
+    return op_iter.size;
+}
+
+quint32 ModbusFirmware::dataAddress() const
+{
+    return op_iter.address;
+}
+
+const QByteArray& ModbusFirmware::data() const
+{
+    return op_iter.buffer;
+}
+
+void ModbusFirmware::setData(const QByteArray& ba)
+{
+    op_iter.buffer = ba;
+}
+
+bool ModbusFirmware::readData(quint32 address, quint32 size)
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return false;
+    if(isExecuting()) return false;
+    if(op_iter.running) return false;
+
+    if(conf_cached) return confCheck(Read, address, size, QByteArray());
+
+    return readStart(Read, address, size, QByteArray());
+}
+
+bool ModbusFirmware::writeData(quint32 address, const QByteArray& ba)
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return false;
+    if(isExecuting()) return false;
+    if(op_iter.running) return false;
+    if(pageSize() == 0 || ba.isEmpty()) return false;
+
+    delta_base.clear();
+
+    if(conf_cached) return confCheck(Write, address, static_cast<quint32>(ba.size()), ba);
+
+    return writeStart(address, ba);
+}
+
+bool ModbusFirmware::writeDataDelta(quint32 address, const QByteArray& ba, quint32 base_address, const QByteArray& base)
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return false;
+    if(isExecuting()) return false;
+    if(op_iter.running) return false;
+    if(pageSize() == 0 || ba.isEmpty() || base.isEmpty()) return false;
+
+    delta_base_address = base_address;
+    delta_base = base;
+
+    bool res = conf_cached ? confCheck(Write, address, static_cast<quint32>(ba.size()), ba) :
+                             writeStart(address, ba);
+
+    if(!res) delta_base.clear();
+
+    return res;
+}
+
+bool ModbusFirmware::verifyData(quint32 address, const QByteArray& ba, bool stop_at_first)
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return false;
+    if(isExecuting()) return false;
+    if(op_iter.running) return false;
+    if(ba.isEmpty()) return false;
+
+    verify_stop_at_first = stop_at_first;
+    verify_crc = false;
+    verify_mismatches.clear();
+
+    if(conf_cached) return confCheck(Verify, address, static_cast<quint32>(ba.size()), ba);
+
+    return readStart(Verify, address, static_cast<quint32>(ba.size()), ba);
+}
+
+bool ModbusFirmware::verifyCrc(quint32 address, const QByteArray& ba, bool stop_at_first)
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return false;
+    if(isExecuting()) return false;
+    if(op_iter.running) return false;
+    if(pageSize() == 0 || ba.isEmpty()) return false;
+
+    verify_stop_at_first = stop_at_first;
+    verify_crc = true;
+    verify_mismatches.clear();
+
+    if(conf_cached) return confCheck(Verify, address, static_cast<quint32>(ba.size()), ba);
+
+    return crcStart(address, ba);
+}
+
+const QVector<ModbusFirmware::Mismatch>& ModbusFirmware::mismatches() const
+{
+    return verify_mismatches;
+}
+
+bool ModbusFirmware::deltaConfirm() const
+{
+    return delta_confirm;
+}
+
+void ModbusFirmware::setDeltaConfirm(bool confirm)
+{
+    delta_confirm = confirm;
+}
+
+bool ModbusFirmware::readStart(OpType op, quint32 address, quint32 size, const QByteArray& image)
+{
+    createReadOpObjects();
+
+    if(iter_chain->empty()){
+
+        iter_chain->clear();
+
+        iter_chain->append(reg_page_num, &ModbusReg::dataWrited, &ModbusReg::errorOccured, [this]{
+            return reg_page_num->write();
+        });
+
+        /*read_chain->append(reg_page_erase, &ModbusReg::dataWrited, &ModbusReg::errorOccured, [this]{
+            return reg_page_erase->write();
+        });*/
+
+        iter_chain->append(file_rgn_page, &ModbusFileRegion::dataReaded, &ModbusFileRegion::errorOccured, [this]{
+            return file_rgn_page->read();
+        });
+    }
+
+    op_type = op;
+    op_iter.begin(address, size);
+    // Проверка: образ для сравнения, прочитанное не накапливается.
+    if(op == Verify) op_iter.buffer = image;
+
+    ModbusTimeline::asyncBegin("firmware", opName(op), &op_iter, "size", size);
+
+    emit progressSetMin(0);
+    emit progressSetMax(op_iter.size);
+    emit progressChanged(op_iter.cur_size);
+
+    estimateStart(estimateRead(address, size));
+
+    iterChainNext();
+
+    return true;
+}
+
+bool ModbusFirmware::writeStart(quint32 address, const QByteArray& ba)
+{
+    delta_pages.clear();
+
+    // Прежний образ записан этим же сеансом - подтверждение не нужно.
+    if(!delta_base.isEmpty()){
+        QByteArray base = delta_base;
+        delta_base.clear();
+
+        if(!deltaDiff(address, ba, delta_base_address, base)){
+            emit deltaUnavailable(tr("All pages changed"));
+            return writeBegin(address, ba);
+        }
+
+        deltaWrite(true);
+        return true;
+    }
+
+    if(!deltaFind(address, ba)) return writeBegin(address, ba);
+
+    if(!delta_confirm){
+        deltaWrite(true);
+        return true;
+    }
+
+    // Одна CRC прежнего образа подтверждает, что память
+    // не менялась после записи.
+    createCrcObjects();
+
+    crc_stage = CrcDelta;
+
+    if(!crcNext()){
+        crc_stage = CrcNone;
+        deltaWrite(false, tr("Error requesting previous image CRC"));
+    }
+
+    return true;
+}
+
+bool ModbusFirmware::writeBegin(quint32 address, const QByteArray& ba)
+{
+    createWriteOpObjects();
+
+    op_type = Write;
+    op_iter.begin(address, ba.size());
+    op_iter.buffer = ba;
+
+    // CRC страниц для проверки после записи - в пуле потоков, параллельно передаче.
+    startDigest(address, ba);
+
+    updateLink();
+    planWrite();
+
+    ModbusTimeline::asyncBegin("firmware", opName(Write), &op_iter, "size", ba.size());
+
+    emit progressSetMin(0);
+    emit progressSetMax(op_iter.size);
+    emit progressChanged(op_iter.cur_size);
+
+    estimateStart(fw_estimator.predict(write_planner));
+    entry_time = netTimestamp();
+
+    write_page_index = 0;
+
+    ModbusTimeline::asyncBegin("firmware", "page", this, "page", op_iter.page);
+
+    // Все страницы совпадают с записанным образом.
+    if(write_arena->count() == 0){
+        QTimer::singleShot(0, this, [this]{
+            while(op_iter.running && opPageDone());
+        });
+        return true;
+    }
+
+    if(!write_stream->exec()){
+        opFail(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Error executing write stream!")));
+    }
+
+    return true;
+}
+
+bool ModbusFirmware::cancel()
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return false;
+
+    // Задание ещё не начато - проверка устройства прерывается.
+    if(id_stage == IdCheck){
+        reg_device_id->cancel();
+
+        id_stage = IdNone;
+        check_data.clear();
+
+        emitOpCanceled(check_op);
+        return true;
+    }
+
+    // Конфигурация перечитывается, задание ещё не начато.
+    if(check_resume){
+        check_resume = false;
+        check_data.clear();
+
+        emitOpCanceled(check_op);
+        return true;
+    }
+
+    if(crc_stage == CrcWhole || crc_stage == CrcPages || crc_stage == CrcDelta){
+        // Ответ устройства получен, ожидаются только CRC образа.
+        if(crc_wait){
+            crcEnd();
+            emit dataVerifyCanceled();
+            return true;
+        }
+        return crc_chain->cancel();
+    }
+
+    if(!op_iter.running) return false;
+
+    if(write_stream && write_stream->isExecuting()){
+        return write_stream->cancel();
+    }
+
+    if(!iter_chain) return false;
+    if(!iter_chain->isExecuting()) return false;
+
+    return iter_chain->cancel();
+}
+
+double ModbusFirmware::estimateRead(quint32 address, quint32 size)
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return 0.0;
+
+    updateLink();
+
+    ModbusTransferPlanner planner;
+    setupPlanner(&planner);
+
+    if(!planner.planRead(flashOffset(address), size)) return 0.0;
+
+    return fw_estimator.predict(&planner);
+}
+
+double ModbusFirmware::estimateWrite(quint32 address, const QByteArray& ba)
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return 0.0;
+
+    updateLink();
+
+    ModbusTransferPlanner planner;
+    setupPlanner(&planner);
+
+    if(!planner.planWrite(flashOffset(address), ba)) return 0.0;
+
+    return fw_estimator.predict(&planner);
+}
+
+const ModbusFlashEstimator& ModbusFirmware::estimator() const
+{
+    return fw_estimator;
+}
+
+double ModbusFirmware::eta() const
+{
+    return fw_estimator.eta();
+}
+
+double ModbusFirmware::bytesPerSecond() const
+{
+    return fw_estimator.bytesPerSecond();
+}
+
+quint32 ModbusFirmware::targetBaud() const
+{
+    return target_baud;
+}
+
+void ModbusFirmware::setTargetBaud(quint32 baud)
+{
+    target_baud = baud;
+}
+
+quint32 ModbusFirmware::negotiatedBaud() const
+{
+    return negotiated_baud;
+}
+
+const ModbusTransferPlanner::Capabilities& ModbusFirmware::capabilities() const
+{
+    return fw_caps;
+}
+
+void ModbusFirmware::setCapabilities(const ModbusTransferPlanner::Capabilities& caps)
+{
+    fw_caps = caps;
+}
+
+bool ModbusFirmware::runApp()
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return false;
+
+    if(!reg_run_app){
+        reg_run_app = new ModbusReg(modbusDev(), QModbusDataUnit::Coils, BOOT_MODBUS_COIL_RUN_APP);
+        reg_run_app->setValue(1);
+
+        // Приложение работает на своей скорости.
+        connect(reg_run_app, &ModbusReg::dataWrited, this, [this]{
+            if(negotiated_baud != 0){
+                modbusDev()->modbusNet()->setBaud(boot_baud);
+                negotiated_baud = 0;
+            }
+            emit appRunned();
+        });
+        connect(reg_run_app, &ModbusReg::errorOccured, this, &ModbusFirmware::appRunErrorOccured);
+    }
+
+    return reg_run_app->write();
+}
+
+void ModbusFirmware::confRead()
+{
+    if(!modbusDev() || !modbusDev()->isValid()) return;
+
+    if(!reg_flash_size)
+        reg_flash_size = new ModbusReg(modbusDev(), QModbusDataUnit::InputRegisters, BOOT_MODBUS_INPUT_REG_FLASH_SIZE);
+
+    if(!reg_page_size)
+        reg_page_size = new ModbusReg(modbusDev(), QModbusDataUnit::InputRegisters, BOOT_MODBUS_INPUT_REG_FLASH_PAGE_SIZE);
+
+    if(!conf_chain){
+        conf_chain = new ModbusChain();
+        conf_chain->setName("conf");
+
+        conf_chain->append(reg_flash_size, &ModbusReg::dataReaded, &ModbusReg::errorOccured, [this]{
+            return reg_flash_size->read();
+        });
+
+        conf_chain->append(reg_page_size, &ModbusReg::dataReaded, &ModbusReg::errorOccured, [this]{
+            return reg_page_size->read();
+        });
+
+        connect(conf_chain, &ModbusChain::success, this, &ModbusFirmware::confChainSuccess);
+        connect(conf_chain, &ModbusChain::fail, this, &ModbusFirmware::confChainFail);
+
+    }
+
+    // Скорость сети сменили извне - прежнее согласование недействительно.
+    ModbusNet* net = modbusDev()->modbusNet();
+    if(negotiated_baud != net->baud()){
+        negotiated_baud = 0;
+        boot_baud = net->baud();
+    }
+    baud_stage = BaudNone;
+
+    conf_readed = false;
+    conf_cached = false;
+    conf_device_known = false;
+    id_stage = IdNone;
+
+    updateLink();
+
+    // Конфигурация из кэша проверяется при первом задании.
+    ModbusConfCache::Entry entry;
+    if(ModbusConfCache::get().find(confCacheLink(), modbusDev()->slaveAddress(), &entry)){
+        reg_flash_size->setValue(static_cast<uint16_t>(entry.flash_size));
+        reg_page_size->setValue(static_cast<uint16_t>(entry.page_size));
+        conf_device_id = entry.device_id;
+        conf_device_known = true;
+        conf_cached = true;
+
+        // Сигнал, как и после чтения, - после возврата из confRead().
+        QTimer::singleShot(0, this, [this]{
+            if(conf_cached && !conf_readed && baud_stage == BaudNone) confDone();
+        });
+        return;
+    }
+
+    conf_start_time = netTimestamp();
+
+    if(!conf_chain->exec()){
+        confChainFail(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Update chain exec fail!")));
+    }
+}
+
+void ModbusFirmware::confChainSuccess()
+{
+    if(conf_chain == nullptr){
+        qDebug() << "ModbusFirmware: updateChainSuccess update_chain == nullptr!";
+        return;
+    }
+
+    // Два чтения входного регистра: запрос 5 байт PDU, ответ 4.
+    quint64 rtt = (netTimestamp() - conf_start_time) / 1000 / 2;
+    fw_estimator.addRttSample(rtt, 5, 4);
+
+    // Идентификатор - только для кэша конфигурации или образов.
+    if((!ModbusConfCache::get().isEnabled() && !ModbusImageCache::get().isEnabled()) ||
+       confCacheLink().isEmpty()){
+        confDone();
+        return;
+    }
+
+    createDeviceIdReg();
+
+    id_stage = IdStore;
+
+    if(!reg_device_id->read()){
+        id_stage = IdNone;
+        confDone();
+    }
+}
+
+void ModbusFirmware::confChainFail(ModbusErr error)
+{
+    if(conf_chain == nullptr){
+        qDebug() << "ModbusFirmware: confChainFail update_chain == nullptr!";
+        return;
+    }
+
+    // Загрузчик мог быть перезапущен и вернуться на скорость загрузки.
+    if(negotiated_baud != 0){
+        modbusDev()->modbusNet()->setBaud(boot_baud);
+        negotiated_baud = 0;
+
+        updateLink();
+        conf_start_time = netTimestamp();
+
+        if(conf_chain->exec()) return;
+    }
+
+    emit confReadErrorOccured(error);
+
+    checkResumeFail(error);
+}
+
+void ModbusFirmware::baudRegWrited()
+{
+    if(baud_stage != BaudSwitch) return;
+
+    // Загрузчик ответил на прежней скорости и перешёл на новую.
+    baud_switch_time = netTimestamp();
+
+    if(!modbusDev()->modbusNet()->setBaud(target_baud)){
+        qDebug() << "ModbusFirmware: transport can't change baud rate!";
+        baudFallback();
+        return;
+    }
+
+    baud_stage = BaudVerify;
+
+    baudPing();
+}
+
+void ModbusFirmware::baudRegReaded()
+{
+    ModbusNet* net = modbusDev()->modbusNet();
+
+    if(reg_baud->value() != net->baud() / BOOT_MODBUS_BAUD_DIVIDER){
+        baudRegError(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Baud rate verify fail!")));
+        return;
+    }
+
+    switch(baud_stage){
+    default:
+        return;
+    case BaudVerify:
+    case BaudRecover:
+        negotiated_baud = net->baud();
+
+        // RTT на новой скорости: чтение регистра, запрос 5 байт PDU, ответ 4.
+        updateLink();
+        fw_estimator.addRttSample((netTimestamp() - baud_ping_time) / 1000, 5, 4);
+        break;
+    case BaudFallback:
+        negotiated_baud = 0;
+        break;
+    }
+
+    baudDone();
+}
+
+void ModbusFirmware::baudRegError(ModbusErr error)
+{
+    ModbusNet* net = modbusDev()->modbusNet();
+
+    qDebug() << "ModbusFirmware: baud negotiation stage" << baud_stage << "fail:" << error.errorStr();
+
+    switch(baud_stage){
+    default:
+        return;
+    case BaudSwitch:
+        // Исключение - скорость не поддерживается, загрузчик остался на прежней.
+        if(error.modbusError() == QModbusDevice::ProtocolError){
+            baudDone();
+            return;
+        }
+        baudFallback();
+        break;
+    case BaudVerify:
+        baudFallback();
+        break;
+    case BaudFallback:
+        // Ответ на проверку мог потеряться после перехода загрузчика.
+        baud_stage = BaudRecover;
+        net->setBaud(target_baud);
+        baudPing();
+        break;
+    case BaudRecover:
+        baud_stage = BaudNone;
+        net->setBaud(boot_baud);
+        updateLink();
+        conf_cached = false;
+        emit confReadErrorOccured(error);
+        checkResumeFail(error);
+        break;
+    }
+}
+
+void ModbusFirmware::baudSwitch()
+{
+    if(!reg_baud){
+        reg_baud = new ModbusReg(modbusDev(), QModbusDataUnit::HoldingRegisters, BOOT_MODBUS_HOLD_REG_BAUD);
+
+        connect(reg_baud, &ModbusReg::dataWrited, this, &ModbusFirmware::baudRegWrited);
+        connect(reg_baud, &ModbusReg::dataReaded, this, &ModbusFirmware::baudRegReaded);
+        connect(reg_baud, &ModbusReg::errorOccured, this, &ModbusFirmware::baudRegError);
+    }
+
+    baud_stage = BaudSwitch;
+
+    reg_baud->setValue(static_cast<uint16_t>(target_baud / BOOT_MODBUS_BAUD_DIVIDER));
+
+    if(!reg_baud->write()){
+        baudDone();
+    }
+}
+
+void ModbusFirmware::baudPing()
+{
+    baud_ping_time = netTimestamp();
+
+    if(!reg_baud->read()){
+        baudRegError(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Baud rate verify fail!")));
+    }
+}
+
+void ModbusFirmware::baudFallback()
+{
+    baud_stage = BaudFallback;
+
+    modbusDev()->modbusNet()->setBaud(boot_baud);
+
+    // Без подтверждения загрузчик вернётся к скорости загрузки
+    // по сторожевому таймеру.
+    qint64 elapsed = (netTimestamp() - baud_switch_time) / 1000000;
+    qint64 wait = BOOT_MODBUS_BAUD_WATCHDOG_MS + BAUD_WATCHDOG_MARGIN - elapsed;
+
+    QTimer::singleShot(static_cast<int>(qMax<qint64>(wait, 0)), this, [this]{
+        if(baud_stage == BaudFallback) baudPing();
+    });
+}
+
+void ModbusFirmware::baudDone()
+{
+    baud_stage = BaudNone;
+    conf_readed = true;
+
+    updateLink();
+
+    emit baudNegotiated(modbusDev()->modbusNet()->baud());
+    emit confReaded();
+
+    checkResume();
+}
+
+void ModbusFirmware::deviceIdReaded()
+{
+    switch(id_stage){
+    default:
+        return;
+    case IdStore:{
+        id_stage = IdNone;
+
+        conf_device_id = reg_device_id->value();
+        conf_device_known = true;
+
+        ModbusConfCache::Entry entry;
+        entry.device_id = conf_device_id;
+        entry.flash_size = flashSize();
+        entry.page_size = pageSize();
+
+        ModbusConfCache::get().insert(confCacheLink(), modbusDev()->slaveAddress(), entry);
+
+        confDone();
+    }break;
+    case IdCheck:
+        id_stage = IdNone;
+        conf_cached = false;
+
+        // Устройство заменено - конфигурация перечитывается,
+        // задание продолжается после чтения.
+        if(reg_device_id->value() != conf_device_id){
+            ModbusConfCache::get().remove(confCacheLink(), modbusDev()->slaveAddress());
+
+            check_resume = true;
+            confRead();
+
+            if(check_resume && (!conf_chain || !conf_chain->isExecuting())){
+                checkResumeFail(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Update chain exec fail!")));
+            }
+            return;
+        }
+
+        checkStart();
+        break;
+    }
+}
+
+void ModbusFirmware::deviceIdError(ModbusErr error)
+{
+    switch(id_stage){
+    default:
+        return;
+    case IdStore:
+        id_stage = IdNone;
+        conf_device_known = false;
+
+        // Устройство не ответило - конфигурация не прочитана.
+        if(error.modbusError() != QModbusDevice::ProtocolError){
+            emit confReadErrorOccured(error);
+            checkResumeFail(error);
+            break;
+        }
+
+        // Загрузчик без идентификатора - конфигурация не кэшируется.
+        ModbusConfCache::get().remove(confCacheLink(), modbusDev()->slaveAddress());
+        confDone();
+        break;
+    case IdCheck:
+        id_stage = IdNone;
+        conf_cached = false;
+        conf_readed = false;
+        conf_device_known = false;
+
+        if(error.modbusError() == QModbusDevice::ProtocolError){
+            ModbusConfCache::get().remove(confCacheLink(), modbusDev()->slaveAddress());
+        }
+
+        check_data.clear();
+
+        emitOpError(check_op, error);
+        break;
+    }
+}
+
+void ModbusFirmware::confDone()
+{
+    if(target_baud != 0 && target_baud != modbusDev()->modbusNet()->baud()){
+        baudSwitch();
+        return;
+    }
+
+    conf_readed = true;
+
+    emit confReaded();
+
+    checkResume();
+}
+
+void ModbusFirmware::checkStart()
+{
+    QByteArray ba = check_data;
+    check_data.clear();
+
+    bool res = false;
+
+    if(check_op == Write){
+        res = writeStart(check_address, ba);
+    }else if(check_op == Verify && verify_crc){
+        res = crcStart(check_address, ba);
+    }else{
+        res = readStart(check_op, check_address, check_size, ba);
+    }
+
+    if(!res){
+        emitOpError(check_op, ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Error starting operation!")));
+    }
+}
+
+void ModbusFirmware::checkResume()
+{
+    if(!check_resume) return;
+
+    check_resume = false;
+
+    checkStart();
+}
+
+void ModbusFirmware::checkResumeFail(ModbusErr error)
+{
+    if(!check_resume) return;
+
+    check_resume = false;
+    check_data.clear();
+
+    emitOpError(check_op, error);
+}
+
+QString ModbusFirmware::confCacheLink()
+{
+    ModbusTransport* transport = modbusDev()->modbusNet()->transport();
+    if(!transport) return QString();
+
+    return transport->linkName();
+}
+
+bool ModbusFirmware::confCheck(OpType op, quint32 address, quint32 size, const QByteArray& ba)
+{
+    createDeviceIdReg();
+
+    check_op = op;
+    check_address = address;
+    check_size = size;
+    check_data = ba;
+
+    id_stage = IdCheck;
+
+    if(!reg_device_id->read()){
+        id_stage = IdNone;
+        check_data.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool ModbusFirmware::verifyPage(const QByteArray& ba)
+{
+    const char* data = ba.constData() + op_iter.skip_before;
+    const char* image = op_iter.buffer.constData() + op_iter.cur_size;
+
+    int size = qMin(static_cast<int>(op_iter.iterSize()), ba.size() - static_cast<int>(op_iter.skip_before));
+    quint32 base = op_iter.address + op_iter.cur_size;
+
+    int pos = 0;
+
+    while(pos < size){
+        pos += ModbusImageCompare::firstMismatch(data + pos, image + pos, size - pos);
+        if(pos >= size) break;
+
+        int end = pos + ModbusImageCompare::firstMatch(data + pos, image + pos, size - pos);
+
+        // Участок продолжается с предыдущей страницы.
+        if(!verify_mismatches.isEmpty() &&
+           verify_mismatches.last().address + verify_mismatches.last().size == base + pos){
+            verify_mismatches.last().size += end - pos;
+        }else{
+            Mismatch m;
+            m.address = base + pos;
+            m.size = end - pos;
+            verify_mismatches.append(m);
+        }
+
+        if(verify_stop_at_first) return false;
+
+        pos = end;
+    }
+
+    // Недочитанная часть страницы - расхождение.
+    if(size < static_cast<int>(op_iter.iterSize())){
+        Mismatch m;
+        m.address = base + qMax(size, 0);
+        m.size = op_iter.iterSize() - qMax(size, 0);
+        verify_mismatches.append(m);
+
+        return !verify_stop_at_first;
+    }
+
+    return true;
+}
+
+bool ModbusFirmware::crcStart(quint32 address, const QByteArray& ba)
+{
+    createCrcObjects();
+
+    // Дайджест, начатый при записи этого образа, используется повторно.
+    if(!fw_digest || !fw_digest->isFor(address, ba, pageSize())){
+        startDigest(address, ba);
+    }
+
+    crc_image = ba;
+    crc_address = address;
+    crc_wait = false;
+    crc_device = 0;
+    crc_readback.clear();
+    crc_index = 0;
+
+    crc_stage = CrcWhole;
+
+    ModbusTimeline::asyncBegin("firmware", "verify_crc", &crc_image, "size", ba.size());
+
+    emit progressSetMin(0);
+    emit progressSetMax(ba.size());
+    emit progressChanged(0);
+
+    // Запрос к устройству уходит сразу, CRC образа
+    // досчитываются в пуле потоков за время ответа.
+    if(!crcNext()){
+        crcEnd();
+        return false;
+    }
+
+    return true;
+}
+
+bool ModbusFirmware::crcNext()
+{
+    quint32 address = crc_address;
+    quint32 size = static_cast<quint32>(crc_image.size());
+
+    if(crc_stage == CrcPages){
+        address = fw_digest->page(crc_index).address;
+        size = fw_digest->page(crc_index).size;
+    }else if(crc_stage == CrcDelta){
+        address = delta_old_address;
+        size = delta_old_size;
+    }
+
+    quint32 offset = flashOffset(address);
+
+    reg_crc_range->setData(0, offset >> 16);
+    reg_crc_range->setData(1, offset & 0xffff);
+    reg_crc_range->setData(2, size >> 16);
+    reg_crc_range->setData(3, size & 0xffff);
+
+    return crc_chain->exec();
+}
+
+void ModbusFirmware::crcCompare()
+{
+    if(crc_stage == CrcWhole){
+        if(crc_device == fw_digest->crc(0, fw_digest->pagesCount())){
+            emit progressChanged(crc_image.size());
+            crcEnd();
+            emit dataVerified(true);
+            return;
+        }
+
+        // Участок в пределах страницы - сразу чтение.
+        if(fw_digest->pagesCount() == 1){
+            Mismatch whole;
+            whole.address = crc_address;
+            whole.size = static_cast<quint32>(crc_image.size());
+            crc_readback.append(whole);
+
+            crcReadback();
+            return;
+        }
+
+        crc_stage = CrcPages;
+        crc_index = 0;
+
+    }else{
+        const ModbusImageDigest::Page& pg = fw_digest->page(crc_index);
+        bool match = crc_device == pg.crc;
+
+        if(!match){
+            // Смежные страницы читаются одним участком.
+            if(!crc_readback.isEmpty() &&
+               crc_readback.last().address + crc_readback.last().size == pg.address){
+                crc_readback.last().size += pg.size;
+            }else{
+                Mismatch m;
+                m.address = pg.address;
+                m.size = pg.size;
+                crc_readback.append(m);
+            }
+        }
+
+        emit progressChanged(pg.address + pg.size - crc_address);
+
+        crc_index ++;
+
+        if((!match && verify_stop_at_first) || crc_index >= fw_digest->pagesCount()){
+            crcReadback();
+            return;
+        }
+    }
+
+    if(!crcNext()){
+        crcEnd();
+        emit dataVerifyErrorOccured(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Error executing CRC chain!")));
+    }
+}
+
+void ModbusFirmware::crcReadback()
+{
+    crc_stage = CrcReadback;
+    crc_index = 0;
+
+    crcReadbackNext();
+}
+
+void ModbusFirmware::crcReadbackNext()
+{
+    if(crc_index >= crc_readback.size()){
+        crcEnd();
+        emit dataVerified(verify_mismatches.isEmpty());
+        return;
+    }
+
+    const Mismatch& seg = crc_readback.at(crc_index ++);
+
+    QByteArray image = crc_image.mid(static_cast<int>(seg.address - crc_address), static_cast<int>(seg.size));
+
+    if(!readStart(Verify, seg.address, seg.size, image)){
+        crcEnd();
+        emit dataVerifyErrorOccured(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Error starting operation!")));
+    }
+}
+
+void ModbusFirmware::crcEnd()
+{
+    ModbusTimeline::asyncEnd("firmware", "verify_crc", &crc_image, "readback", crc_readback.size());
+
+    crc_stage = CrcNone;
+    crc_wait = false;
+    crc_image.clear();
+    crc_readback.clear();
+}
+
+void ModbusFirmware::crcChainSuccess()
+{
+    crc_device = (static_cast<quint32>(reg_crc->data(0)) << 16) | reg_crc->data(1);
+
+    if(crc_stage == CrcDelta){
+        crc_stage = CrcNone;
+
+        bool match = crc_device == delta_old_crc;
+        if(!match) imageCacheDrop();
+
+        deltaWrite(match, tr("Device memory differs from the cached image"));
+        return;
+    }
+
+    bool host_ready = (crc_stage == CrcWhole) ?
+                fw_digest->isReady(0, fw_digest->pagesCount()) :
+                fw_digest->isReady(crc_index);
+
+    if(!host_ready){
+        crc_wait = true;
+        return;
+    }
+
+    crcCompare();
+}
+
+void ModbusFirmware::crcChainFail(ModbusErr error)
+{
+    if(crc_stage == CrcDelta){
+        crc_stage = CrcNone;
+
+        // Загрузчик без CRC - запись всего образа.
+        if(error.modbusError() == QModbusDevice::ProtocolError){
+            deltaWrite(false, tr("Bootloader has no CRC to confirm the cached image"));
+            return;
+        }
+
+        delta_image.clear();
+
+        emit dataWriteErrorOccured(error);
+        return;
+    }
+
+    // Загрузчик без CRC - проверка чтением всего участка.
+    if(crc_stage == CrcWhole && error.modbusError() == QModbusDevice::ProtocolError){
+        qDebug() << "ModbusFirmware: CRC not supported:" << error.errorStr();
+
+        Mismatch whole;
+        whole.address = crc_address;
+        whole.size = static_cast<quint32>(crc_image.size());
+        crc_readback.append(whole);
+
+        crcReadback();
+        return;
+    }
+
+    crcEnd();
+
+    emit dataVerifyErrorOccured(error);
+}
+
+void ModbusFirmware::crcChainCanceled()
+{
+    if(crc_stage == CrcDelta){
+        crc_stage = CrcNone;
+        delta_image.clear();
+
+        emit dataWriteCanceled();
+        return;
+    }
+
+    crcEnd();
+
+    emit dataVerifyCanceled();
+}
+
+bool ModbusFirmware::deltaFind(quint32 address, const QByteArray& ba)
+{
+    ModbusImageCache& cache = ModbusImageCache::get();
+
+    if(!cache.isEnabled() || pageSize() == 0) return false;
+
+    // Без идентификатора образ в кэше может быть от другого устройства.
+    if(!conf_device_known){
+        emit deltaUnavailable(tr("Bootloader has no device id"));
+        return false;
+    }
+
+    ModbusImageCache::Entry entry;
+    QByteArray old_image;
+
+    if(cache.find(confCacheLink(), modbusDev()->slaveAddress(), conf_device_id, &entry)){
+        old_image = cache.image(entry);
+    }
+
+    if(old_image.isEmpty()){
+        emit deltaUnavailable(tr("No cached image for the device"));
+        return false;
+    }
+
+    if(!deltaDiff(address, ba, entry.address, old_image)){
+        emit deltaUnavailable(tr("All pages changed"));
+        return false;
+    }
+
+    delta_old_address = entry.address;
+    delta_old_size = entry.size;
+    delta_old_crc = entry.crc;
+
+    return true;
+}
+
+bool ModbusFirmware::deltaDiff(quint32 address, const QByteArray& ba, quint32 old_address, const QByteArray& old_image)
+{
+    if(pageSize() == 0) return false;
+
+    quint32 end = address + static_cast<quint32>(ba.size());
+    quint32 old_end = old_address + static_cast<quint32>(old_image.size());
+
+    QVector<bool> pages;
+    int changed = 0;
+
+    // Страница не изменена, если её часть в образе
+    // целиком есть в прежнем образе и совпадает с ним.
+    for(quint32 addr = address; addr < end;){
+        quint32 pg_end = qMin(pageAlignedAddress(addr) + pageSize(), end);
+
+        bool same = addr >= old_address && pg_end <= old_end &&
+                    ModbusImageCompare::firstMismatch(ba.constData() + (addr - address),
+                                                      old_image.constData() + (addr - old_address),
+                                                      static_cast<int>(pg_end - addr)) == static_cast<int>(pg_end - addr);
+
+        pages.append(!same);
+        if(!same) changed ++;
+
+        addr = pg_end;
+    }
+
+    if(changed == pages.size()) return false;
+
+    delta_pages = pages;
+    delta_address = address;
+    delta_image = ba;
+
+    return true;
+}
+
+void ModbusFirmware::deltaWrite(bool delta, const QString& reason)
+{
+    QByteArray ba = delta_image;
+    delta_image.clear();
+
+    if(!delta){
+        delta_pages.clear();
+        emit deltaUnavailable(reason);
+    }else{
+        emit deltaPlanned(delta_pages.count(true), delta_pages.size());
+    }
+
+    writeBegin(delta_address, ba);
+}
+
+void ModbusFirmware::imageCacheStore()
+{
+    if(!conf_device_known) return;
+
+    ModbusImageCache::get().insert(confCacheLink(), modbusDev()->slaveAddress(), conf_device_id,
+                                   op_iter.address, op_iter.buffer);
+}
+
+void ModbusFirmware::imageCacheDrop()
+{
+    // Память устройства после прерванной записи неизвестна.
+    if(!conf_device_known) return;
+
+    ModbusImageCache::get().remove(confCacheLink(), modbusDev()->slaveAddress(), conf_device_id);
+}
+
+void ModbusFirmware::digestPageReady(int index)
+{
+    Q_UNUSED(index);
+
+    if(!crc_wait) return;
+
+    bool host_ready = (crc_stage == CrcWhole) ?
+                fw_digest->isReady(0, fw_digest->pagesCount()) :
+                fw_digest->isReady(crc_index);
+
+    if(!host_ready) return;
+
+    crc_wait = false;
+
+    crcCompare();
+}
+
+void ModbusFirmware::emitOpError(OpType op, ModbusErr error)
+{
+    switch(op){
+    case Read:
+        emit dataReadErrorOccured(error);
+        break;
+    case Write:
+        emit dataWriteErrorOccured(error);
+        break;
+    case Verify:
+        emit dataVerifyErrorOccured(error);
+        break;
+    }
+}
+
+void ModbusFirmware::emitOpCanceled(OpType op)
+{
+    switch(op){
+    case Read:
+        emit dataReadCanceled();
+        break;
+    case Write:
+        emit dataWriteCanceled();
+        break;
+    case Verify:
+        emit dataVerifyCanceled();
+        break;
+    }
+}
+
+const char* ModbusFirmware::opName(OpType op)
+{
+    switch(op){
+    default:
+    case Read:
+        return "read";
+    case Write:
+        return "write";
+    case Verify:
+        return "verify";
+    }
+}
+
+void ModbusFirmware::iterChainSuccess()
+{
+    if(iter_chain == nullptr){
+        qDebug() << "ModbusFirmware: iterChainSuccess iter_chain == nullptr!";
+        return;
+    }
+
+    if(op_type == Read){
+        op_iter.appendReaded(file_rgn_page->data());
+    }else if(op_type == Verify && !verifyPage(file_rgn_page->data())){
+        // Первое расхождение - остальное не читается.
+        ModbusTimeline::asyncEnd("firmware", "page", this, "page", op_iter.page);
+
+        op_iter.end();
+
+        traceOpEnd();
+
+        op_iter.buffer.clear();
+        if(crc_stage == CrcReadback) crcEnd();
+        emit dataVerified(false);
+        return;
+    }
+
+    if(opPageDone()){
+        iterChainNext();
+    }
+}
+
+void ModbusFirmware::iterChainFail(ModbusErr error)
+{
+    if(iter_chain == nullptr){
+        qDebug() << "ModbusFirmware: iterChainFail iter_chain == nullptr!";
+        return;
+    }
+
+    qDebug() << "ModbusFirmware: iterChainFail chain index:" << iter_chain->currentIndex();
+
+    opFail(error);
+}
+
+void ModbusFirmware::iterChainCanceled()
+{
+    if(iter_chain == nullptr){
+        qDebug() << "ModbusFirmware: iterChainCanceled iter_chain == nullptr!";
+        return;
+    }
+
+    opCanceled();
+}
+
+void ModbusFirmware::writeStreamEntryDone(int index)
+{
+    // Окно потока держит очередь сети занятой,
+    // поэтому интервал между завершениями - RTT запроса.
+    qint64 now = netTimestamp();
+    quint64 rtt = (now - entry_time) / 1000;
+    entry_time = now;
+
+    switch(write_planner->transactions().at(index).type){
+    case ModbusTransferPlanner::SelectPage:
+        fw_estimator.addRttSample(rtt, 5, 5);
+        break;
+    case ModbusTransferPlanner::ErasePage:
+        fw_estimator.addEraseSample(rtt);
+        break;
+    default:
+        break;
+    }
+
+    // Страницы, не изменённые относительно кэша образов,
+    // завершаются вместе с предыдущей записанной.
+    while(write_page_index < write_page_ends.size() &&
+          index >= write_page_ends.at(write_page_index)){
+
+        write_page_index ++;
+
+        if(!opPageDone()) return;
+
+        ModbusTimeline::asyncBegin("firmware", "page", this, "page", op_iter.page);
+    }
+}
+
+void ModbusFirmware::writeStreamFail(ModbusErr error)
+{
+    qDebug() << "ModbusFirmware: writeStreamFail request index:" << write_stream->completedCount();
+
+    opFail(error);
+}
+
+void ModbusFirmware::writeStreamCanceled()
+{
+    opCanceled();
+}
+
+void ModbusFirmware::iterChainNext()
+{
+    //qDebug() << ((op_type == Read) ? ("--- Reading ---") : ("--- Writing ---"));
+    //qDebug() << "Page" << op_iter.page;
+    //qDebug() << "Rec num" << op_iter.rec_num << "Rec count" << op_iter.rec_count;
+    //qDebug() << "Skip before" << op_iter.skip_before << "Skip after" << op_iter.skip_after;
+
+    reg_page_num->setValue(op_iter.page);
+    file_rgn_page->setRecordNumber(op_iter.rec_num);
+    file_rgn_page->setRecordsCount(op_iter.rec_count);
+
+    ModbusTimeline::asyncBegin("firmware", "page", this, "page", op_iter.page);
+
+    if(!iter_chain->exec()){
+        iterChainFail(ModbusErr(ModbusErr::General, tr("ModbusFirmware"), tr("Error executing iter chain!")));
+    }
+}
+
+void ModbusFirmware::traceOpEnd()
+{
+    ModbusTimeline::asyncEnd("firmware", opName(op_type), &op_iter, "size", op_iter.cur_size);
+}
+
+bool ModbusFirmware::opPageDone()
+{
+    ModbusTimeline::asyncEnd("firmware", "page", this, "page", op_iter.page);
+
+    op_iter.next();
+
+    emit progressChanged(op_iter.cur_size);
+
+    estimateUpdate();
+
+    if(!op_iter.done()) return true;
+
+    op_iter.end();
+
+    traceOpEnd();
+
+    switch(op_type){
+    case Read:
+        emit dataReaded();
+        break;
+    case Write:
+        imageCacheStore();
+        emit dataWrited();
+        break;
+    case Verify:
+        // Прочитанное не хранится, образ больше не нужен.
+        op_iter.buffer.clear();
+        // Проверка по CRC - следующий несовпавший участок.
+        if(crc_stage == CrcReadback){
+            crcReadbackNext();
+            break;
+        }
+        emit dataVerified(verify_mismatches.isEmpty());
+        break;
+    }
+
+    return false;
+}
+
+void ModbusFirmware::opFail(ModbusErr error)
+{
+    ModbusTimeline::asyncEnd("firmware", "page", this, "page", op_iter.page);
+
+    op_iter.end();
+
+    traceOpEnd();
+
+    if(crc_stage == CrcReadback) crcEnd();
+    if(op_type == Write) imageCacheDrop();
+
+    emitOpError(op_type, error);
+}
+
+void ModbusFirmware::opCanceled()
+{
+    ModbusTimeline::asyncEnd("firmware", "page", this, "page", op_iter.page);
+
+    op_iter.end();
+
+    traceOpEnd();
+
+    if(crc_stage == CrcReadback) crcEnd();
+    if(op_type == Write) imageCacheDrop();
+
+    emitOpCanceled(op_type);
+}
+
+void ModbusFirmware::planWrite()
+{
+    setupPlanner(write_planner);
+
+    write_arena->clear();
+
+    if(write_planner->planWrite(flashOffset(op_iter.address), op_iter.buffer, delta_pages)){
+        write_planner->encode(write_arena);
+    }
+
+    write_page_ends = write_planner->pageEnds();
+}
+
+void ModbusFirmware::setupPlanner(ModbusTransferPlanner* planner) const
+{
+    ModbusTransferPlanner::Capabilities caps = fw_caps;
+    caps.max_pdu_size = qMin(caps.max_pdu_size, modbusDev()->maxPduSize());
+
+    planner->setCapabilities(caps);
+    planner->setPageSize(pageSize());
+    planner->setFileNumber(BOOT_MODBUS_FILE_PAGE);
+}
+
+quint32 ModbusFirmware::flashOffset(quint32 addr) const
+{
+    if(addr >= flashBase()) addr -= flashBase();
+    return addr;
+}
+
+qint64 ModbusFirmware::netTimestamp()
+{
+    return modbusDev()->modbusNet()->timestamp();
+}
+
+void ModbusFirmware::updateLink()
+{
+    fw_estimator.setBaud(modbusDev()->modbusNet()->baud());
+    fw_estimator.setFrameDelay(modbusDev()->modbusNet()->frameDelay());
+}
+
+void ModbusFirmware::estimateStart(double predicted)
+{
+    fw_estimator.start(op_iter.size, predicted, netTimestamp());
+
+    emit estimateChanged(fw_estimator.predicted(), fw_estimator.bytesPerSecond());
+}
+
+void ModbusFirmware::estimateUpdate()
+{
+    fw_estimator.update(op_iter.cur_size, netTimestamp());
+
+    emit estimateChanged(fw_estimator.eta(), fw_estimator.bytesPerSecond());
+}
+
+void ModbusFirmware::createOpObjects()
+{
+    if(!reg_page_num)
+        reg_page_num = new ModbusReg(modbusDev(), QModbusDataUnit::HoldingRegisters, BOOT_MODBUS_HOLD_REG_PAGE_NUMBER);
+
+    if(!file_page)
+        file_page = new ModbusFile(modbusDev(), BOOT_MODBUS_FILE_PAGE);
+
+    if(!file_rgn_page)
+        file_rgn_page = new ModbusFileRegion(file_page);
+
+    if(!iter_chain){
+        iter_chain = new ModbusChain();
+        iter_chain->setName("iter");
+
+        connect(iter_chain, &ModbusChain::success, this, &ModbusFirmware::iterChainSuccess);
+        connect(iter_chain, &ModbusChain::fail, this, &ModbusFirmware::iterChainFail);
+        connect(iter_chain, &ModbusChain::canceled, this, &ModbusFirmware::iterChainCanceled);
+    }
+}
+
+void ModbusFirmware::createDeviceIdReg()
+{
+    if(reg_device_id) return;
+
+    reg_device_id = new ModbusReg(modbusDev(), QModbusDataUnit::InputRegisters, BOOT_MODBUS_INPUT_REG_DEVICE_ID);
+
+    connect(reg_device_id, &ModbusReg::dataReaded, this, &ModbusFirmware::deviceIdReaded);
+    connect(reg_device_id, &ModbusReg::errorOccured, this, &ModbusFirmware::deviceIdError);
+}
+
+void ModbusFirmware::createCrcObjects()
+{
+    if(crc_chain) return;
+
+    reg_crc_range = new ModbusReg(modbusDev(), QModbusDataUnit::HoldingRegisters, BOOT_MODBUS_HOLD_REG_CRC_ADDR, 4);
+    reg_crc = new ModbusReg(modbusDev(), QModbusDataUnit::InputRegisters, BOOT_MODBUS_INPUT_REG_CRC, 2);
+
+    crc_chain = new ModbusChain();
+    crc_chain->setName("crc");
+
+    // Запись диапазона запускает вычисление, затем чтение результата.
+    crc_chain->append(reg_crc_range, &ModbusReg::dataWrited, &ModbusReg::errorOccured, [this]{
+        return reg_crc_range->write();
+    });
+
+    crc_chain->append(reg_crc, &ModbusReg::dataReaded, &ModbusReg::errorOccured, [this]{
+        return reg_crc->read();
+    });
+
+    connect(crc_chain, &ModbusChain::success, this, &ModbusFirmware::crcChainSuccess);
+    connect(crc_chain, &ModbusChain::fail, this, &ModbusFirmware::crcChainFail);
+    connect(crc_chain, &ModbusChain::canceled, this, &ModbusFirmware::crcChainCanceled);
+}
+
+void ModbusFirmware::startDigest(quint32 address, const QByteArray& ba)
+{
+    if(!fw_digest){
+        fw_digest = new ModbusImageDigest();
+
+        connect(fw_digest, &ModbusImageDigest::pageReady, this, &ModbusFirmware::digestPageReady);
+    }
+
+    fw_digest->start(address, ba, pageSize());
+}
+
+void ModbusFirmware::createReadOpObjects()
+{
+    createOpObjects();
+}
+
+void ModbusFirmware::createWriteOpObjects()
+{
+    if(!write_planner)
+        write_planner = new ModbusTransferPlanner();
+
+    if(!write_arena)
+        write_arena = new ModbusPduArena();
+
+    if(!write_stream){
+        write_stream = new ModbusPduStream(modbusDev());
+        write_stream->setArena(write_arena);
+
+        connect(write_stream, &ModbusPduStream::entryDone, this, &ModbusFirmware::writeStreamEntryDone);
+        connect(write_stream, &ModbusPduStream::fail, this, &ModbusFirmware::writeStreamFail);
+        connect(write_stream, &ModbusPduStream::canceled, this, &ModbusFirmware::writeStreamCanceled);
+    }
+}
@@ -0,0 +1,518 @@
+#ifndef MODBUSFIRMWARE_H
+#define MODBUSFIRMWARE_H
+
+#include "modbusobj.h"
+#include "modbuserr.h"
+#include "modbustransferplanner.h"
+#include "modbusflashestimator.h"
+#include <QByteArray>
+#include <QVector>
+
+class ModbusReg;
+class ModbusFile;
+class ModbusFileRegion;
+class ModbusChain;
+class ModbusPduArena;
+class ModbusPduStream;
+class ModbusImageDigest;
+
+
+class ModbusFirmware : public ModbusObj
+{
+    Q_OBJECT
+public:
+
+    enum OpType {
+        Read = 0,
+        Write,
+        Verify
+    };
+
+    // Участок памяти, не совпавший с образом.
+    struct Mismatch {
+        quint32 address;
+        quint32 size;
+    };
+
+    explicit ModbusFirmware(QObject *parent = 0);
+    ModbusFirmware(ModbusDev* dev, QObject *parent = 0);
+    ~ModbusFirmware();
+
+    bool isConfReaded() const;
+    /*
+     * Конфигурация взята из ModbusConfCache без обращения к устройству.
+     * Первое задание после этого начинается с чтения идентификатора
+     * устройства; при несовпадении задание завершается ошибкой,
+     * запись кэша удаляется, и конфигурацию нужно прочитать заново.
+     */
+    bool isConfCached() const;
+    bool isExecuting() const;
+
+    quint32 flashSize() const;
+    quint32 pageSize() const;
+    quint32 pagesCount() const;
+
+    quint32 pageNumber(quint32 addr) const;
+    quint32 pageAddress(quint32 pg_num) const;
+    quint32 pageAlignedAddress(quint32 addr) const;
+
+    quint32 dataSize() const;
+    quint32 dataAddress() const;
+
+    const QByteArray& data() const;
+    void setData(const QByteArray& ba);
+
+    bool readData(quint32 address, quint32 size);
+    bool writeData(quint32 address, const QByteArray& ba);
+    /*
+     * Запись страниц, изменённых относительно образа base,
+     * записанного в устройство этим же сеансом (режим слежения).
+     * Ни идентификатор устройства, ни подтверждение CRC не нужны.
+     */
+    bool writeDataDelta(quint32 address, const QByteArray& ba, quint32 base_address, const QByteArray& base);
+
+    /*
+     * Проверка памяти по образу ba постраничным чтением.
+     * Каждая страница сравнивается сразу после чтения и не хранится.
+     * stop_at_first - завершение на первом расхождении,
+     * иначе собираются все несовпавшие участки.
+     * Результат - dataVerified() и mismatches().
+     */
+    bool verifyData(quint32 address, const QByteArray& ba, bool stop_at_first = true);
+    const QVector<Mismatch>& mismatches() const;
+
+    /*
+     * Проверка по CRC-32 загрузчика (BOOT_MODBUS_HOLD_REG_CRC_*)
+     * без чтения памяти: сначала весь участок, при расхождении -
+     * CRC каждой страницы, и только несовпавшие страницы
+     * читаются и сравниваются, как в verifyData().
+     * Загрузчик без CRC проверяется чтением всего участка.
+     */
+    bool verifyCrc(quint32 address, const QByteArray& ba, bool stop_at_first = true);
+
+    /*
+     * При включённом ModbusImageCache записываются только страницы,
+     * изменённые относительно последнего записанного в устройство
+     * образа. Перед такой записью загрузчик подтверждает CRC-32
+     * прежнего образа; без подтверждения или без CRC у загрузчика
+     * записывается весь образ.
+     */
+    bool deltaConfirm() const;
+    void setDeltaConfirm(bool confirm);
+
+    // Отмена задания: передаваемый запрос прерывается,
+    // сигнал отмены выдаётся до возврата.
+    bool cancel();
+
+    bool runApp();
+
+    // Оценка длительности задания до его начала, с.
+    // Требует прочитанной конфигурации.
+    double estimateRead(quint32 address, quint32 size);
+    double estimateWrite(quint32 address, const QByteArray& ba);
+
+    // Оценка текущего задания: оставшееся время, с, и скорость, байт/с.
+    const ModbusFlashEstimator& estimator() const;
+    double eta() const;
+    double bytesPerSecond() const;
+
+    /*
+     * Скорость записи, согласуемая с загрузчиком после чтения
+     * конфигурации, 0 - не согласовывать. При неудачной проверке
+     * новой скорости сеть возвращается на прежнюю.
+     * Скорость сети общая для всех устройств шины, поэтому
+     * согласование имеет смысл при одном устройстве на линии.
+     */
+    quint32 targetBaud() const;
+    void setTargetBaud(quint32 baud);
+    // Скорость, согласованная с загрузчиком, 0 - не согласована.
+    quint32 negotiatedBaud() const;
+
+    // Возможности загрузчика для планирования записи.
+    const ModbusTransferPlanner::Capabilities& capabilities() const;
+    void setCapabilities(const ModbusTransferPlanner::Capabilities& caps);
+
+    static constexpr quint32 flashBase()
+        { return 0x08000000; }
+
+signals:
+    void confReaded();
+    // Перед confReaded, если выполнялось согласование скорости.
+    void baudNegotiated(quint32 baud);
+    void confReadErrorOccured(ModbusErr error);
+
+    void dataReaded();
+    void dataReadErrorOccured(ModbusErr error);
+    void dataReadCanceled();
+
+    // Перед записью по кэшу образов: число записываемых страниц из всех.
+    void deltaPlanned(int pages, int total);
+    // Запись по прежнему образу невозможна, пишется весь образ.
+    void deltaUnavailable(const QString& reason);
+    void dataWrited();
+    void dataWriteErrorOccured(ModbusErr error);
+    void dataWriteCanceled();
+
+    void dataVerified(bool match);
+    void dataVerifyErrorOccured(ModbusErr error);
+    void dataVerifyCanceled();
+
+    void appRunned();
+    void appRunErrorOccured(ModbusErr error);
+
+    void progressSetMin(int val);
+    void progressSetMax(int val);
+    void progressChanged(int val);
+
+    // Вызывается при начале задания и после каждого progressChanged.
+    void estimateChanged(double eta, double bytes_per_s);
+
+public slots:
+    void confRead();
+
+private slots:
+    void confChainSuccess();
+    void confChainFail(ModbusErr error);
+
+    void baudRegWrited();
+    void baudRegReaded();
+    void baudRegError(ModbusErr error);
+
+    void deviceIdReaded();
+    void deviceIdError(ModbusErr error);
+
+    void iterChainSuccess();
+    void iterChainFail(ModbusErr error);
+    void iterChainCanceled();
+
+    void writeStreamEntryDone(int index);
+    void writeStreamFail(ModbusErr error);
+    void writeStreamCanceled();
+
+    void crcChainSuccess();
+    void crcChainFail(ModbusErr error);
+    void crcChainCanceled();
+
+    void digestPageReady(int index);
+
+private:
+    void iterChainNext();
+    void traceOpEnd();
+
+    bool opPageDone();
+    void opFail(ModbusErr error);
+    void opCanceled();
+
+    void planWrite();
+    void setupPlanner(ModbusTransferPlanner* planner) const;
+    quint32 flashOffset(quint32 addr) const;
+
+    qint64 netTimestamp();
+    void updateLink();
+    void estimateStart(double predicted);
+    void estimateUpdate();
+
+    void baudSwitch();
+    void baudPing();
+    void baudFallback();
+    void baudDone();
+
+    void confDone();
+    void checkStart();
+    void checkResume();
+    void checkResumeFail(ModbusErr error);
+    QString confCacheLink();
+    bool confCheck(OpType op, quint32 address, quint32 size, const QByteArray& ba);
+
+    bool readStart(OpType op, quint32 address, quint32 size, const QByteArray& image);
+    bool writeStart(quint32 address, const QByteArray& ba);
+    bool writeBegin(quint32 address, const QByteArray& ba);
+
+    bool deltaFind(quint32 address, const QByteArray& ba);
+    bool deltaDiff(quint32 address, const QByteArray& ba, quint32 old_address, const QByteArray& old_image);
+    void deltaWrite(bool delta, const QString& reason = QString());
+    void imageCacheStore();
+    void imageCacheDrop();
+
+    bool verifyPage(const QByteArray& ba);
+
+    bool crcStart(quint32 address, const QByteArray& ba);
+    bool crcNext();
+    void crcCompare();
+    void crcReadback();
+    void crcReadbackNext();
+    void crcEnd();
+
+    void emitOpError(OpType op, ModbusErr error);
+    void emitOpCanceled(OpType op);
+
+    static const char* opName(OpType op);
+
+    void createOpObjects();
+    void createDeviceIdReg();
+    void createCrcObjects();
+    void startDigest(quint32 address, const QByteArray& ba);
+    void createReadOpObjects();
+    void createWriteOpObjects();
+
+    ModbusReg* reg_flash_size;
+    ModbusReg* reg_page_size;
+
+    ModbusReg* reg_run_app;
+
+    ModbusReg* reg_baud;
+
+    ModbusReg* reg_device_id;
+
+    ModbusReg* reg_crc_range;
+    ModbusReg* reg_crc;
+
+    ModbusReg* reg_page_num;
+    ModbusFile* file_page;
+    ModbusFileRegion* file_rgn_page;
+
+    ModbusChain* conf_chain;
+    ModbusChain* iter_chain;
+    ModbusChain* crc_chain;
+
+    // Постраничные CRC образа, считаются параллельно обмену.
+    ModbusImageDigest* fw_digest;
+
+    // Запись: все запросы задания планируются и кодируются заранее.
+    ModbusTransferPlanner::Capabilities fw_caps;
+    ModbusTransferPlanner* write_planner;
+    ModbusPduArena* write_arena;
+    ModbusPduStream* write_stream;
+    // Индексы последних запросов каждой страницы в арене.
+    QVector<int> write_page_ends;
+    int write_page_index;
+
+    // Оценка длительности, калибруется по RTT чтения конфигурации
+    // и по времени выбора и стирания страниц при записи.
+    ModbusFlashEstimator fw_estimator;
+    qint64 conf_start_time;
+    qint64 entry_time;
+
+    // Согласование скорости: запись регистра, проверка на новой
+    // скорости, при неудаче проверка на прежней и снова на новой.
+    enum BaudStage {
+        BaudNone = 0,
+        BaudSwitch,
+        BaudVerify,
+        BaudFallback,
+        BaudRecover
+    };
+
+    quint32 target_baud;
+    quint32 boot_baud;
+    quint32 negotiated_baud;
+    BaudStage baud_stage;
+    qint64 baud_switch_time;
+    qint64 baud_ping_time;
+
+    // Кэш конфигурации: идентификатор читается после чтения
+    // конфигурации для записи в кэш или перед первым заданием
+    // для проверки конфигурации из кэша.
+    enum IdStage {
+        IdNone = 0,
+        IdStore,
+        IdCheck
+    };
+
+    bool conf_readed;
+    bool conf_cached;
+    quint16 conf_device_id;
+    bool conf_device_known;
+    IdStage id_stage;
+    // Задание, ожидающее проверки.
+    OpType check_op;
+    quint32 check_address;
+    quint32 check_size;
+    QByteArray check_data;
+    // Задание продолжится после повторного чтения конфигурации.
+    bool check_resume;
+
+    // Проверка: образ - в op_iter.buffer, прочитанное не хранится.
+    bool verify_stop_at_first;
+    bool verify_crc;
+    QVector<Mismatch> verify_mismatches;
+
+    // Проверка по CRC: весь участок, затем страницы,
+    // затем чтение несовпавших страниц.
+    enum CrcStage {
+        CrcNone = 0,
+        CrcWhole,
+        CrcPages,
+        CrcReadback,
+        CrcDelta
+    };
+
+    CrcStage crc_stage;
+    QByteArray crc_image;
+    quint32 crc_address;
+    // Ответ устройства ждёт CRC страниц образа.
+    bool crc_wait;
+    quint32 crc_device;
+    // Несовпавшие участки для чтения.
+    QVector<Mismatch> crc_readback;
+    int crc_index;
+
+    // Запись по кэшу образов: страницы образа для записи
+    // (пусто - все) и прежний образ для подтверждения CRC.
+    bool delta_confirm;
+    QVector<bool> delta_pages;
+    quint32 delta_address;
+    QByteArray delta_image;
+    quint32 delta_old_address;
+    quint32 delta_old_size;
+    quint32 delta_old_crc;
+    // Прежний образ сеанса для writeDataDelta().
+    quint32 delta_base_address;
+    QByteArray delta_base;
+
+// DEBUG.
+public:
+
+    struct IterOp{
+        IterOp(){
+            firmware = nullptr;
+
+            reset();
+        }
+
+        IterOp(ModbusFirmware* mf, quint32 op_addr, quint32 op_size){
+
+            firmware = mf;
+
+            reset();
+
+            begin(op_addr, op_size);
+        }
+
+        IterOp(const IterOp& op){
+
+            buffer = op.buffer;
+            running = op.running;
+
+            firmware = op.firmware;
+
+            address = op.address;
+            size = op.size;
+            cur_size = op.cur_size;
+
+            skip_before = op.skip_before;
+            skip_after = op.skip_after;
+
+            page = op.page;
+            rec_num = op.rec_num;
+            rec_count = op.rec_count;
+        }
+
+        ~IterOp(){}
+
+        void update(){
+            quint32 op_addr = address + cur_size;
+
+            page = firmware->pageNumber(op_addr);
+
+            quint32 page_addr = firmware->pageAddress(page);
+            quint32 page_addr_next = firmware->pageAddress(page + 1);
+
+            rec_num = (op_addr - page_addr) / 2;
+            skip_before = op_addr % 2;
+
+            quint32 op_size = qMin(size - cur_size, page_addr_next - op_addr);
+            quint32 op_addr_end = op_addr + op_size;
+            skip_after = op_addr_end % 2;
+
+            quint32 rec_end = (op_addr_end - page_addr + skip_after) / 2;
+            rec_count = rec_end - rec_num;
+        }
+
+        void begin(quint32 op_addr, quint32 op_size){
+
+            reset();
+
+            address = op_addr;
+            size = op_size;
+
+            update();
+
+            running = true;
+        }
+
+        void end(){
+            running = false;
+        }
+
+        bool done(){
+            return cur_size >= size;
+        }
+
+        quint32 iterSize(){
+            return rec_count * 2 - skip_before - skip_after;
+        }
+
+        void next(){
+            cur_size += iterSize();
+            update();
+        }
+
+        void setModbusFirmware(ModbusFirmware* mf){
+            firmware = mf;
+        }
+
+        void reset(){
+
+            buffer.clear();
+            running = false;
+
+            address = 0;
+            size = 0;
+            cur_size = 0;
+
+            skip_before = 0;
+            skip_after = 0;
+            rec_num = 0;
+            rec_count = 0;
+
+            page = 0;
+            rec_num = 0;
+            rec_count = 0;
+            skip_before = 0;
+            skip_after = 0;
+        }
+
+        void appendReaded(const QByteArray& ba){
+            if(static_cast<quint32>(ba.size()) > skip_before + skip_after){
+                buffer.append(ba.mid(skip_before, ba.size() - skip_before - skip_after));
+            }
+        }
+
+        QByteArray dataToWrite() const{
+            return buffer.mid(cur_size, rec_count * 2);
+        }
+
+        bool running;
+
+        QByteArray buffer;
+
+        ModbusFirmware* firmware;
+
+        quint32 address;
+        quint32 size;
+        quint32 cur_size;
+
+        quint32 skip_before;
+        quint32 skip_after;
+
+        quint32 page;
+        quint32 rec_num;
+        quint32 rec_count;
+    };
+
+    IterOp op_iter;
+    OpType op_type;
+};
+
+#endif // MODBUSFIRMWARE_H
@@ -0,0 +1,200 @@
+#include "modbusflashestimator.h"
+#include <math.h>
+
+
+// Запись одиночного регистра/флага: func(1) + addr(2) + value(2).
+#define SINGLE_WRITE_PDU_SIZE 5
+
+// Число измерений, после которого среднее становится скользящим.
+#define AVERAGE_WINDOW 8
+
+// Постоянная времени сглаживания скорости, с.
+#define RATE_TAU 5.0
+
+
+ModbusFlashEstimator::ModbusFlashEstimator()
+{
+    est_baud = 9600;
+    frame_delay = 0;
+
+    reset();
+}
+
+void ModbusFlashEstimator::reset()
+{
+    rtt_avg = 0;
+    rtt_count = 0;
+    overhead_avg = 0;
+    erase_avg = 0;
+    erase_count = 0;
+
+    job_total = 0;
+    job_done = 0;
+    job_predicted = 0.0;
+    job_start = 0;
+    job_last = 0;
+    job_rate = 0.0;
+}
+
+quint32 ModbusFlashEstimator::baud() const
+{
+    return est_baud;
+}
+
+void ModbusFlashEstimator::setBaud(quint32 baud)
+{
+    est_baud = baud;
+}
+
+quint32 ModbusFlashEstimator::frameDelay() const
+{
+    return frame_delay;
+}
+
+void ModbusFlashEstimator::setFrameDelay(quint32 usecs)
+{
+    frame_delay = usecs;
+}
+
+void ModbusFlashEstimator::addRttSample(quint64 rtt, int req_size, int resp_size)
+{
+    ModbusTransferPlanner::Timing tm;
+    tm.baud = est_baud;
+    tm.frame_delay = frame_delay;
+    tm.turnaround = 0;
+
+    qint64 frames = ModbusTransferPlanner::transactionTime(tm, req_size, resp_size, 0) / 1000;
+
+    rtt_count ++;
+    rtt_avg = average(rtt_avg, static_cast<qint64>(rtt), rtt_count);
+    overhead_avg = average(overhead_avg, static_cast<qint64>(rtt) - frames, rtt_count);
+}
+
+void ModbusFlashEstimator::addEraseSample(quint64 rtt)
+{
+    erase_count ++;
+    erase_avg = average(erase_avg, static_cast<qint64>(rtt), erase_count);
+}
+
+quint64 ModbusFlashEstimator::measuredRtt() const
+{
+    return static_cast<quint64>(rtt_avg);
+}
+
+quint64 ModbusFlashEstimator::measuredErase() const
+{
+    return static_cast<quint64>(erase_avg);
+}
+
+ModbusTransferPlanner::Timing ModbusFlashEstimator::timing() const
+{
+    ModbusTransferPlanner::Timing tm;
+    tm.baud = est_baud;
+    tm.frame_delay = frame_delay;
+
+    if(rtt_count != 0){
+        // Реакция устройства и задержки адаптера уже в измерении.
+        tm.turnaround = 0;
+        tm.response_latency = static_cast<quint32>(qMax<qint64>(overhead_avg, 0));
+    }
+
+    if(erase_count != 0){
+        qint64 erase_frames = ModbusTransferPlanner::transactionTime(tm, SINGLE_WRITE_PDU_SIZE, SINGLE_WRITE_PDU_SIZE,
+                                                                      tm.response_latency) / 1000;
+
+        tm.erase_latency = static_cast<quint32>(qMax<qint64>(erase_avg - erase_frames, 0));
+    }
+
+    return tm;
+}
+
+double ModbusFlashEstimator::predict(ModbusTransferPlanner* planner) const
+{
+    planner->setTiming(timing());
+
+    return planner->predict().duration;
+}
+
+void ModbusFlashEstimator::start(quint64 total_bytes, double predicted, qint64 now)
+{
+    job_total = total_bytes;
+    job_done = 0;
+    job_predicted = predicted;
+    job_start = now;
+    job_last = now;
+    job_rate = (predicted > 0.0) ? total_bytes / predicted : 0.0;
+}
+
+void ModbusFlashEstimator::update(quint64 done_bytes, qint64 now)
+{
+    double dt = (now - job_last) / 1e9;
+
+    if(dt > 0.0 && done_bytes > job_done){
+        double rate = (done_bytes - job_done) / dt;
+        double alpha = 1.0 - exp(-dt / RATE_TAU);
+
+        job_rate += alpha * (rate - job_rate);
+    }
+
+    job_done = done_bytes;
+    job_last = now;
+}
+
+double ModbusFlashEstimator::predicted() const
+{
+    return job_predicted;
+}
+
+double ModbusFlashEstimator::elapsed() const
+{
+    return (job_last - job_start) / 1e9;
+}
+
+double ModbusFlashEstimator::eta() const
+{
+    if(job_total == 0 || job_done >= job_total) return 0.0;
+
+    double done_predicted = job_predicted * job_done / job_total;
+
+    // Отношение фактического времени к предсказанному;
+    // предсказание служит априорной оценкой с весом 10%
+    // длительности задания, чтобы первые страницы не давали скачков.
+    double prior = qMax(job_predicted * 0.1, 1.0);
+    double ratio = (elapsed() + prior) / (done_predicted + prior);
+
+    return (job_predicted - done_predicted) * ratio;
+}
+
+double ModbusFlashEstimator::bytesPerSecond() const
+{
+    return job_rate;
+}
+
+QJsonObject ModbusFlashEstimator::toJson() const
+{
+    ModbusTransferPlanner::Timing tm = timing();
+
+    QJsonObject obj;
+
+    obj[QStringLiteral("baud")] = static_cast<double>(est_baud);
+    obj[QStringLiteral("frame_delay_us")] = static_cast<double>(frame_delay);
+    obj[QStringLiteral("rtt_us")] = static_cast<double>(rtt_avg);
+    obj[QStringLiteral("erase_rtt_us")] = static_cast<double>(erase_avg);
+    obj[QStringLiteral("response_latency_us")] = static_cast<double>(tm.response_latency);
+    obj[QStringLiteral("erase_latency_us")] = static_cast<double>(tm.erase_latency);
+    obj[QStringLiteral("predicted_s")] = job_predicted;
+    obj[QStringLiteral("elapsed_s")] = elapsed();
+    obj[QStringLiteral("eta_s")] = eta();
+    obj[QStringLiteral("bytes_per_s")] = job_rate;
+
+    return obj;
+}
+
+qint64 ModbusFlashEstimator::average(qint64 avg, qint64 val, quint32 count)
+{
+    if(count == 0) return val;
+
+    qint64 n = qMin<quint32>(count, AVERAGE_WINDOW);
+
+    return avg + (val - avg) / n;
+}
@@ -0,0 +1,85 @@
+#ifndef MODBUSFLASHESTIMATOR_H
+#define MODBUSFLASHESTIMATOR_H
+
+#include <QtGlobal>
+#include <QJsonObject>
+#include "modbustransferplanner.h"
+
+
+/*
+ * Оценка длительности задания прошивки одного устройства.
+ * До начала задания длительность предсказывается по плану передачи
+ * и модели линии (скорость порта, задержка кадра), откалиброванной
+ * измеренными RTT устройства и временем стирания страницы.
+ * Во время задания оценка уточняется по моментам изменения прогресса.
+ * Времена измерений - в микросекундах, моменты - в наносекундах.
+ */
+class ModbusFlashEstimator
+{
+public:
+    ModbusFlashEstimator();
+
+    // Сброс измерений и задания.
+    void reset();
+
+    quint32 baud() const;
+    void setBaud(quint32 baud);
+
+    quint32 frameDelay() const;
+    void setFrameDelay(quint32 usecs);
+
+    /*
+     * Измерение транзакции без долгих операций (чтение или запись регистра):
+     * из RTT вычитается время кадров по модели, остаток
+     * считается временем реакции устройства и хоста.
+     */
+    void addRttSample(quint64 rtt, int req_size, int resp_size);
+    // Измерение транзакции стирания страницы.
+    void addEraseSample(quint64 rtt);
+
+    // Измеренные RTT короткой транзакции и стирания, 0 - нет данных.
+    quint64 measuredRtt() const;
+    quint64 measuredErase() const;
+
+    // Модель линии и устройства с учётом измерений.
+    ModbusTransferPlanner::Timing timing() const;
+
+    // Предсказание длительности плана, с.
+    // Устанавливает планировщику модель timing().
+    double predict(ModbusTransferPlanner* planner) const;
+
+    void start(quint64 total_bytes, double predicted, qint64 now);
+    void update(quint64 done_bytes, qint64 now);
+
+    // Длительность задания до начала, с.
+    double predicted() const;
+    // Прошло с начала задания, с.
+    double elapsed() const;
+    // Оставшееся время, с.
+    double eta() const;
+    // Скорость передачи образа, байт/с.
+    double bytesPerSecond() const;
+
+    QJsonObject toJson() const;
+
+private:
+    static qint64 average(qint64 avg, qint64 val, quint32 count);
+
+    quint32 est_baud;
+    quint32 frame_delay;
+
+    qint64 rtt_avg;
+    quint32 rtt_count;
+    qint64 overhead_avg;
+    qint64 erase_avg;
+    quint32 erase_count;
+
+    quint64 job_total;
+    quint64 job_done;
+    double job_predicted;
+    qint64 job_start;
+    qint64 job_last;
+    double job_rate;
+};
+
+#endif // MODBUSFLASHESTIMATOR_H
@@ -0,0 +1,258 @@
+#include "modbusimagecache.h"
+#include "modbuscrc32.h"
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+
+
+// Подкаталог, которым владеет кэш; остальное содержимое каталога не трогается.
+#define IMAGE_CACHE_SUBDIR "blobs"
+#define IMAGE_CACHE_INDEX "index.json"
+#define IMAGE_CACHE_SUFFIX ".bin"
+
+
+ModbusImageCache::Entry::Entry()
+{
+    address = 0;
+    size = 0;
+    crc = 0;
+}
+
+ModbusImageCache::ModbusImageCache()
+{
+    cache_enabled = false;
+}
+
+ModbusImageCache& ModbusImageCache::get()
+{
+    static ModbusImageCache cache;
+
+    return cache;
+}
+
+ModbusImageCache::~ModbusImageCache()
+{
+}
+
+bool ModbusImageCache::isEnabled() const
+{
+    return cache_enabled;
+}
+
+void ModbusImageCache::setEnabled(bool enabled)
+{
+    cache_enabled = enabled;
+}
+
+const QString& ModbusImageCache::directory() const
+{
+    return root_dir;
+}
+
+bool ModbusImageCache::setDirectory(const QString& dir)
+{
+    entries.clear();
+    images.clear();
+    cache_dir.clear();
+    root_dir.clear();
+
+    if(dir.isEmpty()) return true;
+
+    QString blobs_dir = QDir(dir).filePath(QStringLiteral(IMAGE_CACHE_SUBDIR));
+
+    if(!QDir().mkpath(blobs_dir)) return false;
+
+    root_dir = dir;
+    cache_dir = blobs_dir;
+
+    // Индекса ещё нет - пустой кэш.
+    if(!QFile::exists(QDir(cache_dir).filePath(QStringLiteral(IMAGE_CACHE_INDEX)))) return true;
+
+    return loadIndex();
+}
+
+bool ModbusImageCache::find(const QString& link, int slave, quint16 device_id, Entry* entry) const
+{
+    if(!isEnabled() || link.isEmpty()) return false;
+
+    auto it = entries.constFind(key(link, slave, device_id));
+    if(it == entries.constEnd()) return false;
+
+    *entry = it.value();
+
+    return true;
+}
+
+QByteArray ModbusImageCache::image(const Entry& entry) const
+{
+    if(cache_dir.isEmpty()) return images.value(entry.sha256);
+
+    QFile file(imagePath(entry.sha256));
+    if(!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    QByteArray ba = file.readAll();
+
+    if(static_cast<quint32>(ba.size()) != entry.size ||
+       QCryptographicHash::hash(ba, QCryptographicHash::Sha256) != entry.sha256){
+        return QByteArray();
+    }
+
+    return ba;
+}
+
+bool ModbusImageCache::insert(const QString& link, int slave, quint16 device_id, quint32 address, const QByteArray& image)
+{
+    if(!isEnabled() || link.isEmpty() || image.isEmpty()) return false;
+
+    Entry entry;
+    entry.address = address;
+    entry.size = static_cast<quint32>(image.size());
+    entry.crc = ModbusCrc32::calc(image.constData(), image.size());
+    entry.sha256 = QCryptographicHash::hash(image, QCryptographicHash::Sha256);
+
+    if(cache_dir.isEmpty()){
+        images.insert(entry.sha256, image);
+        entries.insert(key(link, slave, device_id), entry);
+        prune();
+        return true;
+    }
+
+    // Образ с тем же содержимым уже записан для другого устройства.
+    QString path = imagePath(entry.sha256);
+
+    if(!QFile::exists(path)){
+        QSaveFile file(path);
+        if(!file.open(QIODevice::WriteOnly)) return false;
+        if(file.write(image) != image.size()) return false;
+        if(!file.commit()) return false;
+    }
+
+    entries.insert(key(link, slave, device_id), entry);
+
+    prune();
+
+    return saveIndex();
+}
+
+void ModbusImageCache::remove(const QString& link, int slave, quint16 device_id)
+{
+    if(entries.remove(key(link, slave, device_id)) == 0) return;
+
+    prune();
+    if(!cache_dir.isEmpty()) saveIndex();
+}
+
+void ModbusImageCache::clear()
+{
+    entries.clear();
+
+    prune();
+    if(!cache_dir.isEmpty()) saveIndex();
+}
+
+int ModbusImageCache::count() const
+{
+    return entries.size();
+}
+
+QString ModbusImageCache::key(const QString& link, int slave, quint16 device_id)
+{
+    return link + QLatin1Char('#') + QString::number(slave) + QLatin1Char('#') + QString::number(device_id);
+}
+
+QString ModbusImageCache::imagePath(const QByteArray& sha256) const
+{
+    return QDir(cache_dir).filePath(QString::fromLatin1(sha256.toHex()) + QStringLiteral(IMAGE_CACHE_SUFFIX));
+}
+
+bool ModbusImageCache::loadIndex()
+{
+    QFile file(QDir(cache_dir).filePath(QStringLiteral(IMAGE_CACHE_INDEX)));
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if(!doc.isArray()) return false;
+
+    for(const QJsonValue& val: doc.array()){
+        QJsonObject obj = val.toObject();
+
+        QString link = obj.value(QStringLiteral("link")).toString();
+        int slave = obj.value(QStringLiteral("slave")).toInt();
+        quint16 device_id = static_cast<quint16>(obj.value(QStringLiteral("device_id")).toInt());
+
+        Entry entry;
+        entry.address = static_cast<quint32>(obj.value(QStringLiteral("address")).toDouble());
+        entry.size = static_cast<quint32>(obj.value(QStringLiteral("size")).toDouble());
+        entry.crc = static_cast<quint32>(obj.value(QStringLiteral("crc")).toDouble());
+        entry.sha256 = QByteArray::fromHex(obj.value(QStringLiteral("sha256")).toString().toLatin1());
+
+        if(link.isEmpty() || entry.size == 0 || entry.sha256.size() != 32) continue;
+
+        entries.insert(key(link, slave, device_id), entry);
+    }
+
+    return true;
+}
+
+bool ModbusImageCache::saveIndex() const
+{
+    QJsonArray arr;
+
+    for(auto it = entries.constBegin(); it != entries.constEnd(); ++ it){
+        QString k = it.key();
+
+        QJsonObject obj;
+        obj[QStringLiteral("link")] = k.section(QLatin1Char('#'), 0, -3);
+        obj[QStringLiteral("slave")] = k.section(QLatin1Char('#'), -2, -2).toInt();
+        obj[QStringLiteral("device_id")] = k.section(QLatin1Char('#'), -1).toInt();
+        obj[QStringLiteral("address")] = static_cast<double>(it.value().address);
+        obj[QStringLiteral("size")] = static_cast<double>(it.value().size);
+        obj[QStringLiteral("crc")] = static_cast<double>(it.value().crc);
+        obj[QStringLiteral("sha256")] = QString::fromLatin1(it.value().sha256.toHex());
+
+        arr.append(obj);
+    }
+
+    QSaveFile file(QDir(cache_dir).filePath(QStringLiteral(IMAGE_CACHE_INDEX)));
+    if(!file.open(QIODevice::WriteOnly)) return false;
+
+    if(file.write(QJsonDocument(arr).toJson()) < 0) return false;
+
+    return file.commit();
+}
+
+void ModbusImageCache::prune()
+{
+    if(cache_dir.isEmpty()){
+        QSet<QByteArray> used;
+        for(const Entry& entry: entries) used.insert(entry.sha256);
+
+        for(auto it = images.begin(); it != images.end();){
+            if(used.contains(it.key())) ++ it;
+            else it = images.erase(it);
+        }
+        return;
+    }
+
+    QSet<QString> used;
+
+    for(const Entry& entry: entries){
+        used.insert(QString::fromLatin1(entry.sha256.toHex()) + QStringLiteral(IMAGE_CACHE_SUFFIX));
+    }
+
+    QDir dir(cache_dir);
+
+    // Только файлы, которые мог записать кэш: SHA-256 в hex и суффикс.
+    QRegularExpression blob_re(QStringLiteral("^[0-9a-f]{64}\\" IMAGE_CACHE_SUFFIX "$"));
+
+    for(const QString& name: dir.entryList(QStringList() << QStringLiteral("*" IMAGE_CACHE_SUFFIX), QDir::Files)){
+        if(used.contains(name) || !blob_re.match(name).hasMatch()) continue;
+        dir.remove(name);
+    }
+}
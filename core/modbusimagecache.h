@@ -0,0 +1,74 @@
+#ifndef MODBUSIMAGECACHE_H
+#define MODBUSIMAGECACHE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+
+
+/*
+ * Кэш последних записанных образов по ключу линия + адрес
+ * + идентификатор устройства. Образы хранятся в подкаталоге blobs
+ * заданного каталога по SHA-256 содержимого, один файл на образ
+ * для всех устройств; индекс - index.json там же. Файлы вне
+ * подкаталога кэш не трогает. Без каталога
+ * образы хранятся в памяти до конца сеанса.
+ * ModbusFirmware по образу из кэша находит изменённые страницы
+ * без чтения памяти устройства.
+ */
+class ModbusImageCache
+{
+public:
+
+    struct Entry {
+        Entry();
+
+        quint32 address;
+        quint32 size;
+        quint32 crc; // CRC-32 образа, для подтверждения загрузчиком.
+        QByteArray sha256;
+    };
+
+    static ModbusImageCache& get();
+    ~ModbusImageCache();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    // Каталог кэша, создаётся при отсутствии; индекс загружается.
+    // Пустой - кэш в памяти.
+    const QString& directory() const;
+    bool setDirectory(const QString& dir);
+
+    bool find(const QString& link, int slave, quint16 device_id, Entry* entry) const;
+    // Образ записи, пустой - если файла нет или он повреждён.
+    QByteArray image(const Entry& entry) const;
+
+    bool insert(const QString& link, int slave, quint16 device_id, quint32 address, const QByteArray& image);
+    void remove(const QString& link, int slave, quint16 device_id);
+
+    void clear();
+    int count() const;
+
+private:
+    ModbusImageCache();
+
+    static QString key(const QString& link, int slave, quint16 device_id);
+    QString imagePath(const QByteArray& sha256) const;
+
+    bool loadIndex();
+    bool saveIndex() const;
+    // Удаление образов, на которые не ссылается ни одна запись.
+    void prune();
+
+    bool cache_enabled;
+    QString root_dir;
+    // Подкаталог образов и индекса.
+    QString cache_dir;
+    QHash<QString, Entry> entries;
+    // Образы кэша в памяти по SHA-256.
+    QHash<QByteArray, QByteArray> images;
+};
+
+#endif // MODBUSIMAGECACHE_H
@@ -0,0 +1,91 @@
+#include "modbusimagecompare.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMAGE_COMPARE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGE_COMPARE_NEON
+#endif
+
+
+int ModbusImageCompare::firstMismatch(const void* a, const void* b, int size)
+{
+    const uint8_t* pa = static_cast<const uint8_t*>(a);
+    const uint8_t* pb = static_cast<const uint8_t*>(b);
+
+    int i = 0;
+
+#if defined(IMAGE_COMPARE_SSE2)
+    for(; i + 16 <= size; i += 16){
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff) break;
+    }
+#elif defined(IMAGE_COMPARE_NEON)
+    for(; i + 16 <= size; i += 16){
+        uint8x16_t eq = vceqq_u8(vld1q_u8(pa + i), vld1q_u8(pb + i));
+        uint64x2_t eq64 = vreinterpretq_u64_u8(eq);
+        if((vgetq_lane_u64(eq64, 0) & vgetq_lane_u64(eq64, 1)) != ~static_cast<uint64_t>(0)) break;
+    }
+#endif
+
+    return i + firstMismatchScalar(pa + i, pb + i, size - i);
+}
+
+int ModbusImageCompare::firstMatch(const void* a, const void* b, int size)
+{
+    const uint8_t* pa = static_cast<const uint8_t*>(a);
+    const uint8_t* pb = static_cast<const uint8_t*>(b);
+
+    int i = 0;
+
+#if defined(IMAGE_COMPARE_SSE2)
+    for(; i + 16 <= size; i += 16){
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0) break;
+    }
+#elif defined(IMAGE_COMPARE_NEON)
+    for(; i + 16 <= size; i += 16){
+        uint8x16_t eq = vceqq_u8(vld1q_u8(pa + i), vld1q_u8(pb + i));
+        uint64x2_t eq64 = vreinterpretq_u64_u8(eq);
+        if((vgetq_lane_u64(eq64, 0) | vgetq_lane_u64(eq64, 1)) != 0) break;
+    }
+#endif
+
+    return i + firstMatchScalar(pa + i, pb + i, size - i);
+}
+
+int ModbusImageCompare::firstMismatchScalar(const void* a, const void* b, int size)
+{
+    const uint8_t* pa = static_cast<const uint8_t*>(a);
+    const uint8_t* pb = static_cast<const uint8_t*>(b);
+
+    int i = 0;
+    while(i < size && pa[i] == pb[i]) i ++;
+
+    return i;
+}
+
+int ModbusImageCompare::firstMatchScalar(const void* a, const void* b, int size)
+{
+    const uint8_t* pa = static_cast<const uint8_t*>(a);
+    const uint8_t* pb = static_cast<const uint8_t*>(b);
+
+    int i = 0;
+    while(i < size && pa[i] != pb[i]) i ++;
+
+    return i;
+}
+
+const char* ModbusImageCompare::implementation()
+{
+#if defined(IMAGE_COMPARE_SSE2)
+    return "sse2";
+#elif defined(IMAGE_COMPARE_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
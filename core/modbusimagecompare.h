@@ -0,0 +1,28 @@
+#ifndef MODBUSIMAGECOMPARE_H
+#define MODBUSIMAGECOMPARE_H
+
+#include <stdint.h>
+
+
+/*
+ * Поиск расхождений прочитанных данных с образом.
+ * Сравнение блоками по 16 байт на SIMD (SSE2/NEON),
+ * блок с расхождением и хвост - скалярно.
+ */
+class ModbusImageCompare
+{
+public:
+    // Индекс первого различающегося байта, size - если совпадают.
+    static int firstMismatch(const void* a, const void* b, int size);
+    // Индекс первого совпадающего байта, size - если различаются все.
+    static int firstMatch(const void* a, const void* b, int size);
+
+    // Скалярные реализации, для проверки и сравнения.
+    static int firstMismatchScalar(const void* a, const void* b, int size);
+    static int firstMatchScalar(const void* a, const void* b, int size);
+
+    // Используемая реализация: "sse2", "neon" или "scalar".
+    static const char* implementation();
+};
+
+#endif // MODBUSIMAGECOMPARE_H
@@ -0,0 +1,215 @@
+#include "modbusimagedigest.h"
+#include "modbuscrc32.h"
+#include "modbustimeline.h"
+#include <QCryptographicHash>
+#include <QtConcurrent>
+
+
+// Вычисление одной страницы в потоке пула.
+// Образ разделяется неявно, копирования нет.
+struct DigestPageFunctor {
+    typedef ModbusImageDigest::Page result_type;
+
+    DigestPageFunctor(quint32 address, const QByteArray& image, int algorithms)
+        : image_address(address), image(image), algorithms(algorithms)
+    {
+    }
+
+    ModbusImageDigest::Page operator()(const ModbusImageDigest::Page& pg) const
+    {
+        ModbusImageDigest::Page res = pg;
+        const char* data = image.constData() + (pg.address - image_address);
+
+        if(algorithms & ModbusImageDigest::Crc32){
+            res.crc = ModbusCrc32::calc(data, static_cast<int>(pg.size));
+        }
+
+        if(algorithms & ModbusImageDigest::Sha256){
+            res.sha256 = QCryptographicHash::hash(QByteArray::fromRawData(data, static_cast<int>(pg.size)),
+                                                  QCryptographicHash::Sha256);
+        }
+
+        return res;
+    }
+
+    quint32 image_address;
+    QByteArray image;
+    int algorithms;
+};
+
+
+ModbusImageDigest::Page::Page()
+{
+    address = 0;
+    size = 0;
+    crc = 0;
+}
+
+ModbusImageDigest::ModbusImageDigest(QObject *parent) : QObject(parent)
+{
+    digest_address = 0;
+    digest_page_size = 0;
+    digest_algorithms = 0;
+    ready_count = 0;
+
+    connect(&watcher, &QFutureWatcher<Page>::resultReadyAt, this, &ModbusImageDigest::resultReady);
+    connect(&watcher, &QFutureWatcher<Page>::finished, this, &ModbusImageDigest::watcherFinished);
+}
+
+ModbusImageDigest::~ModbusImageDigest()
+{
+    cancel();
+}
+
+bool ModbusImageDigest::start(quint32 address, const QByteArray& image, quint32 page_size, int algorithms)
+{
+    cancel();
+
+    if(image.isEmpty() || page_size == 0) return false;
+
+    digest_address = address;
+    digest_page_size = page_size;
+    digest_algorithms = algorithms;
+    digest_image = image;
+
+    pages.clear();
+    ready.clear();
+    ready_count = 0;
+
+    quint32 end = address + static_cast<quint32>(image.size());
+
+    for(quint32 addr = address; addr < end;){
+        Page pg;
+        pg.address = addr;
+        pg.size = qMin((addr & ~(page_size - 1)) + page_size, end) - addr;
+        pages.append(pg);
+        addr += pg.size;
+    }
+
+    ready.fill(false, pages.size());
+
+    ModbusTimeline::asyncBegin("digest", "image", this, "pages", pages.size());
+
+    watcher.setFuture(QtConcurrent::mapped(pages, DigestPageFunctor(address, digest_image, algorithms)));
+
+    return true;
+}
+
+void ModbusImageDigest::cancel()
+{
+    if(!watcher.isRunning()) return;
+
+    // Отменённые результаты не нужны, сигналы отключаются на время ожидания.
+    watcher.blockSignals(true);
+    watcher.cancel();
+    watcher.waitForFinished();
+    watcher.blockSignals(false);
+
+    ModbusTimeline::asyncEnd("digest", "image", this, "ready", ready_count);
+
+    digest_image.clear();
+    pages.clear();
+    ready.clear();
+    ready_count = 0;
+}
+
+void ModbusImageDigest::waitForFinished()
+{
+    watcher.waitForFinished();
+}
+
+bool ModbusImageDigest::isRunning() const
+{
+    return watcher.isRunning();
+}
+
+bool ModbusImageDigest::isFor(quint32 address, const QByteArray& image, quint32 page_size, int algorithms) const
+{
+    if(pages.isEmpty()) return false;
+
+    return digest_address == address &&
+           digest_page_size == page_size &&
+           (digest_algorithms & algorithms) == algorithms &&
+           digest_image == image;
+}
+
+quint32 ModbusImageDigest::address() const
+{
+    return digest_address;
+}
+
+const QByteArray& ModbusImageDigest::image() const
+{
+    return digest_image;
+}
+
+int ModbusImageDigest::pagesCount() const
+{
+    return pages.size();
+}
+
+int ModbusImageDigest::readyCount() const
+{
+    return ready_count;
+}
+
+bool ModbusImageDigest::isReady(int index) const
+{
+    if(index < 0 || index >= ready.size()) return false;
+
+    return ready.at(index);
+}
+
+bool ModbusImageDigest::isReady(int first, int count) const
+{
+    if(first < 0 || count < 0 || first + count > ready.size()) return false;
+
+    for(int i = first; i < first + count; i ++){
+        if(!ready.at(i)) return false;
+    }
+
+    return true;
+}
+
+const ModbusImageDigest::Page& ModbusImageDigest::page(int index) const
+{
+    return pages.at(index);
+}
+
+quint32 ModbusImageDigest::crc(int first, int count) const
+{
+    if(count <= 0) return 0;
+
+    quint32 res = pages.at(first).crc;
+
+    for(int i = first + 1; i < first + count; i ++){
+        res = ModbusCrc32::combine(res, pages.at(i).crc, pages.at(i).size);
+    }
+
+    return res;
+}
+
+void ModbusImageDigest::resultReady(int index)
+{
+    if(index < 0 || index >= pages.size() || ready.at(index)) return;
+
+    pages[index] = watcher.resultAt(index);
+    ready[index] = true;
+    ready_count ++;
+
+    emit pageReady(index);
+}
+
+void ModbusImageDigest::watcherFinished()
+{
+    if(watcher.isCanceled()) return;
+
+    // Результаты, сигналы о которых ещё в очереди.
+    for(int i = 0; i < pages.size(); i ++){
+        if(!ready.at(i)) resultReady(i);
+    }
+
+    ModbusTimeline::asyncEnd("digest", "image", this, "ready", ready_count);
+
+    emit finished();
+}
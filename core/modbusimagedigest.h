@@ -0,0 +1,84 @@
+#ifndef MODBUSIMAGEDIGEST_H
+#define MODBUSIMAGEDIGEST_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QFutureWatcher>
+
+
+/*
+ * Постраничные дайджесты образа (CRC-32 и SHA-256),
+ * вычисляемые в пуле потоков QtConcurrent.
+ * Страницы выровнены по размеру страницы FLASH, первая
+ * и последняя могут быть неполными. Готовность каждой
+ * страницы сообщается сигналом pageReady() по мере
+ * вычисления, поэтому потребитель может начинать работу
+ * с первыми страницами, не дожидаясь всего образа.
+ */
+class ModbusImageDigest : public QObject
+{
+    Q_OBJECT
+public:
+
+    enum Algorithm {
+        Crc32 = 0x1,
+        Sha256 = 0x2
+    };
+
+    struct Page {
+        Page();
+
+        quint32 address;
+        quint32 size;
+        quint32 crc;
+        QByteArray sha256;
+    };
+
+    explicit ModbusImageDigest(QObject *parent = 0);
+    ~ModbusImageDigest();
+
+    // Запуск вычисления, текущее прерывается.
+    bool start(quint32 address, const QByteArray& image, quint32 page_size, int algorithms = Crc32);
+    void cancel();
+    void waitForFinished();
+
+    bool isRunning() const;
+    // Дайджесты этого же образа уже вычислены или вычисляются.
+    bool isFor(quint32 address, const QByteArray& image, quint32 page_size, int algorithms = Crc32) const;
+
+    quint32 address() const;
+    const QByteArray& image() const;
+
+    int pagesCount() const;
+    int readyCount() const;
+    bool isReady(int index) const;
+    bool isReady(int first, int count) const;
+
+    const Page& page(int index) const;
+
+    // CRC-32 страниц first..first+count-1, склейкой CRC страниц.
+    quint32 crc(int first, int count) const;
+
+signals:
+    void pageReady(int index);
+    void finished();
+
+private slots:
+    void resultReady(int index);
+    void watcherFinished();
+
+private:
+    QFutureWatcher<Page> watcher;
+
+    quint32 digest_address;
+    quint32 digest_page_size;
+    int digest_algorithms;
+    QByteArray digest_image;
+
+    QVector<Page> pages;
+    QVector<bool> ready;
+    int ready_count;
+};
+
+#endif // MODBUSIMAGEDIGEST_H
@@ -0,0 +1,130 @@
+#include "modbusimagewatcher.h"
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QFile>
+
+
+// Пауза после изменения по умолчанию, мс.
+#define IMAGE_WATCHER_SETTLE_TIME 300
+
+
+ModbusImageWatcher::ModbusImageWatcher(QObject *parent) : QObject(parent)
+{
+    fs_watcher = new QFileSystemWatcher(this);
+
+    settle_timer.setSingleShot(true);
+    settle_timer.setInterval(IMAGE_WATCHER_SETTLE_TIME);
+
+    connect(fs_watcher, &QFileSystemWatcher::fileChanged, this, &ModbusImageWatcher::fileChanged);
+    connect(fs_watcher, &QFileSystemWatcher::directoryChanged, this, &ModbusImageWatcher::directoryChanged);
+    connect(&settle_timer, &QTimer::timeout, this, &ModbusImageWatcher::settled);
+}
+
+ModbusImageWatcher::~ModbusImageWatcher()
+{
+}
+
+bool ModbusImageWatcher::start(const QString& filename)
+{
+    stop();
+
+    QFileInfo info(filename);
+
+    // Каталог - чтобы заметить файл, заменённый или созданный заново.
+    if(!fs_watcher->addPath(info.absolutePath())) return false;
+
+    file_name = info.absoluteFilePath();
+
+    if(info.exists()){
+        fs_watcher->addPath(file_name);
+        readImage(&last_image);
+    }
+
+    return true;
+}
+
+void ModbusImageWatcher::stop()
+{
+    settle_timer.stop();
+
+    if(!fs_watcher->files().isEmpty()) fs_watcher->removePaths(fs_watcher->files());
+    if(!fs_watcher->directories().isEmpty()) fs_watcher->removePaths(fs_watcher->directories());
+
+    file_name.clear();
+    last_image.clear();
+}
+
+bool ModbusImageWatcher::isWatching() const
+{
+    return !file_name.isEmpty();
+}
+
+const QString& ModbusImageWatcher::fileName() const
+{
+    return file_name;
+}
+
+const QByteArray& ModbusImageWatcher::image() const
+{
+    return last_image;
+}
+
+int ModbusImageWatcher::settleTime() const
+{
+    return settle_timer.interval();
+}
+
+void ModbusImageWatcher::setSettleTime(int ms)
+{
+    settle_timer.setInterval(ms);
+}
+
+void ModbusImageWatcher::fileChanged(const QString& path)
+{
+    if(path != file_name) return;
+
+    settle_timer.start();
+}
+
+void ModbusImageWatcher::directoryChanged(const QString& path)
+{
+    Q_UNUSED(path);
+
+    if(file_name.isEmpty()) return;
+
+    // Файл заменён - слежение за ним снято.
+    if(!fs_watcher->files().contains(file_name) && QFile::exists(file_name)){
+        fs_watcher->addPath(file_name);
+        settle_timer.start();
+    }
+}
+
+void ModbusImageWatcher::settled()
+{
+    if(file_name.isEmpty()) return;
+
+    if(!fs_watcher->files().contains(file_name) && QFile::exists(file_name)){
+        fs_watcher->addPath(file_name);
+    }
+
+    QByteArray ba;
+
+    // Файл удалён или пуст на время сборки - ждём следующего изменения.
+    if(!readImage(&ba) || ba.isEmpty()) return;
+
+    if(ba == last_image) return;
+
+    last_image = ba;
+
+    emit imageChanged(last_image);
+}
+
+bool ModbusImageWatcher::readImage(QByteArray* ba) const
+{
+    QFile file(file_name);
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    *ba = file.readAll();
+
+    return ba->size() == file.size();
+}
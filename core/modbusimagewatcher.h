@@ -0,0 +1,58 @@
+#ifndef MODBUSIMAGEWATCHER_H
+#define MODBUSIMAGEWATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QTimer>
+
+class QFileSystemWatcher;
+
+
+/*
+ * Слежение за файлом образа - результатом сборки.
+ * Сборка пишет файл частями или заменяет его переименованием,
+ * поэтому файл читается после паузы в изменениях, и новый
+ * образ сообщается, только если содержимое изменилось.
+ * Изменённые страницы записывает ModbusFirmware по кэшу образов.
+ */
+class ModbusImageWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusImageWatcher(QObject *parent = 0);
+    ~ModbusImageWatcher();
+
+    // Текущее содержимое файла - исходный образ, о нём не сообщается.
+    bool start(const QString& filename);
+    void stop();
+
+    bool isWatching() const;
+    const QString& fileName() const;
+
+    // Последний прочитанный образ.
+    const QByteArray& image() const;
+
+    // Пауза после последнего изменения до чтения файла, мс.
+    int settleTime() const;
+    void setSettleTime(int ms);
+
+signals:
+    void imageChanged(const QByteArray& image);
+
+private slots:
+    void fileChanged(const QString& path);
+    void directoryChanged(const QString& path);
+    void settled();
+
+private:
+    bool readImage(QByteArray* ba) const;
+
+    QFileSystemWatcher* fs_watcher;
+    QTimer settle_timer;
+
+    QString file_name;
+    QByteArray last_image;
+};
+
+#endif // MODBUSIMAGEWATCHER_H
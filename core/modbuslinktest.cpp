@@ -0,0 +1,430 @@
+#include "modbuslinktest.h"
+#include "modbusdev.h"
+#include "modbusnet.h"
+#include "modbusmsg.h"
+#include "modbusbootregs.h"
+#include "modbustransferplanner.h"
+#include <QByteArray>
+#include <math.h>
+#include <QDebug>
+
+
+// Повторов каждого размера запроса.
+#define SWEEP_ROUNDS 4
+// Запросов в пачке.
+#define BURST_SIZE 16
+// Время ожидания ответа во время проверки, мс.
+#define TEST_TIMEOUT 1000
+
+// Наибольшее время стирания страницы stm32f10x, мкс.
+#define ERASE_TIME_MAX 40000
+// Наибольшее время записи полуслова stm32f10x, мкс.
+#define PROGRAM_TIME_MAX 70
+
+// Пределы подбираемых параметров, как в SettingsDlg.
+#define TIMEOUT_MIN 50
+#define TIMEOUT_MAX 1000
+#define RETRIES_MIN 1
+#define RETRIES_MAX 10
+
+// Допустимая вероятность отказа транзакции после всех повторов.
+#define FAIL_PROBABILITY 1e-6
+
+#define REF_TYPE 0x6
+
+// Кандидаты задержки кадра, мкс.
+static const quint32 frame_delays[] = {1, 1000, 2000, 5000, 10000, 20000, 50000, 100000};
+static const int frame_delays_count = sizeof(frame_delays) / sizeof(frame_delays[0]);
+
+
+ModbusLinkTest::Result::Result()
+{
+    probes = 0;
+    lost = 0;
+    rtt_min = 0;
+    rtt_max = 0;
+    turnaround = 0;
+    burst_time = 0;
+    timeout = 0;
+    frame_delay = 0;
+    retries = 0;
+}
+
+ModbusLinkTest::Stats::Stats()
+{
+    probes = 0;
+    lost = 0;
+    rtt_min = 0;
+    rtt_max = 0;
+    rtt_short = 0;
+    turnaround_sum = 0;
+    turnaround_count = 0;
+    burst_start = 0;
+    burst_end = 0;
+}
+
+ModbusLinkTest::ModbusLinkTest(QObject *parent) : QObject(parent)
+{
+    modbus_dev = nullptr;
+    executing = false;
+    phase = Sweep;
+    candidate = 0;
+    probe_index = 0;
+    pending = 0;
+    sent_time = 0;
+    progress = 0;
+    saved_timeout = 0;
+    saved_retries = 0;
+    saved_frame_delay = 0;
+}
+
+ModbusLinkTest::ModbusLinkTest(ModbusDev* dev, QObject *parent) : QObject(parent)
+{
+    modbus_dev = dev;
+    executing = false;
+    phase = Sweep;
+    candidate = 0;
+    probe_index = 0;
+    pending = 0;
+    sent_time = 0;
+    progress = 0;
+    saved_timeout = 0;
+    saved_retries = 0;
+    saved_frame_delay = 0;
+}
+
+ModbusLinkTest::~ModbusLinkTest()
+{
+    if(executing){
+        cancelProbes();
+        restoreLink();
+    }
+}
+
+ModbusDev* ModbusLinkTest::modbusDev()
+{
+    return modbus_dev;
+}
+
+void ModbusLinkTest::setModbusDev(ModbusDev* dev)
+{
+    modbus_dev = dev;
+}
+
+bool ModbusLinkTest::isExecuting() const
+{
+    return executing;
+}
+
+const ModbusLinkTest::Result& ModbusLinkTest::result() const
+{
+    return test_result;
+}
+
+QJsonObject ModbusLinkTest::toJson() const
+{
+    QJsonObject obj;
+
+    obj[QStringLiteral("probes")] = static_cast<double>(test_result.probes);
+    obj[QStringLiteral("lost")] = static_cast<double>(test_result.lost);
+    obj[QStringLiteral("rtt_min_us")] = static_cast<double>(test_result.rtt_min);
+    obj[QStringLiteral("rtt_max_us")] = static_cast<double>(test_result.rtt_max);
+    obj[QStringLiteral("turnaround_us")] = static_cast<double>(test_result.turnaround);
+    obj[QStringLiteral("burst_us")] = static_cast<double>(test_result.burst_time);
+    obj[QStringLiteral("timeout_ms")] = static_cast<double>(test_result.timeout);
+    obj[QStringLiteral("frame_delay_us")] = static_cast<double>(test_result.frame_delay);
+    obj[QStringLiteral("retries")] = static_cast<double>(test_result.retries);
+
+    return obj;
+}
+
+bool ModbusLinkTest::exec()
+{
+    if(executing) return false;
+    if(!modbus_dev || !modbus_dev->isValid()) return false;
+    if(!modbus_dev->modbusNet()->isConnectedToNet()) return false;
+
+    ModbusNet* net = modbus_dev->modbusNet();
+
+    saved_timeout = net->timeout();
+    saved_retries = net->retries();
+    saved_frame_delay = net->frameDelay();
+
+    buildProbes();
+
+    executing = true;
+    candidate = 0;
+    progress = 0;
+    test_result = Result();
+
+    emit progressSetMax(frame_delays_count * (sweep_probes.size() + BURST_SIZE));
+    emit progressChanged(progress);
+
+    if(!startCandidate()){
+        fail(ModbusErr(ModbusErr::General, tr("ModbusLinkTest"), tr("Error sending probe!")));
+    }
+
+    return true;
+}
+
+void ModbusLinkTest::probeSended()
+{
+    probeDone(qobject_cast<ModbusMsg*>(sender()), false);
+}
+
+void ModbusLinkTest::probeError(ModbusErr error)
+{
+    ModbusMsg* msg = qobject_cast<ModbusMsg*>(sender());
+
+    switch(error.modbusError()){
+    case QModbusDevice::ProtocolError:
+    case QModbusDevice::ConnectionError:
+    case QModbusDevice::ReplyAbortedError:
+        // Исключение загрузчика или разрыв соединения - не потеря.
+        probe_msgs.removeOne(msg);
+        if(msg) msg->deleteLater();
+        fail(error);
+        break;
+    default:
+        probeDone(msg, true);
+        break;
+    }
+}
+
+void ModbusLinkTest::buildProbes()
+{
+    sweep_probes.clear();
+
+    // Чтение регистра: наименьший ответ.
+    Probe reg_probe;
+    reg_probe.request = QModbusRequest(QModbusPdu::ReadInputRegisters,
+                                       static_cast<quint16>(BOOT_MODBUS_INPUT_REG_FLASH_SIZE), static_cast<quint16>(1));
+    // func(1) + byte_count(1) + value(2).
+    reg_probe.resp_size = 4;
+
+    // Чтение записей текущей страницы: ответ растёт до предела PDU.
+    // func(1) + byte_count(1) + resp_len(1) + ref_type(1).
+    const int max_recs = (modbus_dev->maxPduSize() - 4) / 2;
+    const int recs[] = {1, 16, 64, max_recs};
+
+    for(int round = 0; round < SWEEP_ROUNDS; round ++){
+        sweep_probes.append(reg_probe);
+
+        for(int count: recs){
+            count = qMin(count, max_recs);
+
+            QByteArray data(8, 0);
+            uint8_t* ptr = reinterpret_cast<uint8_t*>(data.data());
+
+            ptr[0] = 7;
+            ptr[1] = REF_TYPE;
+            ptr[2] = BOOT_MODBUS_FILE_PAGE >> 8;
+            ptr[3] = BOOT_MODBUS_FILE_PAGE & 0xff;
+            ptr[4] = 0;
+            ptr[5] = 0;
+            ptr[6] = static_cast<uint8_t>(count >> 8);
+            ptr[7] = static_cast<uint8_t>(count & 0xff);
+
+            Probe probe;
+            probe.request = QModbusRequest(QModbusPdu::ReadFileRecord, data);
+            probe.resp_size = 4 + count * 2;
+
+            sweep_probes.append(probe);
+        }
+    }
+
+    // Пачка - самые длинные ответы.
+    burst_probe = sweep_probes.last();
+}
+
+bool ModbusLinkTest::startCandidate()
+{
+    cand_stats = Stats();
+
+    modbus_dev->modbusNet()->setLinkParameters(TEST_TIMEOUT, 0, frame_delays[candidate]);
+
+    phase = Sweep;
+    probe_index = 0;
+    pending = 0;
+
+    return sendProbe(sweep_probes.at(probe_index));
+}
+
+bool ModbusLinkTest::sendProbe(const Probe& probe)
+{
+    ModbusMsg* msg = new ModbusMsg(probe.request);
+
+    connect(msg, &ModbusMsg::sendSuccess, this, &ModbusLinkTest::probeSended);
+    connect(msg, &ModbusMsg::sendError, this, &ModbusLinkTest::probeError);
+
+    sent_time = timestamp();
+
+    if(!modbus_dev->sendMsg(msg)){
+        delete msg;
+        return false;
+    }
+
+    probe_msgs.append(msg);
+    pending ++;
+
+    return true;
+}
+
+void ModbusLinkTest::probeDone(ModbusMsg* msg, bool lost)
+{
+    if(!msg) return;
+
+    probe_msgs.removeOne(msg);
+    msg->deleteLater();
+
+    if(!executing) return;
+
+    qint64 now = timestamp();
+
+    pending --;
+    progress ++;
+    emit progressChanged(progress);
+
+    Stats& st = cand_stats;
+
+    st.probes ++;
+    if(lost) st.lost ++;
+
+    if(phase == Sweep){
+        if(!lost){
+            const Probe& probe = sweep_probes.at(probe_index);
+
+            quint64 rtt = (now - sent_time) / 1000;
+
+            if(st.rtt_max == 0 || rtt < st.rtt_min) st.rtt_min = rtt;
+            if(rtt > st.rtt_max) st.rtt_max = rtt;
+            if(probe.resp_size == 4 && (st.rtt_short == 0 || rtt < st.rtt_short)) st.rtt_short = rtt;
+
+            ModbusTransferPlanner::Timing tm;
+            tm.baud = modbus_dev->modbusNet()->baud();
+            tm.turnaround = 0;
+
+            qint64 frames = ModbusTransferPlanner::transactionTime(tm, probe.request.size(), probe.resp_size, 0) / 1000;
+
+            st.turnaround_sum += static_cast<qint64>(rtt) - frames;
+            st.turnaround_count ++;
+        }
+
+        probe_index ++;
+
+        if(probe_index < sweep_probes.size()){
+            if(!sendProbe(sweep_probes.at(probe_index))){
+                fail(ModbusErr(ModbusErr::General, tr("ModbusLinkTest"), tr("Error sending probe!")));
+            }
+            return;
+        }
+
+        // Нет ни одного ответа - дело не в задержке кадра.
+        if(st.lost == st.probes){
+            fail(ModbusErr(ModbusErr::General, tr("ModbusLinkTest"), tr("Device does not respond!")));
+            return;
+        }
+
+        phase = Burst;
+        st.burst_start = now;
+
+        for(int i = 0; i < BURST_SIZE; i ++){
+            if(!sendProbe(burst_probe)){
+                fail(ModbusErr(ModbusErr::General, tr("ModbusLinkTest"), tr("Error sending probe!")));
+                return;
+            }
+        }
+
+        return;
+    }
+
+    if(pending > 0) return;
+
+    st.burst_end = now;
+
+    if(st.lost == 0 || candidate + 1 >= frame_delays_count){
+        finish(st, frame_delays[candidate]);
+        return;
+    }
+
+    candidate ++;
+
+    progress = candidate * (sweep_probes.size() + BURST_SIZE);
+    emit progressChanged(progress);
+
+    if(!startCandidate()){
+        fail(ModbusErr(ModbusErr::General, tr("ModbusLinkTest"), tr("Error sending probe!")));
+    }
+}
+
+void ModbusLinkTest::finish(const Stats& st, quint32 frame_delay)
+{
+    Result& res = test_result;
+
+    res.probes = st.probes;
+    res.lost = st.lost;
+    res.rtt_min = static_cast<quint32>(st.rtt_min);
+    res.rtt_max = static_cast<quint32>(st.rtt_max);
+    res.turnaround = st.turnaround_count ?
+                         static_cast<quint32>(qMax<qint64>(st.turnaround_sum / st.turnaround_count, 0)) : 0;
+    res.burst_time = static_cast<quint32>((st.burst_end - st.burst_start) / 1000 / BURST_SIZE);
+    res.frame_delay = frame_delay;
+
+    // Ответ должен успеть прийти после записи самого длинного
+    // запроса и после стирания страницы, с двукратным запасом.
+    const quint64 max_recs = (modbus_dev->maxPduSize() - 4) / 2;
+    quint64 wait = qMax(st.rtt_max + PROGRAM_TIME_MAX * max_recs, st.rtt_short + ERASE_TIME_MAX) * 2;
+    quint32 timeout = static_cast<quint32>((wait + 9999) / 10000 * 10);
+    res.timeout = qBound<quint32>(TIMEOUT_MIN, timeout, TIMEOUT_MAX);
+
+    // Вероятность потери с поправкой Лапласа: без потерь
+    // на сотне запросов всё равно остаётся запас повторов.
+    double p = static_cast<double>(st.lost + 1) / (st.probes + 2);
+    int retries = static_cast<int>(ceil(log(FAIL_PROBABILITY) / log(p))) - 1;
+    res.retries = static_cast<quint32>(qBound(RETRIES_MIN, retries, RETRIES_MAX));
+
+    restoreLink();
+
+    executing = false;
+
+    emit done();
+}
+
+void ModbusLinkTest::fail(const ModbusErr& error)
+{
+    if(!executing) return;
+
+    cancelProbes();
+    restoreLink();
+
+    executing = false;
+
+    emit errorOccured(error);
+}
+
+void ModbusLinkTest::cancelProbes()
+{
+    for(ModbusMsg* msg: probe_msgs){
+        disconnect(msg, nullptr, this, nullptr);
+
+        if(modbus_dev->cancelMsg(msg) || !msg->isSending()){
+            msg->deleteLater();
+        }else{
+            // Передаваемое сообщение удалит себя само по завершении.
+            connect(msg, &ModbusMsg::finished, msg, &QObject::deleteLater);
+        }
+    }
+
+    probe_msgs.clear();
+    pending = 0;
+}
+
+void ModbusLinkTest::restoreLink()
+{
+    modbus_dev->modbusNet()->setLinkParameters(saved_timeout, saved_retries, saved_frame_delay);
+}
+
+qint64 ModbusLinkTest::timestamp()
+{
+    return modbus_dev->modbusNet()->timestamp();
+}
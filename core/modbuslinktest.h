@@ -0,0 +1,129 @@
+#ifndef MODBUSLINKTEST_H
+#define MODBUSLINKTEST_H
+
+#include <QObject>
+#include <QVector>
+#include <QList>
+#include <QModbusRequest>
+#include <QJsonObject>
+#include "modbuserr.h"
+
+class ModbusDev;
+class ModbusMsg;
+
+
+/*
+ * Проверка линии до загрузчика и подбор параметров связи.
+ * Для каждой задержки кадра из ряда кандидатов (по возрастанию)
+ * загрузчик опрашивается запросами с растущим размером ответа
+ * по одному, затем пачкой подряд, без повторов.
+ * Выбирается наименьшая задержка без потерь; по измеренным
+ * RTT и доле потерь вычисляются время ожидания ответа и число повторов.
+ * Запросы только читают память, состояние загрузчика не меняется.
+ * На время проверки параметры сети подменяются и затем восстанавливаются.
+ */
+class ModbusLinkTest : public QObject
+{
+    Q_OBJECT
+public:
+
+    struct Result {
+        Result();
+
+        quint32 probes; // Запросов при выбранной задержке.
+        quint32 lost;
+        quint32 rtt_min; // мкс.
+        quint32 rtt_max; // мкс.
+        quint32 turnaround; // мкс, RTT за вычетом времени кадров.
+        quint32 burst_time; // мкс на запрос пачки.
+
+        quint32 timeout; // мс.
+        quint32 frame_delay; // мкс.
+        quint32 retries;
+    };
+
+    explicit ModbusLinkTest(QObject *parent = 0);
+    ModbusLinkTest(ModbusDev* dev, QObject *parent = 0);
+    ~ModbusLinkTest();
+
+    ModbusDev* modbusDev();
+    void setModbusDev(ModbusDev* dev);
+
+    bool isExecuting() const;
+
+    const Result& result() const;
+    QJsonObject toJson() const;
+
+signals:
+    void progressSetMax(int val);
+    void progressChanged(int val);
+
+    void done();
+    void errorOccured(ModbusErr error);
+
+public slots:
+    bool exec();
+
+private slots:
+    void probeSended();
+    void probeError(ModbusErr error);
+
+private:
+    struct Probe {
+        QModbusRequest request;
+        int resp_size;
+    };
+
+    struct Stats {
+        Stats();
+
+        quint32 probes;
+        quint32 lost;
+        quint64 rtt_min;
+        quint64 rtt_max;
+        quint64 rtt_short;
+        qint64 turnaround_sum;
+        quint32 turnaround_count;
+        qint64 burst_start;
+        qint64 burst_end;
+    };
+
+    enum Phase {
+        Sweep = 0,
+        Burst
+    };
+
+    ModbusDev* modbus_dev;
+
+    bool executing;
+    Phase phase;
+    int candidate;
+    int probe_index;
+    int pending;
+    qint64 sent_time;
+    int progress;
+
+    QVector<Probe> sweep_probes;
+    Probe burst_probe;
+    Stats cand_stats;
+    QList<ModbusMsg*> probe_msgs;
+
+    quint32 saved_timeout;
+    quint32 saved_retries;
+    quint32 saved_frame_delay;
+
+    Result test_result;
+
+    void buildProbes();
+    bool startCandidate();
+    bool sendProbe(const Probe& probe);
+    void probeDone(ModbusMsg* msg, bool lost);
+    void finish(const Stats& st, quint32 frame_delay);
+    void fail(const ModbusErr& error);
+    void cancelProbes();
+    void restoreLink();
+
+    qint64 timestamp();
+};
+
+#endif // MODBUSLINKTEST_H
@@ -1,5 +1,5 @@
 #include "modbusmsg.h"
-#include <QModbusClient>
+#include "modbustransport.h"
 #include <QModbusReply>
 #include <QDebug>
 
@@ -97,7 +97,7 @@ bool ModbusMsg::clear()
     return true;
 }
 
-bool ModbusMsg::send(QModbusClient *modbus, int slaveAddr)
+bool ModbusMsg::send(ModbusTransport *modbus, int slaveAddr)
 {
     if(isSending()){
         qDebug() << "ModbusMsg: send sending message!";
@@ -138,11 +138,25 @@ int ModbusMsg::dataSize() const
     return msg_sender->dataSize();
 }
 
+int ModbusMsg::functionCode() const
+{
+    if(!msg_sender) return QModbusPdu::Invalid;
+    return msg_sender->functionCode();
+}
+
+QModbusRequest ModbusMsg::request() const
+{
+    if(!msg_sender) return QModbusRequest();
+    return msg_sender->request();
+}
+
 bool ModbusMsg::cancel()
 {
     if(isSending()){
-        qDebug() << "ModbusMsg: cancel sending message!";
-        return false;
+        // Ответ бросается: транспорт завершит транзакцию сам
+        // и отбросит запоздавший ответ устройства.
+        if(modbus_reply) disconnect(modbus_reply, nullptr, this, nullptr);
+        cleanupReply();
     }
     onSendCanceled();
 
@@ -244,7 +258,7 @@ ModbusMsg::MsgRawRequest::~MsgRawRequest()
 {
 }
 
-QModbusReply *ModbusMsg::MsgRawRequest::send(QModbusClient *modbus, int modbus_slave)
+QModbusReply *ModbusMsg::MsgRawRequest::send(ModbusTransport *modbus, int modbus_slave)
 {
     if(!modbus_req.isValid()) return nullptr;
 
@@ -256,6 +270,16 @@ int ModbusMsg::MsgRawRequest::dataSize() const
     return modbus_req.size();
 }
 
+int ModbusMsg::MsgRawRequest::functionCode() const
+{
+    return modbus_req.functionCode();
+}
+
+QModbusRequest ModbusMsg::MsgRawRequest::request() const
+{
+    return modbus_req;
+}
+
 ModbusMsg::MsgDataUnit::MsgDataUnit(const QModbusDataUnit &du, ModbusMsg::DataUnitDirection d) : MsgSender()
 {
     modbus_du = du;
@@ -266,7 +290,7 @@ ModbusMsg::MsgDataUnit::~MsgDataUnit()
 {
 }
 
-QModbusReply *ModbusMsg::MsgDataUnit::send(QModbusClient *modbus, int modbus_slave)
+QModbusReply *ModbusMsg::MsgDataUnit::send(ModbusTransport *modbus, int modbus_slave)
 {
     switch(dir){
     default:
@@ -300,3 +324,32 @@ int ModbusMsg::MsgDataUnit::dataSize() const
     }
     return 0;
 }
+
+int ModbusMsg::MsgDataUnit::functionCode() const
+{
+    bool single = modbus_du.valueCount() == 1;
+
+    switch(modbus_du.registerType()){
+    default:
+        break;
+    case QModbusDataUnit::Coils:
+        if(dir == ModbusMsg::Read) return QModbusPdu::ReadCoils;
+        return single ? QModbusPdu::WriteSingleCoil : QModbusPdu::WriteMultipleCoils;
+    case QModbusDataUnit::DiscreteInputs:
+        if(dir == ModbusMsg::Read) return QModbusPdu::ReadDiscreteInputs;
+        break;
+    case QModbusDataUnit::HoldingRegisters:
+        if(dir == ModbusMsg::Read) return QModbusPdu::ReadHoldingRegisters;
+        return single ? QModbusPdu::WriteSingleRegister : QModbusPdu::WriteMultipleRegisters;
+    case QModbusDataUnit::InputRegisters:
+        if(dir == ModbusMsg::Read) return QModbusPdu::ReadInputRegisters;
+        break;
+    }
+    return QModbusPdu::Invalid;
+}
+
+QModbusRequest ModbusMsg::MsgDataUnit::request() const
+{
+    return (dir == ModbusMsg::Read) ? ModbusTransport::readRequest(modbus_du) :
+                                      ModbusTransport::writeRequest(modbus_du);
+}
@@ -7,8 +7,8 @@
 #include <QModbusDataUnit>
 #include "modbuserr.h"
 
-class QModbusClient;
 class QModbusReply;
+class ModbusTransport;
 
 class ModbusMsg : public QObject
 {
@@ -50,10 +50,13 @@ public:
 
     bool clear();
 
-    bool send(QModbusClient* modbus, int slaveAddr);
+    bool send(ModbusTransport* modbus, int slaveAddr);
 
     int dataSize() const;
+    int functionCode() const;
+    QModbusRequest request() const;
 
+    // Отмена, в том числе передаваемого сообщения.
     bool cancel();
 
 signals:
@@ -73,8 +76,10 @@ private:
         MsgSender(){}
         virtual ~MsgSender(){}
 
-        virtual QModbusReply* send(QModbusClient *modbus, int modbus_slave) = 0;
+        virtual QModbusReply* send(ModbusTransport *modbus, int modbus_slave) = 0;
         virtual int dataSize() const = 0;
+        virtual int functionCode() const = 0;
+        virtual QModbusRequest request() const = 0;
     };
 
     class MsgRawRequest : public MsgSender {
@@ -82,8 +87,10 @@ private:
         MsgRawRequest(const QModbusRequest& req);
         ~MsgRawRequest();
 
-        QModbusReply* send(QModbusClient *modbus, int modbus_slave);
+        QModbusReply* send(ModbusTransport *modbus, int modbus_slave);
         virtual int dataSize() const;
+        virtual int functionCode() const;
+        virtual QModbusRequest request() const;
 
     private:
         QModbusRequest modbus_req;
@@ -95,8 +102,10 @@ private:
         MsgDataUnit(const QModbusDataUnit& du, DataUnitDirection d);
         ~MsgDataUnit();
 
-        QModbusReply* send(QModbusClient *modbus, int modbus_slave);
+        QModbusReply* send(ModbusTransport *modbus, int modbus_slave);
         virtual int dataSize() const;
+        virtual int functionCode() const;
+        virtual QModbusRequest request() const;
 
     private:
         QModbusDataUnit modbus_du;
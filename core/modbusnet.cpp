@@ -0,0 +1,438 @@
+#include "modbusnet.h"
+#include <QModbusRtuSerialMaster>
+#include "settings.h"
+#include "modbusmsg.h"
+#include "modbusrtutransport.h"
+#include "modbustimeline.h"
+#include <QModbusReply>
+#include <QVariant>
+#include <math.h>
+#include <QDebug>
+
+
+#define MAX_PDU_SIZE 253
+
+
+ModbusNet::ModbusNet(QObject *parent) : QObject(parent)
+{
+    msg_queue = new MsgQueue();
+    modbus = nullptr;
+    net_stats = new ModbusNetStats();
+    net_trace = new ModbusTrace();
+    modbus_timeout = 0;
+    modbus_retries = 0;
+    modbus_frame_delay = 0;
+    modbus_baud = 9600;
+}
+
+ModbusNet::~ModbusNet()
+{
+    disconnectFromNet();
+    if(modbus) delete modbus;
+    delete msg_queue;
+    delete net_stats;
+    delete net_trace;
+}
+
+bool ModbusNet::setup()
+{
+    Settings& settings = Settings::get();
+
+    ModbusRtuTransport* transport = new ModbusRtuTransport(this);
+    QModbusRtuSerialMaster* modbus_rtu = transport->device();
+
+    modbus_rtu->setConnectionParameter(QModbusDevice::SerialPortNameParameter, settings.serialPortName());
+    modbus_rtu->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, settings.serailPortBaud());
+    modbus_rtu->setConnectionParameter(QModbusDevice::SerialParityParameter, settings.serialPortParity());
+    modbus_rtu->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, settings.serialPortStopBits());
+    modbus_rtu->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, QSerialPort::Data8); // 7 or 9 bit? O'Rly?
+
+    ModbusSerialTuning::Config tuning;
+    tuning.low_latency = settings.serialLowLatency();
+    tuning.latency_timer = settings.serialLowLatency() ? settings.serialLatencyTimer() : 0;
+    tuning.rs485 = settings.serialRs485();
+
+    transport->serialTuning().setConfig(tuning);
+
+    if(!setTransport(transport)) return false;
+
+    modbus_baud = settings.serailPortBaud();
+
+    setLinkParameters(settings.linkTimeout(), settings.linkRetries(), settings.linkFrameDelay());
+
+    return true;
+}
+
+bool ModbusNet::setTransport(ModbusTransport* transport)
+{
+    if(!transport) return false;
+    if(transport == modbus) return true;
+
+    transport->setParent(this);
+
+    connect(transport, &ModbusTransport::stateChanged, this, &ModbusNet::on_modbus_state_changed);
+    connect(transport, &ModbusTransport::errorOccurred, this, &ModbusNet::on_modbus_error_occured);
+
+    if(modbus) delete modbus;
+    modbus = transport;
+
+    return true;
+}
+
+ModbusTransport* ModbusNet::transport()
+{
+    return modbus;
+}
+
+bool ModbusNet::connectToNet()
+{
+    if(!modbus) return false;
+
+    if(!modbus->connectDevice()){
+        return false;
+    }
+
+    return true;
+}
+
+void ModbusNet::disconnectFromNet()
+{
+    if(!modbus) return;
+
+    modbus->disconnectDevice();
+
+    clearQueue();
+}
+
+bool ModbusNet::isConnectedToNet()
+{
+    if(!modbus) return false;
+
+    return modbus->state() == QModbusDevice::ConnectedState;
+}
+
+int ModbusNet::maxPduSize() const
+{
+    return MAX_PDU_SIZE;
+}
+
+quint32 ModbusNet::timeout() const
+{
+    return static_cast<quint32>(modbus_timeout);
+}
+
+quint32 ModbusNet::retries() const
+{
+    return modbus_retries;
+}
+
+quint32 ModbusNet::frameDelay() const
+{
+    return modbus_frame_delay;
+}
+
+quint32 ModbusNet::baud() const
+{
+    return modbus_baud;
+}
+
+bool ModbusNet::setBaud(quint32 baud)
+{
+    if(baud == 0) return false;
+
+    if(modbus && !modbus->setBaud(baud)) return false;
+
+    modbus_baud = baud;
+
+    return true;
+}
+
+void ModbusNet::setLinkParameters(quint32 timeout, quint32 retries, quint32 frame_delay)
+{
+    modbus_timeout = static_cast<int>(timeout);
+    modbus_retries = retries;
+    modbus_frame_delay = frame_delay;
+
+    if(!modbus) return;
+
+    modbus->setInterFrameDelay(static_cast<int>(frame_delay));
+    modbus->setTimeout(static_cast<int>(timeout));
+    modbus->setNumberOfRetries(static_cast<int>(retries));
+}
+
+bool ModbusNet::sendMsg(ModbusMsg *msg, int slaveAddr)
+{
+    if(!modbus) return false;
+    if(!isConnectedToNet()) return false;
+
+    bool need_send = msg_queue->empty();
+
+    MsgItem item;
+    item.msg = msg;
+    item.slave_addr = slaveAddr;
+    item.queued_time = timestamp();
+    item.sent_time = item.queued_time;
+    item.sent = false;
+
+    msg_queue->append(item);
+
+    ModbusTimeline::asyncBegin("net", "queue", msg, "slave", slaveAddr);
+
+    if(need_send){
+        sendNextMsg();
+    }
+
+    return true;
+}
+
+bool ModbusNet::cancelMsg(ModbusMsg* msg)
+{
+    if(msg_queue->empty()) return false;
+
+    // Первое сообщение очереди передаётся.
+    if(msg_queue->first().msg == msg){
+        MsgItem item = msg_queue->takeFirst();
+
+        disconnect(msg, &ModbusMsg::finished, this, &ModbusNet::on_queue_msg_finished);
+
+        msg->cancel();
+        recordMsg(item);
+
+        // Обработчики отмены могли уже начать передачу.
+        if(!msg_queue->empty() && !msg_queue->first().sent) sendNextMsg();
+
+        return true;
+    }
+
+    for(int i = 1; i < msg_queue->size(); i ++){
+        if(msg_queue->at(i).msg != msg) continue;
+
+        MsgItem item = msg_queue->takeAt(i);
+
+        msg->cancel();
+        recordMsg(item);
+
+        return true;
+    }
+
+    return false;
+}
+
+const ModbusNetStats& ModbusNet::stats() const
+{
+    return *net_stats;
+}
+
+void ModbusNet::resetStats()
+{
+    net_stats->reset();
+}
+
+bool ModbusNet::saveStats(const QString& filename) const
+{
+    return net_stats->saveJson(filename);
+}
+
+ModbusTrace& ModbusNet::trace()
+{
+    return *net_trace;
+}
+
+bool ModbusNet::saveTrace(const QString& filename) const
+{
+    return net_trace->save(filename);
+}
+
+void ModbusNet::on_modbus_state_changed(QModbusDevice::State state)
+{
+    emit stateChanged(state);
+
+    switch(state){
+    default:
+        break;
+    case QModbusDevice::ConnectedState:
+        emit connectedToNet();
+        break;
+    case QModbusDevice::UnconnectedState:
+        emit disconnectedFromNet();
+        break;
+    }
+}
+
+void ModbusNet::on_modbus_error_occured(QModbusDevice::Error error)
+{
+    ModbusErr err(ModbusErr::Modbus, tr("ModbusNet"), tr("Modbus error!"));
+
+    err.setModbusError(error);
+
+    if(modbus) err.setModbusErrorStr(modbus->errorString());
+
+    emit errorOccured(err);
+}
+
+void ModbusNet::on_queue_msg_finished()
+{
+    if(msg_queue->empty()){
+        qDebug() << "ModbusNet: on_queue_msg_sended with empty queue!";
+        return;
+    }
+
+    MsgItem& item = msg_queue->first();
+    ModbusMsg* msg = item.msg;
+
+    disconnect(msg, &ModbusMsg::finished, this, &ModbusNet::on_queue_msg_finished);
+
+    recordMsg(item);
+
+    msg_queue->removeFirst();
+
+    sendNextMsg();
+}
+
+bool ModbusNet::sendNextMsg()
+{
+    if(!modbus) return false;
+    if(!isConnectedToNet()) return false;
+
+    for(;;){
+        if(msg_queue->empty()) return false;
+
+        MsgItem& item = msg_queue->first();
+
+        ModbusMsg* msg = item.msg;
+        int slaveAddr = item.slave_addr;
+
+        connect(msg, &ModbusMsg::finished, this, &ModbusNet::on_queue_msg_finished);
+
+        int frame_delay = ceil(static_cast<float>(msg->dataSize()) * 11 /
+                               modbus_baud * 1000) * 1000;
+
+        //qDebug() << "msg size" << data_size << "frame delay" << frame_delay;
+
+        int used_frame_delay = qMax<int>(frame_delay, modbus_frame_delay);
+
+        // Долбаный Qt SerialBus ограничивает
+        // время отправки данных до
+        // interFrameDelay мкс.
+        modbus->setInterFrameDelay(used_frame_delay);
+
+        item.sent_time = timestamp();
+        item.sent = true;
+
+        ModbusTimeline::asyncEnd("net", "queue", msg);
+        ModbusTimeline::asyncBegin("net", "transaction", msg, "func", msg->functionCode());
+
+        if(msg->send(modbus, slaveAddr)) break;
+
+        disconnect(msg, &ModbusMsg::finished, this, &ModbusNet::on_queue_msg_finished);
+
+        recordMsg(item);
+
+        msg_queue->removeFirst();
+    }
+
+    return true;
+}
+
+void ModbusNet::clearQueue()
+{
+    if(msg_queue->empty()) return;
+
+    // Передаваемое сообщение прерывается, как в cancelMsg().
+    disconnect(msg_queue->first().msg, &ModbusMsg::finished, this, &ModbusNet::on_queue_msg_finished);
+
+    MsgQueue items = *msg_queue;
+    msg_queue->clear();
+
+    for(const MsgItem& item: items){
+        item.msg->cancel();
+        recordMsg(item);
+    }
+}
+
+qint64 ModbusNet::timestamp() const
+{
+    if(!modbus) return 0;
+    return modbus->timestamp();
+}
+
+void ModbusNet::recordMsg(const MsgItem& item)
+{
+    ModbusMsg* msg = item.msg;
+
+    qint64 now = timestamp();
+
+    // Не отправленное сообщение ждало в очереди до отмены.
+    quint64 queue_wait = ((item.sent ? item.sent_time : now) - item.queued_time) / 1000;
+    quint64 rtt = (now - item.sent_time) / 1000;
+
+    // Адрес(1) + CRC(2).
+    const int adu_overhead = 3;
+
+    int sent_bytes = 0;
+    int recv_bytes = 0;
+    int retries = 0;
+
+    QModbusResponse resp;
+
+    ModbusNetStats::Outcome outcome = ModbusNetStats::Success;
+
+    switch(msg->state()){
+    default:
+    case ModbusMsg::Sended:
+        break;
+    case ModbusMsg::Error:
+        outcome = ModbusNetStats::Error;
+        break;
+    case ModbusMsg::Canceled:
+        outcome = ModbusNetStats::Canceled;
+        break;
+    }
+
+    if(outcome == ModbusNetStats::Canceled){
+        // Прерванный запрос уже ушёл в линию.
+        if(item.sent) sent_bytes = msg->dataSize() + adu_overhead;
+    }else{
+        sent_bytes = msg->dataSize() + adu_overhead;
+
+        QModbusReply* reply = msg->reply();
+        if(reply){
+            resp = reply->rawResult();
+
+            if(resp.isValid()){
+                recv_bytes = resp.size() + adu_overhead;
+            }
+
+            if(reply->error() == QModbusDevice::TimeoutError){
+                outcome = ModbusNetStats::Timeout;
+            }else if(resp.isException()){
+                outcome = ModbusNetStats::Exception;
+            }
+        }
+
+        // Повторы выполняет QModbusClient: при тайм-ауте исчерпаны все,
+        // иначе их число оценивается по времени ожидания ответа.
+        if(outcome == ModbusNetStats::Timeout){
+            retries = static_cast<int>(modbus_retries);
+        }else if(modbus_timeout > 0){
+            retries = qMin(static_cast<int>(rtt / 1000 / modbus_timeout), static_cast<int>(modbus_retries));
+        }
+
+        sent_bytes *= retries + 1;
+    }
+
+    net_stats->recordTransaction(msg->functionCode(), queue_wait, rtt,
+                                 sent_bytes, recv_bytes, outcome, retries);
+
+    if(!item.sent){
+        ModbusTimeline::asyncEnd("net", "queue", msg);
+    }else{
+        ModbusTimeline::asyncEnd("net", "transaction", msg, "outcome", outcome);
+    }
+
+    // Отменённые до отправки сообщения в сеть не попадали.
+    if(net_trace->isEnabled() && item.sent){
+        net_trace->append(item.sent_time, now - item.sent_time, item.slave_addr,
+                          outcome, msg->request(), resp);
+    }
+}
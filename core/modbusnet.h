@@ -0,0 +1,127 @@
+#ifndef MODBUSNET_H
+#define MODBUSNET_H
+
+#include <QObject>
+#include <QModbusDevice>
+#include <QString>
+#include <QQueue>
+#include "modbuserr.h"
+#include "modbusnetstats.h"
+#include "modbustrace.h"
+
+class ModbusTransport;
+class ModbusMsg;
+
+
+class ModbusNet : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusNet(QObject *parent = 0);
+    ~ModbusNet();
+
+    bool setup();
+
+    // Установка транспорта, ModbusNet становится его владельцем.
+    bool setTransport(ModbusTransport* transport);
+    ModbusTransport* transport();
+
+    bool connectToNet();
+    void disconnectFromNet();
+
+    bool isConnectedToNet();
+
+    int maxPduSize() const;
+
+    /*
+     * Параметры линии: время ожидания ответа, мс,
+     * число повторов и задержка между кадрами, мкс.
+     * setup() берёт их из Settings.
+     */
+    quint32 timeout() const;
+    quint32 retries() const;
+    quint32 frameDelay() const;
+    void setLinkParameters(quint32 timeout, quint32 retries, quint32 frame_delay);
+
+    /*
+     * Скорость обмена, бод. setup() берёт её из Settings.
+     * Смена скорости подключённого транспорта действует
+     * со следующего сообщения очереди; возвращает ложь,
+     * если транспорт её не поддерживает.
+     */
+    quint32 baud() const;
+    bool setBaud(quint32 baud);
+
+    /*
+     * Возвращает истину после добавления сообщения в очередь,
+     * не зависимо от результатов передачи.
+     * Для контроля отправки сообщения в сеть необходимо
+     * использовать сигналы сообщения.
+     */
+    bool sendMsg(ModbusMsg* msg, int slaveAddr);
+
+    /*
+     * Отмена сообщения из очереди.
+     * Передаваемое сообщение прерывается сразу:
+     * его ответ бросается, а транзакцию вместе с повторами
+     * ведёт транспорт, поэтому следующее сообщение попадёт
+     * на линию после ответа на прерванное или через
+     * (retries() + 1) * timeout() в худшем случае.
+     * Возвращает ложь, если сообщения нет в очереди.
+     */
+    bool cancelMsg(ModbusMsg* msg);
+
+    // Статистика транзакций.
+    const ModbusNetStats& stats() const;
+    void resetStats();
+    bool saveStats(const QString& filename) const;
+
+    // Запись PDU транзакций.
+    ModbusTrace& trace();
+    bool saveTrace(const QString& filename) const;
+
+    // Монотонное время транспорта, нс.
+    qint64 timestamp() const;
+
+signals:
+    void stateChanged(QModbusDevice::State state);
+    void errorOccured(ModbusErr error);
+
+    // Вызываются после сигнала stateChanged.
+    void connectedToNet();
+    void disconnectedFromNet();
+
+public slots:
+
+private slots:
+    void on_modbus_state_changed(QModbusDevice::State state);
+    void on_modbus_error_occured(QModbusDevice::Error error);
+
+    void on_queue_msg_finished();
+
+private:
+    ModbusTransport* modbus;
+
+    struct MsgItem {
+        ModbusMsg* msg;
+        int slave_addr;
+        qint64 queued_time;
+        qint64 sent_time;
+        bool sent;
+    };
+    typedef QQueue<MsgItem> MsgQueue;
+    MsgQueue* msg_queue;
+
+    ModbusNetStats* net_stats;
+    ModbusTrace* net_trace;
+    int modbus_timeout;
+    quint32 modbus_retries;
+    quint32 modbus_frame_delay;
+    quint32 modbus_baud;
+
+    bool sendNextMsg();
+    void clearQueue();
+    void recordMsg(const MsgItem& item);
+};
+
+#endif // MODBUSNET_H
@@ -0,0 +1,242 @@
+#include "modbusnetstats.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QFile>
+#include <QtAlgorithms>
+#include <string.h>
+
+
+ModbusHistogram::ModbusHistogram()
+{
+    reset();
+}
+
+void ModbusHistogram::reset()
+{
+    memset(buckets, 0, sizeof(buckets));
+    total_count = 0;
+    total_sum = 0;
+    min_val = 0;
+    max_val = 0;
+}
+
+void ModbusHistogram::record(quint64 val)
+{
+    buckets[bucketIndex(val)] ++;
+
+    if(total_count == 0 || val < min_val) min_val = val;
+    if(val > max_val) max_val = val;
+
+    total_count ++;
+    total_sum += val;
+}
+
+quint64 ModbusHistogram::count() const
+{
+    return total_count;
+}
+
+quint64 ModbusHistogram::min() const
+{
+    return min_val;
+}
+
+quint64 ModbusHistogram::max() const
+{
+    return max_val;
+}
+
+double ModbusHistogram::mean() const
+{
+    if(total_count == 0) return 0.0;
+    return static_cast<double>(total_sum) / total_count;
+}
+
+quint64 ModbusHistogram::percentile(double p) const
+{
+    if(total_count == 0) return 0;
+
+    quint64 rank = static_cast<quint64>(p / 100.0 * total_count + 0.5);
+    if(rank == 0) rank = 1;
+    if(rank > total_count) rank = total_count;
+
+    quint64 acc = 0;
+    for(int i = 0; i < buckets_count; i ++){
+        acc += buckets[i];
+        if(acc >= rank){
+            return qBound(min_val, bucketValue(i), max_val);
+        }
+    }
+
+    return max_val;
+}
+
+QJsonObject ModbusHistogram::toJson() const
+{
+    QJsonObject obj;
+
+    obj[QStringLiteral("count")] = static_cast<double>(total_count);
+    obj[QStringLiteral("min")] = static_cast<double>(min_val);
+    obj[QStringLiteral("max")] = static_cast<double>(max_val);
+    obj[QStringLiteral("mean")] = mean();
+    obj[QStringLiteral("p50")] = static_cast<double>(percentile(50.0));
+    obj[QStringLiteral("p90")] = static_cast<double>(percentile(90.0));
+    obj[QStringLiteral("p99")] = static_cast<double>(percentile(99.0));
+    obj[QStringLiteral("p999")] = static_cast<double>(percentile(99.9));
+
+    QJsonArray bucketsArr;
+    for(int i = 0; i < buckets_count; i ++){
+        if(buckets[i] == 0) continue;
+
+        QJsonArray bucket;
+        bucket.append(static_cast<double>(bucketValue(i)));
+        bucket.append(static_cast<double>(buckets[i]));
+
+        bucketsArr.append(bucket);
+    }
+    obj[QStringLiteral("buckets")] = bucketsArr;
+
+    return obj;
+}
+
+int ModbusHistogram::bucketIndex(quint64 val)
+{
+    if(val < static_cast<quint64>(sub_count)) return static_cast<int>(val);
+
+    int msb = 63 - static_cast<int>(qCountLeadingZeroBits(val));
+    if(msb >= max_bits) return buckets_count - 1;
+
+    int shift = msb - sub_bits;
+
+    return (shift + 1) * sub_count + static_cast<int>((val >> shift) & (sub_count - 1));
+}
+
+quint64 ModbusHistogram::bucketValue(int index)
+{
+    if(index < sub_count) return static_cast<quint64>(index);
+
+    int shift = index / sub_count - 1;
+    quint64 sub = static_cast<quint64>(index % sub_count);
+
+    return (sub_count + sub) << shift;
+}
+
+
+ModbusNetStats::ModbusNetStats()
+{
+    for(int i = 0; i < func_codes_count; i ++){
+        m_func_rtt[i] = nullptr;
+    }
+
+    reset();
+}
+
+ModbusNetStats::~ModbusNetStats()
+{
+    for(int i = 0; i < func_codes_count; i ++){
+        if(m_func_rtt[i]) delete m_func_rtt[i];
+    }
+}
+
+void ModbusNetStats::reset()
+{
+    m_transactions = 0;
+    m_bytes_sent = 0;
+    m_bytes_received = 0;
+    m_errors = 0;
+    m_timeouts = 0;
+    m_exceptions = 0;
+    m_canceled = 0;
+    m_retries = 0;
+
+    m_queue_wait.reset();
+    m_rtt.reset();
+
+    for(int i = 0; i < func_codes_count; i ++){
+        if(m_func_rtt[i]) m_func_rtt[i]->reset();
+    }
+}
+
+void ModbusNetStats::recordTransaction(int func_code, quint64 queue_wait, quint64 rtt,
+                                       int sent_bytes, int recv_bytes, Outcome outcome, int retries)
+{
+    m_transactions ++;
+    m_bytes_sent += sent_bytes;
+    m_bytes_received += recv_bytes;
+    m_retries += retries;
+
+    switch(outcome){
+    default:
+    case Success:
+        break;
+    case Error:
+        m_errors ++;
+        break;
+    case Timeout:
+        m_errors ++;
+        m_timeouts ++;
+        break;
+    case Exception:
+        m_errors ++;
+        m_exceptions ++;
+        break;
+    case Canceled:
+        m_canceled ++;
+        // Прерванная транзакция учитывается в байтах, но не в RTT:
+        // ответ не дождались, и время обрезано отменой.
+        m_queue_wait.record(queue_wait);
+        return;
+    }
+
+    m_queue_wait.record(queue_wait);
+    m_rtt.record(rtt);
+
+    if(func_code > 0 && func_code < func_codes_count){
+        ModbusHistogram*& hist = m_func_rtt[func_code];
+        if(!hist) hist = new ModbusHistogram();
+        hist->record(rtt);
+    }
+}
+
+const ModbusHistogram* ModbusNetStats::functionRtt(int func_code) const
+{
+    if(func_code <= 0 || func_code >= func_codes_count) return nullptr;
+    return m_func_rtt[func_code];
+}
+
+QJsonObject ModbusNetStats::toJson() const
+{
+    QJsonObject obj;
+
+    obj[QStringLiteral("transactions")] = static_cast<double>(m_transactions);
+    obj[QStringLiteral("bytes_sent")] = static_cast<double>(m_bytes_sent);
+    obj[QStringLiteral("bytes_received")] = static_cast<double>(m_bytes_received);
+    obj[QStringLiteral("errors")] = static_cast<double>(m_errors);
+    obj[QStringLiteral("timeouts")] = static_cast<double>(m_timeouts);
+    obj[QStringLiteral("exceptions")] = static_cast<double>(m_exceptions);
+    obj[QStringLiteral("canceled")] = static_cast<double>(m_canceled);
+    obj[QStringLiteral("retries")] = static_cast<double>(m_retries);
+
+    obj[QStringLiteral("queue_wait_us")] = m_queue_wait.toJson();
+    obj[QStringLiteral("rtt_us")] = m_rtt.toJson();
+
+    QJsonObject funcs;
+    for(int i = 0; i < func_codes_count; i ++){
+        if(!m_func_rtt[i] || m_func_rtt[i]->count() == 0) continue;
+
+        funcs[QStringLiteral("0x%1").arg(i, 2, 16, QLatin1Char('0'))] = m_func_rtt[i]->toJson();
+    }
+    obj[QStringLiteral("function_rtt_us")] = funcs;
+
+    return obj;
+}
+
+bool ModbusNetStats::saveJson(const QString& filename) const
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QByteArray json = QJsonDocument(toJson()).toJson();
+
+    return file.write(json) == json.size();
+}
@@ -0,0 +1,111 @@
+#ifndef MODBUSNETSTATS_H
+#define MODBUSNETSTATS_H
+
+#include <stdint.h>
+#include <QtGlobal>
+#include <QJsonObject>
+#include <QString>
+
+
+/*
+ * Гистограмма с логарифмически-линейными интервалами
+ * (как HDR Histogram): 16 подинтервалов на каждую степень двойки,
+ * относительная погрешность не хуже 1/16.
+ * Запись значения - несколько арифметических операций без выделения памяти.
+ */
+class ModbusHistogram
+{
+public:
+    ModbusHistogram();
+
+    void reset();
+    void record(quint64 val);
+
+    quint64 count() const;
+    quint64 min() const;
+    quint64 max() const;
+    double mean() const;
+    quint64 percentile(double p) const;
+
+    QJsonObject toJson() const;
+
+private:
+    static constexpr int sub_bits = 4;
+    static constexpr int sub_count = 1 << sub_bits;
+    static constexpr int max_bits = 40;
+    static constexpr int buckets_count = (max_bits - sub_bits + 1) * sub_count;
+
+    static int bucketIndex(quint64 val);
+    static quint64 bucketValue(int index);
+
+    quint32 buckets[buckets_count];
+    quint64 total_count;
+    quint64 total_sum;
+    quint64 min_val;
+    quint64 max_val;
+};
+
+
+/*
+ * Статистика транзакций сети Modbus.
+ * Времена - в микросекундах.
+ */
+class ModbusNetStats
+{
+public:
+
+    enum Outcome {
+        Success = 0,
+        Error,
+        Timeout,
+        Exception,
+        Canceled
+    };
+
+    ModbusNetStats();
+    ~ModbusNetStats();
+
+    void reset();
+
+    void recordTransaction(int func_code, quint64 queue_wait, quint64 rtt,
+                           int sent_bytes, int recv_bytes, Outcome outcome, int retries);
+
+    quint64 transactions() const { return m_transactions; }
+    quint64 bytesSent() const { return m_bytes_sent; }
+    quint64 bytesReceived() const { return m_bytes_received; }
+    quint64 errors() const { return m_errors; }
+    quint64 timeouts() const { return m_timeouts; }
+    quint64 exceptions() const { return m_exceptions; }
+    quint64 canceled() const { return m_canceled; }
+    quint64 retries() const { return m_retries; }
+
+    const ModbusHistogram& queueWait() const { return m_queue_wait; }
+    const ModbusHistogram& rtt() const { return m_rtt; }
+
+    // Гистограмма RTT по коду функции, nullptr если функция не использовалась.
+    const ModbusHistogram* functionRtt(int func_code) const;
+
+    QJsonObject toJson() const;
+    bool saveJson(const QString& filename) const;
+
+private:
+    static constexpr int func_codes_count = 0x80;
+
+    quint64 m_transactions;
+    quint64 m_bytes_sent;
+    quint64 m_bytes_received;
+    quint64 m_errors;
+    quint64 m_timeouts;
+    quint64 m_exceptions;
+    quint64 m_canceled;
+    quint64 m_retries;
+
+    ModbusHistogram m_queue_wait;
+    ModbusHistogram m_rtt;
+    ModbusHistogram* m_func_rtt[func_codes_count];
+
+    ModbusNetStats(const ModbusNetStats&) = delete;
+    ModbusNetStats& operator=(const ModbusNetStats&) = delete;
+};
+
+#endif // MODBUSNETSTATS_H
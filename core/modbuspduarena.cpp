@@ -0,0 +1,94 @@
+#include "modbuspduarena.h"
+
+
+static inline void put16(uint8_t* ptr, uint16_t val)
+{
+    ptr[0] = val >> 8;
+    ptr[1] = val & 0xff;
+}
+
+
+ModbusPduArena::ModbusPduArena()
+{
+}
+
+ModbusPduArena::~ModbusPduArena()
+{
+}
+
+void ModbusPduArena::clear()
+{
+    arena_data.clear();
+    arena_entries.clear();
+}
+
+void ModbusPduArena::reserve(int pdus, int bytes)
+{
+    arena_entries.reserve(pdus);
+    arena_data.reserve(bytes);
+}
+
+int ModbusPduArena::count() const
+{
+    return arena_entries.size();
+}
+
+bool ModbusPduArena::empty() const
+{
+    return arena_entries.isEmpty();
+}
+
+int ModbusPduArena::size() const
+{
+    return arena_data.size();
+}
+
+QModbusPdu::FunctionCode ModbusPduArena::functionCode(int i) const
+{
+    if(i < 0 || i >= arena_entries.size()) return QModbusPdu::Invalid;
+
+    return static_cast<QModbusPdu::FunctionCode>(static_cast<uint8_t>(arena_data.at(arena_entries.at(i).offset)));
+}
+
+QModbusRequest ModbusPduArena::request(int i) const
+{
+    if(i < 0 || i >= arena_entries.size()) return QModbusRequest();
+
+    const Entry& entry = arena_entries.at(i);
+    const char* pdu = arena_data.constData() + entry.offset;
+
+    // Копия: запрос может пережить очистку или удаление арены.
+    return QModbusRequest(static_cast<QModbusPdu::FunctionCode>(static_cast<uint8_t>(pdu[0])),
+                          QByteArray(pdu + 1, entry.size - 1));
+}
+
+uint8_t* ModbusPduArena::append(QModbusPdu::FunctionCode func, int data_size)
+{
+    Entry entry;
+    entry.offset = arena_data.size();
+    entry.size = 1 + data_size;
+
+    arena_entries.append(entry);
+    arena_data.resize(entry.offset + entry.size);
+
+    uint8_t* pdu = reinterpret_cast<uint8_t*>(arena_data.data()) + entry.offset;
+    pdu[0] = static_cast<uint8_t>(func);
+
+    return pdu + 1;
+}
+
+void ModbusPduArena::appendWriteSingleRegister(uint16_t addr, uint16_t value)
+{
+    uint8_t* ptr = append(QModbusPdu::WriteSingleRegister, 4);
+
+    put16(ptr, addr);
+    put16(ptr + 2, value);
+}
+
+void ModbusPduArena::appendWriteSingleCoil(uint16_t addr, bool value)
+{
+    uint8_t* ptr = append(QModbusPdu::WriteSingleCoil, 4);
+
+    put16(ptr, addr);
+    put16(ptr + 2, value ? 0xff00 : 0x0000);
+}
@@ -0,0 +1,54 @@
+#ifndef MODBUSPDUARENA_H
+#define MODBUSPDUARENA_H
+
+#include <stdint.h>
+#include <QByteArray>
+#include <QVector>
+#include <QModbusPdu>
+#include <QModbusRequest>
+
+
+/*
+ * Непрерывный буфер заранее закодированных PDU задания.
+ * Все запросы кодируются до отправки первого из них,
+ * request() возвращает копию PDU (не более 253 байт).
+ */
+class ModbusPduArena
+{
+public:
+    ModbusPduArena();
+    ~ModbusPduArena();
+
+    void clear();
+    void reserve(int pdus, int bytes);
+
+    // Число PDU.
+    int count() const;
+    bool empty() const;
+    // Размер всех PDU, байт.
+    int size() const;
+
+    QModbusPdu::FunctionCode functionCode(int i) const;
+    QModbusRequest request(int i) const;
+
+    /*
+     * Добавление PDU с данными размера data_size.
+     * Возвращает указатель на данные для заполнения,
+     * действительный до следующего добавления.
+     */
+    uint8_t* append(QModbusPdu::FunctionCode func, int data_size);
+
+    void appendWriteSingleRegister(uint16_t addr, uint16_t value);
+    void appendWriteSingleCoil(uint16_t addr, bool value);
+
+private:
+    struct Entry {
+        int offset; // Смещение кода функции в буфере.
+        int size; // Размер PDU вместе с кодом функции.
+    };
+
+    QByteArray arena_data;
+    QVector<Entry> arena_entries;
+};
+
+#endif // MODBUSPDUARENA_H
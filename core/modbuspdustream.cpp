@@ -0,0 +1,249 @@
+#include "modbuspdustream.h"
+#include "modbusdev.h"
+#include "modbusmsg.h"
+#include "modbuspduarena.h"
+#include <QDebug>
+
+
+#define DEFAULT_WINDOW 2
+
+
+ModbusPduStream::ModbusPduStream(QObject *parent) : QObject(parent)
+{
+    modbus_dev = nullptr;
+    pdu_arena = nullptr;
+    stream_window = DEFAULT_WINDOW;
+    stream_state = Idle;
+    need_cancel = false;
+    next_index = 0;
+    done_count = 0;
+    msg_queue = new MsgQueue();
+}
+
+ModbusPduStream::ModbusPduStream(ModbusDev* dev, QObject *parent) : QObject(parent)
+{
+    modbus_dev = dev;
+    pdu_arena = nullptr;
+    stream_window = DEFAULT_WINDOW;
+    stream_state = Idle;
+    need_cancel = false;
+    next_index = 0;
+    done_count = 0;
+    msg_queue = new MsgQueue();
+}
+
+ModbusPduStream::~ModbusPduStream()
+{
+    cancelQueued();
+
+    // Передаваемое сообщение удалит себя само по завершении.
+    for(ModbusMsg* msg: *msg_queue){
+        disconnect(msg, nullptr, this, nullptr);
+        connect(msg, &ModbusMsg::finished, msg, &QObject::deleteLater);
+    }
+
+    delete msg_queue;
+}
+
+ModbusDev* ModbusPduStream::modbusDev()
+{
+    return modbus_dev;
+}
+
+void ModbusPduStream::setModbusDev(ModbusDev* dev)
+{
+    modbus_dev = dev;
+}
+
+const ModbusPduArena* ModbusPduStream::arena() const
+{
+    return pdu_arena;
+}
+
+void ModbusPduStream::setArena(const ModbusPduArena* arena)
+{
+    pdu_arena = arena;
+}
+
+int ModbusPduStream::window() const
+{
+    return stream_window;
+}
+
+void ModbusPduStream::setWindow(int size)
+{
+    stream_window = qMax(1, size);
+}
+
+ModbusPduStream::State ModbusPduStream::state() const
+{
+    return stream_state;
+}
+
+bool ModbusPduStream::isExecuting() const
+{
+    return stream_state == Executing;
+}
+
+int ModbusPduStream::completedCount() const
+{
+    return done_count;
+}
+
+bool ModbusPduStream::exec()
+{
+    if(stream_state == Executing) return false;
+    if(!modbus_dev || !modbus_dev->isValid()) return false;
+    if(!pdu_arena || pdu_arena->empty()) return false;
+    if(!msg_queue->empty()) return false;
+
+    stream_state = Executing;
+    need_cancel = false;
+    next_index = 0;
+    done_count = 0;
+
+    if(!fillWindow()){
+        // Уже отправленные запросы отменит или завершит msgError.
+        if(stream_state == Executing){
+            cancelQueued();
+            stream_state = Error;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool ModbusPduStream::cancel()
+{
+    if(stream_state != Executing) return false;
+
+    need_cancel = true;
+
+    cancelQueued();
+
+    // Все запросы окна прерваны.
+    if(msg_queue->empty()){
+        stream_state = Canceled;
+        emit canceled();
+    }
+
+    return true;
+}
+
+void ModbusPduStream::msgSended()
+{
+    ModbusMsg* msg = takeSender();
+    if(!msg) return;
+
+    msg->deleteLater();
+
+    if(stream_state != Executing) return;
+
+    done_count ++;
+
+    if(need_cancel){
+        if(msg_queue->empty()){
+            stream_state = Canceled;
+            emit canceled();
+        }
+        return;
+    }
+
+    // Сначала пополнение окна, затем обработка результата.
+    if(!fillWindow()){
+        cancelQueued();
+        stream_state = Error;
+        emit fail(ModbusErr(ModbusErr::General, tr("ModbusPduStream"), tr("Error sending request!")));
+        return;
+    }
+
+    // Состояние меняется до сигналов,
+    // чтобы из обработчиков можно было начать новую передачу.
+    bool last = done_count >= pdu_arena->count();
+    if(last) stream_state = Done;
+
+    emit entryDone(done_count - 1);
+
+    if(last && stream_state == Done) emit success();
+}
+
+void ModbusPduStream::msgError(ModbusErr error)
+{
+    ModbusMsg* msg = takeSender();
+    if(!msg) return;
+
+    msg->deleteLater();
+
+    if(stream_state != Executing) return;
+
+    cancelQueued();
+
+    stream_state = Error;
+    emit fail(error);
+}
+
+bool ModbusPduStream::fillWindow()
+{
+    while(msg_queue->size() < stream_window && next_index < pdu_arena->count()){
+        if(!sendEntry(next_index)) return false;
+        next_index ++;
+    }
+
+    return true;
+}
+
+bool ModbusPduStream::sendEntry(int index)
+{
+    ModbusMsg* msg = new ModbusMsg(pdu_arena->request(index));
+
+    connect(msg, &ModbusMsg::sendSuccess, this, &ModbusPduStream::msgSended);
+    connect(msg, &ModbusMsg::sendError, this, &ModbusPduStream::msgError);
+
+    // Сообщение может завершиться внутри sendMsg.
+    msg_queue->append(msg);
+
+    if(!modbus_dev->sendMsg(msg)){
+        msg_queue->removeOne(msg);
+        delete msg;
+        return false;
+    }
+
+    return true;
+}
+
+void ModbusPduStream::cancelQueued()
+{
+    if(!modbus_dev) return;
+
+    MsgQueue queued = *msg_queue;
+
+    for(ModbusMsg* msg: queued){
+        // Передаваемое сообщение прерывается вместе с остальными.
+        if(!modbus_dev->cancelMsg(msg)) continue;
+
+        disconnect(msg, nullptr, this, nullptr);
+        msg_queue->removeOne(msg);
+        msg->deleteLater();
+    }
+}
+
+ModbusMsg* ModbusPduStream::takeSender()
+{
+    ModbusMsg* msg = qobject_cast<ModbusMsg*>(sender());
+    if(!msg){
+        qDebug() << "ModbusPduStream: msg == NULL!";
+        return nullptr;
+    }
+
+    if(msg_queue->empty() || msg_queue->first() != msg){
+        qDebug() << "ModbusPduStream: unexpected msg!";
+        return nullptr;
+    }
+
+    msg_queue->removeFirst();
+
+    disconnect(msg, nullptr, this, nullptr);
+
+    return msg;
+}
@@ -0,0 +1,86 @@
+#ifndef MODBUSPDUSTREAM_H
+#define MODBUSPDUSTREAM_H
+
+#include <QObject>
+#include <QQueue>
+#include "modbuserr.h"
+
+class ModbusDev;
+class ModbusMsg;
+class ModbusPduArena;
+
+
+/*
+ * Отправка PDU арены устройству подряд.
+ * В очереди сети поддерживается окно из нескольких запросов,
+ * поэтому следующий запрос уходит сразу после ответа на предыдущий,
+ * без возврата в логику задания.
+ * При ошибке запроса ещё не отправленные запросы окна отменяются.
+ */
+class ModbusPduStream : public QObject
+{
+    Q_OBJECT
+public:
+
+    enum State {
+        Idle = 0,
+        Executing,
+        Done,
+        Canceled,
+        Error
+    };
+
+    explicit ModbusPduStream(QObject *parent = 0);
+    ModbusPduStream(ModbusDev* dev, QObject *parent = 0);
+    ~ModbusPduStream();
+
+    ModbusDev* modbusDev();
+    void setModbusDev(ModbusDev* dev);
+
+    // Арена не принадлежит потоку.
+    const ModbusPduArena* arena() const;
+    void setArena(const ModbusPduArena* pdu_arena);
+
+    int window() const;
+    void setWindow(int size);
+
+    State state() const;
+    bool isExecuting() const;
+
+    // Число выполненных запросов.
+    int completedCount() const;
+
+signals:
+    void entryDone(int index);
+    void success();
+    void fail(ModbusErr error);
+    void canceled();
+
+public slots:
+    bool exec();
+    bool cancel();
+
+private slots:
+    void msgSended();
+    void msgError(ModbusErr error);
+
+private:
+    ModbusDev* modbus_dev;
+    const ModbusPduArena* pdu_arena;
+    int stream_window;
+
+    State stream_state;
+    bool need_cancel;
+    int next_index;
+    int done_count;
+
+    typedef QQueue<ModbusMsg*> MsgQueue;
+    MsgQueue* msg_queue;
+
+    bool fillWindow();
+    bool sendEntry(int index);
+    void cancelQueued();
+    ModbusMsg* takeSender();
+};
+
+#endif // MODBUSPDUSTREAM_H
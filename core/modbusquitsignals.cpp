@@ -0,0 +1,88 @@
+#include "modbusquitsignals.h"
+#include <QCoreApplication>
+#include <QSocketNotifier>
+
+#ifdef Q_OS_UNIX
+#include <signal.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+
+// [0] - запись из обработчика, [1] - чтение в цикле событий.
+static int quit_fds[2] = {-1, -1};
+
+static void quit_handler(int)
+{
+    char b = 1;
+    ssize_t res = ::write(quit_fds[0], &b, sizeof(b));
+    Q_UNUSED(res);
+}
+#endif
+
+
+ModbusQuitSignals::ModbusQuitSignals(QObject *parent) : QObject(parent)
+{
+    quit_notifier = nullptr;
+}
+
+ModbusQuitSignals::~ModbusQuitSignals()
+{
+#ifdef Q_OS_UNIX
+    if(!quit_notifier) return;
+
+    ::signal(SIGINT, SIG_DFL);
+    ::signal(SIGTERM, SIG_DFL);
+
+    delete quit_notifier;
+    quit_notifier = nullptr;
+
+    ::close(quit_fds[0]);
+    ::close(quit_fds[1]);
+    quit_fds[0] = quit_fds[1] = -1;
+#endif
+}
+
+bool ModbusQuitSignals::install()
+{
+#ifdef Q_OS_UNIX
+    if(quit_notifier) return true;
+    if(quit_fds[0] != -1) return false;
+
+    if(::socketpair(AF_UNIX, SOCK_STREAM, 0, quit_fds) != 0){
+        quit_fds[0] = quit_fds[1] = -1;
+        return false;
+    }
+
+    // Переполненный канал не должен блокировать обработчик.
+    ::fcntl(quit_fds[0], F_SETFL, ::fcntl(quit_fds[0], F_GETFL) | O_NONBLOCK);
+    ::fcntl(quit_fds[1], F_SETFL, ::fcntl(quit_fds[1], F_GETFL) | O_NONBLOCK);
+
+    quit_notifier = new QSocketNotifier(quit_fds[1], QSocketNotifier::Read, this);
+    connect(quit_notifier, &QSocketNotifier::activated, this, &ModbusQuitSignals::readSignal);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = quit_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ModbusQuitSignals::readSignal()
+{
+#ifdef Q_OS_UNIX
+    char buf[16];
+    while(::read(quit_fds[1], buf, sizeof(buf)) > 0){}
+#endif
+
+    QCoreApplication::quit();
+}
@@ -0,0 +1,32 @@
+#ifndef MODBUSQUITSIGNALS_H
+#define MODBUSQUITSIGNALS_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+
+/*
+ * Завершение цикла событий по SIGINT и SIGTERM.
+ * Обработчик сигнала только пишет байт в socketpair
+ * (async-signal-safe), QSocketNotifier на другом конце
+ * вызывает QCoreApplication::quit() уже в цикле событий.
+ * Один объект на процесс; вне UNIX сигналы не перехватываются.
+ */
+class ModbusQuitSignals : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusQuitSignals(QObject *parent = 0);
+    ~ModbusQuitSignals();
+
+    bool install();
+
+private slots:
+    void readSignal();
+
+private:
+    QSocketNotifier* quit_notifier;
+};
+
+#endif // MODBUSQUITSIGNALS_H
@@ -0,0 +1,69 @@
+#include "modbusrecordcodec.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define RECORD_CODEC_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RECORD_CODEC_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RECORD_CODEC_NEON
+#endif
+
+
+void ModbusRecordCodec::swap(void* dst, const void* src, int count)
+{
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+
+    int i = 0;
+
+#if defined(RECORD_CODEC_SSSE3)
+    const __m128i mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+    for(; i + 8 <= count; i += 8){
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i * 2), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(RECORD_CODEC_SSE2)
+    for(; i + 8 <= count; i += 8){
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 2));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i * 2), v);
+    }
+#elif defined(RECORD_CODEC_NEON)
+    for(; i + 8 <= count; i += 8){
+        uint8x16_t v = vld1q_u8(s + i * 2);
+        vst1q_u8(d + i * 2, vrev16q_u8(v));
+    }
+#endif
+
+    swapScalar(d + i * 2, s + i * 2, count - i);
+}
+
+void ModbusRecordCodec::swapScalar(void* dst, const void* src, int count)
+{
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+
+    for(int i = 0; i < count; i ++){
+        uint8_t lo = s[i * 2];
+        uint8_t hi = s[i * 2 + 1];
+        d[i * 2] = hi;
+        d[i * 2 + 1] = lo;
+    }
+}
+
+const char* ModbusRecordCodec::implementation()
+{
+#if defined(RECORD_CODEC_SSSE3)
+    return "ssse3";
+#elif defined(RECORD_CODEC_SSE2)
+    return "sse2";
+#elif defined(RECORD_CODEC_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
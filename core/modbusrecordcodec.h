@@ -0,0 +1,27 @@
+#ifndef MODBUSRECORDCODEC_H
+#define MODBUSRECORDCODEC_H
+
+#include <stdint.h>
+
+
+/*
+ * Преобразование записей файла Modbus (16 бит, big-endian на линии)
+ * в байты образа прошивки (little-endian) и обратно.
+ * Обе стороны - перестановка байт в каждом слове,
+ * выполняется блоками по 16 байт на SIMD (SSSE3/SSE2/NEON),
+ * хвост и остальные архитектуры - скалярно.
+ */
+class ModbusRecordCodec
+{
+public:
+    // count - число записей; dst и src могут совпадать.
+    static void swap(void* dst, const void* src, int count);
+
+    // Скалярная реализация, для проверки и сравнения.
+    static void swapScalar(void* dst, const void* src, int count);
+
+    // Используемая реализация: "ssse3", "sse2", "neon" или "scalar".
+    static const char* implementation();
+};
+
+#endif // MODBUSRECORDCODEC_H
@@ -67,6 +67,16 @@ void ModbusReg::setData(int i, uint16_t val)
     reg_data[i] = val;
 }
 
+const uint16_t* ModbusReg::constData() const
+{
+    return reg_data.constData();
+}
+
+uint16_t* ModbusReg::regData()
+{
+    return reg_data.data();
+}
+
 uint16_t ModbusReg::value() const
 {
     if(reg_data.empty()) return 0;
@@ -93,12 +103,7 @@ bool ModbusReg::read()
     connect(modbus_msg, &ModbusMsg::sendSuccess, this, &ModbusReg::msgDataReaded);
     connect(modbus_msg, &ModbusMsg::sendError, this, &ModbusReg::msgError);
 
-    if(!modbusDev()->sendMsg(modbus_msg)){
-        delete modbus_msg;
-        return false;
-    }
-
-    return true;
+    return sendMsg(modbus_msg);
 }
 
 bool ModbusReg::write()
@@ -114,9 +119,22 @@ bool ModbusReg::write()
     connect(modbus_msg, &ModbusMsg::sendSuccess, this, &ModbusReg::msgDataWrited);
     connect(modbus_msg, &ModbusMsg::sendError, this, &ModbusReg::msgError);
 
-    if(!modbusDev()->sendMsg(modbus_msg)){
-        delete modbus_msg;
-        return false;
+    return sendMsg(modbus_msg);
+}
+
+bool ModbusReg::cancel()
+{
+    if(reg_msgs.empty()) return false;
+
+    QList<ModbusMsg*> msgs = reg_msgs;
+    reg_msgs.clear();
+
+    for(ModbusMsg* msg: msgs){
+        disconnect(msg, nullptr, this, nullptr);
+
+        if(modbusDev()) modbusDev()->cancelMsg(msg);
+
+        msg->deleteLater();
     }
 
     return true;
@@ -124,7 +142,7 @@ bool ModbusReg::write()
 
 void ModbusReg::msgError(ModbusErr error)
 {
-    ModbusMsg* msg = qobject_cast<ModbusMsg*>(sender());
+    ModbusMsg* msg = takeSender();
     if(!msg){
         qDebug() << "ModbusReg: msgError msg == NULL!";
         return;
@@ -137,7 +155,7 @@ void ModbusReg::msgError(ModbusErr error)
 
 void ModbusReg::msgDataReaded()
 {
-    ModbusMsg* msg = qobject_cast<ModbusMsg*>(sender());
+    ModbusMsg* msg = takeSender();
     if(!msg){
         qDebug() << "ModbusReg: msgDataReaded msg == NULL!";
         return;
@@ -178,7 +196,7 @@ void ModbusReg::msgDataReaded()
 
 void ModbusReg::msgDataWrited()
 {
-    ModbusMsg* msg = qobject_cast<ModbusMsg*>(sender());
+    ModbusMsg* msg = takeSender();
     if(!msg){
         qDebug() << "ModbusReg: msgDataWrited msg == NULL!";
         return;
@@ -203,3 +221,25 @@ void ModbusReg::msgDataWrited()
     emit dataWrited();
 }
 
+bool ModbusReg::sendMsg(ModbusMsg* msg)
+{
+    reg_msgs.append(msg);
+
+    if(!modbusDev()->sendMsg(msg)){
+        reg_msgs.removeOne(msg);
+        delete msg;
+        return false;
+    }
+
+    return true;
+}
+
+ModbusMsg* ModbusReg::takeSender()
+{
+    ModbusMsg* msg = qobject_cast<ModbusMsg*>(sender());
+    if(!msg) return nullptr;
+
+    reg_msgs.removeOne(msg);
+
+    return msg;
+}
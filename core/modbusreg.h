@@ -5,6 +5,7 @@
 #include "modbuserr.h"
 #include <QModbusDataUnit>
 #include <QVector>
+#include <QList>
 
 class ModbusMsg;
 
@@ -30,12 +31,19 @@ public:
     uint16_t &data(int i);
     void setData(int i, uint16_t val);
 
+    const uint16_t* constData() const;
+    uint16_t* regData();
+
     uint16_t value() const;
     void setValue(uint16_t val);
 
     bool read();
     bool write();
 
+    // Отмена чтений и записей без сигналов,
+    // передаваемый запрос прерывается.
+    bool cancel();
+
 signals:
     void errorOccured(ModbusErr error);
     void dataReaded();
@@ -50,6 +58,12 @@ private:
     QModbusDataUnit::RegisterType reg_type;
     int reg_address;
     QVector<uint16_t> reg_data;
+
+    // Ещё не завершённые сообщения.
+    QList<ModbusMsg*> reg_msgs;
+
+    bool sendMsg(ModbusMsg* msg);
+    ModbusMsg* takeSender();
 };
 
 #endif // MODBUSREG_H
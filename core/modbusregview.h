@@ -0,0 +1,150 @@
+#ifndef MODBUSREGVIEW_H
+#define MODBUSREGVIEW_H
+
+#include "modbusreg.h"
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+
+// Порядок слов в многорегистровых значениях.
+enum class ModbusWordOrder {
+    BigEndian, // Старшее слово в младшем регистре (Modicon).
+    LittleEndian // Младшее слово в младшем регистре.
+};
+
+
+// Битовое поле внутри одного регистра.
+template <unsigned Bit, unsigned Width = 1>
+struct ModbusBits {
+    static_assert(Width > 0 && Bit + Width <= 16, "ModbusBits: field out of register!");
+};
+
+
+/*
+ * Описание типа значения в регистрах:
+ * число регистров и преобразование в/из слов.
+ */
+template <typename T>
+struct ModbusRegTraits {
+
+    static_assert(std::is_arithmetic<T>::value, "ModbusRegTraits: unsupported type!");
+    static_assert(sizeof(T) % sizeof(uint16_t) == 0, "ModbusRegTraits: type size must be multiple of register size!");
+
+    typedef T value_type;
+
+    typedef typename std::conditional<sizeof(T) == 2, uint16_t,
+            typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type>::type bits_type;
+
+    static constexpr int words = sizeof(T) / sizeof(uint16_t);
+
+    template <ModbusWordOrder Order>
+    static value_type decode(const uint16_t* regs)
+    {
+        bits_type bits = 0;
+        for(int i = 0; i < words; i ++){
+            bits = static_cast<bits_type>(bits << 16) | regs[wordIndex<Order>(i)];
+        }
+        value_type val;
+        memcpy(&val, &bits, sizeof(val));
+        return val;
+    }
+
+    template <ModbusWordOrder Order>
+    static void encode(uint16_t* regs, value_type val)
+    {
+        bits_type bits;
+        memcpy(&bits, &val, sizeof(bits));
+        for(int i = words - 1; i >= 0; i --){
+            regs[wordIndex<Order>(i)] = static_cast<uint16_t>(bits);
+            bits = static_cast<bits_type>(bits >> 16);
+        }
+    }
+
+    // Индекс регистра для i-го слова, начиная со старшего.
+    template <ModbusWordOrder Order>
+    static constexpr int wordIndex(int i)
+    {
+        return (Order == ModbusWordOrder::BigEndian) ? i : (words - 1 - i);
+    }
+};
+
+template <unsigned Bit, unsigned Width>
+struct ModbusRegTraits<ModbusBits<Bit, Width>> {
+
+    typedef uint16_t value_type;
+
+    static constexpr int words = 1;
+    static constexpr uint16_t mask = static_cast<uint16_t>(((1u << Width) - 1) << Bit);
+
+    template <ModbusWordOrder Order>
+    static value_type decode(const uint16_t* regs)
+    {
+        return static_cast<value_type>((regs[0] & mask) >> Bit);
+    }
+
+    template <ModbusWordOrder Order>
+    static void encode(uint16_t* regs, value_type val)
+    {
+        regs[0] = static_cast<uint16_t>((regs[0] & ~mask) | ((val << Bit) & mask));
+    }
+};
+
+
+/*
+ * Типизированное представление блока регистров ModbusReg.
+ * Не копирует данные - чтение и запись идут
+ * непосредственно в регистры объекта.
+ * Например: ModbusRegView<float> temp(reg, 2);
+ */
+template <typename T, ModbusWordOrder Order = ModbusWordOrder::BigEndian>
+class ModbusRegView
+{
+public:
+    typedef ModbusRegTraits<T> Traits;
+    typedef typename Traits::value_type value_type;
+
+    static constexpr int wordsCount()
+        { return Traits::words; }
+
+    explicit ModbusRegView(ModbusReg* reg = nullptr, int offset = 0)
+        :modbus_reg(reg), reg_offset(offset) {}
+
+    ModbusReg* modbusReg() const { return modbus_reg; }
+    void setModbusReg(ModbusReg* reg) { modbus_reg = reg; }
+
+    int offset() const { return reg_offset; }
+    void setOffset(int offset) { reg_offset = offset; }
+
+    // Число значений, умещающихся в регистрах после смещения.
+    int count() const
+    {
+        if(!modbus_reg) return 0;
+        int regs = modbus_reg->regCount() - reg_offset;
+        return (regs > 0) ? (regs / Traits::words) : 0;
+    }
+
+    value_type data(int i) const
+    {
+        Q_ASSERT(i >= 0 && i < count());
+        return Traits::template decode<Order>(modbus_reg->constData() + reg_offset + i * Traits::words);
+    }
+
+    void setData(int i, value_type val)
+    {
+        Q_ASSERT(i >= 0 && i < count());
+        Traits::template encode<Order>(modbus_reg->regData() + reg_offset + i * Traits::words, val);
+    }
+
+    value_type value() const
+        { return data(0); }
+
+    void setValue(value_type val)
+        { setData(0, val); }
+
+private:
+    ModbusReg* modbus_reg;
+    int reg_offset;
+};
+
+#endif // MODBUSREGVIEW_H
@@ -0,0 +1,105 @@
+#include "modbusreplaytransport.h"
+#include "modbusnetstats.h"
+#include <QTimer>
+
+
+ModbusReplayTransport::ModbusReplayTransport(QObject *parent) : ModbusPduTransport(parent)
+{
+    replay_pos = 0;
+    replay_mismatch = false;
+    replay_time = 0;
+}
+
+ModbusReplayTransport::~ModbusReplayTransport()
+{
+}
+
+bool ModbusReplayTransport::load(const QString& filename)
+{
+    QVector<ModbusTrace::Record> recs;
+
+    if(!ModbusTrace::load(filename, &recs)) return false;
+
+    setRecords(recs);
+
+    return true;
+}
+
+void ModbusReplayTransport::setRecords(const QVector<ModbusTrace::Record>& recs)
+{
+    records = recs;
+    rewind();
+}
+
+int ModbusReplayTransport::count() const
+{
+    return records.size();
+}
+
+int ModbusReplayTransport::position() const
+{
+    return replay_pos;
+}
+
+bool ModbusReplayTransport::atEnd() const
+{
+    return replay_pos >= records.size();
+}
+
+void ModbusReplayTransport::rewind()
+{
+    replay_pos = 0;
+    replay_mismatch = false;
+    replay_time = records.empty() ? 0 : records.first().timestamp;
+}
+
+qint64 ModbusReplayTransport::timestamp() const
+{
+    return replay_time;
+}
+
+void ModbusReplayTransport::processRequest(const QModbusRequest& req, int slaveAddr)
+{
+    if(!atEnd()){
+        const ModbusTrace::Record& rec = records.at(replay_pos);
+
+        replay_mismatch = rec.slave_addr != slaveAddr ||
+                          rec.request.functionCode() != req.functionCode() ||
+                          rec.request.data() != req.data();
+    }
+
+    // Ответ всегда асинхронный, как у настоящего устройства.
+    QTimer::singleShot(0, this, &ModbusReplayTransport::replayNext);
+}
+
+void ModbusReplayTransport::replayNext()
+{
+    if(atEnd()){
+        failRequest(QModbusDevice::TimeoutError, tr("Replay finished."));
+        return;
+    }
+
+    if(replay_mismatch){
+        emit mismatch(replay_pos);
+        failRequest(QModbusDevice::ProtocolError, tr("Request mismatch at record %1.").arg(replay_pos));
+        return;
+    }
+
+    const ModbusTrace::Record rec = records.at(replay_pos ++);
+
+    replay_time = rec.timestamp + static_cast<qint64>(rec.duration) * 1000;
+
+    switch(rec.outcome){
+    default:
+    case ModbusNetStats::Success:
+    case ModbusNetStats::Exception:
+        finishRequest(rec.response);
+        break;
+    case ModbusNetStats::Timeout:
+        failRequest(QModbusDevice::TimeoutError, tr("Request timeout."));
+        break;
+    case ModbusNetStats::Error:
+        failRequest(QModbusDevice::UnknownError, tr("Recorded error."));
+        break;
+    }
+}
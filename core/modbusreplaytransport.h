@@ -0,0 +1,49 @@
+#ifndef MODBUSREPLAYTRANSPORT_H
+#define MODBUSREPLAYTRANSPORT_H
+
+#include "modbustransport.h"
+#include "modbustrace.h"
+#include <QVector>
+
+
+/*
+ * Воспроизведение записанного сеанса (ModbusTrace).
+ * Запросы сверяются с записью, ответы и ошибки
+ * выдаются в записанном порядке, время транспорта
+ * соответствует записанным отметкам времени.
+ */
+class ModbusReplayTransport : public ModbusPduTransport
+{
+    Q_OBJECT
+public:
+    explicit ModbusReplayTransport(QObject *parent = 0);
+    ~ModbusReplayTransport();
+
+    bool load(const QString& filename);
+    void setRecords(const QVector<ModbusTrace::Record>& recs);
+
+    int count() const;
+    int position() const;
+    bool atEnd() const;
+    void rewind();
+
+    qint64 timestamp() const;
+
+signals:
+    // Запрос не совпал с записью.
+    void mismatch(int index);
+
+protected:
+    void processRequest(const QModbusRequest& req, int slaveAddr);
+
+private slots:
+    void replayNext();
+
+private:
+    QVector<ModbusTrace::Record> records;
+    int replay_pos;
+    bool replay_mismatch;
+    qint64 replay_time;
+};
+
+#endif // MODBUSREPLAYTRANSPORT_H
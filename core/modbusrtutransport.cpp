@@ -0,0 +1,133 @@
+#include "modbusrtutransport.h"
+#include <QModbusRtuSerialMaster>
+#include <QSerialPort>
+#include <QVariant>
+#include <QDebug>
+
+
+ModbusRtuTransport::ModbusRtuTransport(QObject *parent) : ModbusTransport(parent)
+{
+    modbus_rtu = new QModbusRtuSerialMaster(this);
+
+    // Раньше пересылки состояния: к сигналу о соединении порт уже настроен.
+    connect(modbus_rtu, &QModbusDevice::stateChanged, this, &ModbusRtuTransport::on_modbus_state_changed);
+
+    connect(modbus_rtu, &QModbusDevice::stateChanged, this, &ModbusTransport::stateChanged);
+    connect(modbus_rtu, &QModbusDevice::errorOccurred, this, &ModbusTransport::errorOccurred);
+}
+
+ModbusRtuTransport::~ModbusRtuTransport()
+{
+    delete modbus_rtu;
+}
+
+QModbusRtuSerialMaster* ModbusRtuTransport::device()
+{
+    return modbus_rtu;
+}
+
+ModbusSerialTuning& ModbusRtuTransport::serialTuning()
+{
+    return serial_tuning;
+}
+
+bool ModbusRtuTransport::connectDevice()
+{
+    return modbus_rtu->connectDevice();
+}
+
+void ModbusRtuTransport::disconnectDevice()
+{
+    modbus_rtu->disconnectDevice();
+}
+
+QModbusDevice::State ModbusRtuTransport::state() const
+{
+    return modbus_rtu->state();
+}
+
+QString ModbusRtuTransport::errorString() const
+{
+    return modbus_rtu->errorString();
+}
+
+void ModbusRtuTransport::setInterFrameDelay(int usecs)
+{
+    modbus_rtu->setInterFrameDelay(usecs);
+}
+
+void ModbusRtuTransport::setTimeout(int msecs)
+{
+    modbus_rtu->setTimeout(msecs);
+}
+
+void ModbusRtuTransport::setNumberOfRetries(int retries)
+{
+    modbus_rtu->setNumberOfRetries(retries);
+}
+
+bool ModbusRtuTransport::setBaud(quint32 baud)
+{
+    modbus_rtu->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, static_cast<int>(baud));
+
+    if(modbus_rtu->state() != QModbusDevice::ConnectedState) return true;
+
+    QSerialPort* port = modbus_rtu->findChild<QSerialPort*>();
+    if(!port || !port->isOpen()) return false;
+
+    return port->setBaudRate(static_cast<qint32>(baud));
+}
+
+QString ModbusRtuTransport::linkName() const
+{
+    return modbus_rtu->connectionParameter(QModbusDevice::SerialPortNameParameter).toString();
+}
+
+QModbusReply* ModbusRtuTransport::sendRawRequest(const QModbusRequest& req, int slaveAddr)
+{
+    return modbus_rtu->sendRawRequest(req, slaveAddr);
+}
+
+QModbusReply* ModbusRtuTransport::sendReadRequest(const QModbusDataUnit& du, int slaveAddr)
+{
+    return modbus_rtu->sendReadRequest(du, slaveAddr);
+}
+
+QModbusReply* ModbusRtuTransport::sendWriteRequest(const QModbusDataUnit& du, int slaveAddr)
+{
+    return modbus_rtu->sendWriteRequest(du, slaveAddr);
+}
+
+void ModbusRtuTransport::on_modbus_state_changed(QModbusDevice::State state)
+{
+    switch(state){
+    default:
+        break;
+    case QModbusDevice::ConnectedState:
+        if(!serial_tuning.apply(portHandle(),
+                                modbus_rtu->connectionParameter(QModbusDevice::SerialPortNameParameter).toString())){
+            qDebug() << "ModbusRtuTransport:" << serial_tuning.report();
+        }
+        break;
+    case QModbusDevice::ClosingState:
+        // Порт ещё открыт.
+        if(serial_tuning.isApplied() && !serial_tuning.restore(portHandle())){
+            qDebug() << "ModbusRtuTransport:" << serial_tuning.report();
+        }
+        break;
+    }
+}
+
+int ModbusRtuTransport::portHandle() const
+{
+    // QModbusRtuSerialMaster не даёт доступа к порту,
+    // но порт - его дочерний объект.
+    QSerialPort* port = modbus_rtu->findChild<QSerialPort*>();
+    if(!port || !port->isOpen()) return -1;
+
+#ifdef Q_OS_UNIX
+    return port->handle();
+#else
+    return -1;
+#endif
+}
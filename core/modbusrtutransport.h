@@ -0,0 +1,54 @@
+#ifndef MODBUSRTUTRANSPORT_H
+#define MODBUSRTUTRANSPORT_H
+
+#include "modbustransport.h"
+#include "modbusserialtuning.h"
+
+class QModbusRtuSerialMaster;
+
+
+/*
+ * Транспорт через последовательный порт (Modbus RTU).
+ * Настройка порта для малой задержки применяется
+ * после соединения и отменяется при разъединении.
+ */
+class ModbusRtuTransport : public ModbusTransport
+{
+    Q_OBJECT
+public:
+    explicit ModbusRtuTransport(QObject *parent = 0);
+    ~ModbusRtuTransport();
+
+    QModbusRtuSerialMaster* device();
+
+    ModbusSerialTuning& serialTuning();
+
+    bool connectDevice();
+    void disconnectDevice();
+
+    QModbusDevice::State state() const;
+    QString errorString() const;
+
+    void setInterFrameDelay(int usecs);
+    void setTimeout(int msecs);
+    void setNumberOfRetries(int retries);
+    bool setBaud(quint32 baud);
+
+    QString linkName() const;
+
+    QModbusReply* sendRawRequest(const QModbusRequest& req, int slaveAddr);
+    QModbusReply* sendReadRequest(const QModbusDataUnit& du, int slaveAddr);
+    QModbusReply* sendWriteRequest(const QModbusDataUnit& du, int slaveAddr);
+
+private slots:
+    void on_modbus_state_changed(QModbusDevice::State state);
+
+private:
+    QModbusRtuSerialMaster* modbus_rtu;
+    ModbusSerialTuning serial_tuning;
+
+    // Дескриптор открытого порта, -1 если недоступен.
+    int portHandle() const;
+};
+
+#endif // MODBUSRTUTRANSPORT_H
@@ -0,0 +1,315 @@
+#include "modbusserialtuning.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QByteArray>
+#include <QJsonArray>
+#include <errno.h>
+#include <string.h>
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#endif
+
+
+#define DEFAULT_SYSFS_ROOT "/sys"
+
+
+#ifdef Q_OS_LINUX
+static int systemIoctl(int fd, unsigned long request, void* arg)
+{
+    return ::ioctl(fd, request, arg);
+}
+#endif
+
+
+ModbusSerialTuning::Config::Config()
+{
+    low_latency = false;
+    latency_timer = 0;
+    rs485 = false;
+}
+
+ModbusSerialTuning::ModbusSerialTuning()
+{
+#ifdef Q_OS_LINUX
+    ioctl_func = systemIoctl;
+#else
+    ioctl_func = nullptr;
+#endif
+    sysfs_root = QStringLiteral(DEFAULT_SYSFS_ROOT);
+
+    serial_saved = false;
+    saved_serial_flags = 0;
+    latency_saved = false;
+    saved_latency = 0;
+    rs485_saved = false;
+    saved_rs485_flags = 0;
+}
+
+const ModbusSerialTuning::Config& ModbusSerialTuning::config() const
+{
+    return tuning_conf;
+}
+
+void ModbusSerialTuning::setConfig(const Config& conf)
+{
+    tuning_conf = conf;
+}
+
+void ModbusSerialTuning::setIoctlFunc(IoctlFunc func)
+{
+    ioctl_func = func;
+}
+
+void ModbusSerialTuning::setSysfsRoot(const QString& path)
+{
+    sysfs_root = path;
+}
+
+bool ModbusSerialTuning::apply(int fd, const QString& port_name)
+{
+    tuning_report.clear();
+
+    // Восстановление прошлого применения, если отключения не было.
+    if(isApplied()) restore(fd);
+
+    if(!tuning_conf.low_latency && tuning_conf.latency_timer == 0 && !tuning_conf.rs485) return true;
+
+#ifdef Q_OS_LINUX
+    // Ссылки вида /dev/serial/by-id/... указывают на ttyUSBn.
+    QFileInfo info(port_name.contains(QLatin1Char('/')) ? port_name : QStringLiteral("/dev/") + port_name);
+    QString canonical = info.canonicalFilePath();
+    tty_name = QFileInfo(canonical.isEmpty() ? info.filePath() : canonical).fileName();
+
+    if(fd < 0){
+        addReport(QStringLiteral("serial port handle is not available"));
+        return false;
+    }
+
+    bool res = true;
+
+    if(tuning_conf.low_latency) res &= applyLowLatency(fd);
+    if(tuning_conf.latency_timer != 0) res &= applyLatencyTimer();
+    if(tuning_conf.rs485) res &= applyRs485(fd);
+
+    return res;
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(port_name);
+
+    addReport(QStringLiteral("serial port tuning is supported on Linux only"));
+
+    return false;
+#endif
+}
+
+bool ModbusSerialTuning::restore(int fd)
+{
+    bool res = true;
+
+#ifdef Q_OS_LINUX
+    if(serial_saved && fd >= 0){
+        struct serial_struct ss;
+        memset(&ss, 0, sizeof(ss));
+
+        if(doIoctl(fd, TIOCGSERIAL, &ss) == 0){
+            ss.flags = saved_serial_flags;
+            res &= doIoctl(fd, TIOCSSERIAL, &ss) == 0;
+        }else{
+            res = false;
+        }
+    }
+
+    if(latency_saved){
+        res &= writeLatencyTimer(saved_latency);
+    }
+
+    if(rs485_saved && fd >= 0){
+        struct serial_rs485 rs;
+        memset(&rs, 0, sizeof(rs));
+
+        if(doIoctl(fd, TIOCGRS485, &rs) == 0){
+            rs.flags = saved_rs485_flags;
+            res &= doIoctl(fd, TIOCSRS485, &rs) == 0;
+        }else{
+            res = false;
+        }
+    }
+#else
+    Q_UNUSED(fd);
+#endif
+
+    if(isApplied()){
+        addReport(res ? QStringLiteral("restored") : QStringLiteral("restore failed"));
+    }
+
+    serial_saved = false;
+    latency_saved = false;
+    rs485_saved = false;
+
+    return res;
+}
+
+bool ModbusSerialTuning::isApplied() const
+{
+    return serial_saved || latency_saved || rs485_saved;
+}
+
+const QStringList& ModbusSerialTuning::report() const
+{
+    return tuning_report;
+}
+
+QJsonObject ModbusSerialTuning::toJson() const
+{
+    QJsonObject obj;
+
+    obj[QStringLiteral("tty")] = tty_name;
+    obj[QStringLiteral("low_latency")] = tuning_conf.low_latency;
+    obj[QStringLiteral("latency_timer_ms")] = static_cast<double>(tuning_conf.latency_timer);
+    obj[QStringLiteral("rs485")] = tuning_conf.rs485;
+    obj[QStringLiteral("applied")] = isApplied();
+    obj[QStringLiteral("report")] = QJsonArray::fromStringList(tuning_report);
+
+    return obj;
+}
+
+bool ModbusSerialTuning::applyLowLatency(int fd)
+{
+#ifdef Q_OS_LINUX
+    struct serial_struct ss;
+    memset(&ss, 0, sizeof(ss));
+
+    if(doIoctl(fd, TIOCGSERIAL, &ss) != 0){
+        addReport(QStringLiteral("ASYNC_LOW_LATENCY: TIOCGSERIAL failed: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return false;
+    }
+
+    bool was_on = ss.flags & ASYNC_LOW_LATENCY;
+
+    if(!was_on){
+        saved_serial_flags = ss.flags;
+
+        ss.flags |= ASYNC_LOW_LATENCY;
+
+        if(doIoctl(fd, TIOCSSERIAL, &ss) != 0){
+            addReport(QStringLiteral("ASYNC_LOW_LATENCY: TIOCSSERIAL failed: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            return false;
+        }
+
+        serial_saved = true;
+    }
+
+    addReport(QStringLiteral("ASYNC_LOW_LATENCY: on (was %1)").arg(was_on ? QStringLiteral("on") : QStringLiteral("off")));
+
+    return true;
+#else
+    Q_UNUSED(fd);
+    return false;
+#endif
+}
+
+bool ModbusSerialTuning::applyLatencyTimer()
+{
+    quint32 current = 0;
+
+    // Таймер есть только у адаптеров FTDI.
+    if(!readLatencyTimer(&current)){
+        addReport(QStringLiteral("latency_timer: not available for %1").arg(tty_name));
+        return true;
+    }
+
+    if(current != tuning_conf.latency_timer){
+        if(!writeLatencyTimer(tuning_conf.latency_timer)){
+            addReport(QStringLiteral("latency_timer: write failed (%1 ms left), check permissions of %2")
+                      .arg(current).arg(latencyTimerPath()));
+            return false;
+        }
+
+        saved_latency = current;
+        latency_saved = true;
+    }
+
+    addReport(QStringLiteral("latency_timer: %1 ms (was %2 ms)").arg(tuning_conf.latency_timer).arg(current));
+
+    return true;
+}
+
+bool ModbusSerialTuning::applyRs485(int fd)
+{
+#ifdef Q_OS_LINUX
+    struct serial_rs485 rs;
+    memset(&rs, 0, sizeof(rs));
+
+    if(doIoctl(fd, TIOCGRS485, &rs) != 0){
+        // USB-адаптеры переключают передатчик сами и RS-485 ioctl не поддерживают.
+        addReport(QStringLiteral("RS-485: not supported by driver: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return true;
+    }
+
+    quint32 flags = rs.flags;
+    quint32 new_flags = (flags | SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND) & ~SER_RS485_RTS_AFTER_SEND;
+
+    if(flags != new_flags){
+        rs.flags = new_flags;
+
+        if(doIoctl(fd, TIOCSRS485, &rs) != 0){
+            addReport(QStringLiteral("RS-485: TIOCSRS485 failed: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            return false;
+        }
+
+        saved_rs485_flags = flags;
+        rs485_saved = true;
+    }
+
+    addReport(QStringLiteral("RS-485: enabled, RTS on send (was %1)")
+              .arg((flags & SER_RS485_ENABLED) ? QStringLiteral("enabled") : QStringLiteral("disabled")));
+
+    return true;
+#else
+    Q_UNUSED(fd);
+    return false;
+#endif
+}
+
+QString ModbusSerialTuning::latencyTimerPath() const
+{
+    return sysfs_root + QStringLiteral("/bus/usb-serial/devices/") + tty_name + QStringLiteral("/latency_timer");
+}
+
+bool ModbusSerialTuning::readLatencyTimer(quint32* value) const
+{
+    QFile file(latencyTimerPath());
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    bool ok = false;
+    *value = file.readAll().trimmed().toUInt(&ok);
+
+    return ok;
+}
+
+bool ModbusSerialTuning::writeLatencyTimer(quint32 value) const
+{
+    QFile file(latencyTimerPath());
+    if(!file.open(QIODevice::WriteOnly)) return false;
+
+    QByteArray data = QByteArray::number(value);
+
+    return file.write(data) == data.size();
+}
+
+void ModbusSerialTuning::addReport(const QString& str)
+{
+    tuning_report.append(str);
+}
+
+int ModbusSerialTuning::doIoctl(int fd, unsigned long request, void* arg) const
+{
+    if(!ioctl_func){
+        errno = ENOSYS;
+        return -1;
+    }
+
+    return ioctl_func(fd, request, arg);
+}
@@ -0,0 +1,82 @@
+#ifndef MODBUSSERIALTUNING_H
+#define MODBUSSERIALTUNING_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+
+/*
+ * Настройка последовательного порта Linux для малой задержки:
+ * флаг ASYNC_LOW_LATENCY (TIOCGSERIAL/TIOCSSERIAL),
+ * таймер задержки USB-адаптеров FTDI (sysfs latency_timer)
+ * и режим RS-485 драйвера (TIOCGRS485/TIOCSRS485).
+ * Исходные значения запоминаются при применении и восстанавливаются
+ * при отключении. Результат каждого шага попадает в отчёт.
+ * ioctl и корень sysfs подменяются для проверки на pty.
+ * На других ОС настройка не выполняется.
+ */
+class ModbusSerialTuning
+{
+public:
+
+    struct Config {
+        Config();
+
+        bool low_latency;
+        quint32 latency_timer; // мс, 0 - не менять.
+        bool rs485;
+    };
+
+    typedef int (*IoctlFunc)(int fd, unsigned long request, void* arg);
+
+    ModbusSerialTuning();
+
+    const Config& config() const;
+    void setConfig(const Config& conf);
+
+    void setIoctlFunc(IoctlFunc func);
+    void setSysfsRoot(const QString& path);
+
+    // Применение к открытому порту, port_name - имя или путь устройства.
+    // Возвращает ложь, если хотя бы один шаг не выполнен.
+    bool apply(int fd, const QString& port_name);
+    // Восстановление запомненных значений.
+    bool restore(int fd);
+
+    bool isApplied() const;
+
+    const QStringList& report() const;
+    QJsonObject toJson() const;
+
+private:
+    bool applyLowLatency(int fd);
+    bool applyLatencyTimer();
+    bool applyRs485(int fd);
+
+    QString latencyTimerPath() const;
+    bool readLatencyTimer(quint32* value) const;
+    bool writeLatencyTimer(quint32 value) const;
+
+    void addReport(const QString& str);
+    int doIoctl(int fd, unsigned long request, void* arg) const;
+
+    Config tuning_conf;
+    IoctlFunc ioctl_func;
+    QString sysfs_root;
+    QString tty_name;
+
+    bool serial_saved;
+    int saved_serial_flags;
+
+    bool latency_saved;
+    quint32 saved_latency;
+
+    bool rs485_saved;
+    quint32 saved_rs485_flags;
+
+    QStringList tuning_report;
+};
+
+#endif // MODBUSSERIALTUNING_H
@@ -0,0 +1,135 @@
+#include "modbustimeline.h"
+#include <QByteArray>
+#include <QFile>
+
+
+#define TIMELINE_DEFAULT_CAPACITY 65536
+#define TIMELINE_PID 1
+
+
+bool ModbusTimeline::timeline_enabled = false;
+
+
+ModbusTimeline::ModbusTimeline()
+{
+    events = nullptr;
+    events_capacity = 0;
+    events_count = 0;
+    events_head = 0;
+
+    setCapacity(TIMELINE_DEFAULT_CAPACITY);
+
+    timeline_timer.start();
+}
+
+ModbusTimeline& ModbusTimeline::get()
+{
+    static ModbusTimeline timeline;
+
+    return timeline;
+}
+
+ModbusTimeline::~ModbusTimeline()
+{
+    delete[] events;
+}
+
+void ModbusTimeline::setEnabled(bool enabled)
+{
+    timeline_enabled = enabled;
+}
+
+int ModbusTimeline::capacity() const
+{
+    return events_capacity;
+}
+
+void ModbusTimeline::setCapacity(int capacity)
+{
+    if(capacity < 1) capacity = 1;
+
+    delete[] events;
+
+    events = new Event[capacity];
+    events_capacity = capacity;
+
+    clear();
+}
+
+void ModbusTimeline::clear()
+{
+    events_count = 0;
+    events_head = 0;
+}
+
+int ModbusTimeline::count() const
+{
+    return events_count;
+}
+
+QByteArray ModbusTimeline::toJson() const
+{
+    QByteArray json;
+    json.reserve(events_count * 128 + 64);
+
+    json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    for(int i = 0; i < events_count; i ++){
+        int index = (events_head - events_count + i + events_capacity) % events_capacity;
+        const Event& ev = events[index];
+
+        if(i != 0) json.append(",\n");
+
+        json.append("{\"name\":\"").append(ev.name);
+        json.append("\",\"cat\":\"").append(ev.cat);
+        json.append("\",\"ph\":\"").append(ev.phase);
+        json.append("\",\"ts\":").append(QByteArray::number(ev.timestamp / 1000.0, 'f', 3));
+        json.append(",\"pid\":").append(QByteArray::number(TIMELINE_PID));
+        json.append(",\"tid\":").append(QByteArray::number(ev.tid));
+
+        if(ev.phase == AsyncBegin || ev.phase == AsyncEnd){
+            json.append(",\"id\":\"0x").append(QByteArray::number(static_cast<qulonglong>(ev.id), 16)).append('"');
+        }else if(ev.phase == Instant){
+            json.append(",\"s\":\"t\"");
+        }
+
+        if(ev.arg_name){
+            json.append(",\"args\":{\"").append(ev.arg_name).append("\":");
+            json.append(QByteArray::number(ev.arg)).append('}');
+        }
+
+        json.append('}');
+    }
+
+    json.append("]}\n");
+
+    return json;
+}
+
+bool ModbusTimeline::save(const QString& filename) const
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QByteArray json = toJson();
+
+    return file.write(json) == json.size();
+}
+
+void ModbusTimeline::append(Phase phase, const char* cat, const char* name, int tid,
+                            const void* id, const char* arg_name, qint64 arg)
+{
+    Event& ev = events[events_head];
+
+    ev.timestamp = timeline_timer.nsecsElapsed();
+    ev.cat = cat;
+    ev.name = name;
+    ev.arg_name = arg_name;
+    ev.arg = arg;
+    ev.id = reinterpret_cast<quintptr>(id);
+    ev.tid = tid;
+    ev.phase = static_cast<char>(phase);
+
+    if(++ events_head >= events_capacity) events_head = 0;
+    if(events_count < events_capacity) events_count ++;
+}
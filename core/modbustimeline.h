@@ -0,0 +1,92 @@
+#ifndef MODBUSTIMELINE_H
+#define MODBUSTIMELINE_H
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <QString>
+
+
+/*
+ * Временная шкала событий сеанса (цепочки, страницы, транзакции)
+ * для просмотра в Perfetto / chrome://tracing.
+ * События хранятся в кольцевом буфере фиксированного размера.
+ * Имена и категории - строковые литералы, поэтому запись события
+ * не выделяет память, а при выключенной шкале сводится к проверке флага.
+ */
+class ModbusTimeline
+{
+public:
+
+    enum Phase {
+        Begin = 'B',
+        End = 'E',
+        Instant = 'i',
+        AsyncBegin = 'b',
+        AsyncEnd = 'e'
+    };
+
+    static ModbusTimeline& get();
+    ~ModbusTimeline();
+
+    static bool isEnabled() { return timeline_enabled; }
+    void setEnabled(bool enabled);
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    void clear();
+    int count() const;
+
+    // Асинхронный интервал (отдельная дорожка на каждый id).
+    static void asyncBegin(const char* cat, const char* name, const void* id,
+                           const char* arg_name = nullptr, qint64 arg = 0)
+    {
+        if(timeline_enabled) get().append(AsyncBegin, cat, name, 0, id, arg_name, arg);
+    }
+
+    static void asyncEnd(const char* cat, const char* name, const void* id,
+                         const char* arg_name = nullptr, qint64 arg = 0)
+    {
+        if(timeline_enabled) get().append(AsyncEnd, cat, name, 0, id, arg_name, arg);
+    }
+
+    static void instant(const char* cat, const char* name, int tid = 0,
+                        const char* arg_name = nullptr, qint64 arg = 0)
+    {
+        if(timeline_enabled) get().append(Instant, cat, name, tid, nullptr, arg_name, arg);
+    }
+
+    // Формат Chrome trace-event JSON.
+    QByteArray toJson() const;
+    bool save(const QString& filename) const;
+
+private:
+    ModbusTimeline();
+
+    struct Event {
+        qint64 timestamp;
+        const char* cat;
+        const char* name;
+        const char* arg_name;
+        qint64 arg;
+        quintptr id;
+        int tid;
+        char phase;
+    };
+
+    void append(Phase phase, const char* cat, const char* name, int tid,
+                const void* id, const char* arg_name, qint64 arg);
+
+    static bool timeline_enabled;
+
+    QElapsedTimer timeline_timer;
+    Event* events;
+    int events_capacity;
+    int events_count;
+    int events_head;
+
+    ModbusTimeline(const ModbusTimeline&) = delete;
+    ModbusTimeline& operator=(const ModbusTimeline&) = delete;
+};
+
+#endif // MODBUSTIMELINE_H
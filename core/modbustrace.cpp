@@ -0,0 +1,197 @@
+#include "modbustrace.h"
+#include <QFile>
+#include <QDataStream>
+#include <string.h>
+
+
+// "MBTR".
+#define TRACE_FILE_MAGIC 0x5254424d
+#define TRACE_FILE_VERSION 1
+// Бит исключения в коде функции.
+#define EXCEPTION_BYTE 0x80
+
+
+ModbusTrace::ModbusTrace(int capacity)
+{
+    trace_enabled = false;
+    entries = nullptr;
+    entries_capacity = 0;
+    entries_count = 0;
+    entries_head = 0;
+
+    setCapacity(capacity);
+}
+
+ModbusTrace::~ModbusTrace()
+{
+    delete[] entries;
+}
+
+bool ModbusTrace::isEnabled() const
+{
+    return trace_enabled;
+}
+
+void ModbusTrace::setEnabled(bool enabled)
+{
+    trace_enabled = enabled;
+}
+
+int ModbusTrace::capacity() const
+{
+    return entries_capacity;
+}
+
+void ModbusTrace::setCapacity(int capacity)
+{
+    if(capacity < 1) capacity = 1;
+
+    delete[] entries;
+
+    entries = new Entry[capacity];
+    entries_capacity = capacity;
+
+    clear();
+}
+
+void ModbusTrace::clear()
+{
+    entries_count = 0;
+    entries_head = 0;
+}
+
+int ModbusTrace::count() const
+{
+    return entries_count;
+}
+
+ModbusTrace::Record ModbusTrace::record(int i) const
+{
+    Record rec;
+
+    int index = (entries_head - entries_count + i + entries_capacity) % entries_capacity;
+    const Entry& entry = entries[index];
+
+    rec.timestamp = entry.timestamp;
+    rec.duration = entry.duration;
+    rec.slave_addr = entry.slave_addr;
+    rec.outcome = entry.outcome;
+
+    restorePdu(&rec.request, entry.req, entry.req_size);
+    restorePdu(&rec.response, entry.resp, entry.resp_size);
+
+    return rec;
+}
+
+void ModbusTrace::append(qint64 timestamp, qint64 duration, int slaveAddr, int outcome,
+                         const QModbusPdu& req, const QModbusPdu& resp)
+{
+    if(!trace_enabled) return;
+
+    Entry& entry = entries[entries_head];
+
+    entry.timestamp = timestamp;
+    entry.duration = static_cast<quint32>(qMin<qint64>(duration / 1000, 0xffffffff));
+    entry.slave_addr = static_cast<quint8>(slaveAddr);
+    entry.outcome = static_cast<quint8>(outcome);
+    entry.req_size = storePdu(entry.req, req);
+    entry.resp_size = storePdu(entry.resp, resp);
+
+    if(++ entries_head >= entries_capacity) entries_head = 0;
+    if(entries_count < entries_capacity) entries_count ++;
+}
+
+bool ModbusTrace::save(const QString& filename) const
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QDataStream ds(&file);
+    ds.setByteOrder(QDataStream::LittleEndian);
+
+    ds << static_cast<quint32>(TRACE_FILE_MAGIC) << static_cast<quint16>(TRACE_FILE_VERSION);
+    ds << static_cast<quint32>(entries_count);
+
+    for(int i = 0; i < entries_count; i ++){
+        int index = (entries_head - entries_count + i + entries_capacity) % entries_capacity;
+        const Entry& entry = entries[index];
+
+        ds << entry.timestamp << entry.duration;
+        ds << entry.slave_addr << entry.outcome << entry.req_size << entry.resp_size;
+
+        ds.writeRawData(entry.req, entry.req_size);
+        ds.writeRawData(entry.resp, entry.resp_size);
+    }
+
+    return ds.status() == QDataStream::Ok;
+}
+
+bool ModbusTrace::load(const QString& filename, QVector<Record>* records)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream ds(&file);
+    ds.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+
+    ds >> magic >> version >> count;
+
+    if(magic != TRACE_FILE_MAGIC || version != TRACE_FILE_VERSION) return false;
+
+    records->clear();
+    records->reserve(static_cast<int>(count));
+
+    char buf[max_pdu_size];
+
+    for(quint32 i = 0; i < count; i ++){
+        Record rec;
+
+        quint8 slave_addr = 0, outcome = 0, req_size = 0, resp_size = 0;
+
+        ds >> rec.timestamp >> rec.duration;
+        ds >> slave_addr >> outcome >> req_size >> resp_size;
+
+        if(req_size > max_pdu_size || resp_size > max_pdu_size) return false;
+
+        rec.slave_addr = slave_addr;
+        rec.outcome = outcome;
+
+        if(ds.readRawData(buf, req_size) != req_size) return false;
+        restorePdu(&rec.request, buf, req_size);
+
+        if(ds.readRawData(buf, resp_size) != resp_size) return false;
+        restorePdu(&rec.response, buf, resp_size);
+
+        records->append(rec);
+    }
+
+    return ds.status() == QDataStream::Ok;
+}
+
+quint8 ModbusTrace::storePdu(char* buf, const QModbusPdu& pdu)
+{
+    if(!pdu.isValid()) return 0;
+
+    const QByteArray& data = pdu.data();
+    int size = qMin(data.size(), max_pdu_size - 1);
+
+    quint8 func = static_cast<quint8>(pdu.functionCode());
+    if(pdu.isException()) func |= EXCEPTION_BYTE;
+
+    buf[0] = static_cast<char>(func);
+    memcpy(buf + 1, data.constData(), size);
+
+    return static_cast<quint8>(size + 1);
+}
+
+void ModbusTrace::restorePdu(QModbusPdu* pdu, const char* buf, int size)
+{
+    if(size < 1) return;
+
+    pdu->setFunctionCode(static_cast<QModbusPdu::FunctionCode>(static_cast<quint8>(buf[0])));
+    pdu->setData(QByteArray(buf + 1, size - 1));
+}
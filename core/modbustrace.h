@@ -0,0 +1,80 @@
+#ifndef MODBUSTRACE_H
+#define MODBUSTRACE_H
+
+#include <QtGlobal>
+#include <QModbusPdu>
+#include <QModbusRequest>
+#include <QModbusResponse>
+#include <QVector>
+#include <QString>
+
+
+/*
+ * Запись PDU запросов и ответов сети Modbus.
+ * Записи хранятся в кольцевом буфере фиксированного размера,
+ * добавление записи - копирование PDU без выделения памяти.
+ * Буфер сохраняется в компактный двоичный файл.
+ */
+class ModbusTrace
+{
+public:
+
+    struct Record {
+        qint64 timestamp; // Время отправки, нс.
+        quint32 duration; // Время ожидания ответа, мкс.
+        int slave_addr;
+        int outcome; // ModbusNetStats::Outcome.
+        QModbusRequest request;
+        QModbusResponse response;
+    };
+
+    explicit ModbusTrace(int capacity = 4096);
+    ~ModbusTrace();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    void clear();
+
+    // Число записей, 0 - самая старая.
+    int count() const;
+    Record record(int i) const;
+
+    void append(qint64 timestamp, qint64 duration, int slaveAddr, int outcome,
+                const QModbusPdu& req, const QModbusPdu& resp);
+
+    bool save(const QString& filename) const;
+    static bool load(const QString& filename, QVector<Record>* records);
+
+private:
+    // Код функции(1) + данные(252).
+    static constexpr int max_pdu_size = 253;
+
+    struct Entry {
+        qint64 timestamp;
+        quint32 duration;
+        quint8 slave_addr;
+        quint8 outcome;
+        quint8 req_size;
+        quint8 resp_size;
+        char req[max_pdu_size];
+        char resp[max_pdu_size];
+    };
+
+    static quint8 storePdu(char* buf, const QModbusPdu& pdu);
+    static void restorePdu(QModbusPdu* pdu, const char* buf, int size);
+
+    bool trace_enabled;
+    Entry* entries;
+    int entries_capacity;
+    int entries_count;
+    int entries_head;
+
+    ModbusTrace(const ModbusTrace&) = delete;
+    ModbusTrace& operator=(const ModbusTrace&) = delete;
+};
+
+#endif // MODBUSTRACE_H
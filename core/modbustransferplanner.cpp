@@ -0,0 +1,519 @@
+#include "modbustransferplanner.h"
+#include "modbuspduarena.h"
+#include "modbusrecordcodec.h"
+#include "modbusbootregs.h"
+#include <QJsonArray>
+#include <string.h>
+
+
+#define REF_TYPE 0x6
+
+// ref_type(1) + file_num(2) + rec_num(2) + rec_len(2).
+#define SUB_REQ_HEADER_SIZE 7
+// resp_len(1) + ref_type(1).
+#define SUB_RESP_HEADER_SIZE 2
+// func(1) + byte_count(1).
+#define FILE_PDU_HEADER_SIZE 2
+// func(1) + addr(2) + value(2).
+#define SINGLE_WRITE_PDU_SIZE 5
+
+// Адрес(1) + CRC(2).
+#define ADU_OVERHEAD 3
+
+
+static inline void put16(uint8_t* ptr, uint16_t val)
+{
+    ptr[0] = val >> 8;
+    ptr[1] = val & 0xff;
+}
+
+
+ModbusTransferPlanner::Capabilities::Capabilities()
+{
+    max_pdu_size = 253;
+    multiple_sub_requests = false;
+    skip_erased = true;
+    erased_value = 0xff;
+}
+
+ModbusTransferPlanner::Timing::Timing()
+{
+    baud = 9600;
+    char_bits = 11;
+    turnaround = 1000;
+    frame_delay = 0;
+    response_latency = 100;
+    erase_latency = 20000;
+    program_latency = 50;
+}
+
+ModbusTransferPlanner::Prediction::Prediction()
+{
+    transactions = 0;
+    selects = 0;
+    erases = 0;
+    writes = 0;
+    reads = 0;
+    records = 0;
+    bytes_sent = 0;
+    bytes_received = 0;
+    duration = 0.0;
+}
+
+ModbusTransferPlanner::ModbusTransferPlanner()
+{
+    page_size = 0;
+    file_number = BOOT_MODBUS_FILE_PAGE;
+    image_offset = 0;
+}
+
+ModbusTransferPlanner::~ModbusTransferPlanner()
+{
+}
+
+const ModbusTransferPlanner::Capabilities& ModbusTransferPlanner::capabilities() const
+{
+    return plan_caps;
+}
+
+void ModbusTransferPlanner::setCapabilities(const Capabilities& caps)
+{
+    plan_caps = caps;
+}
+
+const ModbusTransferPlanner::Timing& ModbusTransferPlanner::timing() const
+{
+    return plan_timing;
+}
+
+void ModbusTransferPlanner::setTiming(const Timing& tm)
+{
+    plan_timing = tm;
+}
+
+quint32 ModbusTransferPlanner::pageSize() const
+{
+    return page_size;
+}
+
+void ModbusTransferPlanner::setPageSize(quint32 size)
+{
+    page_size = size;
+}
+
+uint16_t ModbusTransferPlanner::fileNumber() const
+{
+    return file_number;
+}
+
+void ModbusTransferPlanner::setFileNumber(uint16_t file_num)
+{
+    file_number = file_num;
+}
+
+void ModbusTransferPlanner::clear()
+{
+    plan_image.clear();
+    image_offset = 0;
+    plan_transactions.clear();
+    plan_runs.clear();
+    page_ends.clear();
+}
+
+bool ModbusTransferPlanner::planWrite(quint32 offset, const QByteArray& image, const QVector<bool>& page_mask)
+{
+    clear();
+
+    if(page_size == 0 || page_size % 2 != 0) return false;
+    if(image.isEmpty()) return false;
+
+    // Границы записей.
+    quint32 begin = offset & ~1u;
+    quint32 end = (offset + image.size() + 1) & ~1u;
+
+    plan_image.fill(static_cast<char>(plan_caps.erased_value), end - begin);
+    memcpy(plan_image.data() + (offset - begin), image.constData(), image.size());
+    image_offset = begin;
+
+    quint32 first_page = begin / page_size;
+
+    for(quint32 page = first_page; page <= (end - 1) / page_size; page ++){
+        quint32 page_addr = page * page_size;
+
+        quint32 first = qMax(begin, page_addr);
+        quint32 last = qMin(end, page_addr + page_size);
+
+        int index = static_cast<int>(page - first_page);
+
+        if(page_mask.isEmpty() || (index < page_mask.size() && page_mask.at(index))){
+            planPage(page, (first - page_addr) / 2, (last - page_addr) / 2, true);
+        }
+
+        page_ends.append(plan_transactions.size() - 1);
+    }
+
+    return true;
+}
+
+bool ModbusTransferPlanner::planRead(quint32 offset, quint32 size)
+{
+    clear();
+
+    if(page_size == 0 || page_size % 2 != 0) return false;
+    if(size == 0) return false;
+
+    quint32 begin = offset & ~1u;
+    quint32 end = (offset + size + 1) & ~1u;
+
+    for(quint32 page = begin / page_size; page <= (end - 1) / page_size; page ++){
+        quint32 page_addr = page * page_size;
+
+        quint32 first = qMax(begin, page_addr);
+        quint32 last = qMin(end, page_addr + page_size);
+
+        planPage(page, (first - page_addr) / 2, (last - page_addr) / 2, false);
+
+        page_ends.append(plan_transactions.size() - 1);
+    }
+
+    return true;
+}
+
+const QVector<ModbusTransferPlanner::Transaction>& ModbusTransferPlanner::transactions() const
+{
+    return plan_transactions;
+}
+
+const QVector<ModbusTransferPlanner::Run>& ModbusTransferPlanner::runs() const
+{
+    return plan_runs;
+}
+
+const QVector<int>& ModbusTransferPlanner::pageEnds() const
+{
+    return page_ends;
+}
+
+void ModbusTransferPlanner::encode(ModbusPduArena* arena) const
+{
+    int bytes = 0;
+    for(const Transaction& t: plan_transactions){
+        bytes += requestSize(t);
+    }
+
+    arena->reserve(plan_transactions.size(), bytes);
+
+    for(const Transaction& t: plan_transactions){
+        switch(t.type){
+        case SelectPage:
+            arena->appendWriteSingleRegister(BOOT_MODBUS_HOLD_REG_PAGE_NUMBER, static_cast<uint16_t>(t.page));
+            break;
+        case ErasePage:
+            arena->appendWriteSingleCoil(BOOT_MODBUS_COIL_PAGE_ERASE, true);
+            break;
+        case WriteRecords:
+        case ReadRecords:{
+            int data_size = requestSize(t) - FILE_PDU_HEADER_SIZE;
+
+            uint8_t* ptr = arena->append((t.type == WriteRecords) ? QModbusPdu::WriteFileRecord :
+                                                                   QModbusPdu::ReadFileRecord, 1 + data_size);
+            *ptr ++ = static_cast<uint8_t>(data_size);
+
+            for(int i = t.first_run; i < t.first_run + t.runs_count; i ++){
+                const Run& run = plan_runs.at(i);
+
+                ptr[0] = REF_TYPE;
+                put16(ptr + 1, file_number);
+                put16(ptr + 3, run.rec_num);
+                put16(ptr + 5, run.rec_count);
+                ptr += SUB_REQ_HEADER_SIZE;
+
+                if(t.type == WriteRecords){
+                    quint32 img_pos = t.page * page_size + run.rec_num * 2 - image_offset;
+
+                    ModbusRecordCodec::swap(ptr, plan_image.constData() + img_pos, run.rec_count);
+                    ptr += run.rec_count * 2;
+                }
+            }
+        }break;
+        }
+    }
+}
+
+ModbusTransferPlanner::Prediction ModbusTransferPlanner::predict() const
+{
+    Prediction pred;
+
+    qint64 duration = 0;
+
+    for(const Transaction& t: plan_transactions){
+        int req_size = requestSize(t);
+        int resp_size = responseSize(t);
+
+        qint64 latency = plan_timing.response_latency;
+
+        switch(t.type){
+        case SelectPage:
+            pred.selects ++;
+            break;
+        case ErasePage:
+            pred.erases ++;
+            latency += plan_timing.erase_latency;
+            break;
+        case WriteRecords:
+            pred.writes ++;
+            for(int i = t.first_run; i < t.first_run + t.runs_count; i ++){
+                pred.records += plan_runs.at(i).rec_count;
+                latency += static_cast<qint64>(plan_timing.program_latency) * plan_runs.at(i).rec_count;
+            }
+            break;
+        case ReadRecords:
+            pred.reads ++;
+            for(int i = t.first_run; i < t.first_run + t.runs_count; i ++){
+                pred.records += plan_runs.at(i).rec_count;
+            }
+            break;
+        }
+
+        pred.transactions ++;
+        pred.bytes_sent += req_size + ADU_OVERHEAD;
+        pred.bytes_received += resp_size + ADU_OVERHEAD;
+
+        duration += transactionTime(plan_timing, req_size, resp_size, latency);
+    }
+
+    pred.duration = duration / 1e9;
+
+    return pred;
+}
+
+QJsonObject ModbusTransferPlanner::toJson() const
+{
+    Prediction pred = predict();
+
+    QJsonObject obj;
+
+    obj[QStringLiteral("pages")] = page_ends.size();
+    obj[QStringLiteral("transactions")] = pred.transactions;
+    obj[QStringLiteral("selects")] = pred.selects;
+    obj[QStringLiteral("erases")] = pred.erases;
+    obj[QStringLiteral("writes")] = pred.writes;
+    obj[QStringLiteral("reads")] = pred.reads;
+    obj[QStringLiteral("records")] = static_cast<double>(pred.records);
+    obj[QStringLiteral("bytes_sent")] = static_cast<double>(pred.bytes_sent);
+    obj[QStringLiteral("bytes_received")] = static_cast<double>(pred.bytes_received);
+    obj[QStringLiteral("duration_s")] = pred.duration;
+
+    QJsonObject caps;
+    caps[QStringLiteral("max_pdu_size")] = plan_caps.max_pdu_size;
+    caps[QStringLiteral("multiple_sub_requests")] = plan_caps.multiple_sub_requests;
+    caps[QStringLiteral("skip_erased")] = plan_caps.skip_erased;
+    obj[QStringLiteral("capabilities")] = caps;
+
+    return obj;
+}
+
+int ModbusTransferPlanner::requestSize(const Transaction& t) const
+{
+    int size = FILE_PDU_HEADER_SIZE;
+
+    switch(t.type){
+    case SelectPage:
+    case ErasePage:
+        return SINGLE_WRITE_PDU_SIZE;
+    case WriteRecords:
+        for(int i = t.first_run; i < t.first_run + t.runs_count; i ++){
+            size += SUB_REQ_HEADER_SIZE + plan_runs.at(i).rec_count * 2;
+        }
+        break;
+    case ReadRecords:
+        size += SUB_REQ_HEADER_SIZE * t.runs_count;
+        break;
+    }
+
+    return size;
+}
+
+int ModbusTransferPlanner::responseSize(const Transaction& t) const
+{
+    int size = FILE_PDU_HEADER_SIZE;
+
+    switch(t.type){
+    case SelectPage:
+    case ErasePage:
+    case WriteRecords:
+        // Ответ повторяет запрос.
+        return requestSize(t);
+    case ReadRecords:
+        for(int i = t.first_run; i < t.first_run + t.runs_count; i ++){
+            size += SUB_RESP_HEADER_SIZE + plan_runs.at(i).rec_count * 2;
+        }
+        break;
+    }
+
+    return size;
+}
+
+qint64 ModbusTransferPlanner::transactionTime(const Timing& tm, int req_size, int resp_size, qint64 latency)
+{
+    // Qt SerialBus отводит на отправку запроса не менее interFrameDelay.
+    qint64 req_time = qMax<qint64>(frameTime(tm, req_size), tm.frame_delay * 1000LL);
+
+    return req_time + latency * 1000 + frameTime(tm, resp_size);
+}
+
+qint64 ModbusTransferPlanner::frameTime(const Timing& tm, int pdu_size)
+{
+    if(tm.baud == 0) return 0;
+
+    qint64 char_time = static_cast<qint64>(tm.char_bits) * 1000000000LL / tm.baud;
+
+    // Пауза 3.5 символа, не менее 1750 мкс.
+    qint64 t35 = qMax<qint64>(char_time * 7 / 2, 1750000LL);
+
+    return (pdu_size + ADU_OVERHEAD) * char_time + t35 + tm.turnaround * 1000LL;
+}
+
+void ModbusTransferPlanner::planPage(quint32 page, uint16_t rec_first, uint16_t rec_end, bool write)
+{
+    Transaction t;
+    t.page = page;
+    t.first_run = 0;
+    t.runs_count = 0;
+
+    t.type = SelectPage;
+    plan_transactions.append(t);
+
+    if(write){
+        t.type = ErasePage;
+        plan_transactions.append(t);
+    }
+
+    QVector<Run> page_runs;
+
+    if(write && plan_caps.skip_erased){
+        const uint8_t* img = reinterpret_cast<const uint8_t*>(plan_image.constData()) +
+                             page * page_size - image_offset;
+        const uint8_t erased = plan_caps.erased_value;
+
+        auto is_erased = [img, erased](uint16_t rec){
+            return img[rec * 2] == erased && img[rec * 2 + 1] == erased;
+        };
+
+        uint16_t rec = rec_first;
+
+        while(rec < rec_end){
+            while(rec < rec_end && is_erased(rec)) rec ++;
+            if(rec >= rec_end) break;
+
+            Run run;
+            run.rec_num = rec;
+
+            while(rec < rec_end && !is_erased(rec)) rec ++;
+
+            run.rec_count = rec - run.rec_num;
+            page_runs.append(run);
+        }
+    }else if(rec_end > rec_first){
+        Run run;
+        run.rec_num = rec_first;
+        run.rec_count = rec_end - rec_first;
+        page_runs.append(run);
+    }
+
+    addRuns(page, write ? WriteRecords : ReadRecords, page_runs);
+}
+
+void ModbusTransferPlanner::addRuns(quint32 page, Type type, const QVector<Run>& page_runs)
+{
+    // Заголовок подзапроса в запросе (запись) или в ответе (чтение).
+    const int sub_header = (type == WriteRecords) ? SUB_REQ_HEADER_SIZE : SUB_RESP_HEADER_SIZE;
+    const int budget = plan_caps.max_pdu_size - FILE_PDU_HEADER_SIZE;
+    const int max_recs = (budget - sub_header) / 2;
+
+    if(max_recs <= 0) return;
+
+    auto pdus = [max_recs](int recs){
+        return (recs + max_recs - 1) / max_recs;
+    };
+
+    // Объединение соседних участков, если это не увеличивает
+    // число обменов: с подзапросами - когда промежуток короче
+    // заголовка подзапроса, без них - когда уменьшается число PDU.
+    QVector<Run> merged;
+
+    for(const Run& run: page_runs){
+        if(!merged.isEmpty()){
+            Run& prev = merged.last();
+
+            int gap = run.rec_num - (prev.rec_num + prev.rec_count);
+            int joined = prev.rec_count + gap + run.rec_count;
+
+            bool merge = plan_caps.multiple_sub_requests ?
+                             (gap * 2 <= SUB_REQ_HEADER_SIZE && pdus(joined) <= pdus(prev.rec_count) + pdus(run.rec_count)) :
+                             (pdus(joined) < pdus(prev.rec_count) + pdus(run.rec_count));
+
+            if(merge){
+                prev.rec_count = joined;
+                continue;
+            }
+        }
+
+        merged.append(run);
+    }
+
+    Transaction t;
+    t.type = type;
+    t.page = page;
+    t.first_run = 0;
+    t.runs_count = 0;
+
+    if(!plan_caps.multiple_sub_requests){
+        for(const Run& run: merged){
+            for(int done = 0; done < run.rec_count; done += max_recs){
+                Run piece;
+                piece.rec_num = run.rec_num + done;
+                piece.rec_count = qMin(max_recs, run.rec_count - done);
+
+                t.first_run = plan_runs.size();
+                t.runs_count = 1;
+
+                plan_runs.append(piece);
+                plan_transactions.append(t);
+            }
+        }
+        return;
+    }
+
+    // Плотная упаковка участков в PDU по порядку.
+    int space = 0;
+    bool open = false;
+
+    for(const Run& run: merged){
+        int done = 0;
+
+        while(done < run.rec_count){
+            bool req_full = open && (type == ReadRecords) &&
+                            (plan_transactions.last().runs_count + 1) * SUB_REQ_HEADER_SIZE > budget;
+
+            if(!open || space < sub_header + 2 || req_full){
+                t.first_run = plan_runs.size();
+                t.runs_count = 0;
+                plan_transactions.append(t);
+
+                space = budget;
+                open = true;
+            }
+
+            Run piece;
+            piece.rec_num = run.rec_num + done;
+            piece.rec_count = qMin(run.rec_count - done, (space - sub_header) / 2);
+
+            plan_runs.append(piece);
+            plan_transactions.last().runs_count ++;
+
+            space -= sub_header + piece.rec_count * 2;
+            done += piece.rec_count;
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#ifndef MODBUSTRANSFERPLANNER_H
+#define MODBUSTRANSFERPLANNER_H
+
+#include <stdint.h>
+#include <QtGlobal>
+#include <QByteArray>
+#include <QVector>
+#include <QJsonObject>
+
+class ModbusPduArena;
+
+
+/*
+ * Планировщик передачи образа через загрузчик:
+ * по образу, размеру страницы, пределу PDU и возможностям устройства
+ * строит последовательность транзакций выбора страницы, стирания
+ * и передачи записей с минимальным числом обменов.
+ * План можно закодировать в арену PDU или только оценить
+ * число транзакций и длительность (пробный прогон).
+ */
+class ModbusTransferPlanner
+{
+public:
+
+    // Возможности устройства.
+    struct Capabilities {
+        Capabilities();
+
+        int max_pdu_size;
+        // Несколько подзапросов в одном запросе чтения/записи файла.
+        bool multiple_sub_requests;
+        // Записи, совпадающие со стёртой памятью, после стирания не передаются.
+        bool skip_erased;
+        uint8_t erased_value;
+    };
+
+    // Модель линии и устройства для оценки длительности,
+    // та же, что у ModbusVirtualTransport и ModbusBootSim.
+    struct Timing {
+        Timing();
+
+        quint32 baud;
+        quint32 char_bits;
+        quint32 turnaround; // мкс.
+        quint32 frame_delay; // мкс, минимальное время передачи запроса.
+        quint32 response_latency; // мкс.
+        quint32 erase_latency; // мкс.
+        quint32 program_latency; // мкс на запись.
+    };
+
+    enum Type {
+        SelectPage = 0,
+        ErasePage,
+        WriteRecords,
+        ReadRecords
+    };
+
+    // Непрерывный участок записей страницы.
+    struct Run {
+        uint16_t rec_num;
+        uint16_t rec_count;
+    };
+
+    struct Transaction {
+        Type type;
+        quint32 page;
+        int first_run;
+        int runs_count;
+    };
+
+    struct Prediction {
+        Prediction();
+
+        int transactions;
+        int selects;
+        int erases;
+        int writes;
+        int reads;
+        quint64 records;
+        quint64 bytes_sent;
+        quint64 bytes_received;
+        double duration; // с.
+    };
+
+    ModbusTransferPlanner();
+    ~ModbusTransferPlanner();
+
+    const Capabilities& capabilities() const;
+    void setCapabilities(const Capabilities& caps);
+
+    const Timing& timing() const;
+    void setTiming(const Timing& tm);
+
+    quint32 pageSize() const;
+    void setPageSize(quint32 size);
+
+    uint16_t fileNumber() const;
+    void setFileNumber(uint16_t file_num);
+
+    void clear();
+
+    // offset - смещение от начала FLASH.
+    // page_mask - страницы образа для записи по порядку, пусто - все;
+    // пропущенные страницы остаются в pageEnds().
+    bool planWrite(quint32 offset, const QByteArray& image, const QVector<bool>& page_mask = QVector<bool>());
+    bool planRead(quint32 offset, quint32 size);
+
+    const QVector<Transaction>& transactions() const;
+    const QVector<Run>& runs() const;
+
+    // Индексы последних транзакций каждой страницы,
+    // у пропущенной - предыдущей страницы (-1 - нет такой).
+    const QVector<int>& pageEnds() const;
+
+    void encode(ModbusPduArena* arena) const;
+
+    Prediction predict() const;
+    QJsonObject toJson() const;
+
+    // Длительность транзакции по модели линии, нс.
+    // latency - время обработки запроса устройством, мкс.
+    static qint64 transactionTime(const Timing& tm, int req_size, int resp_size, qint64 latency);
+
+private:
+    // Размеры PDU транзакции с кодом функции.
+    int requestSize(const Transaction& t) const;
+    int responseSize(const Transaction& t) const;
+
+    static qint64 frameTime(const Timing& tm, int pdu_size);
+
+    void planPage(quint32 page, uint16_t rec_first, uint16_t rec_end, bool write);
+    void addRuns(quint32 page, Type type, const QVector<Run>& page_runs);
+
+    Capabilities plan_caps;
+    Timing plan_timing;
+    quint32 page_size;
+    uint16_t file_number;
+
+    // Образ, выровненный по записям и дополненный стёртыми байтами.
+    QByteArray plan_image;
+    quint32 image_offset;
+
+    QVector<Transaction> plan_transactions;
+    QVector<Run> plan_runs;
+    QVector<int> page_ends;
+};
+
+#endif // MODBUSTRANSFERPLANNER_H
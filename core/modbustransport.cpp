@@ -0,0 +1,345 @@
+#include "modbustransport.h"
+#include <QDataStream>
+#include <QByteArray>
+#include <QVector>
+#include <QDebug>
+
+
+ModbusTransport::ModbusTransport(QObject *parent) : QObject(parent)
+{
+    transport_timer.start();
+}
+
+ModbusTransport::~ModbusTransport()
+{
+}
+
+void ModbusTransport::setInterFrameDelay(int usecs)
+{
+    Q_UNUSED(usecs);
+}
+
+void ModbusTransport::setTimeout(int msecs)
+{
+    Q_UNUSED(msecs);
+}
+
+void ModbusTransport::setNumberOfRetries(int retries)
+{
+    Q_UNUSED(retries);
+}
+
+bool ModbusTransport::setBaud(quint32 baud)
+{
+    Q_UNUSED(baud);
+
+    return false;
+}
+
+qint64 ModbusTransport::timestamp() const
+{
+    return transport_timer.nsecsElapsed();
+}
+
+QString ModbusTransport::linkName() const
+{
+    return QString();
+}
+
+QModbusRequest ModbusTransport::readRequest(const QModbusDataUnit& du)
+{
+    QModbusPdu::FunctionCode func;
+
+    switch(du.registerType()){
+    default:
+        return QModbusRequest();
+    case QModbusDataUnit::Coils:
+        func = QModbusPdu::ReadCoils;
+        break;
+    case QModbusDataUnit::DiscreteInputs:
+        func = QModbusPdu::ReadDiscreteInputs;
+        break;
+    case QModbusDataUnit::HoldingRegisters:
+        func = QModbusPdu::ReadHoldingRegisters;
+        break;
+    case QModbusDataUnit::InputRegisters:
+        func = QModbusPdu::ReadInputRegisters;
+        break;
+    }
+
+    QByteArray data;
+
+    QDataStream ds(&data, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    ds << static_cast<quint16>(du.startAddress()) << static_cast<quint16>(du.valueCount());
+
+    return QModbusRequest(func, data);
+}
+
+QModbusRequest ModbusTransport::writeRequest(const QModbusDataUnit& du)
+{
+    QByteArray data;
+
+    QDataStream ds(&data, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint16 addr = static_cast<quint16>(du.startAddress());
+    quint16 count = static_cast<quint16>(du.valueCount());
+
+    if(count == 0) return QModbusRequest();
+
+    switch(du.registerType()){
+    default:
+        break;
+    case QModbusDataUnit::Coils:
+        if(count == 1){
+            ds << addr << static_cast<quint16>(du.value(0) ? 0xff00 : 0x0000);
+            return QModbusRequest(QModbusPdu::WriteSingleCoil, data);
+        }else{
+            quint8 bytes = static_cast<quint8>((count + 7) / 8);
+            ds << addr << count << bytes;
+            for(quint8 b = 0; b < bytes; b ++){
+                quint8 byte = 0;
+                for(int bit = 0; bit < 8; bit ++){
+                    int i = b * 8 + bit;
+                    if(i < count && du.value(i)) byte |= (1 << bit);
+                }
+                ds << byte;
+            }
+            return QModbusRequest(QModbusPdu::WriteMultipleCoils, data);
+        }
+    case QModbusDataUnit::HoldingRegisters:
+        if(count == 1){
+            ds << addr << du.value(0);
+            return QModbusRequest(QModbusPdu::WriteSingleRegister, data);
+        }else{
+            ds << addr << count << static_cast<quint8>(count * sizeof(quint16));
+            for(int i = 0; i < count; i ++){
+                ds << du.value(i);
+            }
+            return QModbusRequest(QModbusPdu::WriteMultipleRegisters, data);
+        }
+    }
+
+    return QModbusRequest();
+}
+
+bool ModbusTransport::readResult(const QModbusResponse& resp, QModbusDataUnit* du)
+{
+    if(!resp.isValid() || resp.isException()) return false;
+
+    QByteArray data = resp.data();
+
+    QDataStream ds(data);
+    ds.setByteOrder(QDataStream::BigEndian);
+
+    quint8 bytes = 0;
+    uint count = du->valueCount();
+    QVector<quint16> values(static_cast<int>(count));
+
+    switch(resp.functionCode()){
+    default:
+        return false;
+    case QModbusPdu::ReadCoils:
+    case QModbusPdu::ReadDiscreteInputs:
+        ds >> bytes;
+        if(bytes != (count + 7) / 8 || data.size() != bytes + 1) return false;
+        for(uint i = 0; i < count; i ++){
+            quint8 byte = static_cast<quint8>(data.at(1 + i / 8));
+            values[i] = (byte >> (i % 8)) & 0x1;
+        }
+        break;
+    case QModbusPdu::ReadHoldingRegisters:
+    case QModbusPdu::ReadInputRegisters:
+        ds >> bytes;
+        if(bytes != count * sizeof(quint16) || data.size() != bytes + 1) return false;
+        for(uint i = 0; i < count; i ++){
+            ds >> values[i];
+        }
+        break;
+    case QModbusPdu::WriteSingleCoil:
+    case QModbusPdu::WriteSingleRegister:
+    case QModbusPdu::WriteMultipleCoils:
+    case QModbusPdu::WriteMultipleRegisters:
+        // Ответ на запись повторяет запрос.
+        return true;
+    }
+
+    du->setValues(values);
+
+    return true;
+}
+
+
+ModbusPduTransport::ModbusPduTransport(QObject *parent) : ModbusTransport(parent)
+{
+    pdu_state = QModbusDevice::UnconnectedState;
+    req_queue = new RequestQueue();
+}
+
+ModbusPduTransport::~ModbusPduTransport()
+{
+    delete req_queue;
+}
+
+bool ModbusPduTransport::connectDevice()
+{
+    if(pdu_state != QModbusDevice::UnconnectedState) return false;
+
+    setState(QModbusDevice::ConnectingState);
+    setState(QModbusDevice::ConnectedState);
+
+    return true;
+}
+
+void ModbusPduTransport::disconnectDevice()
+{
+    if(pdu_state == QModbusDevice::UnconnectedState) return;
+
+    setState(QModbusDevice::ClosingState);
+
+    while(!req_queue->empty()){
+        PendingRequest req = req_queue->takeFirst();
+        if(req.reply){
+            req.reply->setError(QModbusDevice::ReplyAbortedError, tr("Device disconnected."));
+        }
+    }
+
+    setState(QModbusDevice::UnconnectedState);
+}
+
+QModbusDevice::State ModbusPduTransport::state() const
+{
+    return pdu_state;
+}
+
+QString ModbusPduTransport::errorString() const
+{
+    return pdu_error_str;
+}
+
+QModbusReply* ModbusPduTransport::sendRawRequest(const QModbusRequest& req, int slaveAddr)
+{
+    return enqueueRequest(req, slaveAddr, QModbusReply::Raw, QModbusDataUnit());
+}
+
+QModbusReply* ModbusPduTransport::sendReadRequest(const QModbusDataUnit& du, int slaveAddr)
+{
+    return enqueueRequest(readRequest(du), slaveAddr, QModbusReply::Common, du);
+}
+
+QModbusReply* ModbusPduTransport::sendWriteRequest(const QModbusDataUnit& du, int slaveAddr)
+{
+    return enqueueRequest(writeRequest(du), slaveAddr, QModbusReply::Common, du);
+}
+
+void ModbusPduTransport::finishRequest(const QModbusResponse& resp)
+{
+    if(req_queue->empty()){
+        qDebug() << "ModbusPduTransport: finishRequest with empty queue!";
+        return;
+    }
+
+    // Запрос остаётся в очереди до завершения ответа,
+    // чтобы новые запросы из обработчиков ответа
+    // не начали обрабатываться раньше времени.
+    PendingRequest& req = req_queue->first();
+    QModbusReply* reply = req.reply;
+
+    if(reply){
+        reply->setRawResult(resp);
+
+        if(resp.isException()){
+            reply->setError(QModbusDevice::ProtocolError,
+                            tr("Modbus exception: 0x%1").arg(static_cast<int>(resp.exceptionCode()), 2, 16, QLatin1Char('0')));
+        }else if(reply->type() == QModbusReply::Common){
+            QModbusDataUnit du = req.unit;
+            if(readResult(resp, &du)){
+                reply->setResult(du);
+                reply->setFinished(true);
+            }else{
+                reply->setError(QModbusDevice::UnknownError, tr("Invalid response."));
+            }
+        }else{
+            reply->setFinished(true);
+        }
+    }
+
+    req_queue->removeFirst();
+
+    processNextRequest();
+}
+
+void ModbusPduTransport::failRequest(QModbusDevice::Error err, const QString& err_str)
+{
+    if(req_queue->empty()){
+        qDebug() << "ModbusPduTransport: failRequest with empty queue!";
+        return;
+    }
+
+    QModbusReply* reply = req_queue->first().reply;
+
+    if(reply){
+        reply->setError(err, err_str);
+    }
+
+    req_queue->removeFirst();
+
+    processNextRequest();
+}
+
+void ModbusPduTransport::setError(QModbusDevice::Error err, const QString& err_str)
+{
+    pdu_error_str = err_str;
+
+    emit errorOccurred(err);
+}
+
+void ModbusPduTransport::setState(QModbusDevice::State st)
+{
+    if(pdu_state == st) return;
+
+    pdu_state = st;
+
+    emit stateChanged(st);
+}
+
+QModbusReply* ModbusPduTransport::enqueueRequest(const QModbusRequest& req, int slaveAddr,
+                                                 QModbusReply::ReplyType type, const QModbusDataUnit& du)
+{
+    if(pdu_state != QModbusDevice::ConnectedState){
+        setError(QModbusDevice::ConnectionError, tr("Device not connected."));
+        return nullptr;
+    }
+
+    if(!req.isValid()){
+        setError(QModbusDevice::ProtocolError, tr("Invalid Modbus request."));
+        return nullptr;
+    }
+
+    QModbusReply* reply = new QModbusReply(type, slaveAddr, this);
+
+    PendingRequest pending;
+    pending.reply = reply;
+    pending.request = req;
+    pending.unit = du;
+    pending.slave_addr = slaveAddr;
+
+    bool need_process = req_queue->empty();
+
+    req_queue->append(pending);
+
+    if(need_process) processNextRequest();
+
+    return reply;
+}
+
+void ModbusPduTransport::processNextRequest()
+{
+    if(req_queue->empty()) return;
+
+    const PendingRequest& req = req_queue->first();
+
+    processRequest(req.request, req.slave_addr);
+}
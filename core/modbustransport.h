@@ -0,0 +1,121 @@
+#ifndef MODBUSTRANSPORT_H
+#define MODBUSTRANSPORT_H
+
+#include <QObject>
+#include <QModbusDevice>
+#include <QModbusReply>
+#include <QModbusRequest>
+#include <QModbusResponse>
+#include <QModbusDataUnit>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QQueue>
+#include <QString>
+
+
+/*
+ * Транспорт сети Modbus.
+ * Отделяет ModbusNet от конкретного QModbusClient,
+ * что позволяет подменять последовательный порт
+ * воспроизведением записи или симулятором.
+ */
+class ModbusTransport : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ModbusTransport(QObject *parent = 0);
+    virtual ~ModbusTransport();
+
+    virtual bool connectDevice() = 0;
+    virtual void disconnectDevice() = 0;
+
+    virtual QModbusDevice::State state() const = 0;
+    virtual QString errorString() const = 0;
+
+    // Задержка между кадрами, мкс.
+    virtual void setInterFrameDelay(int usecs);
+
+    // Время ожидания ответа, мс, и число повторов.
+    virtual void setTimeout(int msecs);
+    virtual void setNumberOfRetries(int retries);
+
+    // Смена скорости обмена без разъединения.
+    // Возвращает ложь, если транспорт этого не поддерживает.
+    virtual bool setBaud(quint32 baud);
+
+    // Монотонное время транспорта, нс.
+    virtual qint64 timestamp() const;
+
+    // Имя линии (порта) для ключей кэшей, пустое - линия безымянная.
+    virtual QString linkName() const;
+
+    virtual QModbusReply* sendRawRequest(const QModbusRequest& req, int slaveAddr) = 0;
+    virtual QModbusReply* sendReadRequest(const QModbusDataUnit& du, int slaveAddr) = 0;
+    virtual QModbusReply* sendWriteRequest(const QModbusDataUnit& du, int slaveAddr) = 0;
+
+    // Преобразование единиц данных в PDU и обратно,
+    // так же, как это делает QModbusClient.
+    static QModbusRequest readRequest(const QModbusDataUnit& du);
+    static QModbusRequest writeRequest(const QModbusDataUnit& du);
+    static bool readResult(const QModbusResponse& resp, QModbusDataUnit* du);
+
+signals:
+    void stateChanged(QModbusDevice::State state);
+    void errorOccurred(QModbusDevice::Error error);
+
+private:
+    QElapsedTimer transport_timer;
+};
+
+
+/*
+ * Транспорт, обрабатывающий запросы на уровне PDU
+ * внутри процесса. Запросы обрабатываются строго по одному,
+ * как на шине. Наследник получает запрос в processRequest()
+ * и завершает его асинхронно вызовом finishRequest() или failRequest().
+ */
+class ModbusPduTransport : public ModbusTransport
+{
+    Q_OBJECT
+public:
+    explicit ModbusPduTransport(QObject *parent = 0);
+    ~ModbusPduTransport();
+
+    bool connectDevice();
+    void disconnectDevice();
+
+    QModbusDevice::State state() const;
+    QString errorString() const;
+
+    QModbusReply* sendRawRequest(const QModbusRequest& req, int slaveAddr);
+    QModbusReply* sendReadRequest(const QModbusDataUnit& du, int slaveAddr);
+    QModbusReply* sendWriteRequest(const QModbusDataUnit& du, int slaveAddr);
+
+protected:
+    virtual void processRequest(const QModbusRequest& req, int slaveAddr) = 0;
+
+    void finishRequest(const QModbusResponse& resp);
+    void failRequest(QModbusDevice::Error err, const QString& err_str);
+
+    void setError(QModbusDevice::Error err, const QString& err_str);
+    void setState(QModbusDevice::State st);
+
+private:
+    struct PendingRequest {
+        QPointer<QModbusReply> reply;
+        QModbusRequest request;
+        QModbusDataUnit unit;
+        int slave_addr;
+    };
+    typedef QQueue<PendingRequest> RequestQueue;
+
+    QModbusDevice::State pdu_state;
+    QString pdu_error_str;
+    RequestQueue* req_queue;
+
+    QModbusReply* enqueueRequest(const QModbusRequest& req, int slaveAddr,
+                                 QModbusReply::ReplyType type, const QModbusDataUnit& du);
+    void processNextRequest();
+};
+
+#endif // MODBUSTRANSPORT_H
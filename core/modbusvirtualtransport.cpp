@@ -0,0 +1,149 @@
+#include "modbusvirtualtransport.h"
+#include "modbusbootsim.h"
+#include <QTimer>
+#include <math.h>
+
+
+// Адрес(1) + CRC(2).
+#define ADU_OVERHEAD 3
+
+
+ModbusVirtualTransport::Link::Link()
+{
+    baud = 9600;
+    char_bits = 11;
+    turnaround = 1000;
+    timeout = 500;
+    retries = 3;
+}
+
+ModbusVirtualTransport::ModbusVirtualTransport(QObject *parent) : ModbusPduTransport(parent)
+{
+    virtual_time = 0;
+    frames_count = 0;
+    timeouts_count = 0;
+    pending_answer = false;
+}
+
+ModbusVirtualTransport::~ModbusVirtualTransport()
+{
+}
+
+const ModbusVirtualTransport::Link& ModbusVirtualTransport::link() const
+{
+    return vt_link;
+}
+
+void ModbusVirtualTransport::setLink(const Link& lnk)
+{
+    vt_link = lnk;
+}
+
+bool ModbusVirtualTransport::setBaud(quint32 baud)
+{
+    if(baud == 0) return false;
+
+    vt_link.baud = baud;
+
+    return true;
+}
+
+void ModbusVirtualTransport::setTimeout(int msecs)
+{
+    vt_link.timeout = static_cast<quint32>(qMax(msecs, 0));
+}
+
+void ModbusVirtualTransport::setNumberOfRetries(int retries)
+{
+    vt_link.retries = qMax(retries, 0);
+}
+
+void ModbusVirtualTransport::addDevice(ModbusBootSim* sim)
+{
+    devices.insert(sim->slaveAddress(), sim);
+}
+
+void ModbusVirtualTransport::removeDevice(ModbusBootSim* sim)
+{
+    devices.remove(sim->slaveAddress());
+}
+
+ModbusBootSim* ModbusVirtualTransport::device(int slaveAddr) const
+{
+    return devices.value(slaveAddr, nullptr);
+}
+
+qint64 ModbusVirtualTransport::frameTime(int pdu_size) const
+{
+    qint64 char_time = static_cast<qint64>(vt_link.char_bits) * 1000000000LL / vt_link.baud;
+
+    // Пауза 3.5 символа, не менее 1750 мкс.
+    qint64 t35 = qMax<qint64>(char_time * 7 / 2, 1750000LL);
+
+    return (pdu_size + ADU_OVERHEAD) * char_time + t35 + vt_link.turnaround * 1000LL;
+}
+
+qint64 ModbusVirtualTransport::timestamp() const
+{
+    return virtual_time;
+}
+
+void ModbusVirtualTransport::advance(qint64 ns)
+{
+    virtual_time += ns;
+}
+
+quint32 ModbusVirtualTransport::framesCount() const
+{
+    return frames_count;
+}
+
+quint32 ModbusVirtualTransport::timeoutsCount() const
+{
+    return timeouts_count;
+}
+
+void ModbusVirtualTransport::processRequest(const QModbusRequest& req, int slaveAddr)
+{
+    ModbusBootSim* sim = device(slaveAddr);
+
+    pending_answer = false;
+
+    for(int attempt = 0; attempt <= vt_link.retries; attempt ++){
+
+        virtual_time += frameTime(req.size());
+        frames_count ++;
+
+        quint32 latency = 0;
+
+        if(sim) sim->setTime(static_cast<quint64>(virtual_time / 1000));
+
+        // На другой скорости устройство кадр не примет.
+        if(sim && sim->baud() == vt_link.baud && sim->process(req, &pending_resp, &latency)){
+            virtual_time += static_cast<qint64>(latency) * 1000;
+            virtual_time += frameTime(pending_resp.size());
+            frames_count ++;
+
+            pending_answer = true;
+            break;
+        }
+
+        // Ответа нет - ожидание таймаута.
+        virtual_time += static_cast<qint64>(vt_link.timeout) * 1000000;
+        timeouts_count ++;
+    }
+
+    // Завершение через цикл событий, без рекурсии
+    // и без ожидания реального времени.
+    QTimer::singleShot(0, this, &ModbusVirtualTransport::completeRequest);
+}
+
+void ModbusVirtualTransport::completeRequest()
+{
+    if(pending_answer){
+        pending_answer = false;
+        finishRequest(pending_resp);
+    }else{
+        failRequest(QModbusDevice::TimeoutError, tr("Request timeout."));
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef MODBUSVIRTUALTRANSPORT_H
+#define MODBUSVIRTUALTRANSPORT_H
+
+#include "modbustransport.h"
+#include <QMap>
+
+class ModbusBootSim;
+
+
+/*
+ * Транспорт внутри процесса с виртуальным временем.
+ * Запросы обслуживаются моделями загрузчика (ModbusBootSim),
+ * время передачи кадров по линии, задержки устройства,
+ * таймауты и повторы учитываются в виртуальных часах,
+ * поэтому сеанс выполняется быстрее реального времени.
+ */
+class ModbusVirtualTransport : public ModbusPduTransport
+{
+    Q_OBJECT
+public:
+
+    struct Link {
+        Link();
+
+        quint32 baud;
+        quint32 char_bits; // Старт + 8 бит + чётность/стоп + стоп.
+        quint32 turnaround; // мкс, задержка адаптера и хоста на каждый кадр.
+        quint32 timeout; // мс.
+        int retries;
+    };
+
+    explicit ModbusVirtualTransport(QObject *parent = 0);
+    ~ModbusVirtualTransport();
+
+    const Link& link() const;
+    void setLink(const Link& lnk);
+    bool setBaud(quint32 baud);
+
+    void setTimeout(int msecs);
+    void setNumberOfRetries(int retries);
+
+    // Устройства не принадлежат транспорту.
+    void addDevice(ModbusBootSim* sim);
+    void removeDevice(ModbusBootSim* sim);
+    ModbusBootSim* device(int slaveAddr) const;
+
+    // Время кадра заданного размера PDU, нс.
+    qint64 frameTime(int pdu_size) const;
+
+    qint64 timestamp() const;
+    void advance(qint64 ns);
+
+    quint32 framesCount() const;
+    quint32 timeoutsCount() const;
+
+protected:
+    void processRequest(const QModbusRequest& req, int slaveAddr);
+
+private slots:
+    void completeRequest();
+
+private:
+    Link vt_link;
+    QMap<int, ModbusBootSim*> devices;
+
+    qint64 virtual_time;
+    quint32 frames_count;
+    quint32 timeouts_count;
+
+    bool pending_answer;
+    QModbusResponse pending_resp;
+};
+
+#endif // MODBUSVIRTUALTRANSPORT_H
@@ -0,0 +1,234 @@
+#include "settings.h"
+#include <QSettings>
+#include <QSerialPortInfo>
+
+
+#define S(str) QStringLiteral(str)
+
+#define SERIAL_NAME S("serial_name")
+#define SERIAL_BAUD S("serial_baud")
+#define SERIAL_PARITY S("serial_parity")
+#define SERIAL_STOPBITS S("serial_stopbits")
+#define SERIAL_LOW_LATENCY S("serial_low_latency")
+#define SERIAL_LATENCY_TIMER S("serial_latency_timer")
+#define SERIAL_RS485 S("serial_rs485")
+#define SERIAL_FLASH_BAUD S("serial_flash_baud")
+
+#define MODBUS_SLAVE S("modbus_slave")
+#define MODBUS_TIMEOUT S("modbus_timeout")
+#define MODBUS_FRAME_DELAY S("modbus_frame_delay")
+#define MODBUS_RETRIES S("modbus_retries")
+
+#define LINK_TUNING S("link_tuning")
+#define LINK_BAUD S("baud")
+#define LINK_TIMEOUT S("timeout")
+#define LINK_FRAME_DELAY S("frame_delay")
+#define LINK_RETRIES S("retries")
+
+
+Settings::LinkTuning::LinkTuning()
+{
+    baud = 0;
+    timeout = 0;
+    frame_delay = 0;
+    retries = 0;
+}
+
+
+Settings::Settings(QObject *parent) : QObject(parent)
+{
+}
+
+Settings &Settings::get()
+{
+    static Settings settings;
+
+    return settings;
+}
+
+Settings::~Settings()
+{
+}
+
+void Settings::read()
+{
+    QSettings settings;
+
+    QString defSerialName;
+
+    auto portsInfo = QSerialPortInfo::availablePorts();
+    if(!portsInfo.empty()) defSerialName = portsInfo.first().portName();
+
+    m_serial_name = settings.value(SERIAL_NAME, defSerialName).toString();
+    m_serial_baud = settings.value(SERIAL_BAUD, 9600).toUInt();
+    m_serial_parity = static_cast<QSerialPort::Parity>(settings.value(SERIAL_PARITY, 0).toUInt());
+    m_serial_stopbits = static_cast<QSerialPort::StopBits>(settings.value(SERIAL_STOPBITS, 0).toUInt());
+    m_serial_low_latency = settings.value(SERIAL_LOW_LATENCY, false).toBool();
+    m_serial_latency_timer = settings.value(SERIAL_LATENCY_TIMER, 1).toUInt();
+    m_serial_rs485 = settings.value(SERIAL_RS485, false).toBool();
+    m_serial_flash_baud = settings.value(SERIAL_FLASH_BAUD, 0).toUInt();
+
+    m_modbus_slave = settings.value(MODBUS_SLAVE, 1).toUInt();
+    m_modbus_timeout = settings.value(MODBUS_TIMEOUT, 500).toUInt();
+    m_modbus_frame_delay = settings.value(MODBUS_FRAME_DELAY, 10000000).toUInt();
+    m_modbus_retries = settings.value(MODBUS_RETRIES, 10).toUInt();
+
+    m_link_tuning.clear();
+
+    // Имена портов могут содержать '/', поэтому хранятся массивом.
+    int count = settings.beginReadArray(LINK_TUNING);
+    for(int i = 0; i < count; i ++){
+        settings.setArrayIndex(i);
+
+        LinkTuning tuning;
+        tuning.baud = settings.value(LINK_BAUD).toUInt();
+        tuning.timeout = settings.value(LINK_TIMEOUT).toUInt();
+        tuning.frame_delay = settings.value(LINK_FRAME_DELAY).toUInt();
+        tuning.retries = settings.value(LINK_RETRIES).toUInt();
+
+        m_link_tuning.insert(settings.value(SERIAL_NAME).toString(), tuning);
+    }
+    settings.endArray();
+}
+
+void Settings::write()
+{
+    QSettings settings;
+
+    settings.clear();
+
+    settings.setValue(SERIAL_NAME, m_serial_name);
+    settings.setValue(SERIAL_BAUD, m_serial_baud);
+    settings.setValue(SERIAL_PARITY, static_cast<quint32>(m_serial_parity));
+    settings.setValue(SERIAL_STOPBITS, static_cast<quint32>(m_serial_stopbits));
+    settings.setValue(SERIAL_LOW_LATENCY, m_serial_low_latency);
+    settings.setValue(SERIAL_LATENCY_TIMER, m_serial_latency_timer);
+    settings.setValue(SERIAL_RS485, m_serial_rs485);
+    settings.setValue(SERIAL_FLASH_BAUD, m_serial_flash_baud);
+
+    settings.setValue(MODBUS_SLAVE, m_modbus_slave);
+    settings.setValue(MODBUS_TIMEOUT, m_modbus_timeout);
+    settings.setValue(MODBUS_FRAME_DELAY, m_modbus_frame_delay);
+    settings.setValue(MODBUS_RETRIES, m_modbus_retries);
+
+    settings.beginWriteArray(LINK_TUNING, m_link_tuning.size());
+    int i = 0;
+    for(auto it = m_link_tuning.constBegin(); it != m_link_tuning.constEnd(); ++ it, i ++){
+        settings.setArrayIndex(i);
+
+        settings.setValue(SERIAL_NAME, it.key());
+        settings.setValue(LINK_BAUD, it.value().baud);
+        settings.setValue(LINK_TIMEOUT, it.value().timeout);
+        settings.setValue(LINK_FRAME_DELAY, it.value().frame_delay);
+        settings.setValue(LINK_RETRIES, it.value().retries);
+    }
+    settings.endArray();
+}
+
+bool Settings::linkTuning(const QString& port, LinkTuning* tuning) const
+{
+    auto it = m_link_tuning.constFind(port);
+    if(it == m_link_tuning.constEnd()) return false;
+
+    if(tuning) *tuning = it.value();
+
+    return true;
+}
+
+void Settings::setLinkTuning(const QString& port, const LinkTuning& tuning)
+{
+    m_link_tuning.insert(port, tuning);
+}
+
+void Settings::removeLinkTuning(const QString& port)
+{
+    m_link_tuning.remove(port);
+}
+
+quint32 Settings::linkTimeout() const
+{
+    const LinkTuning* tuning = currentLinkTuning();
+    return tuning ? tuning->timeout : m_modbus_timeout;
+}
+
+quint32 Settings::linkFrameDelay() const
+{
+    const LinkTuning* tuning = currentLinkTuning();
+    return tuning ? tuning->frame_delay : m_modbus_frame_delay;
+}
+
+quint32 Settings::linkRetries() const
+{
+    const LinkTuning* tuning = currentLinkTuning();
+    return tuning ? tuning->retries : m_modbus_retries;
+}
+
+const Settings::LinkTuning* Settings::currentLinkTuning() const
+{
+    auto it = m_link_tuning.constFind(m_serial_name);
+    if(it == m_link_tuning.constEnd()) return nullptr;
+
+    if(it.value().baud != m_serial_baud) return nullptr;
+
+    return &it.value();
+}
+
+void Settings::setSerialPortName(const QString &val)
+{
+    m_serial_name = val;
+}
+
+void Settings::setSerialPortBaud(quint32 val)
+{
+    m_serial_baud = val;
+}
+
+void Settings::setSerialPortParity(QSerialPort::Parity val)
+{
+    m_serial_parity = val;
+}
+
+void Settings::setSerialPortStopBits(QSerialPort::StopBits val)
+{
+    m_serial_stopbits = val;
+}
+
+void Settings::setSerialLowLatency(bool val)
+{
+    m_serial_low_latency = val;
+}
+
+void Settings::setSerialLatencyTimer(quint32 val)
+{
+    m_serial_latency_timer = val;
+}
+
+void Settings::setSerialRs485(bool val)
+{
+    m_serial_rs485 = val;
+}
+
+void Settings::setSerialFlashBaud(quint32 val)
+{
+    m_serial_flash_baud = val;
+}
+
+void Settings::setModbusSlaveAddress(quint32 val)
+{
+    m_modbus_slave = val;
+}
+
+void Settings::setModbusTimeout(quint32 val)
+{
+    m_modbus_timeout = val;
+}
+
+void Settings::setModbusFrameDelay(quint32 val)
+{
+    m_modbus_frame_delay = val;
+}
+
+void Settings::setModbusRetries(quint32 val)
+{
+    m_modbus_retries = val;
+}
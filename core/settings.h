@@ -0,0 +1,102 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QString>
+#include <QMap>
+
+
+class Settings : public QObject
+{
+    Q_OBJECT
+public:
+
+    // Параметры связи, подобранные проверкой линии.
+    struct LinkTuning {
+        LinkTuning();
+
+        quint32 baud; // Скорость, на которой выполнена проверка.
+        quint32 timeout;
+        quint32 frame_delay;
+        quint32 retries;
+    };
+
+    static Settings& get();
+    ~Settings();
+
+    void read();
+    void write();
+
+    // Порт.
+    const QString& serialPortName()            const { return m_serial_name; }
+    quint32 serailPortBaud()                   const { return m_serial_baud; }
+    QSerialPort::Parity serialPortParity()     const { return m_serial_parity; }
+    QSerialPort::StopBits serialPortStopBits() const { return m_serial_stopbits; }
+    // Linux: режим низкой задержки, таймер задержки адаптера, мс, RS-485.
+    bool serialLowLatency()                    const { return m_serial_low_latency; }
+    quint32 serialLatencyTimer()               const { return m_serial_latency_timer; }
+    bool serialRs485()                         const { return m_serial_rs485; }
+    // Скорость, согласуемая с загрузчиком после чтения конфигурации, 0 - не согласовывать.
+    quint32 serialFlashBaud()                  const { return m_serial_flash_baud; }
+
+    // Протокол.
+    quint32 modbusSlaveAddress() const { return m_modbus_slave; }
+    quint32 modbusTimeout()      const { return m_modbus_timeout; }
+    quint32 modbusFrameDelay()   const { return m_modbus_frame_delay; }
+    quint32 modbusRetries()      const { return m_modbus_retries; }
+
+    // Подобранные параметры по имени порта.
+    bool linkTuning(const QString& port, LinkTuning* tuning) const;
+    void setLinkTuning(const QString& port, const LinkTuning& tuning);
+    void removeLinkTuning(const QString& port);
+
+    // Параметры связи текущего порта: подобранные,
+    // если проверка выполнялась на текущей скорости, иначе заданные.
+    quint32 linkTimeout()    const;
+    quint32 linkFrameDelay() const;
+    quint32 linkRetries()    const;
+
+public slots:
+    // Порт.
+    void setSerialPortName(const QString& val);
+    void setSerialPortBaud(quint32 val);
+    void setSerialPortParity(QSerialPort::Parity val);
+    void setSerialPortStopBits(QSerialPort::StopBits val);
+    void setSerialLowLatency(bool val);
+    void setSerialLatencyTimer(quint32 val);
+    void setSerialRs485(bool val);
+    void setSerialFlashBaud(quint32 val);
+
+    // Протокол.
+    void setModbusSlaveAddress(quint32 val);
+    void setModbusTimeout(quint32 val);
+    void setModbusFrameDelay(quint32 val);
+    void setModbusRetries(quint32 val);
+
+signals:
+
+private:
+    explicit Settings(QObject *parent = 0);
+
+    // Порт.
+    QString m_serial_name;
+    quint32 m_serial_baud;
+    QSerialPort::Parity m_serial_parity;
+    QSerialPort::StopBits m_serial_stopbits;
+    bool m_serial_low_latency;
+    quint32 m_serial_latency_timer;
+    bool m_serial_rs485;
+    quint32 m_serial_flash_baud;
+    // Протокол.
+    quint32 m_modbus_slave;
+    quint32 m_modbus_timeout;
+    quint32 m_modbus_frame_delay;
+    quint32 m_modbus_retries;
+    // Проверка линии.
+    QMap<QString, LinkTuning> m_link_tuning;
+
+    const LinkTuning* currentLinkTuning() const;
+};
+
+#endif // SETTINGS_H
@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Демон записи прошивки с очередью заданий.
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = qmodbus_flashd
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../modbus.pri)
+
+SOURCES += main.cpp \
+    daemonjob.cpp \
+    daemonport.cpp \
+    flashdaemon.cpp
+
+HEADERS += daemonjob.h \
+    daemonport.h \
+    flashdaemon.h
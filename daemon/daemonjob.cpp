@@ -0,0 +1,175 @@
+#include "daemonjob.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include "modbusfirmware.h"
+
+
+#define S(str) QStringLiteral(str)
+
+
+DaemonLink::DaemonLink()
+{
+    baud = 9600;
+    parity = QSerialPort::NoParity;
+    stop_bits = QSerialPort::OneStop;
+    timeout = 500;
+    retries = 3;
+    frame_delay = 0;
+}
+
+bool DaemonLink::operator==(const DaemonLink& other) const
+{
+    return port == other.port && baud == other.baud &&
+           parity == other.parity && stop_bits == other.stop_bits &&
+           timeout == other.timeout && retries == other.retries &&
+           frame_delay == other.frame_delay;
+}
+
+bool DaemonLink::operator!=(const DaemonLink& other) const
+{
+    return !(*this == other);
+}
+
+DaemonJob::DaemonJob()
+{
+    mode = Write;
+    slave = 1;
+    address = ModbusFirmware::flashBase();
+    size = 0;
+    verify = false;
+    verify_all = false;
+    verify_crc = false;
+    run_app = false;
+    flash_baud = 0;
+}
+
+bool DaemonJob::fromJson(const QJsonObject& obj, const QString& files_dir, QString* error)
+{
+    QString cmd = obj.value(S("cmd")).toString();
+
+    if(cmd == S("write")) mode = Write;
+    else if(cmd == S("read")) mode = Read;
+    else if(cmd == S("verify")) mode = Verify;
+    else{
+        *error = S("Unknown command %1").arg(cmd);
+        return false;
+    }
+
+    id = obj.value(S("id")).toString();
+    if(id.isEmpty()){
+        *error = S("Job id is required");
+        return false;
+    }
+
+    link.port = obj.value(S("port")).toString();
+    if(link.port.isEmpty()){
+        *error = S("Port is required");
+        return false;
+    }
+
+    link.baud = static_cast<quint32>(obj.value(S("baud")).toDouble(link.baud));
+    link.timeout = static_cast<quint32>(obj.value(S("timeout")).toDouble(link.timeout));
+    link.retries = static_cast<quint32>(obj.value(S("retries")).toDouble(link.retries));
+    link.frame_delay = static_cast<quint32>(obj.value(S("frame_delay")).toDouble(link.frame_delay));
+
+    QString parity = obj.value(S("parity")).toString(S("none"));
+    if(parity == S("none")) link.parity = QSerialPort::NoParity;
+    else if(parity == S("even")) link.parity = QSerialPort::EvenParity;
+    else if(parity == S("odd")) link.parity = QSerialPort::OddParity;
+    else{
+        *error = S("Invalid parity %1").arg(parity);
+        return false;
+    }
+
+    link.stop_bits = obj.value(S("stop_bits")).toInt(1) == 2 ? QSerialPort::TwoStop : QSerialPort::OneStop;
+
+    slave = obj.value(S("slave")).toInt(slave);
+    address = static_cast<quint32>(obj.value(S("address")).toDouble(address));
+    size = static_cast<quint32>(obj.value(S("size")).toDouble(size));
+    verify = obj.value(S("verify")).toBool(false);
+    verify_all = obj.value(S("verify_all")).toBool(false);
+    verify_crc = obj.value(S("crc")).toBool(false);
+    run_app = obj.value(S("run")).toBool(false);
+    flash_baud = static_cast<quint32>(obj.value(S("flash_baud")).toDouble(0));
+
+    if(link.baud == 0 || slave < 1 || slave > 247){
+        *error = S("Invalid baud rate or slave address");
+        return false;
+    }
+
+    if(mode == Read){
+        QString path = obj.value(S("output")).toString();
+        if(path.isEmpty()){
+            *error = S("Output file is required");
+            return false;
+        }
+        output = resolvePath(files_dir, path);
+        if(output.isEmpty()){
+            *error = S("Output file %1 is outside the files directory").arg(path);
+            return false;
+        }
+        return true;
+    }
+
+    if(obj.contains(S("data"))){
+        image = QByteArray::fromBase64(obj.value(S("data")).toString().toLatin1());
+    }else{
+        QString path = obj.value(S("image")).toString();
+        QString image_path = resolvePath(files_dir, path);
+        if(image_path.isEmpty()){
+            *error = S("Image %1 is outside the files directory").arg(path);
+            return false;
+        }
+
+        QFile file(image_path);
+        if(!file.open(QIODevice::ReadOnly)){
+            *error = S("Can't open image %1").arg(file.fileName());
+            return false;
+        }
+        image = file.readAll();
+    }
+
+    if(image.isEmpty()){
+        *error = S("Empty image");
+        return false;
+    }
+
+    return true;
+}
+
+QString DaemonJob::resolvePath(const QString& base, const QString& path)
+{
+    if(base.isEmpty() || path.isEmpty()) return QString();
+
+    QString base_path = QFileInfo(base).canonicalFilePath();
+    if(base_path.isEmpty()) return QString();
+
+    QFileInfo info(QDir(base_path), path);
+
+    // Несуществующий файл - по каталогу, в котором он будет создан.
+    QString canonical = info.exists() ? info.canonicalFilePath() :
+                                        QFileInfo(info.absolutePath()).canonicalFilePath();
+    if(canonical.isEmpty()) return QString();
+
+    if(!info.exists()) canonical = QDir(canonical).filePath(info.fileName());
+
+    if(!base_path.endsWith(QLatin1Char('/'))) base_path += QLatin1Char('/');
+
+    if(!canonical.startsWith(base_path)) return QString();
+
+    return canonical;
+}
+
+const char* DaemonJob::modeName(Mode mode)
+{
+    switch(mode){
+    default:
+    case Write:
+        return "write";
+    case Read:
+        return "read";
+    case Verify:
+        return "verify";
+    }
+}
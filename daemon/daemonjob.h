@@ -0,0 +1,84 @@
+#ifndef DAEMONJOB_H
+#define DAEMONJOB_H
+
+#include <QString>
+#include <QByteArray>
+#include <QPointer>
+#include <QLocalSocket>
+#include <QSerialPort>
+#include <QJsonObject>
+
+
+// Параметры линии порта.
+struct DaemonLink {
+    DaemonLink();
+
+    bool operator==(const DaemonLink& other) const;
+    bool operator!=(const DaemonLink& other) const;
+
+    QString port;
+    quint32 baud;
+    QSerialPort::Parity parity;
+    QSerialPort::StopBits stop_bits;
+    quint32 timeout; // мс.
+    quint32 retries;
+    quint32 frame_delay; // мкс.
+};
+
+
+// Задание демона.
+struct DaemonJob {
+    DaemonJob();
+
+    enum Mode {
+        Write = 0,
+        Read,
+        Verify
+    };
+
+    // Коды завершения, как у qmodbus_flash.
+    enum Result {
+        Ok = 0,
+        Usage = 1,
+        File = 2,
+        Connect = 3,
+        Config = 4,
+        Transfer = 5,
+        VerifyMismatch = 6,
+        RunApp = 7,
+        Canceled = 8
+    };
+
+    QString id;
+    Mode mode;
+    DaemonLink link;
+    int slave;
+    quint32 address;
+    quint32 size; // Чтение: 0 - до конца памяти.
+    QByteArray image; // Запись и проверка.
+    QString output; // Чтение: файл образа.
+    bool verify; // Проверка после записи.
+    bool verify_all; // Поиск всех расхождений, иначе до первого.
+    bool verify_crc; // Проверка по CRC загрузчика.
+    bool run_app;
+    quint32 flash_baud; // Согласуемая скорость, 0 - нет.
+
+    // Клиент, получающий события задания.
+    QPointer<QLocalSocket> client;
+
+    /*
+     * Разбор команды write/read/verify.
+     * Образ берётся из файла "image" или из base64 "data".
+     * Файлы "image" и "output" допускаются только внутри
+     * каталога files_dir, пустой - доступ к файлам запрещён.
+     * Возвращает ложь и текст ошибки при неверной команде.
+     */
+    bool fromJson(const QJsonObject& obj, const QString& files_dir, QString* error);
+
+    // Путь внутри каталога base после раскрытия ссылок, пустой - вне его.
+    static QString resolvePath(const QString& base, const QString& path);
+
+    static const char* modeName(Mode mode);
+};
+
+#endif // DAEMONJOB_H
@@ -0,0 +1,622 @@
+#include "daemonport.h"
+#include <QModbusRtuSerialMaster>
+#include <QJsonArray>
+#include <QTimer>
+#include <QFile>
+#include "modbusnet.h"
+#include "modbusdev.h"
+#include "modbusfirmware.h"
+#include "modbusrtutransport.h"
+
+
+#define S(str) QStringLiteral(str)
+
+
+DaemonPort::DaemonPort(const QString& port, QObject *parent) : QObject(parent)
+{
+    port_name = port;
+    cur_slave = nullptr;
+    stage = Idle;
+    cancel_pending = false;
+    progress_max = 0;
+    progress_val = 0;
+
+    net = new ModbusNet(this);
+
+    connect(net, &ModbusNet::errorOccured, this, &DaemonPort::netError);
+    connect(net, &ModbusNet::connectedToNet, this, &DaemonPort::connectedToNet);
+    connect(net, &ModbusNet::disconnectedFromNet, this, &DaemonPort::disconnectedFromNet);
+}
+
+DaemonPort::~DaemonPort()
+{
+    net->disconnectFromNet();
+
+    for(Slave* s: slaves){
+        delete s->fw;
+        delete s->dev;
+        delete s;
+    }
+
+    delete net;
+}
+
+const QString& DaemonPort::portName() const
+{
+    return port_name;
+}
+
+bool DaemonPort::isOpen() const
+{
+    return net->isConnectedToNet();
+}
+
+bool DaemonPort::isBusy() const
+{
+    return stage != Idle;
+}
+
+int DaemonPort::queueSize() const
+{
+    return job_queue.size();
+}
+
+bool DaemonPort::hasJob(const QString& id, QLocalSocket* client) const
+{
+    if(isBusy() && cur_job.id == id && cur_job.client == client) return true;
+
+    for(const DaemonJob& job: job_queue){
+        if(job.id == id && job.client == client) return true;
+    }
+
+    return false;
+}
+
+void DaemonPort::enqueue(const DaemonJob& job)
+{
+    job_queue.enqueue(job);
+
+    sendEvent(job, S("queued"), QJsonObject{{S("position"), job_queue.size() - 1 + (isBusy() ? 1 : 0)}});
+
+    if(!isBusy() && job_queue.size() == 1){
+        QTimer::singleShot(0, this, &DaemonPort::next);
+    }
+}
+
+bool DaemonPort::cancel(const QString& id, QLocalSocket* client)
+{
+    for(int i = 0; i < job_queue.size(); i ++){
+        if(job_queue.at(i).id != id || job_queue.at(i).client != client) continue;
+
+        DaemonJob job = job_queue.takeAt(i);
+        sendEvent(job, S("done"), QJsonObject{{S("code"), DaemonJob::Canceled}});
+
+        return true;
+    }
+
+    if(stage == Idle || cur_job.id != id || cur_job.client != client) return false;
+
+    switch(stage){
+    case Writing:
+    case Reading:
+    case Verifying:
+        if(cur_slave->fw->cancel()) return true;
+        break;
+    default:
+        break;
+    }
+
+    // Отмена при переходе к следующему шагу.
+    cancel_pending = true;
+
+    return true;
+}
+
+void DaemonPort::dropClient(QLocalSocket* client)
+{
+    for(int i = job_queue.size() - 1; i >= 0; i --){
+        if(job_queue.at(i).client == client || job_queue.at(i).client.isNull()){
+            job_queue.removeAt(i);
+        }
+    }
+}
+
+bool DaemonPort::close()
+{
+    if(isBusy()) return false;
+
+    net->disconnectFromNet();
+
+    return true;
+}
+
+QJsonObject DaemonPort::toJson() const
+{
+    QJsonObject obj;
+
+    obj[S("port")] = port_name;
+    obj[S("open")] = isOpen();
+    obj[S("baud")] = static_cast<double>(net->baud());
+    obj[S("busy")] = isBusy();
+    obj[S("stage")] = QString::fromLatin1(stageName(stage));
+    obj[S("queue")] = job_queue.size();
+    if(isBusy()) obj[S("job")] = cur_job.id;
+
+    QJsonArray slaves_arr;
+    for(auto it = slaves.constBegin(); it != slaves.constEnd(); ++ it){
+        QJsonObject sl;
+        sl[S("slave")] = it.key();
+        sl[S("conf_valid")] = it.value()->conf_valid;
+        sl[S("flash_kib")] = static_cast<double>(it.value()->fw->flashSize());
+        sl[S("page_size")] = static_cast<double>(it.value()->fw->pageSize());
+        slaves_arr.append(sl);
+    }
+    obj[S("slaves")] = slaves_arr;
+
+    return obj;
+}
+
+void DaemonPort::next()
+{
+    if(isBusy() || job_queue.isEmpty()) return;
+
+    cur_job = job_queue.dequeue();
+    cur_slave = nullptr;
+    cancel_pending = false;
+    stage = Connecting;
+
+    sendEvent(cur_job, S("started"), QJsonObject{{S("port"), port_name}});
+
+    // Порт уже открыт с теми же параметрами - без переподключения.
+    if(net->isConnectedToNet() && cur_link == cur_job.link){
+        runJob();
+        return;
+    }
+
+    if(!openLink(cur_job.link) && stage == Connecting){
+        finishJob(DaemonJob::Connect, S("Can't open port %1").arg(port_name));
+    }
+}
+
+void DaemonPort::netError(ModbusErr error)
+{
+    // Ошибки транзакций приходят и от сообщений.
+    if(stage != Connecting) return;
+
+    finishJob(DaemonJob::Connect, S("Connection fail"), errorJson(error));
+}
+
+void DaemonPort::connectedToNet()
+{
+    if(stage != Connecting) return;
+
+    runJob();
+}
+
+void DaemonPort::disconnectedFromNet()
+{
+    // Устройства могли быть сброшены, пока порт был закрыт.
+    for(Slave* s: slaves) s->conf_valid = false;
+}
+
+bool DaemonPort::openLink(const DaemonLink& link)
+{
+    if(net->transport()) net->disconnectFromNet();
+
+    ModbusRtuTransport* transport = new ModbusRtuTransport();
+    QModbusRtuSerialMaster* rtu = transport->device();
+
+    rtu->setConnectionParameter(QModbusDevice::SerialPortNameParameter, link.port);
+    rtu->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, static_cast<int>(link.baud));
+    rtu->setConnectionParameter(QModbusDevice::SerialParityParameter, link.parity);
+    rtu->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, link.stop_bits);
+    rtu->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, QSerialPort::Data8);
+
+    net->setTransport(transport);
+    net->setBaud(link.baud);
+    net->setLinkParameters(link.timeout, link.retries, link.frame_delay);
+
+    cur_link = link;
+
+    return net->connectToNet();
+}
+
+DaemonPort::Slave* DaemonPort::slave(int addr)
+{
+    Slave* s = slaves.value(addr, nullptr);
+    if(s) return s;
+
+    s = new Slave();
+    s->dev = new ModbusDev(net, addr);
+    s->fw = new ModbusFirmware(s->dev);
+    s->conf_valid = false;
+
+    ModbusFirmware* fw = s->fw;
+
+    connect(fw, &ModbusFirmware::confReaded, this, [this, fw]{ confReaded(fw); });
+    connect(fw, &ModbusFirmware::confReadErrorOccured, this, [this, fw](ModbusErr err){ confReadError(fw, err); });
+    connect(fw, &ModbusFirmware::progressSetMax, this, [this](int val){ progress_max = val; progress_val = 0; });
+    connect(fw, &ModbusFirmware::progressChanged, this, [this, fw](int val){ progressChanged(fw, val); });
+    connect(fw, &ModbusFirmware::estimateChanged, this, [this, fw](double eta, double rate){ estimateChanged(fw, eta, rate); });
+    connect(fw, &ModbusFirmware::dataReaded, this, [this, fw]{ dataReaded(fw); });
+    connect(fw, &ModbusFirmware::dataReadErrorOccured, this, [this, fw](ModbusErr err){ opError(fw, err); });
+    connect(fw, &ModbusFirmware::dataReadCanceled, this, [this, fw]{ opCanceled(fw); });
+    connect(fw, &ModbusFirmware::deltaPlanned, this, [this, fw](int pages, int total){ deltaPlanned(fw, pages, total); });
+    connect(fw, &ModbusFirmware::dataWrited, this, [this, fw]{ dataWrited(fw); });
+    connect(fw, &ModbusFirmware::dataWriteErrorOccured, this, [this, fw](ModbusErr err){ opError(fw, err); });
+    connect(fw, &ModbusFirmware::dataWriteCanceled, this, [this, fw]{ opCanceled(fw); });
+    connect(fw, &ModbusFirmware::dataVerified, this, [this, fw](bool match){ dataVerified(fw, match); });
+    connect(fw, &ModbusFirmware::dataVerifyErrorOccured, this, [this, fw](ModbusErr err){ opError(fw, err); });
+    connect(fw, &ModbusFirmware::dataVerifyCanceled, this, [this, fw]{ opCanceled(fw); });
+    connect(fw, &ModbusFirmware::appRunned, this, [this, fw]{ appRunned(fw); });
+    connect(fw, &ModbusFirmware::appRunErrorOccured, this, [this, fw](ModbusErr err){ appRunError(fw, err); });
+
+    slaves.insert(addr, s);
+
+    return s;
+}
+
+void DaemonPort::runJob()
+{
+    cur_slave = slave(cur_job.slave);
+    cur_slave->fw->setTargetBaud(cur_job.flash_baud);
+
+    // Скорость сети общая для устройств порта: после согласования
+    // с другим устройством сеть возвращается на скорость этого -
+    // согласованную с ним или скорость линии. Конфигурация
+    // перечитывается на ней, при ошибке - на скорости загрузки.
+    quint32 slave_baud = cur_slave->fw->negotiatedBaud() ? cur_slave->fw->negotiatedBaud() : cur_link.baud;
+    if(net->baud() != slave_baud){
+        net->setBaud(slave_baud);
+        cur_slave->conf_valid = false;
+    }
+
+    if(cancel_pending){
+        finishJob(DaemonJob::Canceled, S("Canceled"));
+        return;
+    }
+
+    stage = Config;
+
+    if(cur_slave->conf_valid && cur_slave->fw->isConfReaded()){
+        confReaded(cur_slave->fw);
+        return;
+    }
+
+    cur_slave->fw->confRead();
+}
+
+void DaemonPort::startOp()
+{
+    if(cancel_pending){
+        finishJob(DaemonJob::Canceled, S("Canceled"));
+        return;
+    }
+
+    ModbusFirmware* fw = cur_slave->fw;
+
+    quint32 flash_bytes = fw->flashSize() * 1024;
+    quint32 offset = cur_job.address >= ModbusFirmware::flashBase() ?
+                         cur_job.address - ModbusFirmware::flashBase() : cur_job.address;
+
+    quint32 size = 0;
+
+    switch(cur_job.mode){
+    case DaemonJob::Write:
+    case DaemonJob::Verify:
+        size = static_cast<quint32>(cur_job.image.size());
+        break;
+    case DaemonJob::Read:
+        size = cur_job.size ? cur_job.size : (offset < flash_bytes ? flash_bytes - offset : 0);
+        break;
+    }
+
+    if(size == 0 || offset >= flash_bytes || size > flash_bytes - offset){
+        finishJob(DaemonJob::Usage, S("Range 0x%1 + %2 is out of flash").arg(cur_job.address, 8, 16, QLatin1Char('0')).arg(size));
+        return;
+    }
+
+    switch(cur_job.mode){
+    case DaemonJob::Write:{
+        stage = Writing;
+
+        QJsonObject obj;
+        obj[S("op")] = QString::fromLatin1(stageName(stage));
+        obj[S("address")] = static_cast<double>(cur_job.address);
+        obj[S("size")] = cur_job.image.size();
+        obj[S("predicted_s")] = fw->estimateWrite(cur_job.address, cur_job.image);
+        sendEvent(cur_job, S("begin"), obj);
+
+        if(!fw->writeData(cur_job.address, cur_job.image)){
+            finishJob(DaemonJob::Transfer, S("Write start fail"));
+        }
+    }break;
+    case DaemonJob::Read:
+        startRead(Reading, size);
+        break;
+    case DaemonJob::Verify:
+        startRead(Verifying, size);
+        break;
+    }
+}
+
+void DaemonPort::startRead(Stage st, quint32 size)
+{
+    stage = st;
+
+    ModbusFirmware* fw = cur_slave->fw;
+
+    QJsonObject obj;
+    obj[S("op")] = QString::fromLatin1(stageName(stage));
+    obj[S("address")] = static_cast<double>(cur_job.address);
+    obj[S("size")] = static_cast<double>(size);
+    obj[S("predicted_s")] = fw->estimateRead(cur_job.address, size);
+    sendEvent(cur_job, S("begin"), obj);
+
+    bool res = false;
+
+    if(stage != Verifying){
+        res = fw->readData(cur_job.address, size);
+    }else if(cur_job.verify_crc){
+        res = fw->verifyCrc(cur_job.address, cur_job.image, !cur_job.verify_all);
+    }else{
+        res = fw->verifyData(cur_job.address, cur_job.image, !cur_job.verify_all);
+    }
+
+    if(!res){
+        finishJob(DaemonJob::Transfer, S("Read start fail"));
+    }
+}
+
+void DaemonPort::runApp()
+{
+    stage = Running;
+
+    // После запуска приложения загрузчик нужно будет открыть заново.
+    cur_slave->conf_valid = false;
+
+    sendEvent(cur_job, S("run"));
+
+    if(!cur_slave->fw->runApp()){
+        finishJob(DaemonJob::RunApp, S("Application start fail"));
+    }
+}
+
+void DaemonPort::confReaded(ModbusFirmware* fw)
+{
+    if(!cur_slave || cur_slave->fw != fw || stage != Config) return;
+
+    bool cached = cur_slave->conf_valid;
+    cur_slave->conf_valid = true;
+
+    QJsonObject obj;
+    obj[S("flash_kib")] = static_cast<double>(fw->flashSize());
+    obj[S("page_size")] = static_cast<double>(fw->pageSize());
+    obj[S("baud")] = static_cast<double>(net->baud());
+    obj[S("cached")] = cached || fw->isConfCached();
+    sendEvent(cur_job, S("config"), obj);
+
+    startOp();
+}
+
+void DaemonPort::confReadError(ModbusFirmware* fw, ModbusErr error)
+{
+    if(!cur_slave || cur_slave->fw != fw || stage != Config) return;
+
+    finishJob(DaemonJob::Config, S("Bootloader configuration read fail"), errorJson(error));
+}
+
+void DaemonPort::progressChanged(ModbusFirmware* fw, int val)
+{
+    if(!cur_slave || cur_slave->fw != fw) return;
+
+    progress_val = val;
+}
+
+void DaemonPort::estimateChanged(ModbusFirmware* fw, double eta, double bytes_per_s)
+{
+    if(!cur_slave || cur_slave->fw != fw) return;
+    if(stage != Writing && stage != Reading && stage != Verifying) return;
+
+    QJsonObject obj;
+    obj[S("op")] = QString::fromLatin1(stageName(stage));
+    obj[S("done")] = progress_val;
+    obj[S("total")] = progress_max;
+    obj[S("eta_s")] = eta;
+    obj[S("bytes_per_s")] = bytes_per_s;
+    sendEvent(cur_job, S("progress"), obj);
+}
+
+void DaemonPort::dataReaded(ModbusFirmware* fw)
+{
+    if(!cur_slave || cur_slave->fw != fw) return;
+
+    if(stage == Reading){
+        QFile file(cur_job.output);
+
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+           file.write(fw->data()) != fw->data().size()){
+            finishJob(DaemonJob::File, S("Can't write %1").arg(cur_job.output));
+            return;
+        }
+
+        sendEvent(cur_job, S("saved"), QJsonObject{{S("file"), cur_job.output}, {S("size"), fw->data().size()}});
+
+    }else{
+        return;
+    }
+
+    if(cur_job.run_app){
+        runApp();
+        return;
+    }
+
+    finishJob(DaemonJob::Ok);
+}
+
+void DaemonPort::dataVerified(ModbusFirmware* fw, bool match)
+{
+    if(!cur_slave || cur_slave->fw != fw || stage != Verifying) return;
+
+    if(!match){
+        const QVector<ModbusFirmware::Mismatch>& mismatches = fw->mismatches();
+
+        QJsonArray ranges;
+        for(const ModbusFirmware::Mismatch& m: mismatches){
+            ranges.append(QJsonObject{{S("address"), static_cast<double>(m.address)},
+                                      {S("size"), static_cast<double>(m.size)}});
+        }
+
+        quint32 offset = mismatches.isEmpty() ? 0 : mismatches.first().address - cur_job.address;
+
+        QJsonObject obj;
+        obj[S("address")] = static_cast<double>(cur_job.address + offset);
+        obj[S("offset")] = static_cast<double>(offset);
+        obj[S("ranges")] = ranges;
+        finishJob(DaemonJob::VerifyMismatch, S("Verify mismatch at offset %1").arg(offset), obj);
+        return;
+    }
+
+    sendEvent(cur_job, S("verified"), QJsonObject{{S("size"), cur_job.image.size()}});
+
+    if(cur_job.run_app){
+        runApp();
+        return;
+    }
+
+    finishJob(DaemonJob::Ok);
+}
+
+void DaemonPort::deltaPlanned(ModbusFirmware* fw, int pages, int total)
+{
+    if(!cur_slave || cur_slave->fw != fw || stage != Writing) return;
+
+    QJsonObject obj;
+    obj[S("pages")] = pages;
+    obj[S("total")] = total;
+    sendEvent(cur_job, S("delta"), obj);
+}
+
+void DaemonPort::dataWrited(ModbusFirmware* fw)
+{
+    if(!cur_slave || cur_slave->fw != fw || stage != Writing) return;
+
+    if(cur_job.verify){
+        startRead(Verifying, static_cast<quint32>(cur_job.image.size()));
+        return;
+    }
+
+    if(cur_job.run_app){
+        runApp();
+        return;
+    }
+
+    finishJob(DaemonJob::Ok);
+}
+
+void DaemonPort::opError(ModbusFirmware* fw, ModbusErr error)
+{
+    if(!cur_slave || cur_slave->fw != fw) return;
+
+    finishJob(DaemonJob::Transfer, S("Transfer fail"), errorJson(error));
+}
+
+void DaemonPort::opCanceled(ModbusFirmware* fw)
+{
+    if(!cur_slave || cur_slave->fw != fw) return;
+
+    finishJob(DaemonJob::Canceled, S("Canceled"));
+}
+
+void DaemonPort::appRunned(ModbusFirmware* fw)
+{
+    if(!cur_slave || cur_slave->fw != fw || stage != Running) return;
+
+    finishJob(DaemonJob::Ok);
+}
+
+void DaemonPort::appRunError(ModbusFirmware* fw, ModbusErr error)
+{
+    if(!cur_slave || cur_slave->fw != fw || stage != Running) return;
+
+    finishJob(DaemonJob::RunApp, S("Application start fail"), errorJson(error));
+}
+
+void DaemonPort::finishJob(int code, const QString& message, QJsonObject details)
+{
+    if(stage == Idle) return;
+
+    if(code != DaemonJob::Ok){
+        details[S("stage")] = QString::fromLatin1(stageName(stage));
+        details[S("code")] = code;
+        details[S("message")] = message;
+        sendEvent(cur_job, S("error"), details);
+
+        // Загрузчик мог быть сброшен - конфигурация перечитывается.
+        switch(code){
+        case DaemonJob::Connect:
+        case DaemonJob::Config:
+        case DaemonJob::Transfer:
+        case DaemonJob::RunApp:
+            if(cur_slave) cur_slave->conf_valid = false;
+            break;
+        default:
+            break;
+        }
+    }
+
+    sendEvent(cur_job, S("done"), QJsonObject{{S("code"), code}});
+
+    stage = Idle;
+    cur_slave = nullptr;
+    cancel_pending = false;
+    cur_job = DaemonJob();
+
+    // Следующее задание вне обработчиков сообщений сети.
+    QTimer::singleShot(0, this, &DaemonPort::next);
+}
+
+void DaemonPort::sendEvent(const DaemonJob& job, const QString& name, QJsonObject obj)
+{
+    obj[S("event")] = name;
+    obj[S("id")] = job.id;
+
+    emit jobEvent(job, obj);
+}
+
+const char* DaemonPort::stageName(Stage st)
+{
+    switch(st){
+    default:
+    case Idle:
+        return "idle";
+    case Connecting:
+        return "connect";
+    case Config:
+        return "config";
+    case Writing:
+        return "write";
+    case Reading:
+        return "read";
+    case Verifying:
+        return "verify";
+    case Running:
+        return "run";
+    }
+}
+
+QJsonObject DaemonPort::errorJson(ModbusErr error)
+{
+    QJsonObject obj;
+
+    obj[S("sender")] = error.sanderName();
+    obj[S("error")] = error.errorStr();
+
+    if(error.type() == ModbusErr::Modbus){
+        obj[S("modbus_error")] = static_cast<int>(error.modbusError());
+        obj[S("modbus_exception")] = static_cast<int>(error.modbusException());
+        obj[S("modbus_error_str")] = error.modbusErrorStr();
+    }
+
+    return obj;
+}
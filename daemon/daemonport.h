@@ -0,0 +1,120 @@
+#ifndef DAEMONPORT_H
+#define DAEMONPORT_H
+
+#include <QObject>
+#include <QQueue>
+#include <QMap>
+#include <QJsonObject>
+#include "daemonjob.h"
+#include "modbuserr.h"
+
+class ModbusNet;
+class ModbusDev;
+class ModbusFirmware;
+
+
+/*
+ * Последовательный порт демона с очередью заданий.
+ * Порт остаётся открытым между заданиями, а конфигурация
+ * каждого загрузчика на нём читается один раз и
+ * перечитывается только после ошибки задания.
+ * Задания выполняются строго по очереди.
+ */
+class DaemonPort : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DaemonPort(const QString& port, QObject *parent = 0);
+    ~DaemonPort();
+
+    const QString& portName() const;
+
+    bool isOpen() const;
+    bool isBusy() const;
+    int queueSize() const;
+    // Задание клиента в очереди или выполняется.
+    bool hasJob(const QString& id, QLocalSocket* client) const;
+
+    void enqueue(const DaemonJob& job);
+    // Отмена задания клиента из очереди или текущего.
+    bool cancel(const QString& id, QLocalSocket* client);
+    // Отмена заданий отключившегося клиента из очереди.
+    void dropClient(QLocalSocket* client);
+
+    // Закрытие порта без заданий.
+    bool close();
+
+    QJsonObject toJson() const;
+
+signals:
+    // Событие задания для его клиента.
+    void jobEvent(const DaemonJob& job, QJsonObject event);
+
+private slots:
+    void next();
+
+    void netError(ModbusErr error);
+    void connectedToNet();
+    void disconnectedFromNet();
+
+private:
+    struct Slave {
+        ModbusDev* dev;
+        ModbusFirmware* fw;
+        bool conf_valid;
+    };
+
+    enum Stage {
+        Idle = 0,
+        Connecting,
+        Config,
+        Writing,
+        Reading,
+        Verifying,
+        Running
+    };
+
+    QString port_name;
+    ModbusNet* net;
+    DaemonLink cur_link;
+
+    QQueue<DaemonJob> job_queue;
+    QMap<int, Slave*> slaves;
+
+    DaemonJob cur_job;
+    Slave* cur_slave;
+    Stage stage;
+    bool cancel_pending;
+
+    int progress_max;
+    int progress_val;
+
+    bool openLink(const DaemonLink& link);
+    Slave* slave(int addr);
+
+    void runJob();
+    void startOp();
+    void startRead(Stage st, quint32 size);
+    void runApp();
+
+    void confReaded(ModbusFirmware* fw);
+    void confReadError(ModbusFirmware* fw, ModbusErr error);
+    void progressChanged(ModbusFirmware* fw, int val);
+    void estimateChanged(ModbusFirmware* fw, double eta, double bytes_per_s);
+    void dataReaded(ModbusFirmware* fw);
+    void deltaPlanned(ModbusFirmware* fw, int pages, int total);
+    void dataWrited(ModbusFirmware* fw);
+    void dataVerified(ModbusFirmware* fw, bool match);
+    void opError(ModbusFirmware* fw, ModbusErr error);
+    void opCanceled(ModbusFirmware* fw);
+    void appRunned(ModbusFirmware* fw);
+    void appRunError(ModbusFirmware* fw, ModbusErr error);
+
+    void finishJob(int code, const QString& message = QString(), QJsonObject details = QJsonObject());
+    void sendEvent(const DaemonJob& job, const QString& name, QJsonObject obj = QJsonObject());
+
+    static const char* stageName(Stage st);
+    static QJsonObject errorJson(ModbusErr error);
+};
+
+#endif // DAEMONPORT_H
@@ -0,0 +1,228 @@
+#include "flashdaemon.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include "daemonport.h"
+
+
+#define S(str) QStringLiteral(str)
+
+// Предел длины строки команды (образ в base64).
+#define MAX_LINE_SIZE (16 * 1024 * 1024)
+
+// Ожидание ответа уже запущенного демона, мс.
+#define LISTEN_PROBE_TIMEOUT 500
+
+
+FlashDaemon::FlashDaemon(QObject *parent) : QObject(parent)
+{
+    server = new QLocalServer(this);
+
+    connect(server, &QLocalServer::newConnection, this, &FlashDaemon::newConnection);
+}
+
+FlashDaemon::~FlashDaemon()
+{
+    // Порты закрываются до сокетов клиентов.
+    qDeleteAll(ports);
+    ports.clear();
+}
+
+bool FlashDaemon::listen(const QString& name)
+{
+    listen_error.clear();
+
+    QLocalSocket probe;
+    probe.connectToServer(name);
+
+    if(probe.waitForConnected(LISTEN_PROBE_TIMEOUT)){
+        probe.abort();
+        listen_error = S("Another daemon is listening");
+        return false;
+    }
+
+    // Никто не отвечает - сокет остался от аварийно завершённого демона.
+    QLocalServer::removeServer(name);
+
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    return server->listen(name);
+}
+
+QString FlashDaemon::errorString() const
+{
+    if(!listen_error.isEmpty()) return listen_error;
+
+    return server->errorString();
+}
+
+const QString& FlashDaemon::filesDir() const
+{
+    return files_dir;
+}
+
+void FlashDaemon::setFilesDir(const QString& dir)
+{
+    files_dir = dir;
+}
+
+void FlashDaemon::newConnection()
+{
+    while(QLocalSocket* client = server->nextPendingConnection()){
+        connect(client, &QLocalSocket::readyRead, this, &FlashDaemon::clientReadyRead);
+        connect(client, &QLocalSocket::disconnected, this, &FlashDaemon::clientDisconnected);
+
+        reply(client, QJsonObject{{S("event"), S("hello")}, {S("version"), protocolVersion()}});
+    }
+}
+
+void FlashDaemon::clientReadyRead()
+{
+    QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+
+    while(client->canReadLine()){
+        QByteArray line = client->readLine().trimmed();
+        if(line.isEmpty()) continue;
+
+        QJsonParseError err;
+        QJsonDocument doc = QJsonDocument::fromJson(line, &err);
+
+        if(err.error != QJsonParseError::NoError || !doc.isObject()){
+            replyError(client, QJsonValue(), S("Invalid command: %1").arg(err.errorString()));
+            continue;
+        }
+
+        command(client, doc.object());
+    }
+
+    if(client->bytesAvailable() > MAX_LINE_SIZE){
+        replyError(client, QJsonValue(), S("Command is too long"));
+        client->disconnectFromServer();
+    }
+}
+
+void FlashDaemon::clientDisconnected()
+{
+    QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+    if(!client) return;
+
+    // Текущее задание доводится до конца, ожидающие снимаются.
+    for(DaemonPort* p: ports) p->dropClient(client);
+
+    client->deleteLater();
+}
+
+void FlashDaemon::jobEvent(const DaemonJob& job, QJsonObject event)
+{
+    if(job.client.isNull()) return;
+    if(job.client->state() != QLocalSocket::ConnectedState) return;
+
+    reply(job.client.data(), event);
+}
+
+void FlashDaemon::command(QLocalSocket* client, const QJsonObject& cmd)
+{
+    QString name = cmd.value(S("cmd")).toString();
+    QJsonValue id = cmd.value(S("id"));
+
+    if(name == S("write") || name == S("read") || name == S("verify")){
+        DaemonJob job;
+        QString error;
+
+        if(!job.fromJson(cmd, files_dir, &error)){
+            replyError(client, id, error);
+            return;
+        }
+
+        for(DaemonPort* p: ports){
+            if(p->hasJob(job.id, client)){
+                replyError(client, id, S("Job %1 already exists").arg(job.id));
+                return;
+            }
+        }
+
+        job.client = client;
+        port(job.link.port)->enqueue(job);
+
+    }else if(name == S("cancel")){
+        DaemonPort* job_port = nullptr;
+        for(DaemonPort* p: ports){
+            // Задания других клиентов не видны.
+            if(p->hasJob(id.toString(), client)){
+                job_port = p;
+                break;
+            }
+        }
+
+        if(!job_port){
+            replyError(client, id, S("No such job"));
+            return;
+        }
+
+        // Задание может завершиться внутри cancel() - подтверждение раньше.
+        reply(client, QJsonObject{{S("event"), S("canceling")}, {S("id"), id}});
+
+        job_port->cancel(id.toString(), client);
+
+    }else if(name == S("status")){
+        QJsonArray arr;
+        for(DaemonPort* p: ports) arr.append(p->toJson());
+
+        reply(client, QJsonObject{{S("event"), S("status")}, {S("id"), id}, {S("ports"), arr}});
+
+    }else if(name == S("close")){
+        QString port_name = cmd.value(S("port")).toString();
+        DaemonPort* p = ports.value(port_name, nullptr);
+
+        if(!p){
+            replyError(client, id, S("No such port %1").arg(port_name));
+            return;
+        }
+
+        if(!p->close()){
+            replyError(client, id, S("Port %1 is busy").arg(port_name));
+            return;
+        }
+
+        ports.remove(port_name);
+        p->deleteLater();
+
+        reply(client, QJsonObject{{S("event"), S("closed")}, {S("id"), id}, {S("port"), port_name}});
+
+    }else{
+        replyError(client, id, S("Unknown command %1").arg(name));
+    }
+}
+
+DaemonPort* FlashDaemon::port(const QString& name)
+{
+    DaemonPort* p = ports.value(name, nullptr);
+    if(p) return p;
+
+    p = new DaemonPort(name, this);
+    connect(p, &DaemonPort::jobEvent, this, &FlashDaemon::jobEvent);
+
+    ports.insert(name, p);
+
+    return p;
+}
+
+void FlashDaemon::reply(QLocalSocket* client, const QJsonObject& obj)
+{
+    client->write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    client->write("\n", 1);
+}
+
+void FlashDaemon::replyError(QLocalSocket* client, const QJsonValue& id, const QString& message)
+{
+    QJsonObject obj;
+
+    obj[S("event")] = S("error");
+    if(!id.isUndefined() && !id.isNull()) obj[S("id")] = id;
+    obj[S("code")] = DaemonJob::Usage;
+    obj[S("message")] = message;
+
+    reply(client, obj);
+}
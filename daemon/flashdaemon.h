@@ -0,0 +1,70 @@
+#ifndef FLASHDAEMON_H
+#define FLASHDAEMON_H
+
+#include <QObject>
+#include <QMap>
+#include <QJsonObject>
+#include "daemonjob.h"
+
+class QLocalServer;
+class QLocalSocket;
+class DaemonPort;
+
+
+/*
+ * Демон записи прошивки.
+ * Принимает команды клиентов через локальный сокет
+ * строками компактного JSON (по объекту на строку)
+ * и отвечает так же. Задания ставятся в очередь порта,
+ * события задания отправляются поставившему его клиенту.
+ *
+ * Пути файлов заданий ограничены каталогом filesDir().
+ *
+ * Команды (поле "cmd"):
+ * write, read, verify - задание, см. DaemonJob;
+ * cancel {id} - отмена задания;
+ * status - состояние портов;
+ * close {port} - закрытие простаивающего порта.
+ */
+class FlashDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FlashDaemon(QObject *parent = 0);
+    ~FlashDaemon();
+
+    // Сокет доступен только пользователю демона.
+    // Занятое другим демоном имя не перехватывается.
+    bool listen(const QString& name);
+    QString errorString() const;
+
+    // Каталог файлов образов заданий, пустой - только данные в команде.
+    const QString& filesDir() const;
+    void setFilesDir(const QString& dir);
+
+    static constexpr int protocolVersion()
+    {
+        return 1;
+    }
+
+private slots:
+    void newConnection();
+    void clientReadyRead();
+    void clientDisconnected();
+
+    void jobEvent(const DaemonJob& job, QJsonObject event);
+
+private:
+    QLocalServer* server;
+    QString listen_error;
+    QString files_dir;
+    QMap<QString, DaemonPort*> ports;
+
+    void command(QLocalSocket* client, const QJsonObject& cmd);
+    DaemonPort* port(const QString& name);
+
+    void reply(QLocalSocket* client, const QJsonObject& obj);
+    void replyError(QLocalSocket* client, const QJsonValue& id, const QString& message);
+};
+
+#endif // FLASHDAEMON_H
@@ -0,0 +1,79 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QFileInfo>
+#include "flashdaemon.h"
+#include "modbusquitsignals.h"
+#include "modbusconfcache.h"
+#include "modbusimagecache.h"
+#include "modbuscompat.h"
+
+
+#define S(str) QStringLiteral(str)
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setOrganizationName(S("artem.lab"));
+    a.setApplicationName(S("qmodbus_flashd"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(S("Firmware flashing daemon for the Modbus bootloader.\n"
+                                       "Keeps serial ports open between jobs and accepts\n"
+                                       "newline-delimited JSON commands on a local socket."));
+    parser.addHelpOption();
+
+    QCommandLineOption optSocket(S("socket"), S("Local socket name or path."), S("name"), S("qmodbus_flashd"));
+
+    QCommandLineOption optConfCache(S("conf-cache"), S("Keep bootloader configuration cache in file between runs."), S("file"));
+
+    QCommandLineOption optImageCache(S("image-cache"), S("Last written images cache directory: only changed pages are written."), S("dir"));
+
+    QCommandLineOption optFilesDir(S("files-dir"), S("Directory for job image and output files; without it jobs pass images as data only."), S("dir"));
+
+    parser.addOptions({optSocket, optConfCache, optImageCache, optFilesDir});
+
+    parser.process(a);
+
+    QTextStream err(stderr);
+
+    // Конфигурация загрузчиков переживает переоткрытие портов.
+    ModbusConfCache::get().setEnabled(true);
+    if(parser.isSet(optConfCache)) ModbusConfCache::get().load(parser.value(optConfCache));
+
+    if(parser.isSet(optImageCache)){
+        if(!ModbusImageCache::get().setDirectory(parser.value(optImageCache))){
+            err << "Can't open image cache " << parser.value(optImageCache) << Qt::endl;
+            return 1;
+        }
+        ModbusImageCache::get().setEnabled(true);
+    }
+
+    FlashDaemon daemon;
+
+    if(parser.isSet(optFilesDir)){
+        if(!QFileInfo(parser.value(optFilesDir)).isDir()){
+            err << "No such directory " << parser.value(optFilesDir) << Qt::endl;
+            return 1;
+        }
+        daemon.setFilesDir(parser.value(optFilesDir));
+    }
+
+    if(!daemon.listen(parser.value(optSocket))){
+        err << "Can't listen " << parser.value(optSocket) << ": " << daemon.errorString() << Qt::endl;
+        return 1;
+    }
+
+    ModbusQuitSignals quit_signals;
+    quit_signals.install();
+
+    int res = a.exec();
+
+    if(parser.isSet(optConfCache) && !ModbusConfCache::get().save(parser.value(optConfCache))){
+        err << "Can't save " << parser.value(optConfCache) << Qt::endl;
+    }
+
+    return res;
+}
@@ -0,0 +1,97 @@
+#include "alloccounter.h"
+#include <stddef.h>
+#include <limits.h> // __GLIBC__
+#include <atomic>
+
+
+// Выделения идут из любых потоков процесса.
+static std::atomic<bool> counting(false);
+static std::atomic<quint64> allocs_count(0);
+static std::atomic<quint64> frees_count(0);
+static std::atomic<quint64> bytes_count(0);
+
+
+#ifdef __GLIBC__
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+
+static inline void countAlloc(size_t size)
+{
+    if(!counting.load(std::memory_order_relaxed)) return;
+
+    allocs_count.fetch_add(1, std::memory_order_relaxed);
+    bytes_count.fetch_add(size, std::memory_order_relaxed);
+}
+
+extern "C" void* malloc(size_t size)
+{
+    countAlloc(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t nmemb, size_t size)
+{
+    countAlloc(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    // Перевыделение считается новым выделением.
+    countAlloc(size);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void* ptr)
+{
+    if(ptr && counting.load(std::memory_order_relaxed)){
+        frees_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    __libc_free(ptr);
+}
+
+#endif
+
+
+bool AllocCounter::isAvailable()
+{
+#ifdef __GLIBC__
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocCounter::start()
+{
+    allocs_count.store(0, std::memory_order_relaxed);
+    frees_count.store(0, std::memory_order_relaxed);
+    bytes_count.store(0, std::memory_order_relaxed);
+    counting.store(true, std::memory_order_relaxed);
+}
+
+void AllocCounter::stop()
+{
+    counting.store(false, std::memory_order_relaxed);
+}
+
+quint64 AllocCounter::allocs()
+{
+    return allocs_count.load(std::memory_order_relaxed);
+}
+
+quint64 AllocCounter::frees()
+{
+    return frees_count.load(std::memory_order_relaxed);
+}
+
+quint64 AllocCounter::bytes()
+{
+    return bytes_count.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,27 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+
+/*
+ * Счётчик выделений памяти.
+ * Подменяет malloc/calloc/realloc/free glibc
+ * для всего процесса (включая operator new и Qt).
+ * Считает только между start() и stop().
+ * Без glibc подмены нет и счётчики остаются нулевыми.
+ */
+class AllocCounter
+{
+public:
+    static bool isAvailable();
+
+    static void start();
+    static void stop();
+
+    static quint64 allocs();
+    static quint64 frees();
+    static quint64 bytes();
+};
+
+#endif // ALLOCCOUNTER_H
@@ -0,0 +1,259 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QByteArray>
+#include <QVector>
+#include <QFile>
+#include <QTextStream>
+#include <QModbusRequest>
+#include <QModbusResponse>
+#include "alloccounter.h"
+#include "modbusnet.h"
+#include "modbusdev.h"
+#include "modbusfile.h"
+#include "modbusrecordcodec.h"
+#include "modbusimagecompare.h"
+#include "modbuscrc32.h"
+#include "modbuscompat.h"
+
+
+#define S(str) QStringLiteral(str)
+
+#define REF_TYPE 0x6
+
+
+// Число операций и записей за один проход.
+struct Pass {
+    quint64 ops;
+    quint64 records;
+};
+
+// Не даёт компилятору выбросить результат.
+static volatile quint64 sink = 0;
+
+
+template <typename Func>
+static QJsonObject measure(const QString& name, const QString& unit, int iterations, Func func)
+{
+    // Прогрев.
+    func();
+
+    Pass total = {0, 0};
+
+    QElapsedTimer timer;
+
+    AllocCounter::start();
+    timer.start();
+
+    for(int i = 0; i < iterations; i ++){
+        Pass pass = func();
+        total.ops += pass.ops;
+        total.records += pass.records;
+    }
+
+    qint64 ns = timer.nsecsElapsed();
+    AllocCounter::stop();
+
+    QJsonObject res;
+    res[S("name")] = name;
+    res[S("unit")] = unit;
+    res[S("iterations")] = iterations;
+    res[S("ops")] = static_cast<double>(total.ops);
+    res[S("records")] = static_cast<double>(total.records);
+    res[S("ns_total")] = static_cast<double>(ns);
+    res[S("ns_per_record")] = total.records ? static_cast<double>(ns) / total.records : 0.0;
+    res[S("ns_per_op")] = total.ops ? static_cast<double>(ns) / total.ops : 0.0;
+    if(AllocCounter::isAvailable()){
+        res[S("allocs_per_op")] = total.ops ? static_cast<double>(AllocCounter::allocs()) / total.ops : 0.0;
+        res[S("alloc_bytes_per_op")] = total.ops ? static_cast<double>(AllocCounter::bytes()) / total.ops : 0.0;
+    }
+
+    return res;
+}
+
+static QModbusResponse readResponse(const QModbusRequest& req, const QVector<uint16_t>& recs)
+{
+    // Запрос: byte_count, ref_type, file_num, rec_num, rec_len.
+    QByteArray req_data = req.data();
+
+    uint16_t rec_num = (static_cast<uint8_t>(req_data.at(4)) << 8) | static_cast<uint8_t>(req_data.at(5));
+    uint16_t rec_len = (static_cast<uint8_t>(req_data.at(6)) << 8) | static_cast<uint8_t>(req_data.at(7));
+
+    QByteArray data;
+    data.append(static_cast<char>(rec_len * 2 + 2));
+    data.append(static_cast<char>(rec_len * 2 + 1));
+    data.append(static_cast<char>(REF_TYPE));
+
+    for(uint16_t i = rec_num; i < rec_num + rec_len; i ++){
+        data.append(static_cast<char>(recs[i] >> 8));
+        data.append(static_cast<char>(recs[i] & 0xff));
+    }
+
+    return QModbusResponse(QModbusPdu::ReadFileRecord, data);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setOrganizationName(S("artem.lab"));
+    a.setApplicationName(S("qmodbus_microbench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(S("PDU encode/decode microbenchmarks.\n"
+                                       "Prints one JSON object per benchmark."));
+    parser.addHelpOption();
+
+    QCommandLineOption optRecords(S("records"), S("Records in file region."), S("count"), S("512"));
+    QCommandLineOption optIterations(S("iterations"), S("Passes over the region."), S("count"), S("10000"));
+    QCommandLineOption optOutput(S("output"), S("Write results to file instead of stdout."), S("file"));
+
+    parser.addOptions({optRecords, optIterations, optOutput});
+
+    parser.process(a);
+
+    QTextStream err(stderr);
+
+    int records = parser.value(optRecords).toInt();
+    int iterations = parser.value(optIterations).toInt();
+
+    if(records <= 0 || records > 0xffff || iterations <= 0){
+        err << "Invalid parameters!" << Qt::endl;
+        return 2;
+    }
+
+    QFile out_file;
+
+    if(parser.isSet(optOutput)){
+        out_file.setFileName(parser.value(optOutput));
+        if(!out_file.open(QIODevice::WriteOnly | QIODevice::Truncate)){
+            err << "Can't open " << out_file.fileName() << Qt::endl;
+            return 2;
+        }
+    }else{
+        out_file.open(stdout, QIODevice::WriteOnly);
+    }
+
+    // Транспорт не нужен, сеть даёт только размер PDU.
+    ModbusNet net;
+    ModbusDev dev(&net, 1);
+    ModbusFile file(&dev, 1);
+
+    QByteArray image(records * 2, Qt::Uninitialized);
+    for(int i = 0; i < image.size(); i ++){
+        image[i] = static_cast<char>(i * 7 + 3);
+    }
+
+    ModbusFileRegion rgn(&file, 0, static_cast<uint16_t>(records));
+    rgn.setData(image);
+
+    // Ответы на чтение всего региона.
+    QVector<QModbusResponse> responses;
+    {
+        ModbusFile::RegionOp op(&dev, &rgn, ModbusFile::RegionOp::Read);
+        do{
+            op.iterNext();
+            responses.append(readResponse(op.modbusRequest(), rgn.records()));
+        }while(!op.done());
+    }
+
+    QVector<QJsonObject> results;
+
+    results.append(measure(S("read_request"), S("pdu"), iterations, [&]{
+        Pass pass = {0, static_cast<quint64>(records)};
+        ModbusFile::RegionOp op(&dev, &rgn, ModbusFile::RegionOp::Read);
+        do{
+            op.iterNext();
+            sink += op.modbusRequest().size();
+            pass.ops ++;
+        }while(!op.done());
+        return pass;
+    }));
+
+    results.append(measure(S("write_request"), S("pdu"), iterations, [&]{
+        Pass pass = {0, static_cast<quint64>(records)};
+        ModbusFile::RegionOp op(&dev, &rgn, ModbusFile::RegionOp::Write);
+        do{
+            op.iterNext();
+            sink += op.modbusRequest().size();
+            pass.ops ++;
+        }while(!op.done());
+        return pass;
+    }));
+
+    results.append(measure(S("iter_store_data"), S("pdu"), iterations, [&]{
+        Pass pass = {0, static_cast<quint64>(records)};
+        ModbusFile::RegionOp op(&dev, &rgn, ModbusFile::RegionOp::Read);
+        for(const QModbusResponse& resp: responses){
+            op.iterNext();
+            sink += op.iterStoreData(resp);
+            pass.ops ++;
+        }
+        return pass;
+    }));
+
+    results.append(measure(S("region_data"), S("call"), iterations, [&]{
+        Pass pass = {1, static_cast<quint64>(records)};
+        sink += rgn.data().size();
+        return pass;
+    }));
+
+    results.append(measure(S("region_set_data"), S("call"), iterations, [&]{
+        Pass pass = {1, static_cast<quint64>(records)};
+        rgn.setData(image);
+        sink += rgn.recordsCount();
+        return pass;
+    }));
+
+    // Проверка прошивки: совпадающая страница и расхождение в конце.
+    QByteArray page_copy = image;
+    page_copy[page_copy.size() - 1] = static_cast<char>(~page_copy.at(page_copy.size() - 1));
+
+    results.append(measure(S("compare_page"), S("call"), iterations, [&]{
+        Pass pass = {1, static_cast<quint64>(records)};
+        sink += ModbusImageCompare::firstMismatch(image.constData(), page_copy.constData(), image.size());
+        return pass;
+    }));
+
+    results.append(measure(S("compare_page_scalar"), S("call"), iterations, [&]{
+        Pass pass = {1, static_cast<quint64>(records)};
+        sink += ModbusImageCompare::firstMismatchScalar(image.constData(), page_copy.constData(), image.size());
+        return pass;
+    }));
+
+    results.append(measure(S("crc32_page"), S("call"), iterations, [&]{
+        Pass pass = {1, static_cast<quint64>(records)};
+        sink += ModbusCrc32::calc(image.constData(), image.size());
+        return pass;
+    }));
+
+    results.append(measure(S("crc32_page_scalar"), S("call"), iterations, [&]{
+        Pass pass = {1, static_cast<quint64>(records)};
+        sink += ModbusCrc32::updateScalar(0, image.constData(), image.size());
+        return pass;
+    }));
+
+    bool valid = rgn.data() == image &&
+                 ModbusCrc32::calc(image.constData(), image.size()) ==
+                 ModbusCrc32::updateScalar(0, image.constData(), image.size()) &&
+                 ModbusImageCompare::firstMismatch(image.constData(), page_copy.constData(), image.size()) ==
+                 ModbusImageCompare::firstMismatchScalar(image.constData(), page_copy.constData(), image.size());
+
+    for(QJsonObject& res: results){
+        res[S("region_records")] = records;
+        res[S("codec")] = QString::fromLatin1(ModbusRecordCodec::implementation());
+        res[S("compare")] = QString::fromLatin1(ModbusImageCompare::implementation());
+        res[S("crc32")] = QString::fromLatin1(ModbusCrc32::implementation());
+        out_file.write(QJsonDocument(res).toJson(QJsonDocument::Compact));
+        out_file.write("\n");
+    }
+
+    if(!valid){
+        err << "Region data, compare or CRC mismatch!" << Qt::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Микротесты кодирования/декодирования PDU.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = qmodbus_microbench
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../modbus.pri)
+
+SOURCES += main.cpp \
+    alloccounter.cpp
+
+HEADERS += alloccounter.h
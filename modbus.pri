@@ -0,0 +1,15 @@
+# Подключение библиотеки Modbus (core/) к приложению и утилитам.
+
+QT       += core concurrent serialbus serialport
+
+INCLUDEPATH += $$PWD/core
+DEPENDPATH += $$PWD/core
+
+MODBUS_CORE_DIR = $$shadowed($$PWD/core)
+win32:CONFIG(release, debug|release): MODBUS_CORE_DIR = $$MODBUS_CORE_DIR/release
+else:win32:CONFIG(debug, debug|release): MODBUS_CORE_DIR = $$MODBUS_CORE_DIR/debug
+
+LIBS += -L$$MODBUS_CORE_DIR -lqmodbus_core
+
+win32-msvc*: PRE_TARGETDEPS += $$MODBUS_CORE_DIR/qmodbus_core.lib
+else: PRE_TARGETDEPS += $$MODBUS_CORE_DIR/libqmodbus_core.a